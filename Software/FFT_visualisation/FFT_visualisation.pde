@@ -22,10 +22,9 @@ int speed_cutoff = 0;
 int step;
 
 int[] num = new int[512];
-byte[] inBuffer = new byte[16];
+float[] nums = new float[0];
 int mic_gain;
 int max_freq_Index;
-int peak_int;
 float peak;
 float min_fft = 0;
 float max_fft = 0;
@@ -34,6 +33,106 @@ boolean axis_drawn = false;
 boolean iq_graph = true;
 float axis_start;
 
+// spectrum frames of the sensor, see sensor/SerialFormat.h
+final int SYNC_0 = 0xA5;
+final int SYNC_1 = 0xD2;
+final int FRAME_VERSION = 2;
+final int HEADER_SIZE = 22;
+final int CRC_SIZE = 4;
+final int PAYLOAD_FLOAT32 = 1;
+final int PAYLOAD_QUANTIZED8 = 2;
+byte[] rx = new byte[65536];
+int rxFill = 0;
+int lastSequence = -1;
+int lostFrames = 0;
+
+int rxByte(int i) {
+  return rx[i] & 0xFF;
+}
+
+int rxInt(int i, int size) {
+  int value = 0;
+  for(int b = size - 1; b >= 0; b--){
+    value = (value << 8) | rxByte(i + b);
+  }
+  return value;
+}
+
+void rxConsume(int count) {
+  System.arraycopy(rx, count, rx, 0, rxFill - count);
+  rxFill -= count;
+}
+
+// reads what has arrived; true if a complete frame was decoded into the globals. Text and broken frames are skipped.
+boolean readFrame() {
+  while(myPort.available() > 0 && rxFill < rx.length){
+    rx[rxFill++] = (byte)myPort.read();
+  }
+
+  while(true){
+    int start = 0;
+    while(start + 1 < rxFill && !(rxByte(start) == SYNC_0 && rxByte(start + 1) == SYNC_1)){
+      start++;
+    }
+    rxConsume(start);
+    if(rxFill < HEADER_SIZE){
+      return false;
+    }
+
+    int type = rxByte(3);
+    int payloadSize = rxInt(7, 2);
+    int binCount = rxInt(20, 2);
+    boolean valid = rxByte(2) == FRAME_VERSION && binCount <= 2048 && payloadSize <= 4 * 2048;
+    if(!valid){
+      rxConsume(1);
+      continue;
+    }
+    int frameSize = HEADER_SIZE + payloadSize;
+    if(rxFill < frameSize + CRC_SIZE){
+      return false;
+    }
+
+    java.util.zip.CRC32 crc = new java.util.zip.CRC32();
+    crc.update(rx, 2, frameSize - 2);
+    if((int)crc.getValue() != rxInt(frameSize, 4)){
+      println("dropped a corrupted frame");
+      rxConsume(1);
+      continue;
+    }
+
+    int sequence = rxInt(5, 2);
+    if(lastSequence >= 0 && sequence != ((lastSequence + 1) & 0xFFFF)){
+      lostFrames += (sequence - lastSequence - 1) & 0xFFFF;
+      println("lost frames: " + lostFrames);
+    }
+    lastSequence = sequence;
+
+    boolean known = (type == PAYLOAD_FLOAT32 && payloadSize == 4 * binCount)
+                    || (type == PAYLOAD_QUANTIZED8 && payloadSize == binCount);
+    if(!known){
+      println("unsupported payload type " + type + ", set serialPayload to Float32 or Quantized8");
+      rxConsume(frameSize + CRC_SIZE);
+      continue;
+    }
+
+    mic_gain = (byte)rxByte(13);
+    max_freq_Index = rxInt(14, 2);
+    peak = Float.intBitsToFloat(rxInt(16, 4));
+    num_fft_bins = binCount;
+    nums = new float[num_fft_bins];
+    for(int i = 0; i < num_fft_bins; i++){
+      if(type == PAYLOAD_FLOAT32){
+        nums[i] = Float.intBitsToFloat(rxInt(HEADER_SIZE + 4 * i, 4));
+      }else{
+        nums[i] = -20 + 0.5 * rxByte(HEADER_SIZE + i);
+      }
+    }
+
+    rxConsume(frameSize + CRC_SIZE);
+    return true;
+  }
+}
+
 float log10 (float x) {
   return (log(x) / log(10));
 }
@@ -156,44 +255,22 @@ void draw () {
   //================== read data from serial =============================
   
   oldspeed = speed;
-  myPort.clear();
   myPort.write("d");
-  
-  while(myPort.available()<9){
+
+  // wait for the frame, ask again if it got lost on the way
+  int waited = 0;
+  while(!readFrame()){
     delay(1);
+    if(++waited > 1000){
+      myPort.write("d");
+      waited = 0;
+    }
   }
-
-  //print("mic_gain:");
-  mic_gain = (myPort.read());
-  //print(mic_gain);
-  
-  //print(", max_freq_index:");
-  max_freq_Index = (myPort.read()) + (myPort.read()<<8);
   speed = max_freq_Index;
-  //print(max_freq_Index);
-  
-  //print(", peak:");
-  peak_int = myPort.read() + (myPort.read()<<8) + (myPort.read()<<16) + (myPort.read()<<24);
-  peak = Float.intBitsToFloat(peak_int);
-  //print(round(peak*100)/100.0);
-  
-  //print(", numfft:");
-  num_fft_bins = (myPort.read()) + (myPort.read()<<8);
-  //print(num_fft_bins);
-  
-  int[] nums_int = new int[num_fft_bins];
-  float[] nums = new float[num_fft_bins];
 
   for(int i = 0; i < num_fft_bins; i++){
-      //print(",");
-      while(myPort.available()<4){
-        delay(1);
-      }
-      nums_int[i] = myPort.read() + (myPort.read()<<8) + (myPort.read()<<16) + (myPort.read()<<24);
-      nums[i] = Float.intBitsToFloat(nums_int[i]);
       min_fft = min(min_fft, nums[i]);
       max_fft = max(max_fft, nums[i]);
-      //print(nums[i]);
   }
   
   //print(",min:");
@@ -0,0 +1,61 @@
+#ifndef AUDIOBLOCKPOOL_H
+#define AUDIOBLOCKPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Size of the block pool of the 32 bit audio library (AudioMemory_F32), derived from the audio graph instead of
+ * guessed.
+ *
+ * Every audio cycle (AUDIO_BLOCK_SAMPLES samples) the blocks in use are:
+ *  - the I2S input: per channel one block being filled by the DMA and one handed to the graph
+ *  - one block per stage that writes its own output (gain, mixer); stages that only read (peak) take none
+ *  - the I2S output: per channel the block being played and the next one
+ *  - blocks analysers keep across cycles; the library FFT analysers keep a whole FFT window per channel, IqFft
+ *    copies the samples into its own window and releases the blocks in the same cycle, so FFT width, overlap and IQ
+ *    mode do not count for it
+ *
+ * The model is the steady state; a margin on top covers the blocks of a cycle whose update is late. The live use is
+ * reported by AudioSystem (getBlocksInUse, getBlocksMaxInUse); if the high-water mark comes close to the pool size the
+ * margin is too small, a missing block shows as dropped audio block in $counters.
+ */
+namespace AudioBlockPool
+{
+constexpr size_t blockSamples = 128; // AUDIO_BLOCK_SAMPLES
+// audio_block_f32_t: the samples plus reference count, pool index, length, sample rate and id
+constexpr size_t floatBlockBytes = blockSamples * 4 + 20;
+// audio_block_t of the 16 bit library (CITRAD_FIXED_POINT): the samples plus reference count and pool index
+constexpr size_t int16BlockBytes = blockSamples * 2 + 4;
+constexpr uint16_t maxBlocks = 192; // the allocation mask of the 32 bit pool covers 192 blocks, more are not used
+
+struct Graph
+{
+    uint8_t inputChannels;  // I2S input
+    uint8_t writingStages;  // stages that allocate a block for their output
+    uint8_t outputChannels; // I2S output (headphone), 0 if not connected
+    uint16_t keptSamples;   // samples analysers keep across cycles, over all channels
+};
+
+/// blocks in use in the steady state of the graph
+constexpr uint16_t requiredBlocks(Graph const& graph)
+{
+    return uint16_t(
+        2 * graph.inputChannels + graph.writingStages + 2 * graph.outputChannels +
+        (graph.keptSamples + blockSamples - 1) / blockSamples);
+}
+
+/// the pool for AudioMemory_F32 (AudioMemory in the fixed point graph): the required blocks and margin on top, at
+/// most maxBlocks
+constexpr uint16_t poolBlocks(Graph const& graph, uint16_t margin)
+{
+    return requiredBlocks(graph) + margin < maxBlocks ? uint16_t(requiredBlocks(graph) + margin) : maxBlocks;
+}
+
+constexpr size_t poolBytes(uint16_t blocks, size_t blockBytes)
+{
+    return blocks * blockBytes;
+}
+} // namespace AudioBlockPool
+
+#endif
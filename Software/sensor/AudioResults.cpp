@@ -0,0 +1,147 @@
+#include "AudioResults.h"
+
+#include "FastLog.h"
+
+template <class Layout>
+void AudioResults<Layout>::process(
+    float const* data,
+    NoiseFloorEstimator<Layout>& noiseFloor,
+    float noiseFloorDistanceThreshold,
+    GhostSuppression<Layout>* ghostSuppression)
+{
+    analyse<false>(data + minBinIndex, noiseFloor, noiseFloorDistanceThreshold, ghostSuppression);
+}
+
+template <class Layout>
+void AudioResults<Layout>::processPower(
+    float const* power,
+    NoiseFloorEstimator<Layout>& noiseFloor,
+    float noiseFloorDistanceThreshold,
+    GhostSuppression<Layout>* ghostSuppression)
+{
+    // the bins outside of the analysed range are never needed in dB
+    FastLog::powerToDb(power + minBinIndex, spectrum, numberOfFftBins);
+    analyse<true>(spectrum, noiseFloor, noiseFloorDistanceThreshold, ghostSuppression);
+}
+
+template <class Layout>
+template <bool PowerMean>
+void AudioResults<Layout>::analyse(
+    float const* values,
+    NoiseFloorEstimator<Layout>& noiseFloor,
+    float noiseFloorDistanceThreshold,
+    GhostSuppression<Layout>* ghostSuppression)
+{
+    // detect highest frequency
+    amplitudeMax = -9999.0;
+    amplitudeMaxReverse = -9999.0;
+    max_freq_Index = 0;
+    max_freq_Index_reverse = 0;
+    mean_amplitude = 0.0;
+    mean_amplitude_reverse = 0.0;
+    pedestrian_amplitude = 0.0;
+    bins_with_signal = 0;
+    bins_with_signal_reverse = 0;
+
+    // the bins without ghosts go to noise_floor_distance first, which is overwritten bin by bin below
+    float const* cleaned = values;
+    if(ghostSuppression)
+    {
+        ghostSuppression->apply(values, noise_floor_distance, noiseFloor);
+        cleaned = noise_floor_distance;
+    }
+
+    // copy, noise floor distance and update and pedestrian sum in one pass over the spectrum; the loop body only
+    // touches the current bin so the M7 can keep loads, FPU and stores busy without waiting on earlier bins
+    for(size_t i = 0; i < numberOfFftBins; i++)
+    {
+        float const value = cleaned[i];
+        spectrum[i] = values[i];
+        noise_floor_distance[i] = noiseFloor.update(i, value, noiseFloorDistanceThreshold);
+
+        // detect pedestrian
+        if(i >= Layout::pedestrianBegin - minBinIndex && i < Layout::pedestrianEnd - minBinIndex)
+            pedestrian_amplitude = pedestrian_amplitude + value;
+    }
+    pedestrian_amplitude = pedestrian_amplitude / max_pedestrian_bin;
+    noiseFloor.finishFrame();
+
+    // the detection only walks the analysed range; the mirrored bin fftWidth - i is read through a descending pointer.
+    // Without IQ there is no reverse direction and the reverse metrics stay 0.
+    float const* forward = noise_floor_distance + (Layout::detectionBegin - minBinIndex);
+    float const* mirror = noise_floor_distance;
+    if(Layout::iqMeasurement)
+        mirror += Layout::fftWidth - Layout::detectionBegin - minBinIndex;
+    for(size_t i = Layout::detectionBegin; i < maxBinIndex; i++, forward++)
+    {
+        float const value = *forward;
+        float reverse = -9999.0;
+        if(Layout::iqMeasurement)
+            reverse = *mirror--;
+
+        // the mean of dB values is not the level of the mean power, a few strong bins count for less than they carry
+        mean_amplitude = mean_amplitude + (PowerMean ? FastLog::dbToPower(value) : value);
+        if(value > noiseFloorDistanceThreshold)
+            bins_with_signal++;
+
+        if(Layout::iqMeasurement)
+            mean_amplitude_reverse = mean_amplitude_reverse + (PowerMean ? FastLog::dbToPower(reverse) : reverse);
+        if(reverse > noiseFloorDistanceThreshold)
+            bins_with_signal_reverse++;
+
+        // with forward > reverse make shure that the signal is in the right direction
+        if(value > reverse && value > amplitudeMax)
+        {
+            amplitudeMax = value; // remember highest amplitude
+            max_freq_Index = i;   // remember frequency index
+        }
+        if(reverse > value && reverse > amplitudeMaxReverse)
+        {
+            amplitudeMaxReverse = reverse; // remember highest amplitude
+            max_freq_Index_reverse = i;    // remember frequency index
+        }
+    }
+
+    // multiple targets: the strongest separate peaks of each direction with their sub-bin position
+    peak_count = Tracking::findPeaks(
+        noise_floor_distance + (Layout::pedestrianBegin - minBinIndex),
+        1,
+        peakSearchBins,
+        noiseFloorDistanceThreshold,
+        peakSeparation,
+        peaks,
+        Tracking::maxPeaks);
+    peak_count_reverse = 0;
+    if(Layout::iqMeasurement)
+        peak_count_reverse = Tracking::findPeaks(
+            noise_floor_distance + (2 * Layout::iqOffset - Layout::pedestrianBegin - minBinIndex),
+            -1,
+            peakSearchBins,
+            noiseFloorDistanceThreshold,
+            peakSeparation,
+            peaks_reverse,
+            Tracking::maxPeaks);
+
+    detected_speed = (max_freq_Index - Layout::iqOffset) * Layout::speedConversion;
+    detected_speed_reverse = (max_freq_Index_reverse - Layout::iqOffset) * Layout::speedConversion;
+
+    constexpr float detectionBinCount = maxBinIndex - Layout::detectionBegin;
+    mean_amplitude = mean_amplitude / detectionBinCount;
+    mean_amplitude_reverse = mean_amplitude_reverse / detectionBinCount;
+    if(PowerMean)
+    {
+        mean_amplitude = FastLog::powerToDb(mean_amplitude);
+        if(Layout::iqMeasurement)
+            mean_amplitude_reverse = FastLog::powerToDb(mean_amplitude_reverse);
+    }
+}
+
+// every supported layout is built, so a combination that does not compile shows up in any build
+template struct AudioResults<SpectrumLayout<256, false>>;
+template struct AudioResults<SpectrumLayout<256, true>>;
+template struct AudioResults<SpectrumLayout<512, false>>;
+template struct AudioResults<SpectrumLayout<512, true>>;
+template struct AudioResults<SpectrumLayout<1024, false>>;
+template struct AudioResults<SpectrumLayout<1024, true>>;
+template struct AudioResults<SpectrumLayout<2048, false>>;
+template struct AudioResults<SpectrumLayout<2048, true>>;
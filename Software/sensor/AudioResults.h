@@ -0,0 +1,103 @@
+#ifndef AUDIORESULTS_H
+#define AUDIORESULTS_H
+
+#include "FrameClock.h"
+#include "GhostSuppression.h"
+#include "SpectrumLayout.h"
+#include "Tracking.h"
+#include "noise_floor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// spectrum and detection metrics of one FFT frame; the arrays only hold the analysed bins of the layout
+template <class Layout>
+struct AudioResults
+{
+    static constexpr uint16_t numberOfFftBins = Layout::numberOfFftBins;
+    static constexpr uint16_t maxBinIndex = Layout::maxBinIndex;
+    static constexpr uint16_t minBinIndex = Layout::minBinIndex;
+    static constexpr uint16_t max_pedestrian_bin = Layout::maxPedestrianBin;
+
+    // peaks are searched from Layout::pedestrianBegin up, both directions the same distance from iqOffset
+    static constexpr uint16_t peakSearchBins = maxBinIndex - Layout::pedestrianBegin;
+    static constexpr size_t peakSeparation = // bins of 2 m/s
+        2.0f / Layout::speedConversion > 1 ? size_t(2.0f / Layout::speedConversion) : 1;
+
+    // spectrum, index 0 is FFT bin minBinIndex
+
+    float noise_floor_distance[numberOfFftBins];
+    float spectrum[numberOfFftBins]; // spectral data
+
+    float amplitudeMax;        // highest signal in spectrum
+    float amplitudeMaxReverse; // highest signal in spectrum reverse direction
+
+    uint16_t max_freq_Index;         // FFT bin of highest signal in spectrum
+    uint16_t max_freq_Index_reverse; // FFT bin of highest signal in spectrum reverse direction
+
+    float pedestrian_amplitude;   // used to detect the presence of a pedestrians
+    float detected_speed;         // speed in m/s based on peak frequency
+    float detected_speed_reverse; // speed in m/s based on peak frequency reverse direction
+
+    // mean distance to the noise floor used to detect cars passing by the sensor: the mean of the dB distances with
+    // process(), the mean power over the noise floor in dB with processPower()
+    float mean_amplitude;
+    float mean_amplitude_reverse;
+
+    uint8_t bins_with_signal; // how many bins have signal over the noise threshold?
+    uint8_t bins_with_signal_reverse;
+
+    unsigned long timestamp;      // ms of how long the sensor has been running
+    uint64_t sequence;            // sample clock of the spectrum in hops, see FrameClock.h
+    FrameClock::Time captureTime; // RTC time at which the spectrum was complete
+
+    // strongest peaks per direction (see Tracking::findPeaks), bin counts from Layout::pedestrianBegin
+    Tracking::Peak peaks[Tracking::maxPeaks];
+    Tracking::Peak peaks_reverse[Tracking::maxPeaks];
+    uint8_t peak_count;
+    uint8_t peak_count_reverse;
+
+    static float peakSpeed(Tracking::Peak const& peak)
+    {
+        return (Layout::pedestrianBegin - Layout::iqOffset + peak.bin) * Layout::speedConversion;
+    }
+
+    /// the peaks of one direction in m/s for Tracking::Tracker; out has to hold Tracking::maxPeaks entries
+    size_t detections(bool reverse, Tracking::Detection* out) const
+    {
+        size_t const count = reverse ? peak_count_reverse : peak_count;
+        for(size_t i = 0; i < count; i++)
+        {
+            Tracking::Peak const& peak = reverse ? peaks_reverse[i] : peaks[i];
+            out[i].speed = peakSpeed(peak);
+            out[i].strength = peak.strength;
+        }
+        return count;
+    }
+
+    /// data is the complete FFT output (Layout::fftWidth bins) in dBFS. With ghostSuppression the mirrored ghosts are
+    /// removed before the noise floor and the detection see the bins; spectrum keeps them, it is what is recorded.
+    void process(
+        float const* data,
+        NoiseFloorEstimator<Layout>& noiseFloor,
+        float noiseFloorDistanceThreshold,
+        GhostSuppression<Layout>* ghostSuppression = nullptr);
+    /// power is the complete FFT output in linear power (FftOutput::Power); only the analysed bins are converted to
+    /// dBFS, with FastLog.h
+    void processPower(
+        float const* power,
+        NoiseFloorEstimator<Layout>& noiseFloor,
+        float noiseFloorDistanceThreshold,
+        GhostSuppression<Layout>* ghostSuppression = nullptr);
+
+  private:
+    /// the analysis of the dBFS values of the analysed bins; PowerMean averages the distances as linear power
+    template <bool PowerMean>
+    void analyse(
+        float const* values,
+        NoiseFloorEstimator<Layout>& noiseFloor,
+        float noiseFloorDistanceThreshold,
+        GhostSuppression<Layout>* ghostSuppression);
+};
+
+#endif
@@ -5,84 +5,152 @@
 #include <AudioStream_F32.h>
 #include <OpenAudio_ArduinoLibrary.h>
 
-class AudioSystem
+#include "AudioBlockPool.h"
+#include "AudioResults.h"
+#include "GhostSuppression.h"
+#include "IqFft.h"
+#include "SpectrumLayout.h"
+#include "noise_floor.h"
+
+#ifndef CITRAD_FIXED_POINT
+// 1: the 16 bit blocks of the Teensy audio library, IQ correction and FFT in fixed point (IqFftFixed.h)
+#define CITRAD_FIXED_POINT 0
+#endif
+
+#if defined(__IMXRT1062__)
+#include "IqFftAnalyzer.h"
+
+#if CITRAD_FIXED_POINT
+template <uint16_t FftWidth>
+using IqFftAnalyzer = AudioAnalyzeIqFft_I16<FftWidth>;
+#else
+template <uint16_t FftWidth>
+using IqFftAnalyzer = AudioAnalyzeIqFft_F32<FftWidth>;
+#endif
+#else
+// the host stand-in (host/) yields recorded spectra instead of transforming samples
+template <uint16_t FftWidth>
+using IqFftAnalyzer = HostFft<FftWidth>;
+#endif
+
+/// select the layout with -DCITRAD_FFT_WIDTH, -DCITRAD_FFT_OVERLAP and -DCITRAD_IQ_MEASUREMENT, see SpectrumLayout.h,
+/// and the fixed point graph with -DCITRAD_FIXED_POINT=1
+template <class LayoutT>
+class BasicAudioSystem
 {
   public:
+    using Layout = LayoutT;
+    using Results = AudioResults<Layout>;
+    using NoiseFloor = NoiseFloorEstimator<Layout>;
+    using Ghosts = GhostSuppression<Layout>;
+
     struct Config
     {
-        const unsigned int fftWidth = 1024;
+        static constexpr unsigned int fftWidth = Layout::fftWidth;
 
-        const uint16_t sample_rate = 12000;             // Hz; sample rate of data acquisition
+        static constexpr uint16_t sample_rate = Layout::sampleRate; // Hz; sample rate of data acquisition
         const uint8_t audio_input = AUDIO_INPUT_LINEIN; // AUDIO_INPUT_LINEIN or AUDIO_INPUT_MIC
         const uint8_t linein_level = 15;                // only relevant if AUDIO_INPUT_LINEIN is used
-        const bool iq_measurement = true;               // measure in both directions?
+        static constexpr bool iq_measurement = Layout::iqMeasurement; // measure in both directions?
+
+        // audio blocks on top of the ones the graph needs (see AudioBlockPool.h); raise it if the high-water mark of
+        // $memory comes close to the pool size
+        static constexpr uint16_t audio_block_margin = 8;
+
+        const FftWindow fft_window = FftWindow::Hann; // the static noise floor table is measured with Hann
+        // the FFT hands over linear power, only the analysed bins are converted to dB (FastLog.h) and mean_amplitude
+        // is the mean power over the noise floor instead of the mean dB distance (see AudioResults::processPower)
+        const bool linear_power = false;
 
         const float noise_floor_distance_threshold = 8; // dB; distance of "proper signal" to noise floor
+        // weight of a frame in the noise floor, the same time constant for every overlap; 0 keeps the static one
+        const float noise_floor_adapt_rate = 1.0 / (1000 * Layout::fftOverlap);
+        // a bin that stays above the threshold this long is a louder site, not a passage: the floor rises by up to
+        // noise_floor_max_rise dB/s there (see NoiseFloorEstimator); 0 dB/s only lets the floor follow the quiet bins
+        const float noise_floor_rise_after = 30; // s
+        const float noise_floor_max_rise = 0.5;  // dB/s
         float mic_gain = 1.0;                           // only relevant if AUDIO_INPUT_MIC is used
 
+        // IQ mode: the mirrored ghost of each target is removed before the detection (see GhostSuppression.h), at
+        // first ghost_ratio dB under its target, with ghost_adaptive estimated from the strong targets of the site
+        const bool ghost_suppression = true;
+        const float ghost_ratio = -25;
+        const bool ghost_adaptive = true;
+
         // IQ calibration
         bool hasChanges = false;
         float alpha = 1.10;
         float psi = -0.04;
-
-        Config& operator=(Config const& other);
-    };
-
-    struct Results
-    {
-        // spectrum
-
-        float noise_floor_distance[1024];
-        float spectrum[1024];                // spectral data
-        float spectrum_smoothed[1024] = {0}; // smoothed spectral data for noise floor
-
-        float amplitudeMax;        // highest signal in spectrum
-        float amplitudeMaxReverse; // highest signal in spectrum reverse direction
-
-        uint16_t max_freq_Index;         // index of highest signal in spectrum
-        uint16_t max_freq_Index_reverse; // index of highest signal in spectrum reverse direction
-
-        uint16_t max_pedestrian_bin;
-        float pedestrian_amplitude;   // used to detect the presence of a pedestrians
-        float detected_speed;         // speed in m/s based on peak frequency
-        float detected_speed_reverse; // speed in m/s based on peak frequency reverse direction
-
-        float mean_amplitude; // mean amplitude in spectrum used to detect cars passing by the sensor
-        float mean_amplitude_reverse;
-
-        uint8_t bins_with_signal; // how many bins have signal over the noise threshold?
-        uint8_t bins_with_signal_reverse;
-
-        uint16_t numberOfFftBins;
-        uint16_t maxBinIndex;
-        uint16_t minBinIndex;
-
-        unsigned long timestamp; // ms of how long the sensor has been running
-
-        void process(float* data, uint16_t iq_offset, float noiseFloorDistanceThreshold, float speedConversion);
+        // the commands only set values within these limits, updateIQ() divides by alpha and cos(psi)
+        static constexpr float min_alpha = 0.5;
+        static constexpr float max_alpha = 2;
+        static constexpr float max_psi = 0.5; // rad
+        static constexpr float max_mic_gain = 10;
+
+        Config& operator=(Config const& other)
+        {
+            mic_gain = other.mic_gain;
+            alpha = other.alpha;
+            psi = other.psi;
+
+            return *this;
+        }
     };
 
   public:
-    AudioSystem();
+    BasicAudioSystem();
 
-    void setup(Config const& config, float maxPedestrianSpeed, float sendMaxSpeed);
+    void setup(Config const& config);
     void processData(Results& results);
 
     bool hasData();
     void updateIQ(Config const& config);
 
     float getPeak() { return peak1.read(); }
+    /// spectra transformed and spectra overwritten before processData() picked them up
+    uint32_t getSpectrumCount() { return fft_IQ.spectrumCount(); }
+    uint32_t getMissedSpectra() { return fft_IQ.missedCount(); }
+    /// audio blocks that did not arrive at the FFT; their samples are gaps in the sequence numbers
+    uint32_t getDroppedBlocks() { return fft_IQ.droppedBlockCount(); }
+
+    NoiseFloor& getNoiseFloor() { return noiseFloor; }
+    Ghosts const& getGhostSuppression() const { return ghostSuppression; }
+
+    static constexpr bool fixedPoint = CITRAD_FIXED_POINT != 0;
+
+    /// the audio graph below as seen by the block pool: line in, I gain and Q mixer (not in the fixed point graph, the
+    /// FFT corrects the samples itself), headphone; peak and FFT only read
+    static constexpr AudioBlockPool::Graph blockGraph = {2, fixedPoint ? 0 : 2, 2, 0};
+    static constexpr uint16_t blockPoolSize = AudioBlockPool::poolBlocks(blockGraph, Config::audio_block_margin);
+    static constexpr size_t blockBytes = fixedPoint ? AudioBlockPool::int16BlockBytes : AudioBlockPool::floatBlockBytes;
+
+#if CITRAD_FIXED_POINT
+    /// blocks of the pool in use now and at most since setup()
+    uint16_t getBlocksInUse() { return AudioMemoryUsage(); }
+    uint16_t getBlocksMaxInUse() { return AudioMemoryUsageMax(); }
+#else
+    /// blocks of the pool in use now and at most since setup()
+    uint16_t getBlocksInUse() { return AudioMemoryUsage_F32(); }
+    uint16_t getBlocksMaxInUse() { return AudioMemoryUsageMax_F32(); }
+#endif
 
   private:
     Config config;
 
-    uint16_t iq_offset;       // offset used for IQ calculation
-    uint16_t numberOfFftBins; // is calculated from send_max_speed
-    uint16_t maxBinIndex;
-    uint16_t minBinIndex;
-    uint16_t max_pedestrian_bin;
+    IqFftAnalyzer<Layout::fftWidth> fft_IQ;
+#if CITRAD_FIXED_POINT
+    AudioAnalyzePeak peak1;
 
-    AudioAnalyzeFFT1024_IQ_F32 fft_IQ1024;
+    AudioInputI2S linein;
+    AudioOutputI2S headphone;
+    AudioControlSGTL5000 sgtl5000_1;
+    AudioConnection patchCord2; // FFT I input
+    AudioConnection patchCord4; // FFT Q input
+
+    AudioConnection patchCord5;
+    AudioConnection patchCord6;
+    AudioConnection patchCord7;
+#else
     AudioAnalyzePeak_F32 peak1;
     AudioEffectGain_F32 I_gain; // iGain
     AudioMixer4_F32 Q_mixer;    // qMixer
@@ -100,8 +168,12 @@ class AudioSystem
     AudioConnection_F32 patchCord5;
     AudioConnection_F32 patchCord6;
     AudioConnection_F32 patchCord7;
+#endif
 
-    float speedConversion; // conversion from Hz to m/s
+    NoiseFloor noiseFloor;
+    Ghosts ghostSuppression;
 };
 
+using AudioSystem = BasicAudioSystem<DefaultSpectrumLayout>;
+
 #endif
@@ -0,0 +1,178 @@
+#include "BufferedFile.hpp"
+
+#include <string.h>
+
+BufferedFile::BufferedFile(uint8_t* storage, size_t capacity)
+    : buffer(storage)
+    , size(capacity)
+{}
+
+bool BufferedFile::switchTo(char const* fileName)
+{
+    if(switching)
+        return false;
+    if(fileName && strlen(fileName) >= sizeof(nextName))
+        return false;
+
+    // whatever is in the ring now still belongs to the current file
+    currentBytes = fill;
+    switching = isFileOpen || fileName;
+    accepting = fileName != nullptr;
+    strcpy(nextName, fileName ? fileName : "");
+    return true;
+}
+
+void BufferedFile::close()
+{
+    if(switching)
+    {
+        if(isFileOpen)
+            closeFile();
+        openNextFile(millis());
+    }
+    if(isFileOpen)
+        closeFile();
+    accepting = false;
+}
+
+bool BufferedFile::write(void const* data, size_t byteCount)
+{
+    if(not accepting)
+        return false;
+
+    if(byteCount > size - fill)
+    {
+        stats.overruns++;
+        stats.droppedBytes += byteCount;
+        return false;
+    }
+
+    auto const* source = static_cast<uint8_t const*>(data);
+    size_t const firstPart = min(byteCount, size - head);
+    memcpy(buffer + head, source, firstPart);
+    memcpy(buffer, source + firstPart, byteCount - firstPart);
+
+    head = (head + byteCount) % size;
+    fill += byteCount;
+    if(fill > stats.maxFillLevel)
+        stats.maxFillLevel = fill;
+
+    return true;
+}
+
+size_t BufferedFile::service(uint32_t nowMs, size_t maxSectors)
+{
+    size_t sectorsLeft = maxSectors - writeSectors(maxSectors);
+
+    // a switch takes a step per slice: the partial last sector and closing the current file, then the next file
+    if(switching && isFileOpen && sectorsLeft > 0)
+    {
+        closeFile();
+        sectorsLeft--;
+    }
+    if(switching && sectorsLeft > 0)
+    {
+        openNextFile(nowMs);
+        sectorsLeft--;
+        sectorsLeft -= writeSectors(sectorsLeft);
+    }
+
+    // sparse files (events, summaries) would otherwise keep their records in RAM until the file is closed
+    if(not switching && isFileOpen && sectorsLeft > 0 && (fill > 0 || hasUnflushedData) &&
+       nowMs - lastFlushMs >= flushIntervalMs)
+    {
+        writeAll();
+        flushFile();
+        lastFlushMs = nowMs;
+        sectorsLeft--;
+    }
+    return maxSectors - sectorsLeft;
+}
+
+size_t BufferedFile::writeSectors(size_t maxSectors)
+{
+    if(not isFileOpen)
+        return 0;
+
+    // each write ends on a sector boundary of the file; after a flush wrote a partial sector the next write completes
+    // it, so the ring position of a sector can wrap around the end of the ring
+    size_t sectorsLeft = maxSectors;
+    while(sectorsLeft > 0)
+    {
+        size_t const toBoundary = sectorSize - written % sectorSize;
+        if(currentFill() < toBoundary)
+            break;
+        size_t const sectors = min((currentFill() - toBoundary) / sectorSize, sectorsLeft - 1);
+        size_t const sectorsBefore = written / sectorSize;
+        writeToFile(min(toBoundary + sectors * sectorSize, size - tail));
+        sectorsLeft -= written / sectorSize - sectorsBefore;
+    }
+    return maxSectors - sectorsLeft;
+}
+
+void BufferedFile::writeAll()
+{
+    while(currentFill() > 0)
+        writeToFile(min(currentFill(), size - tail));
+}
+
+void BufferedFile::writeToFile(size_t byteCount)
+{
+    uint32_t const start = micros();
+    file.write(buffer + tail, byteCount);
+    uint32_t const duration = micros() - start;
+
+    stats.writeCalls++;
+    stats.lastWriteMicros = duration;
+    if(duration > stats.maxWriteMicros)
+        stats.maxWriteMicros = duration;
+
+    tail = (tail + byteCount) % size;
+    fill -= byteCount;
+    if(switching)
+        currentBytes -= byteCount;
+    written += byteCount;
+    hasUnflushedData = true;
+}
+
+void BufferedFile::flushFile()
+{
+    uint32_t const start = micros();
+    file.flush();
+    uint32_t const duration = micros() - start;
+
+    stats.flushCalls++;
+    if(duration > stats.maxFlushMicros)
+        stats.maxFlushMicros = duration;
+
+    hasUnflushedData = false;
+}
+
+void BufferedFile::closeFile()
+{
+    writeAll();
+    flushFile();
+    file.close();
+    isFileOpen = false;
+}
+
+void BufferedFile::openNextFile(uint32_t nowMs)
+{
+    switching = false;
+    if(nextName[0] == 0)
+        return;
+
+    file = SD.open(nextName, FILE_WRITE);
+    isFileOpen = static_cast<bool>(file);
+    written = isFileOpen ? size_t(file.size() % sectorSize) : 0; // FILE_WRITE appends
+    lastFlushMs = nowMs;
+    hasUnflushedData = false;
+    if(isFileOpen)
+        return;
+
+    // the records of a file that cannot be created are lost, the writer starts another file later
+    stats.overruns++;
+    stats.droppedBytes += fill;
+    head = tail = fill = 0;
+    accepting = false;
+}
@@ -0,0 +1,103 @@
+#ifndef BUFFEREDFILE_HPP
+#define BUFFEREDFILE_HPP
+
+#include <SD.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Collects small writes in a pre-allocated RAM ring and hands them to the SD card in whole sectors
+ *
+ * write() only copies into RAM and can be called from the time critical part of loop(). The card is touched in
+ * service(), which should run while waiting for the next FFT frame. A record either fits completely or is dropped
+ * and counted as overrun, so a full ring never leaves half a record in the file.
+ *
+ * switchTo() starts the next file without touching the card either: it marks where the current file ends in the ring
+ * and the records behind the mark go to the next file. service() writes the rest of the current file, closes it and
+ * opens the next one step by step, so rotating a file never stalls the frame.
+ */
+class BufferedFile
+{
+  public:
+    static constexpr size_t sectorSize = 512;
+
+    struct Statistics
+    {
+        uint32_t overruns = 0;         // records dropped because the ring was full
+        uint32_t droppedBytes = 0;     // bytes of these records
+        uint32_t writeCalls = 0;       // number of File::write calls
+        uint32_t flushCalls = 0;       // number of File::flush calls
+        uint32_t lastWriteMicros = 0;  // duration of the most recent write call
+        uint32_t maxWriteMicros = 0;   // longest write call
+        uint32_t maxFlushMicros = 0;   // longest flush call
+        size_t maxFillLevel = 0;       // high-water mark of the ring in bytes
+    };
+
+  public:
+    /// capacity has to be a multiple of sectorSize
+    BufferedFile(uint8_t* storage, size_t capacity);
+
+    /// the records written from now on go to the file fileName (created or appended), nullptr: writes are refused.
+    /// Only copies the name; false while the previous switch is still pending, the records keep their file then.
+    bool switchTo(char const* fileName);
+    bool isSwitching() const { return switching; }
+    /// completes a pending switch, writes everything that is buffered and closes the file; blocks on the card
+    void close();
+    /// whether write() takes records, also while the file is still to be opened by service()
+    explicit operator bool() const { return accepting; }
+
+    bool write(void const* data, size_t size);
+
+    /// write at most maxSectors whole sectors to the card; if flushIntervalMs have passed and a sector is left, the
+    /// partial sector is written as well and the file flushed. During a switch the rest of the current file is written
+    /// and the file closed, then the next one is opened. Returns the sectors used, a flush, a close and an open count
+    /// as one each.
+    size_t service(uint32_t nowMs, size_t maxSectors = 4);
+    /// whether service() has a sector, a flush or a switch to do
+    bool needsService(uint32_t nowMs) const
+    {
+        return switching ||
+               (isFileOpen && (fill >= sectorSize - written % sectorSize ||
+                               ((fill > 0 || hasUnflushedData) && nowMs - lastFlushMs >= flushIntervalMs)));
+    }
+
+    size_t fillLevel() const { return fill; }
+    size_t capacity() const { return size; }
+    size_t freeSpace() const { return size - fill; }
+    Statistics const& statistics() const { return stats; }
+
+    uint32_t flushIntervalMs = 1000;
+
+  private:
+    /// bytes at the front of the ring that belong to the open file
+    size_t currentFill() const { return switching ? currentBytes : fill; }
+    size_t writeSectors(size_t maxSectors);
+    void writeAll();
+    void writeToFile(size_t byteCount);
+    void flushFile();
+    void closeFile();
+    void openNextFile(uint32_t nowMs);
+
+  private:
+    File file;
+    bool isFileOpen = false;
+    bool accepting = false;  // write() takes records: a file is open or about to be opened
+    bool switching = false;  // the ring holds the end of the current file, the next one is still to be opened
+    size_t currentBytes = 0; // during a switch: bytes of the current file, the records of the next one follow
+    char nextName[64] = {};  // empty: no file follows
+
+    uint8_t* const buffer;
+    size_t const size;
+    size_t head = 0; // next byte to write into the ring
+    size_t tail = 0; // next byte to write to the card
+    size_t fill = 0;
+    size_t written = 0; // bytes handed to the file, the writes end on its sector boundaries
+
+    uint32_t lastFlushMs = 0;
+    bool hasUnflushedData = false;
+
+    Statistics stats;
+};
+
+#endif
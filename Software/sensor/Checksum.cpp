@@ -0,0 +1,30 @@
+#include "Checksum.h"
+
+namespace
+{
+// CRC-32 a nibble at a time, the table stays small in flash
+constexpr uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+} // namespace
+
+uint32_t Checksum::crc32(uint8_t const* data, size_t size, uint32_t crc)
+{
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+        crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+uint32_t Checksum::fnv1a(uint8_t const* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
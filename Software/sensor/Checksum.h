@@ -0,0 +1,22 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The checksums of the file and stream formats, one implementation each.
+ *
+ * crc32 is the CRC-32 of IEEE 802.3 (reflected polynomial 0xEDB88320, as zlib) over the records of compressed raw
+ * files (RawRecord.h) and the serial frames (SerialFormat.h). A running CRC continues with the previous result as crc.
+ *
+ * fnv1a is the 32 bit FNV-1a hash of the noise floor checkpoint (noise_floor.h) and of the outputs sensorreplay
+ * compares.
+ */
+namespace Checksum
+{
+uint32_t crc32(uint8_t const* data, size_t size, uint32_t crc = 0);
+uint32_t fnv1a(uint8_t const* data, size_t size);
+} // namespace Checksum
+
+#endif
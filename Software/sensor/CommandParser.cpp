@@ -0,0 +1,226 @@
+#include "CommandParser.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+/// splits off the next word of a line, words are separated by spaces or tabs
+char* nextWord(char*& text)
+{
+    while(*text == ' ' || *text == '\t')
+        text++;
+    if(*text == '\0')
+        return nullptr;
+
+    char* const word = text;
+    while(*text != '\0' && *text != ' ' && *text != '\t')
+        text++;
+    if(*text != '\0')
+        *text++ = '\0';
+    return word;
+}
+
+/// the first maxNameLength characters of name
+void copyName(char* target, char const* name)
+{
+    size_t length = 0;
+    while(length < CommandParser::maxNameLength && name[length] != '\0')
+        length++;
+    memcpy(target, name, length);
+    target[length] = '\0';
+}
+
+/// number is only set if the text is a number
+bool parseNumber(char const* text, uint32_t& number)
+{
+    char* end = nullptr;
+    unsigned long const value = strtoul(text, &end, 10);
+    if(end == text || *end != '\0')
+        return false;
+    number = value;
+    return true;
+}
+
+/// a finite number; "nan", "inf" and numbers beyond the range of float are rejected and leave value alone
+bool parseFloat(char const* text, float& value)
+{
+    char* end = nullptr;
+    float const parsed = strtof(text, &end);
+    if(end == text || *end != '\0' || not isfinite(parsed))
+        return false;
+    value = parsed;
+    return true;
+}
+} // namespace
+
+void CommandParser::feed(uint8_t byte, uint32_t nowMs)
+{
+    lastByteMs = nowMs;
+
+    switch(state)
+    {
+    case State::TimeStart:
+        if(byte >= '0' && byte <= '9')
+        {
+            number = byte - '0';
+            state = State::TimeDigits;
+        }
+        return;
+
+    case State::TimeDigits:
+        if(byte >= '0' && byte <= '9')
+        {
+            number = number * 10 + (byte - '0');
+            return;
+        }
+        finishTime();
+        break; // the byte after the number is a command of its own
+
+    case State::Line:
+        if(byte == '\r' || byte == '\n')
+        {
+            finishLine();
+            state = State::Idle;
+        }
+        else if(lineLength == maxLineLength)
+        {
+            Command command;
+            command.type = Command::Invalid;
+            line[lineLength] = '\0';
+            copyName(command.name, line);
+            push(command);
+            state = State::LineTooLong;
+        }
+        else
+            line[lineLength++] = static_cast<char>(byte);
+        return;
+
+    case State::LineTooLong:
+        if(byte == '\r' || byte == '\n')
+            state = State::Idle;
+        return;
+
+    case State::Idle:
+        break;
+    }
+
+    Command command;
+    switch(byte)
+    {
+    case 'd':
+        command.type = Command::SendOutput;
+        break;
+    case 's':
+        command.type = Command::Status;
+        break;
+    case 'p':
+        command.type = Command::Profile;
+        break;
+    case 'm':
+        command.type = Command::Memory;
+        break;
+    case 0:
+        command.type = Command::MicGainDown;
+        break;
+    case 1:
+        command.type = Command::MicGainUp;
+        break;
+    case 'o':
+        command.type = Command::AlphaUp;
+        break;
+    case 'l':
+        command.type = Command::AlphaDown;
+        break;
+    case 'i':
+        command.type = Command::PsiUp;
+        break;
+    case 'k':
+        command.type = Command::PsiDown;
+        break;
+    case 'T':
+        number = 0;
+        state = State::TimeStart;
+        return;
+    case '$':
+        lineLength = 0;
+        state = State::Line;
+        return;
+    default:
+        return; // anything else is ignored, e.g. line ends after a single byte command
+    }
+    push(command);
+}
+
+CommandParser::Command CommandParser::next(uint32_t nowMs)
+{
+    if((state == State::TimeStart || state == State::TimeDigits) && nowMs - lastByteMs >= numberTimeoutMs)
+        finishTime();
+
+    Command command;
+    if(queued == 0)
+        return command;
+
+    command = queue[0];
+    queue[0] = queue[1];
+    queued--;
+    return command;
+}
+
+void CommandParser::finishTime()
+{
+    Command command;
+    command.type = Command::SetTime;
+    command.number = state == State::TimeDigits ? number : 0; // parseInt() returned 0 without digits
+    state = State::Idle;
+    push(command);
+}
+
+void CommandParser::finishLine()
+{
+    line[lineLength] = '\0';
+    char* text = line;
+    char const* const verb = nextWord(text);
+    if(not verb)
+        return; // empty line
+
+    char const* const first = nextWord(text);
+    char const* const second = nextWord(text);
+    bool const noMore = nextWord(text) == nullptr;
+
+    Command command;
+    command.type = Command::Invalid;
+    if(strcmp(verb, "set") == 0 && second && noMore && strlen(first) <= maxNameLength &&
+       parseFloat(second, command.value))
+    {
+        command.type = Command::SetValue;
+        copyName(command.name, first);
+    }
+    else if(strcmp(verb, "get") == 0 && first && not second && strlen(first) <= maxNameLength)
+    {
+        command.type = Command::GetValue;
+        copyName(command.name, first);
+    }
+    else if(strcmp(verb, "time") == 0 && first && not second && parseNumber(first, command.number))
+        command.type = Command::SetTime;
+    else if(not first && strcmp(verb, "status") == 0)
+        command.type = Command::Status;
+    else if(not first && strcmp(verb, "profile") == 0)
+        command.type = Command::Profile;
+    else if(not first && strcmp(verb, "counters") == 0)
+        command.type = Command::Counters;
+    else if(not first && strcmp(verb, "memory") == 0)
+        command.type = Command::Memory;
+    else
+        copyName(command.name, verb);
+
+    push(command);
+}
+
+void CommandParser::push(Command const& command)
+{
+    // only reachable with a full queue if next() is not called after each byte; the oldest command wins
+    if(queued < sizeof(queue) / sizeof(queue[0]))
+        queue[queued++] = command;
+}
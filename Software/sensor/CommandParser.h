@@ -0,0 +1,91 @@
+#ifndef COMMANDPARSER_H
+#define COMMANDPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Incremental parser for the commands on the serial port. It takes one byte at a time and never waits for the rest
+ * of a command, so a slow or stalled sender cannot hold up loop().
+ *
+ * Single byte commands (used by FFT_visualisation):
+ *  - d: send a spectrum frame, s: status, p: profile, m: memory
+ *  - o / l: alpha +/- 0.01, i / k: psi +/- 0.01, 0x00 / 0x01: mic gain -/+ 0.01
+ *  - T followed by digits: set the clock to this unix time. Like Stream::parseInt() everything up to the first digit
+ *    is skipped, the number ends before the first non-digit or 1 s after the last byte.
+ *
+ * Line commands start with '$' and end with '\r' or '\n', e.g. "$set alpha 1.12":
+ *  - $set <name> <value>, $get <name> with the names mic_gain, alpha and psi; a value that is no finite number makes
+ *    the line invalid
+ *  - $time <unix time>, $status, $profile, $counters, $memory
+ */
+class CommandParser
+{
+  public:
+    static constexpr size_t maxLineLength = 48;
+    static constexpr size_t maxNameLength = 15;
+    static constexpr uint32_t numberTimeoutMs = 1000;
+
+    struct Command
+    {
+        enum Type : uint8_t
+        {
+            None,
+            SendOutput,
+            Status,
+            Profile,
+            Counters,
+            Memory,
+            MicGainDown,
+            MicGainUp,
+            AlphaUp,
+            AlphaDown,
+            PsiUp,
+            PsiDown,
+            SetTime,  // number
+            SetValue, // name, value
+            GetValue, // name
+            Invalid,  // name holds the start of the line that was not understood
+        };
+
+        Type type = None;
+        char name[maxNameLength + 1] = {};
+        float value = 0;
+        uint32_t number = 0;
+    };
+
+  public:
+    /// hands one received byte to the parser; completed commands are returned by next()
+    void feed(uint8_t byte, uint32_t nowMs);
+
+    /// the next completed command or a command of type None; also ends a pending T command after its timeout
+    Command next(uint32_t nowMs);
+
+  private:
+    enum class State : uint8_t
+    {
+        Idle,
+        TimeStart,  // 'T' received, waiting for the first digit
+        TimeDigits, // digits of the T command
+        Line,       // '$' received, collecting the line
+        LineTooLong // the line is discarded up to its end
+    };
+
+    void finishTime();
+    void finishLine();
+    void push(Command const& command);
+
+  private:
+    State state = State::Idle;
+    uint32_t lastByteMs = 0;
+    uint32_t number = 0;
+
+    char line[maxLineLength + 1];
+    size_t lineLength = 0;
+
+    // a byte can complete two commands: the end of a T number and a single byte command
+    Command queue[2];
+    size_t queued = 0;
+};
+
+#endif
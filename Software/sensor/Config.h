@@ -2,6 +2,8 @@
 #define CONFIG_H
 
 #include "AudioSystem.h"
+#include "SerialFormat.h"
+#include "SpectrumSummary.h"
 
 #include <cstddef>
 #include <string>
@@ -10,15 +12,46 @@ struct Config
 {
     AudioSystem::Config audio;
 
-    const float max_pedestrian_speed = 10.0; // m/s; speed under which signals are detected as pedestrians
-    const float send_max_speed = 500;        // don't send (and store) spectral data higher than this speed
     const float TRIGGER_AMPLITUDE = 100;     // trigger threshold for mean amplitude to signify a car passing by
+    const uint8_t TRIGGER_BINS = 0;          // trigger threshold for bins with signal (0: only use the amplitude)
     const long COOL_DOWN_PERIOD = 1000;      // cool down period for trigger signal in milliseconds
+    const long PRE_TRIGGER_PERIOD = 3000;    // milliseconds of raw data written before the trigger fired
 
     const bool writeDataToSdCard = true; // write data to SD card?
     const bool write8bit = true;         // write data as 8bit binary (to save disk space)
     const bool writeRawData = true;      // write raw spectral data to SD?
-    const bool writeCsvData = true;      // write calculated metrix to csv table?
+    // only write raw data around trigger events (see EventCapture.h)? Sizes the frame history of FileWriter.
+    static constexpr bool triggerRawData = false;
+    const bool compressRawData = true;   // compress 8bit raw data (file format version 4, see RawRecord.h)?
+    const uint16_t rawKeyFrameInterval = 64; // every n-th compressed frame can be decoded on its own
+    const bool writeRawIndex = true;         // write a seek index next to the raw data (see RawIndex.h)?
+    const uint16_t rawIndexInterval = 64;    // uncompressed frames per index entry (compressed files list key frames)
+    const uint32_t rawFlushIntervalMs = 10000; // compressed raw data lost at most with the power (uncompressed: 1 s)
+    const bool writeCsvData = false;     // write calculated metrix to csv table?
+    const bool writeMetricsData = true;  // write calculated metrix as binary records (see MetricsFormat.h)?
+    const bool writeEventData = true;    // write one csv line per tracked passage (see Tracking.h)?
+    const bool writeSummaryData = true;  // write per bin lowest/mean/highest level per RTC window (SpectrumSummary.h)?
+    const uint32_t summaryWindowSeconds[SpectrumSummary::tierCount] = {1, 10, 60}; // window of each tier, 0: unused
+    const uint32_t summarySecondsPerFile = 86400; // RTC period of one summary file (UTC days), 0: never split
+
+    const bool persistNoiseFloor = true;           // save the adapted noise floor and start from it after a reboot?
+    const size_t noiseFloorCheckpointSeconds = 600; // how often the noise floor is saved
+
+    // payload of the spectrum frames on the serial port (see SerialFormat.h); the viewer reads Float32 and Quantized8
+    const SerialFormat::PayloadType serialPayload = SerialFormat::PayloadType::Quantized8;
+
+    // slices of loop() (see Scheduler.h): the frame runs as soon as it is there, the rest only if its budget ends
+    // before the next frame; a slice that waited maxSliceDelayMs runs anyway
+    const uint32_t frameBudgetMicros = 20000;        // acquisition, analysis and buffering of one FFT frame
+    const uint8_t sdSectorsPerSlice = 1;             // sectors (or flushes) written to the SD card per slice
+    const uint32_t sdSliceBudgetMicros = 5000;
+    const uint32_t serialSliceBudgetMicros = 2000;   // serial output and one reply to a command
+    const uint32_t cardRetryMs = 1000;               // how often a missing SD card is set up again
+    const uint32_t cardSetupBudgetMicros = 50000;
+    const uint32_t housekeepingBudgetMicros = 30000; // noise floor checkpoint and profile log
+    const uint32_t maxSliceDelayMs = 1000;
+
+    const size_t profileLogSeconds = 0; // append the profile (see Profiler.h) to PROFILE.TXT every n seconds, 0: never
 
     const bool splitLargeFiles = true;     // if true, the raw and csv files will be split after each given timespan
     const size_t maxSecondsPerFile = 3600; // used if splitLargeFiles is true
@@ -0,0 +1,46 @@
+#ifndef CSVFORMAT_H
+#define CSVFORMAT_H
+
+#include <Arduino.h>
+
+/**
+ * The per-frame metrics csv table (writeCsvData in Config.h): one line per frame, the columns of MetricsFormat in the
+ * same order. Numbers are formatted by Print, floats with two decimals; lines end with "\r\n".
+ *
+ * The host tools format the table with the Print stand-in of host/Arduino.h, so it matches the sensor byte by byte.
+ */
+namespace CsvFormat
+{
+constexpr char header[] = "timestamp, speed, speed_reverse, strength, strength_reverse, "
+                          "mean_amplitude, mean_amplitude_reverse, bins_with_signal, "
+                          "bins_with_signal_reverse, pedestrian_mean_amplitude, sequence";
+
+/// one line of the table; Results is an AudioResults of any layout
+template <class Results>
+void printLine(Print& out, Results const& results)
+{
+    out.print(results.timestamp);
+    out.print(", ");
+    out.print(results.detected_speed);
+    out.print(", ");
+    out.print(results.detected_speed_reverse);
+    out.print(", ");
+    out.print(results.amplitudeMax);
+    out.print(", ");
+    out.print(results.amplitudeMaxReverse);
+    out.print(", ");
+    out.print(results.mean_amplitude);
+    out.print(", ");
+    out.print(results.mean_amplitude_reverse);
+    out.print(", ");
+    out.print(results.bins_with_signal);
+    out.print(", ");
+    out.print(results.bins_with_signal_reverse);
+    out.print(", ");
+    out.print(results.pedestrian_amplitude);
+    out.print(", ");
+    out.println(results.sequence);
+}
+} // namespace CsvFormat
+
+#endif
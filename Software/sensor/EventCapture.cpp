@@ -0,0 +1,126 @@
+#include "EventCapture.h"
+
+#include <string.h>
+
+EventCapture::Trigger::State EventCapture::Trigger::update(
+    uint32_t timestamp,
+    float meanAmplitude,
+    float meanAmplitudeReverse,
+    uint8_t binsWithSignal,
+    uint8_t binsWithSignalReverse)
+{
+    bool const triggered =
+        meanAmplitude >= settings.amplitude || meanAmplitudeReverse >= settings.amplitude ||
+        (settings.binsWithSignal > 0 &&
+         (binsWithSignal >= settings.binsWithSignal || binsWithSignalReverse >= settings.binsWithSignal));
+
+    if(triggered)
+    {
+        lastTriggerMs = timestamp;
+        if(active)
+            return State::Active;
+
+        active = true;
+        events++;
+        return State::Start;
+    }
+
+    if(active && timestamp - lastTriggerMs < settings.coolDownMs)
+        return State::Active;
+
+    active = false;
+    return State::Quiet;
+}
+
+EventCapture::FrameHistory::FrameHistory(uint8_t* storage, size_t capacity)
+    : buffer(storage)
+    , capacity(capacity)
+{}
+
+void EventCapture::FrameHistory::reset(size_t frameSize)
+{
+    slotSize = frameSize + 1;
+    slots = capacity / slotSize;
+    first = 0;
+    count = 0;
+    keepCount = 0;
+    eventStartPending = false;
+}
+
+void EventCapture::FrameHistory::push(uint8_t const* frame, bool keep)
+{
+    if(slots == 0)
+    {
+        lost += keep;
+        return;
+    }
+
+    if(count == slots)
+    {
+        if(slot(0)[0] & Queued)
+        {
+            // the oldest frame is still waiting for the card, so a frame is lost either way
+            if(not keep)
+            {
+                skipped++;
+                return;
+            }
+            lost++;
+        }
+        dropFirst();
+    }
+
+    uint8_t* const target = slot(count);
+    target[0] = 0;
+    if(keep)
+    {
+        target[0] = eventStartPending ? Queued | StartsEvent : Queued;
+        eventStartPending = false;
+        keepCount++;
+    }
+    memcpy(target + 1, frame, slotSize - 1);
+    count++;
+}
+
+void EventCapture::FrameHistory::startEvent(uint32_t oldestTimestamp)
+{
+    eventStartPending = true;
+    for(size_t i = 0; i < count; i++)
+    {
+        uint8_t* const target = slot(i);
+        uint32_t timestamp;
+        memcpy(&timestamp, target + 1, 4);
+        if(not(target[0] & Queued) && static_cast<int32_t>(timestamp - oldestTimestamp) >= 0)
+        {
+            target[0] = eventStartPending ? Queued | StartsEvent : Queued;
+            eventStartPending = false;
+            keepCount++;
+        }
+    }
+}
+
+uint8_t const* EventCapture::FrameHistory::front(bool& startsEvent)
+{
+    if(keepCount == 0)
+        return nullptr;
+
+    while(not(slot(0)[0] & Queued))
+        dropFirst();
+
+    startsEvent = slot(0)[0] & StartsEvent;
+    return slot(0) + 1;
+}
+
+void EventCapture::FrameHistory::pop()
+{
+    if(count > 0)
+        dropFirst();
+}
+
+void EventCapture::FrameHistory::dropFirst()
+{
+    if(slot(0)[0] & Queued)
+        keepCount--;
+    first = (first + 1) % slots;
+    count--;
+}
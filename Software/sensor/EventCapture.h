@@ -0,0 +1,105 @@
+#ifndef EVENTCAPTURE_H
+#define EVENTCAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Event triggered recording of raw spectra.
+ *
+ * Trigger decides per frame whether a vehicle is passing: an event starts as soon as the mean amplitude or the number
+ * of bins with signal (either direction) reaches its threshold and lasts until no frame has triggered for the cool
+ * down period. FrameHistory keeps the most recent frames in RAM so the start of a passage, which is below the
+ * trigger, can be written once the event has started. It doubles as the queue towards the SD ring, so a long history
+ * does not have to fit into the SD ring at once.
+ */
+namespace EventCapture
+{
+class Trigger
+{
+  public:
+    enum class State : uint8_t
+    {
+        Quiet,  // no event, frames only go into the history
+        Start,  // first triggering frame of an event
+        Active, // event or its cool down is running
+    };
+
+    struct Settings
+    {
+        float amplitude = 100;      // threshold for mean_amplitude / mean_amplitude_reverse
+        uint8_t binsWithSignal = 0; // threshold for bins_with_signal / bins_with_signal_reverse, 0 disables it
+        uint32_t coolDownMs = 1000; // an event ends this long after the last triggering frame
+    };
+
+  public:
+    void setSettings(Settings const& settings) { this->settings = settings; }
+
+    State update(
+        uint32_t timestamp,
+        float meanAmplitude,
+        float meanAmplitudeReverse,
+        uint8_t binsWithSignal,
+        uint8_t binsWithSignalReverse);
+
+    bool isActive() const { return active; }
+    uint32_t eventCount() const { return events; }
+
+  private:
+    Settings settings;
+    bool active = false;
+    uint32_t lastTriggerMs = 0;
+    uint32_t events = 0;
+};
+
+class FrameHistory
+{
+  public:
+    /// every frame has to start with its timestamp (uint 4 bytes)
+    FrameHistory(uint8_t* storage, size_t capacity);
+
+    /// all frames have frameSize bytes until the next reset; drops the stored frames
+    void reset(size_t frameSize);
+
+    /// stores a frame, dropping the oldest one if needed; keep queues it for writing
+    void push(uint8_t const* frame, bool keep);
+
+    /// queues all stored frames not older than oldestTimestamp for writing, the first of them starts an event
+    void startEvent(uint32_t oldestTimestamp);
+
+    /// oldest queued frame or nullptr; frames in front of it that are not queued are dropped
+    uint8_t const* front(bool& startsEvent);
+    void pop();
+
+    size_t frameSize() const { return slotSize - 1; }
+    size_t frameCapacity() const { return slots; }
+    size_t size() const { return count; }
+    size_t queued() const { return keepCount; }
+    uint32_t lostFrames() const { return lost; } // queued frames that had to be dropped because the history was full
+    uint32_t skippedFrames() const { return skipped; } // unqueued frames not stored because everything was queued
+
+  private:
+    enum Marker : uint8_t
+    {
+        Queued = 1 << 0,
+        StartsEvent = 1 << 1,
+    };
+
+    uint8_t* slot(size_t index) { return buffer + ((first + index) % slots) * slotSize; }
+    void dropFirst();
+
+  private:
+    uint8_t* const buffer;
+    size_t const capacity;
+    size_t slotSize = 1; // marker followed by the frame
+    size_t slots = 0;
+    size_t first = 0;
+    size_t count = 0;
+    size_t keepCount = 0;
+    uint32_t lost = 0;
+    uint32_t skipped = 0;
+    bool eventStartPending = false; // the next queued frame starts an event
+};
+} // namespace EventCapture
+
+#endif
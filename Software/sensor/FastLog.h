@@ -0,0 +1,69 @@
+#ifndef FASTLOG_H
+#define FASTLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Conversions between linear power and dB without the math library, for the linear power analysis (see
+ * AudioSystem::Config::linear_power).
+ *
+ * powerToDb splits the float into exponent and a mantissa in [2/3, 4/3) and approximates the logarithm of the mantissa
+ * with a polynomial of degree 5; the error is below 0.0002 dB for every normal float (fftbench checks the bound).
+ * dbToPower builds the power of two from the integer part and approximates the rest with a polynomial of degree 4
+ * (relative error below 2e-5). Both are a handful of multiplications without a branch the compiler cannot turn into
+ * a select, so loops over a spectrum can be vectorised on the host; on the M7 they are a few cycles per bin instead of
+ * a call of log10f.
+ */
+namespace FastLog
+{
+constexpr float minimumDb = -193; // powerToDb of powers that are 0 or not normal, like IqFft::minimumDb
+
+/// 10 log10(power)
+inline float powerToDb(float power)
+{
+    uint32_t bits;
+    memcpy(&bits, &power, 4);
+
+    // power = 2^exponent * mantissa with the mantissa in [2/3, 4/3)
+    uint32_t const offset = (bits - 0x3f2aaaab) & 0xff800000;
+    int32_t const exponent = int32_t(offset) >> 23;
+    bits -= offset;
+    float mantissa;
+    memcpy(&mantissa, &bits, 4);
+
+    // 10 log10(1 + f) for f in [-1/3, 1/3), interpolated at the Chebyshev nodes
+    float const f = mantissa - 1;
+    float const db =
+        f * (4.34294482f + f * (-2.16836067f + f * (1.44497033f + f * (-1.19540794f + f * 0.962899873f))));
+    return power >= 1.17549435e-38f ? float(exponent) * 3.01029996f + db : minimumDb;
+}
+
+/// powerToDb of count values
+inline void powerToDb(float const* power, float* db, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+        db[i] = powerToDb(power[i]);
+}
+
+/// 10^(db / 10); 0 below -379 dB
+inline float dbToPower(float db)
+{
+    float x = db * 0.332192809f; // log2(10) / 10
+    x = x < -126 ? -126 : x > 127 ? 127 : x;
+
+    // 2^x = 2^integer * 2^f with f in [0, 1)
+    int32_t integer = int32_t(x);
+    integer -= float(integer) > x ? 1 : 0;
+    float const f = x - float(integer);
+    float const fraction = 1 + f * (0.693133993f + f * (0.240647048f + f * (0.0534410293f + f * 0.0127631139f)));
+
+    uint32_t const bits = uint32_t(integer + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, 4);
+    return db * 0.332192809f < -126 ? 0 : fraction * scale;
+}
+} // namespace FastLog
+
+#endif
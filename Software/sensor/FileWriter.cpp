@@ -1,11 +1,59 @@
 #include "FileWriter.hpp"
 
+#include "CsvFormat.h"
+#include "MetricsFormat.h"
+
 #include <SPI.h>
 #include <TimeLib.h> // year/month/etc
 
 #include <string>
 
-bool hasToCreateNew(File& file, Config const& config, std::chrono::steady_clock::time_point const& oldCreationTime)
+namespace
+{
+/// collects one csv line so it can be handed to the ring in a single write
+class LineBuffer : public Print
+{
+  public:
+    size_t write(uint8_t c) override
+    {
+        if(length == sizeof(data))
+            return 0;
+        data[length++] = c;
+        return 1;
+    }
+
+    uint8_t data[256];
+    size_t length = 0;
+};
+
+/// ties the sample clock to the RTC at the frame a file is created for, see FrameClock.h
+FrameClock::Anchor anchorOf(AudioSystem::Results const& results)
+{
+    FrameClock::Anchor anchor;
+    anchor.sequence = results.sequence;
+    anchor.time = results.captureTime;
+    anchor.hop = AudioSystem::Layout::fftHop;
+    anchor.sampleRate = AudioSystem::Layout::sampleRate;
+    return anchor;
+}
+} // namespace
+
+FileWriter::FileWriter()
+    : rawFile(rawStorage, sizeof(rawStorage))
+    , csvFile(csvStorage, sizeof(csvStorage))
+    , metricsFile(metricsStorage, sizeof(metricsStorage))
+    , eventFile(eventStorage, sizeof(eventStorage))
+    , indexFile(indexStorage, sizeof(indexStorage))
+    , summaryFiles{
+          {summaryStorage[0], sizeof(summaryStorage[0])},
+          {summaryStorage[1], sizeof(summaryStorage[1])},
+          {summaryStorage[2], sizeof(summaryStorage[2])},
+      }
+    , rawHistory(historyStorage, sizeof(historyStorage))
+{}
+
+bool hasToCreateNew(
+    BufferedFile const& file, Config const& config, std::chrono::steady_clock::time_point const& oldCreationTime)
 {
     if(not file)
         return true;
@@ -21,17 +69,114 @@ bool hasToCreateNew(File& file, Config const& config, std::chrono::steady_clock:
 void FileWriter::writeRawData(AudioSystem::Results const& audioResults, bool write8bit, Config const& config)
 {
     if(hasToCreateNew(rawFile, config, rawFileCreation))
-        openRawFile(audioResults.numberOfFftBins, config);
+        openRawFile(audioResults.numberOfFftBins, write8bit, config, anchorOf(audioResults));
+
+    size_t length = 0;
+    memcpy(frameBuffer, &audioResults.timestamp, 4);
+    length += 4;
+    if(compressRawFile)
+    {
+        memcpy(frameBuffer + length, &audioResults.sequence, 8);
+        length += 8;
+    }
+
+    if(write8bit)
+    {
+        for(size_t i = 0; i < audioResults.numberOfFftBins; i++)
+            frameBuffer[length++] = (uint8_t)-audioResults.spectrum[i];
+    }
+    else
+    {
+        size_t const binBytes = audioResults.numberOfFftBins * 4;
+        memcpy(frameBuffer + length, audioResults.spectrum, binBytes);
+        length += binBytes;
+    }
 
-    rawFile.write((byte*)&audioResults.timestamp, 4);
+    if(not config.triggerRawData)
+    {
+        writeRawFrame(frameBuffer, length, 0);
+        return;
+    }
+
+    if(rawHistory.frameSize() != length)
+        rawHistory.reset(length);
+
+    auto const state = rawTrigger.update(
+        audioResults.timestamp,
+        audioResults.mean_amplitude,
+        audioResults.mean_amplitude_reverse,
+        audioResults.bins_with_signal,
+        audioResults.bins_with_signal_reverse);
+
+    // the frames of an event go through the history as well, so they reach the card after the pre-trigger frames
+    if(state == EventCapture::Trigger::State::Start)
+        rawHistory.startEvent(audioResults.timestamp - config.PRE_TRIGGER_PERIOD);
+    rawHistory.push(frameBuffer, state != EventCapture::Trigger::State::Quiet);
+
+    writeRawHistory(4);
+}
+
+void FileWriter::writeRawFrame(uint8_t const* frame, size_t length, uint8_t flags)
+{
+    uint32_t timestamp;
+    memcpy(&timestamp, frame, 4);
+    if(compressRawFile)
+    {
+        uint64_t sequence;
+        memcpy(&sequence, frame + 4, 8);
+
+        // a segment has to be decodable without the frames that were not written before it
+        if(flags & RawCompression::EventStart)
+            rawEncoder.reset(rawKeyFrameInterval);
+
+        uint8_t codecFlags = 0;
+        uint16_t const payloadSize = rawEncoder.encode(
+            frame + 12, length - 12, encodedBuffer + RawRecord::headerSize(RawRecord::sequencedVersion), codecFlags);
+        flags |= codecFlags;
+        length = RawRecord::frame(encodedBuffer, timestamp, sequence, flags, payloadSize);
+        frame = encodedBuffer;
+    }
+
+    // a dropped frame breaks the chain of differences, so the encoder has to start over with a key frame
+    if(not rawFile.write(frame, length))
+    {
+        if(compressRawFile)
+            rawEncoder.reset(rawKeyFrameInterval);
+        return;
+    }
+
+    // the index lists the records a reader can start at, see RawIndex.h
+    bool const indexed = compressRawFile ? (flags & RawCompression::KeyFrame) != 0
+                                         : (flags & RawCompression::EventStart) || framesSinceIndexEntry == 0;
+    if(indexFile && indexed)
+    {
+        uint8_t entry[RawIndex::entrySize];
+        RawIndex::writeEntry(entry, {timestamp, rawFileOffset});
+        indexFile.write(entry, sizeof(entry));
+        framesSinceIndexEntry = 0;
+    }
+    if(++framesSinceIndexEntry >= rawIndexInterval)
+        framesSinceIndexEntry = 0;
+    rawFileOffset += length;
+}
 
-    for(int i = audioResults.minBinIndex; i < audioResults.maxBinIndex; i++)
-        if(write8bit)
-            rawFile.write((uint8_t)-audioResults.spectrum[i]);
-        else
-            rawFile.write((byte*)&audioResults.spectrum[i], 4);
+void FileWriter::writeRawHistory(size_t maxFrames)
+{
+    if(not rawFile)
+        return;
 
-    rawFile.flush();
+    // only hand over what fits, the rest waits in the history for the next call
+    size_t const maxLength = compressRawFile
+                                 ? RawRecord::maxRecordSize(RawRecord::sequencedVersion, rawHistory.frameSize())
+                                 : rawHistory.frameSize();
+    bool startsEvent = false;
+    uint8_t const* frame = nullptr;
+    for(size_t i = 0; i < maxFrames && rawFile.freeSpace() >= maxLength && (frame = rawHistory.front(startsEvent));
+        i++)
+    {
+        writeRawFrame(frame, rawHistory.frameSize(), startsEvent ? RawCompression::EventStart : 0);
+        rawHistory.pop();
+    }
 }
 
 void FileWriter::writeCsvData(AudioSystem::Results const& audioResults, Config const& config)
@@ -39,78 +184,443 @@ void FileWriter::writeCsvData(AudioSystem::Results const& audioResults, Config c
     if(hasToCreateNew(csvFile, config, csvFileCreation))
         openCsvFile(config);
 
-    csvFile.print(audioResults.timestamp);
-    csvFile.print(", ");
-    csvFile.print(audioResults.detected_speed);
-    csvFile.print(", ");
-    csvFile.print(audioResults.detected_speed_reverse);
-    csvFile.print(", ");
-    csvFile.print(audioResults.amplitudeMax);
-    csvFile.print(", ");
-    csvFile.print(audioResults.amplitudeMaxReverse);
-    csvFile.print(", ");
-    csvFile.print(audioResults.mean_amplitude);
-    csvFile.print(", ");
-    csvFile.print(audioResults.mean_amplitude_reverse);
-    csvFile.print(", ");
-    csvFile.print(audioResults.bins_with_signal);
-    csvFile.print(", ");
-    csvFile.print(audioResults.bins_with_signal_reverse);
-    csvFile.print(", ");
-    csvFile.println(audioResults.pedestrian_amplitude);
-    csvFile.flush();
+    LineBuffer line;
+    CsvFormat::printLine(line, audioResults);
+
+    csvFile.write(line.data, line.length);
+}
+
+void FileWriter::writeMetricsData(AudioSystem::Results const& audioResults, Config const& config)
+{
+    if(hasToCreateNew(metricsFile, config, metricsFileCreation))
+        openMetricsFile(config, anchorOf(audioResults));
+
+    MetricsFormat::Record record;
+    record.timestamp = audioResults.timestamp;
+    record.speed = audioResults.detected_speed;
+    record.speed_reverse = audioResults.detected_speed_reverse;
+    record.strength = audioResults.amplitudeMax;
+    record.strength_reverse = audioResults.amplitudeMaxReverse;
+    record.mean_amplitude = audioResults.mean_amplitude;
+    record.mean_amplitude_reverse = audioResults.mean_amplitude_reverse;
+    record.bins_with_signal = audioResults.bins_with_signal;
+    record.bins_with_signal_reverse = audioResults.bins_with_signal_reverse;
+    record.pedestrian_mean_amplitude = audioResults.pedestrian_amplitude;
+    record.sequence = audioResults.sequence;
+
+    metricsFile.write(&record, sizeof(record));
+}
+
+void FileWriter::writeEventData(Tracking::Event const& event, Config const& config)
+{
+    if(hasToCreateNew(eventFile, config, eventFileCreation))
+        openEventFile(config);
+
+    LineBuffer line;
+    line.print(event.start);
+    line.print(", ");
+    line.print(event.end);
+    line.print(", ");
+    line.print(Tracking::directionName(event.direction));
+    line.print(", ");
+    line.print(Tracking::categoryName(event.category));
+    line.print(", ");
+    line.print(event.peakSpeed);
+    line.print(", ");
+    line.print(event.medianSpeed);
+    line.print(", ");
+    line.print(event.strength);
+    line.print(", ");
+    line.println(event.frames);
+
+    eventFile.write(line.data, line.length);
+}
+
+void FileWriter::writeSummaryData(AudioSystem::Results const& audioResults, Config const& config)
+{
+    for(size_t i = 0; i < audioResults.numberOfFftBins; i++)
+        summaryLevels[i] = SpectrumSummary::quantize(audioResults.spectrum[i]);
+    SpectrumSummary::Frame const frame{
+        audioResults.captureTime.seconds,
+        audioResults.sequence,
+        summaryLevels,
+        audioResults.bins_with_signal,
+        audioResults.bins_with_signal_reverse};
+
+    for(size_t tier = 0; tier < SpectrumSummary::tierCount; tier++)
+    {
+        if(config.summaryWindowSeconds[tier] == 0)
+            continue;
+
+        // the first frame of a later window completes the current one; an RTC that was set back starts a new one too
+        auto& window = summaryWindows[tier];
+        if(not window.empty() && window.startOf(frame.time) != window.start())
+            writeSummaryRecord(tier);
+
+        // a new file starts with a window, so each file covers whole windows of its period
+        if(window.empty())
+        {
+            uint32_t const period =
+                config.summarySecondsPerFile > 0 ? frame.time / config.summarySecondsPerFile : 0;
+            if((not summaryFiles[tier] || period != summaryFilePeriods[tier]) &&
+               openSummaryFile(tier, config, anchorOf(audioResults)))
+                summaryFilePeriods[tier] = period;
+        }
+        window.add(frame);
+    }
+}
+
+void FileWriter::writeSummaryRecord(size_t tier)
+{
+    size_t const length = summaryWindows[tier].writeRecord(summaryRecord);
+    summaryFiles[tier].write(summaryRecord, length);
 }
 
-void FileWriter::openRawFile(size_t const binCount, Config const& config)
+size_t FileWriter::service(size_t maxSectors)
 {
-    if(rawFile)
+    writeRawHistory(4);
+
+    uint32_t const now = millis();
+    size_t sectors = 0;
+    size_t const first = nextServedFile;
+    for(size_t i = 0; i < fileCount && sectors < maxSectors; i++)
     {
-        rawFile.flush();
-        rawFile.close();
+        size_t const index = (first + i) % fileCount;
+        sectors += file(index).service(now, maxSectors - sectors);
+        nextServedFile = (index + 1) % fileCount;
     }
+    return sectors;
+}
+
+bool FileWriter::needsService() const
+{
+    uint32_t const now = millis();
+    bool needed = (rawFile && rawHistory.queued() > 0) || rawFile.needsService(now) || indexFile.needsService(now) ||
+                  csvFile.needsService(now) || metricsFile.needsService(now) || eventFile.needsService(now);
+    for(auto const& file : summaryFiles)
+        needed = needed || file.needsService(now);
+    return needed;
+}
+
+BufferedFile& FileWriter::file(size_t index)
+{
+    switch(index)
+    {
+    case 0:
+        return rawFile;
+    case 1:
+        return indexFile;
+    case 2:
+        return csvFile;
+    case 3:
+        return metricsFile;
+    case 4:
+        return eventFile;
+    default:
+        return summaryFiles[index - 5];
+    }
+}
+
+void FileWriter::close()
+{
+    // frames of an event that are still in the history are written as long as the ring takes them
+    writeRawHistory(rawHistory.size());
+
+    rawFile.close();
+    indexFile.close();
+    csvFile.close();
+    metricsFile.close();
+    eventFile.close();
+
+    // the windows collected so far are written partial, the next frame starts new files
+    for(size_t tier = 0; tier < SpectrumSummary::tierCount; tier++)
+    {
+        if(not summaryWindows[tier].empty())
+            writeSummaryRecord(tier);
+        summaryFiles[tier].close();
+    }
+}
+
+bool FileWriter::loadNoiseFloor(AudioSystem::NoiseFloor& noiseFloor)
+{
+    // the temporary file is only left over if the sensor lost power between removing and renaming
+    for(char const* fileName : {noiseFloorFileName, noiseFloorTempFileName})
+    {
+        File file = SD.open(fileName, FILE_READ);
+        if(not file)
+            continue;
+
+        uint8_t buffer[AudioSystem::NoiseFloor::checkpointSize];
+        size_t const size = file.read(buffer, sizeof(buffer));
+        file.close();
+        if(noiseFloor.readCheckpoint(buffer, size))
+        {
+            log->print("Noise floor loaded from ");
+            log->println(fileName);
+            return true;
+        }
+    }
+    return false;
+}
+
+void FileWriter::checkpointNoiseFloor(AudioSystem::NoiseFloor const& noiseFloor, Config const& config)
+{
+    using namespace std::chrono;
+    auto const now = steady_clock::now();
+    if(now - noiseFloorCheckpoint < seconds(config.noiseFloorCheckpointSeconds))
+        return;
+    noiseFloorCheckpoint = now;
+
+    uint8_t buffer[AudioSystem::NoiseFloor::checkpointSize];
+    noiseFloor.writeCheckpoint(buffer);
+
+    // FILE_WRITE appends, so the checkpoint goes into a fresh file that replaces the old one when it is complete
+    SD.remove(noiseFloorTempFileName);
+    File file = SD.open(noiseFloorTempFileName, FILE_WRITE);
+    if(not file)
+        return;
+    bool const complete = file.write(buffer, sizeof(buffer)) == sizeof(buffer);
+    file.close();
+
+    if(complete)
+    {
+        SD.remove(noiseFloorFileName);
+        SD.rename(noiseFloorTempFileName, noiseFloorFileName);
+    }
+}
+
+void FileWriter::logProfile(Profiler const& profiler, Config const& config)
+{
+    using namespace std::chrono;
+    auto const now = steady_clock::now();
+    if(now - profileLog < seconds(config.profileLogSeconds))
+        return;
+    profileLog = now;
+
+    File file = SD.open(profileFileName, FILE_WRITE);
+    if(not file)
+        return;
+    file.print("time ");
+    file.print(Teensy3Clock.get());
+    file.print(", millis ");
+    file.println(millis());
+    profiler.printTo(file);
+    file.close();
+}
+
+void FileWriter::printStatistics(Print& out) const
+{
+    auto const print = [&out](char const* name, BufferedFile const& file) {
+        auto const& stats = file.statistics();
+        out.print(name);
+        out.print(": fill ");
+        out.print(file.fillLevel());
+        out.print("/");
+        out.print(file.capacity());
+        out.print(" max ");
+        out.print(stats.maxFillLevel);
+        out.print(", overruns ");
+        out.print(stats.overruns);
+        out.print(" (");
+        out.print(stats.droppedBytes);
+        out.print(" bytes), writes ");
+        out.print(stats.writeCalls);
+        out.print(" last/max ");
+        out.print(stats.lastWriteMicros);
+        out.print("/");
+        out.print(stats.maxWriteMicros);
+        out.print(" us, flushes ");
+        out.print(stats.flushCalls);
+        out.print(" max ");
+        out.print(stats.maxFlushMicros);
+        out.println(" us");
+    };
+
+    print("raw", rawFile);
+    print("index", indexFile);
+    print("csv", csvFile);
+    print("metrics", metricsFile);
+    print("events", eventFile);
+    for(size_t tier = 0; tier < SpectrumSummary::tierCount; tier++)
+    {
+        char name[24];
+        sprintf(name, "summary %lus", (unsigned long)summaryWindows[tier].windowSeconds());
+        print(name, summaryFiles[tier]);
+    }
+
+    out.print("trigger: events ");
+    out.print(rawTrigger.eventCount());
+    out.print(", history ");
+    out.print(rawHistory.size());
+    out.print("/");
+    out.print(rawHistory.frameCapacity());
+    out.print(" frames, queued ");
+    out.print(rawHistory.queued());
+    out.print(", lost ");
+    out.print(rawHistory.lostFrames());
+    out.print(", skipped ");
+    out.println(rawHistory.skippedFrames());
+}
+
+void FileWriter::openRawFile(
+    size_t const binCount, bool write8bit, Config const& config, FrameClock::Anchor const& anchor)
+{
+    // the index switches with the raw file, so both have to be done with the previous switch
+    if(rawFile.isSwitching() || indexFile.isSwitching())
+        return;
 
     char filePattern[30];
     sprintf(filePattern, "%04d-%02d-%02d_%02d-%02d-%02d.bin", year(), month(), day(), hour(), minute(), second());
     const String fileName = config.filePrefix + filePattern;
+    if(not rawFile.switchTo(fileName.c_str()))
+        return;
 
-    Serial.println("Creating new file: " + fileName);
+    log->println("Creating new file: " + fileName);
 
     time_t timestamp = Teensy3Clock.get();
 
-    rawFile = SD.open(fileName.c_str(), FILE_WRITE);
-    rawFile.write((byte*)&fileFormatVersion, 2);
+    // each file starts with a key frame so it can be read without its predecessor
+    compressRawFile = write8bit && config.compressRawData;
+    rawKeyFrameInterval = config.rawKeyFrameInterval;
+    rawEncoder.reset(rawKeyFrameInterval);
+    uint16_t const version = compressRawFile ? RawRecord::sequencedVersion : fileFormatVersion;
+
+    // framed records survive a cut anywhere (see RawRecord.h), so the card is flushed less often than for version 1
+    rawFile.flushIntervalMs = compressRawFile ? config.rawFlushIntervalMs : 1000;
+    rawFile.write((byte*)&version, 2);
     rawFile.write((byte*)&timestamp, 4);
     rawFile.write((byte*)&binCount, 2);
-    rawFile.write((byte*)&config.audio.iq_measurement, 1);
-    rawFile.write((byte*)&config.audio.sample_rate, 2);
-    rawFile.flush();
+    bool const iqMeasurement = config.audio.iq_measurement;
+    uint16_t const sampleRate = config.audio.sample_rate;
+    rawFile.write((byte*)&iqMeasurement, 1);
+    rawFile.write((byte*)&sampleRate, 2);
+    rawFileOffset = 11;
+    if(compressRawFile)
+    {
+        uint8_t anchorData[FrameClock::anchorSize];
+        rawFile.write(anchorData, FrameClock::writeAnchor(anchorData, anchor));
+        rawFileOffset += sizeof(anchorData);
+    }
+
+    // the index has the name of the raw file, so a reader finds it
+    strcpy(filePattern + strlen(filePattern) - 3, "idx");
+    openIndexFile(config.filePrefix + filePattern, config);
+
+    EventCapture::Trigger::Settings triggerSettings;
+    triggerSettings.amplitude = config.TRIGGER_AMPLITUDE;
+    triggerSettings.binsWithSignal = config.TRIGGER_BINS;
+    triggerSettings.coolDownMs = config.COOL_DOWN_PERIOD;
+    rawTrigger.setSettings(triggerSettings);
 
     rawFileCreation = std::chrono::steady_clock::now();
 }
 
-void FileWriter::openCsvFile(Config const& config)
+void FileWriter::openIndexFile(String const& fileName, Config const& config)
 {
-    if(csvFile)
+    framesSinceIndexEntry = 0;
+    rawIndexInterval = config.rawIndexInterval > 0 ? config.rawIndexInterval : 1;
+    if(not config.writeRawIndex)
     {
-        csvFile.flush();
-        csvFile.close();
+        indexFile.switchTo(nullptr);
+        return;
     }
 
+    // the entries are small, they reach the card a sector at a time and the rest with each flush
+    if(not indexFile.switchTo(fileName.c_str()))
+        return;
+
+    log->println("Creating new file: " + fileName);
+
+    uint8_t header[RawIndex::headerSize];
+    indexFile.write(header, RawIndex::writeHeader(header));
+}
+
+void FileWriter::openCsvFile(Config const& config)
+{
     char filePattern[30];
     sprintf(filePattern, "%04d-%02d-%02d_%02d-%02d-%02d.csv", year(), month(), day(), hour(), minute(), second());
     const String fileName = config.filePrefix + filePattern;
+    if(not csvFile.switchTo(fileName.c_str()))
+        return;
 
-    Serial.println("Creating new file: " + fileName);
+    log->println("Creating new file: " + fileName);
 
-    csvFile = SD.open(fileName.c_str(), FILE_WRITE);
-    csvFile.println("timestamp, speed, speed_reverse, strength, strength_reverse, "
-                    "mean_amplitude, mean_amplitude_reverse, bins_with_signal, "
-                    "bins_with_signal_reverse, pedestrian_mean_amplitude");
-    csvFile.flush();
+    LineBuffer line;
+    line.println(CsvFormat::header);
+    csvFile.write(line.data, line.length);
 
     csvFileCreation = std::chrono::steady_clock::now();
 }
 
+void FileWriter::openMetricsFile(Config const& config, FrameClock::Anchor const& anchor)
+{
+    char filePattern[30];
+    sprintf(filePattern, "%04d-%02d-%02d_%02d-%02d-%02d.met", year(), month(), day(), hour(), minute(), second());
+    const String fileName = config.filePrefix + filePattern;
+    if(not metricsFile.switchTo(fileName.c_str()))
+        return;
+
+    log->println("Creating new file: " + fileName);
+
+    uint8_t header[MetricsFormat::maxHeaderSize];
+    size_t const headerSize = MetricsFormat::writeHeader(header, Teensy3Clock.get(), anchor);
+    metricsFile.write(header, headerSize);
+
+    metricsFileCreation = std::chrono::steady_clock::now();
+}
+
+void FileWriter::openEventFile(Config const& config)
+{
+    char filePattern[30];
+    sprintf(filePattern, "%04d-%02d-%02d_%02d-%02d-%02d.evt", year(), month(), day(), hour(), minute(), second());
+    const String fileName = config.filePrefix + filePattern;
+    if(not eventFile.switchTo(fileName.c_str()))
+        return;
+
+    log->println("Creating new file: " + fileName);
+
+    // events are rare, so they are written as csv table right away
+
+    LineBuffer line;
+    line.println("start, end, direction, category, peak_speed, median_speed, strength, frames");
+    eventFile.write(line.data, line.length);
+
+    eventFileCreation = std::chrono::steady_clock::now();
+}
+
+bool FileWriter::openSummaryFile(size_t tier, Config const& config, FrameClock::Anchor const& anchor)
+{
+    uint32_t const windowSeconds = config.summaryWindowSeconds[tier];
+    char filePattern[40];
+    sprintf(filePattern,
+            "%04d-%02d-%02d_%02d-%02d-%02d_%lus.sum",
+            year(),
+            month(),
+            day(),
+            hour(),
+            minute(),
+            second(),
+            (unsigned long)windowSeconds);
+    const String fileName = config.filePrefix + filePattern;
+    if(not summaryFiles[tier].switchTo(fileName.c_str()))
+        return false;
+
+    log->println("Creating new file: " + fileName);
+
+    summaryWindows[tier].reset(windowSeconds, rawBinCount);
+
+    SpectrumSummary::Header header;
+    header.creationTime = Teensy3Clock.get();
+    header.windowSeconds = windowSeconds;
+    header.binCount = rawBinCount;
+    header.iq = config.audio.iq_measurement;
+    header.sampleRate = config.audio.sample_rate;
+    header.anchor = anchor;
+    uint8_t buffer[SpectrumSummary::headerSize];
+    summaryFiles[tier].write(buffer, SpectrumSummary::writeHeader(buffer, header));
+    return true;
+}
+
 void FileWriter::setupSpi()
 {
     // Configure SPI
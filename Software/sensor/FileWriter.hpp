@@ -2,7 +2,16 @@
 #define FILEWRITER_HPP
 
 #include "AudioSystem.h"
+#include "BufferedFile.hpp"
 #include "Config.h"
+#include "EventCapture.h"
+#include "FrameClock.h"
+#include "Profiler.h"
+#include "RawCompression.h"
+#include "RawIndex.h"
+#include "RawRecord.h"
+#include "SpectrumSummary.h"
+#include "Tracking.h"
 
 #include <SD.h>
 
@@ -12,28 +21,113 @@
 class FileWriter
 {
   public:
+    FileWriter();
+
+    // these only fill RAM buffers, also when they start the next file; the SD card is written in service()
     void writeRawData(AudioSystem::Results const& audioResults, bool write8bit, Config const& config);
     void writeCsvData(AudioSystem::Results const& audioResults, Config const& config);
+    void writeMetricsData(AudioSystem::Results const& audioResults, Config const& config);
+    void writeEventData(Tracking::Event const& event, Config const& config);
+    void writeSummaryData(AudioSystem::Results const& audioResults, Config const& config);
+
+    /// call while waiting for the next FFT frame: moves event frames into the raw ring and writes at most maxSectors
+    /// sectors of all files together (a flush, closing a file and opening the next count as one each), starting with
+    /// the file after the last one served. Returns the sectors written.
+    size_t service(size_t maxSectors = 16);
+    bool needsService() const;
+    void close();   // writes everything that is still buffered and closes the files
+    void printStatistics(Print& out) const;
+
+    // the noise floor checkpoint is written directly and blocks for a few ms; only call while waiting for a frame
+    bool loadNoiseFloor(AudioSystem::NoiseFloor& noiseFloor);
+    void checkpointNoiseFloor(AudioSystem::NoiseFloor const& noiseFloor, Config const& config);
+    /// appends the profile to the log every config.profileLogSeconds; blocks like the noise floor checkpoint
+    void logProfile(Profiler const& profiler, Config const& config);
 
     void setupSpi();
     bool setupSdCard();
 
+    /// where the messages about new files and the loaded noise floor go, Serial by default; the sensor sends them
+    /// between the serial frames through SerialIO::text()
+    void setLog(Print& out) { log = &out; }
+
   private:
-    void openRawFile(size_t const binCount, Config const& config);
+    void openRawFile(size_t const binCount, bool write8bit, Config const& config, FrameClock::Anchor const& anchor);
+    void openIndexFile(String const& fileName, Config const& config);
     void openCsvFile(Config const& config);
+    void openMetricsFile(Config const& config, FrameClock::Anchor const& anchor);
+    void openEventFile(Config const& config);
+    bool openSummaryFile(size_t tier, Config const& config, FrameClock::Anchor const& anchor);
+
+    void writeRawFrame(uint8_t const* frame, size_t length, uint8_t flags);
+    void writeRawHistory(size_t maxFrames);
+    void writeSummaryRecord(size_t tier);
+
+    static constexpr size_t fileCount = 5 + SpectrumSummary::tierCount;
+    BufferedFile& file(size_t index);
 
   private:
-    File rawFile;
-    File csvFile;
+    static constexpr size_t rawBinCount = AudioSystem::Results::numberOfFftBins;
+
+    uint8_t rawStorage[64 * BufferedFile::sectorSize];
+    uint8_t csvStorage[8 * BufferedFile::sectorSize];
+    uint8_t metricsStorage[4 * BufferedFile::sectorSize];
+    uint8_t eventStorage[2 * BufferedFile::sectorSize];
+    uint8_t indexStorage[2 * BufferedFile::sectorSize];
+    // one frame is assembled here: timestamp, sequence (compressed files only) and bins, uncompressed it is the record
+    uint8_t frameBuffer[4 + 8 + 4 * rawBinCount];
+    static constexpr size_t maxRawRecordSize =
+        RawRecord::maxRecordSize(RawRecord::sequencedVersion, RawCompression::maxPayloadSize(rawBinCount));
+    uint8_t encodedBuffer[maxRawRecordSize]; // one compressed record
+    // raw frames before and during a trigger event; without triggerRawData nothing is stored
+    static constexpr size_t historyBytes = Config::triggerRawData ? 48 * 1024 : 1;
+    uint8_t historyStorage[historyBytes];
+    // a summary ring takes two records, they are written once per window
+    static constexpr size_t summaryRecordSize = SpectrumSummary::recordSize(rawBinCount);
+    static constexpr size_t summarySectors =
+        (2 * summaryRecordSize + BufferedFile::sectorSize - 1) / BufferedFile::sectorSize;
+    uint8_t summaryStorage[SpectrumSummary::tierCount][summarySectors * BufferedFile::sectorSize];
+    uint8_t summaryRecord[summaryRecordSize];
+    uint8_t summaryLevels[rawBinCount]; // of the current frame, quantized once for all tiers
+
+    RawCompression::Encoder rawEncoder;
+    bool compressRawFile = false;
+    uint16_t rawKeyFrameInterval = 64;
+
+    uint32_t rawFileOffset = 0;     // bytes of the raw file in the ring or on the card
+    uint16_t rawIndexInterval = 64; // uncompressed records from one index entry to the next
+    uint16_t framesSinceIndexEntry = 0;
+
+    BufferedFile rawFile;
+    BufferedFile csvFile;
+    BufferedFile metricsFile;
+    BufferedFile eventFile;
+    BufferedFile indexFile;
+    BufferedFile summaryFiles[SpectrumSummary::tierCount];
+    size_t nextServedFile = 0; // service() starts here, so a busy raw file does not hold back the others
+    Print* log = &Serial;
+
+    SpectrumSummary::Window summaryWindows[SpectrumSummary::tierCount];
+    uint32_t summaryFilePeriods[SpectrumSummary::tierCount] = {}; // RTC time of the open files / summarySecondsPerFile
+
+    EventCapture::Trigger rawTrigger;
+    EventCapture::FrameHistory rawHistory;
 
     std::chrono::steady_clock::time_point rawFileCreation;
     std::chrono::steady_clock::time_point csvFileCreation;
+    std::chrono::steady_clock::time_point metricsFileCreation;
+    std::chrono::steady_clock::time_point eventFileCreation;
+    std::chrono::steady_clock::time_point noiseFloorCheckpoint = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point profileLog = std::chrono::steady_clock::now();
 
   private:
     const int SDCARD_MOSI_PIN = 11; // Teensy 4 ignores this, uses pin 11
     const int SDCARD_SCK_PIN = 13;  // Teensy 4 ignores this, uses pin 13
     const int SDCARD_CS_PIN = 10;
     const uint16_t fileFormatVersion = 1;
+    const char* const noiseFloorFileName = "NOISEFLR.BIN";
+    const char* const noiseFloorTempFileName = "NOISEFLR.TMP";
+    const char* const profileFileName = "PROFILE.TXT";
 };
 
 #endif
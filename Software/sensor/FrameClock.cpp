@@ -0,0 +1,33 @@
+#include "FrameClock.h"
+
+#include <string.h>
+
+size_t FrameClock::writeAnchor(uint8_t* buffer, Anchor const& anchor)
+{
+    memcpy(buffer, &anchor.sequence, 8);
+    memcpy(buffer + 8, &anchor.time.seconds, 4);
+    memcpy(buffer + 12, &anchor.time.micros, 4);
+    memcpy(buffer + 16, &anchor.hop, 2);
+    memcpy(buffer + 18, &anchor.sampleRate, 2);
+    return anchorSize;
+}
+
+FrameClock::Anchor FrameClock::readAnchor(uint8_t const* data)
+{
+    Anchor anchor;
+    memcpy(&anchor.sequence, data, 8);
+    memcpy(&anchor.time.seconds, data + 8, 4);
+    memcpy(&anchor.time.micros, data + 12, 4);
+    memcpy(&anchor.hop, data + 16, 2);
+    memcpy(&anchor.sampleRate, data + 18, 2);
+    return anchor;
+}
+
+double FrameClock::secondsSince(Anchor const& anchor, uint64_t sequence)
+{
+    if(anchor.sampleRate == 0)
+        return 0;
+    double const hops = sequence >= anchor.sequence ? double(sequence - anchor.sequence)
+                                                    : -double(anchor.sequence - sequence);
+    return hops * anchor.hop / anchor.sampleRate;
+}
@@ -0,0 +1,56 @@
+#ifndef FRAMECLOCK_H
+#define FRAMECLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Sample clock of the analysed frames and its anchor to the real time clock.
+ *
+ * Every spectrum carries a sequence number: the number of samples the FFT stage has consumed up to the last sample of
+ * the spectrum, in hops (IqFft::sequence()). Audio blocks that did not arrive advance the sample clock as well, so
+ * consecutive spectra differ by exactly one and every spectrum that was lost on the way, overwritten before loop()
+ * picked it up, dropped for a missing block or left out of a file, leaves a gap. The number is 64 bit and does not
+ * wrap; it starts over with each boot of the sensor.
+ *
+ * Files that store sequence numbers (metrics version 2, raw version 4) anchor the frame they were created for to the
+ * RTC: the anchor holds the sequence of that frame, the RTC time at which its spectrum was complete (read in the audio
+ * interrupt, with the sub-second part of the 32768 Hz RTC counter) and the hop and sample rate, so frame n of the
+ * same boot is at
+ *   time + (n - sequence) * hop / sampleRate
+ * seconds. The anchors of two files of the same boot also tell how far sample clock and RTC drift apart.
+ *
+ * Anchor layout (20 bytes, all values little endian):
+ *  - sequence of the anchored frame (uint 8 bytes)
+ *  - RTC time of that frame in seconds since 1970 (uint 4 bytes)
+ *  - sub-second part in microseconds (uint 4 bytes)
+ *  - hop in samples (uint 2 bytes)
+ *  - sample rate in Hz (uint 2 bytes)
+ */
+namespace FrameClock
+{
+struct Time
+{
+    uint32_t seconds = 0; // since 1970
+    uint32_t micros = 0;  // 0 to 999999
+};
+
+struct Anchor
+{
+    uint64_t sequence = 0;
+    Time time;
+    uint16_t hop = 0;
+    uint16_t sampleRate = 0;
+};
+
+constexpr size_t anchorSize = 20;
+
+/// writes anchor into buffer (anchorSize bytes) and returns its size
+size_t writeAnchor(uint8_t* buffer, Anchor const& anchor);
+Anchor readAnchor(uint8_t const* data);
+
+/// seconds from the anchor to the frame with sequence, negative for frames before it
+double secondsSince(Anchor const& anchor, uint64_t sequence);
+} // namespace FrameClock
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+template <class Frame, size_t Capacity>
+class FramePool;
+
+/**
+ * @brief Shared read-only handle to a frame of a FramePool
+ *
+ * The frame stays untouched as long as any handle to it exists; copying a handle adds a holder, destroying or reset()
+ * removes it. Handles are meant for loop() only, they are not safe against interrupts.
+ */
+template <class Frame>
+class FrameRef
+{
+  public:
+    FrameRef() = default;
+    FrameRef(FrameRef const& other)
+        : frame(other.frame)
+        , holders(other.holders)
+    {
+        if(holders)
+            ++*holders;
+    }
+    FrameRef(FrameRef&& other)
+        : frame(other.frame)
+        , holders(other.holders)
+    {
+        other.frame = nullptr;
+        other.holders = nullptr;
+    }
+    FrameRef& operator=(FrameRef other)
+    {
+        swap(other);
+        return *this;
+    }
+    ~FrameRef() { reset(); }
+
+    void reset()
+    {
+        if(holders)
+            --*holders;
+        frame = nullptr;
+        holders = nullptr;
+    }
+
+    explicit operator bool() const { return frame != nullptr; }
+    Frame const& operator*() const { return *frame; }
+    Frame const* operator->() const { return frame; }
+    uint8_t useCount() const { return holders ? *holders : 0; }
+
+  private:
+    template <class, size_t>
+    friend class FramePool;
+
+    FrameRef(Frame* frame, uint8_t* holders)
+        : frame(frame)
+        , holders(holders)
+    {
+        ++*holders;
+    }
+
+    void swap(FrameRef& other)
+    {
+        Frame* const otherFrame = other.frame;
+        uint8_t* const otherHolders = other.holders;
+        other.frame = frame;
+        other.holders = holders;
+        frame = otherFrame;
+        holders = otherHolders;
+    }
+
+    Frame* frame = nullptr;
+    uint8_t* holders = nullptr;
+};
+
+/**
+ * @brief Fixed number of frames that are filled once and then shared between the consumers without copying
+ *
+ * The producer takes a free frame with acquire(), fills it through the returned pointer and hands copies of the
+ * handle to the consumers. A frame is only reused once the last handle is gone, so a slow consumer can keep its
+ * frame while acquisition continues with the others. If every frame is still held, acquire() fails and the frame
+ * has to be dropped; the pool never allocates.
+ */
+template <class Frame, size_t Capacity>
+class FramePool
+{
+    static_assert(Capacity > 0 && Capacity < 256, "unsupported pool size");
+
+  public:
+    struct Statistics
+    {
+        uint32_t acquired = 0;  // frames handed to the producer
+        uint32_t exhausted = 0; // acquire calls that failed because every frame was held
+        size_t maxInUse = 0;    // high-water mark of frames held at once
+    };
+
+  public:
+    /// writable frame for the producer or nullptr if every frame is held; ref becomes the first handle to it
+    Frame* acquire(FrameRef<Frame>& ref)
+    {
+        ref.reset();
+
+        size_t inUse = 0;
+        Frame* result = nullptr;
+        for(size_t i = 0; i < Capacity; i++)
+        {
+            if(holders[i] > 0)
+                inUse++;
+            else if(not result)
+            {
+                ref = FrameRef<Frame>(&frames[i], &holders[i]);
+                result = &frames[i];
+            }
+        }
+
+        if(not result)
+        {
+            stats.exhausted++;
+            return nullptr;
+        }
+
+        stats.acquired++;
+        if(inUse + 1 > stats.maxInUse)
+            stats.maxInUse = inUse + 1;
+        return result;
+    }
+
+    size_t capacity() const { return Capacity; }
+    size_t inUse() const
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < Capacity; i++)
+            count += holders[i] > 0;
+        return count;
+    }
+    Statistics const& statistics() const { return stats; }
+
+  private:
+    Frame frames[Capacity];
+    uint8_t holders[Capacity] = {};
+    Statistics stats;
+};
+
+#endif
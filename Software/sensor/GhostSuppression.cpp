@@ -0,0 +1,79 @@
+#include "GhostSuppression.h"
+
+#include "FastLog.h"
+
+#include <string.h>
+
+namespace
+{
+/// value without the ghost of mirror, not below the noise floor unless it already was
+inline float subtractGhost(float value, float mirror, float floor, float ratio)
+{
+    float const remaining = 1 - FastLog::dbToPower(mirror - value + ratio);
+    float const cleaned = value + FastLog::powerToDb(remaining); // minimumDb if nothing remains
+    float const lowest = value < floor ? value : floor;
+    return cleaned > lowest ? cleaned : lowest;
+}
+} // namespace
+
+template <class Layout>
+void GhostSuppression<Layout>::apply(float const* values, float* out, NoiseFloorEstimator<Layout> const& noiseFloor)
+{
+    if(out != values)
+        memcpy(out, values, binCount * sizeof(float));
+    if(not Layout::iqMeasurement)
+        return;
+
+    if(settings.adaptive)
+        estimate(out, noiseFloor);
+
+    // each pair only reads its own two bins, so the loop runs in place and without dependencies between the pairs
+    constexpr size_t c = center;
+    float const ratio = currentRatio + settings.margin;
+    for(size_t n = 1; n <= pairCount; n++)
+    {
+        float const forward = out[c + n];
+        float const reverse = out[c - n];
+        out[c + n] = subtractGhost(forward, reverse, noiseFloor[c + n], ratio);
+        out[c - n] = subtractGhost(reverse, forward, noiseFloor[c - n], ratio);
+    }
+}
+
+template <class Layout>
+void GhostSuppression<Layout>::estimate(float const* values, NoiseFloorEstimator<Layout> const& noiseFloor)
+{
+    // the strongest target of the frame whose ghost stands clear of the noise; the pedestrian range next to 0 Hz is
+    // left out, the leakage of the DC offset is in both directions there
+    constexpr size_t c = center;
+    float strongest = 0;
+    float measured = 0;
+    for(size_t n = Layout::detectionBegin - Layout::iqOffset; n <= pairCount; n++)
+    {
+        bool const forwardStronger = values[c + n] >= values[c - n];
+        size_t const target = forwardStronger ? c + n : c - n;
+        size_t const ghost = forwardStronger ? c - n : c + n;
+        float const distance = values[target] - noiseFloor[target];
+        float const ratio = values[ghost] - values[target];
+        if(values[ghost] - noiseFloor[ghost] >= settings.minGhostDistance && ratio <= settings.maxRatio &&
+           distance > strongest)
+        {
+            strongest = distance;
+            measured = ratio;
+        }
+    }
+    if(strongest > 0)
+    {
+        currentRatio += (measured - currentRatio) * settings.adaptRate;
+        estimates++;
+    }
+}
+
+// every supported layout is built, so a combination that does not compile shows up in any build
+template class GhostSuppression<SpectrumLayout<256, false>>;
+template class GhostSuppression<SpectrumLayout<256, true>>;
+template class GhostSuppression<SpectrumLayout<512, false>>;
+template class GhostSuppression<SpectrumLayout<512, true>>;
+template class GhostSuppression<SpectrumLayout<1024, false>>;
+template class GhostSuppression<SpectrumLayout<1024, true>>;
+template class GhostSuppression<SpectrumLayout<2048, false>>;
+template class GhostSuppression<SpectrumLayout<2048, true>>;
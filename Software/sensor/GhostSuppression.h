@@ -0,0 +1,87 @@
+#ifndef GHOSTSUPPRESSION_H
+#define GHOSTSUPPRESSION_H
+
+#include "SpectrumLayout.h"
+#include "noise_floor.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Removes the mirrored ghost of each target from an IQ spectrum before the detection.
+ *
+ * The residual I/Q imbalance after the correction (alpha, psi) leaves an image of every signal at the opposite
+ * frequency, ratio dB under it: a car approaching at 50 km/h also shows as a weak car leaving at 50 km/h. The stage
+ * subtracts the image in linear power, bin iqOffset + n from bin iqOffset - n and the other way round:
+ *
+ *     target(n) = power(n) - g power(-n),  g = 10^(ratio / 10)
+ *
+ * A bin that held only a ghost drops to the noise, a real target loses at most 10 log10(1 - g) as its mirror is weaker
+ * than itself. The second order term g^2 target(n) in power(n) is left out. Bins are never pulled below the noise floor
+ * unless they already were, so the ghosts are subtracted margin dB stronger than the ratio says: that covers the error
+ * of the estimate and the 1 dB steps of recorded spectra, and costs a real target 0.03 dB at -25 dB and 3 dB margin.
+ * Only a target in the other direction at the same speed and more than -(ratio + margin) dB weaker goes with the ghost.
+ * Unlike subtracting the mirrored spectrum in dB (subtract_ghost_signal.qmd), the levels of real targets stay as they
+ * are and there is no factor to tune per site.
+ *
+ * With adaptive set the ratio follows the site: in every frame the pair of bins with the strongest target whose
+ * ghost stands at least minGhostDistance over the noise floor (so the noise does not bias it) gives an estimate, the
+ * level difference of ghost and target. Pairs closer than maxRatio are two targets, not target and ghost, and are
+ * left out. The estimates are averaged in dB with adaptRate.
+ *
+ * Without IQ there is no mirror and the values are copied.
+ */
+template <class Layout>
+class GhostSuppression
+{
+  public:
+    static constexpr size_t binCount = Layout::numberOfFftBins;
+    // bin iqOffset in the analysed range and the pairs of mirrored bins around it; the first bin has no mirror
+    static constexpr size_t center = Layout::iqOffset - Layout::minBinIndex;
+    static constexpr size_t pairCount =
+        not Layout::iqMeasurement ? 0 : center < binCount - 1 - center ? center : binCount - 1 - center;
+
+    struct Settings
+    {
+        float ratio = -25;           // dB; power of the ghost relative to its target, the start value with adaptive
+        bool adaptive = true;        // estimate the ratio from strong targets
+        float adaptRate = 0.02f;     // weight of a new estimate
+        float minGhostDistance = 10; // dB; an estimate needs the ghost this far over the noise floor
+        float maxRatio = -10;        // dB; pairs closer than this are two targets
+        float margin = 3;            // dB; the ghosts are subtracted this much stronger than the ratio
+    };
+
+  public:
+    GhostSuppression() { reset(); }
+
+    void setSettings(Settings const& settings)
+    {
+        this->settings = settings;
+        reset();
+    }
+    Settings const& getSettings() const { return settings; }
+    /// back to the ratio of the settings
+    void reset()
+    {
+        currentRatio = settings.ratio;
+        estimates = 0;
+    }
+
+    /// the ratio the ghosts are subtracted with, in dB
+    float ratio() const { return currentRatio; }
+    uint32_t estimateCount() const { return estimates; }
+
+    /// values: the analysed bins in dBFS (index 0 is Layout::minBinIndex); writes them to out without the ghosts. out
+    /// may be values.
+    void apply(float const* values, float* out, NoiseFloorEstimator<Layout> const& noiseFloor);
+
+  private:
+    void estimate(float const* values, NoiseFloorEstimator<Layout> const& noiseFloor);
+
+  private:
+    Settings settings;
+    float currentRatio;
+    uint32_t estimates;
+};
+
+#endif
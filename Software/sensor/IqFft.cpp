@@ -0,0 +1,240 @@
+#include "IqFft.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__IMXRT1062__)
+#include <arm_const_structs.h>
+#include <arm_math.h>
+#endif
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+#if defined(__IMXRT1062__)
+arm_cfft_instance_f32 const* cmsisInstance(uint16_t fftWidth)
+{
+    switch(fftWidth)
+    {
+    case 16:
+        return &arm_cfft_sR_f32_len16;
+    case 32:
+        return &arm_cfft_sR_f32_len32;
+    case 64:
+        return &arm_cfft_sR_f32_len64;
+    case 128:
+        return &arm_cfft_sR_f32_len128;
+    case 256:
+        return &arm_cfft_sR_f32_len256;
+    case 512:
+        return &arm_cfft_sR_f32_len512;
+    case 1024:
+        return &arm_cfft_sR_f32_len1024;
+    case 2048:
+        return &arm_cfft_sR_f32_len2048;
+    default:
+        return &arm_cfft_sR_f32_len4096;
+    }
+}
+#endif
+} // namespace
+
+template <uint16_t FftWidth>
+IqFft<FftWidth>::IqFft()
+{
+#ifndef __IMXRT1062__
+    for(size_t k = 0; k < FftWidth / 2; k++)
+    {
+        twiddles[2 * k] = float(cos(2 * pi * k / FftWidth));
+        twiddles[2 * k + 1] = float(-sin(2 * pi * k / FftWidth));
+    }
+#endif
+    setWindow(window);
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::setWindow(FftWindow window)
+{
+    this->window = window;
+    for(size_t n = 0; n < FftWidth; n++)
+    {
+        double const x = 2 * pi * n / FftWidth;
+        double value = 1;
+        switch(window)
+        {
+        case FftWindow::Rectangular:
+            break;
+        case FftWindow::Hann:
+            value = 0.5 - 0.5 * cos(x);
+            break;
+        case FftWindow::Hamming:
+            value = 0.54 - 0.46 * cos(x);
+            break;
+        case FftWindow::BlackmanHarris:
+            value = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+            break;
+        }
+        windowTable[n] = float(value);
+    }
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::setHop(uint16_t hop)
+{
+    this->hop = hop < 1 ? 1 : hop > FftWidth ? FftWidth : hop;
+    historyPosition = 0;
+    filled = 0;
+    sinceSpectrum = 0;
+    hops = 0;
+    lastSequence = 0;
+}
+
+template <uint16_t FftWidth>
+size_t IqFft<FftWidth>::push(float const* i, float const* q, size_t count, float* spectrum)
+{
+    size_t completed = 0;
+    for(size_t n = 0; n < count; n++)
+    {
+        historyI[historyPosition] = i[n];
+        historyQ[historyPosition] = q[n];
+        historyPosition = (historyPosition + 1) % FftWidth;
+        if(filled < FftWidth)
+            filled++;
+
+        if(++sinceSpectrum < hop)
+            continue;
+        sinceSpectrum = 0;
+        hops++;
+        if(filled == FftWidth)
+        {
+            transformHistory(spectrum);
+            lastSequence = hops;
+            completed++;
+        }
+    }
+    return completed;
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::skip(size_t count)
+{
+    size_t const samples = sinceSpectrum + count;
+    hops += samples / hop;
+    sinceSpectrum = samples % hop;
+    filled = 0;
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::transform(float const* i, float const* q, float* spectrum)
+{
+    for(size_t n = 0; n < FftWidth; n++)
+    {
+        buffer[2 * n] = i[n] * windowTable[n];
+        buffer[2 * n + 1] = q[n] * windowTable[n];
+    }
+    fft();
+    writeSpectrum(spectrum);
+    spectra++;
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::transformHistory(float* spectrum)
+{
+    // the history is a ring, the oldest sample is at historyPosition
+    size_t const older = FftWidth - historyPosition;
+    for(size_t n = 0; n < older; n++)
+    {
+        buffer[2 * n] = historyI[historyPosition + n] * windowTable[n];
+        buffer[2 * n + 1] = historyQ[historyPosition + n] * windowTable[n];
+    }
+    for(size_t n = older; n < FftWidth; n++)
+    {
+        buffer[2 * n] = historyI[n - older] * windowTable[n];
+        buffer[2 * n + 1] = historyQ[n - older] * windowTable[n];
+    }
+    fft();
+    writeSpectrum(spectrum);
+    spectra++;
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::fft()
+{
+#if defined(__IMXRT1062__)
+    arm_cfft_f32(cmsisInstance(FftWidth), buffer, 0, 1);
+#else
+    // in place radix-2 decimation in time: bit reversed order first, then the butterflies
+    for(size_t n = 1, reversed = 0; n < FftWidth; n++)
+    {
+        size_t bit = FftWidth >> 1;
+        for(; reversed & bit; bit >>= 1)
+            reversed ^= bit;
+        reversed ^= bit;
+        if(n < reversed)
+        {
+            float const re = buffer[2 * n];
+            float const im = buffer[2 * n + 1];
+            buffer[2 * n] = buffer[2 * reversed];
+            buffer[2 * n + 1] = buffer[2 * reversed + 1];
+            buffer[2 * reversed] = re;
+            buffer[2 * reversed + 1] = im;
+        }
+    }
+
+    for(size_t length = 2; length <= FftWidth; length <<= 1)
+    {
+        size_t const half = length / 2;
+        size_t const step = FftWidth / length;
+        for(size_t start = 0; start < FftWidth; start += length)
+            for(size_t k = 0; k < half; k++)
+            {
+                float const wr = twiddles[2 * k * step];
+                float const wi = twiddles[2 * k * step + 1];
+                float* const a = &buffer[2 * (start + k)];
+                float* const b = &buffer[2 * (start + k + half)];
+                float const re = b[0] * wr - b[1] * wi;
+                float const im = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - re;
+                b[1] = a[1] - im;
+                a[0] += re;
+                a[1] += im;
+            }
+    }
+#endif
+}
+
+template <uint16_t FftWidth>
+void IqFft<FftWidth>::writeSpectrum(float* spectrum) const
+{
+    // a full scale sine has the amplitude FftWidth / 2 without window
+    static float const fullScaleDb = float(20 * log10(FftWidth / 2.0));
+    static float const toFullScale = float(1 / (FftWidth / 2.0 * (FftWidth / 2.0))); // for the linear power
+
+    // bin i holds the frequency FftWidth / 2 - i, see setXAxis(3) of the library
+    if(output == FftOutput::Power)
+    {
+        for(size_t i = 0; i < FftWidth; i++)
+        {
+            size_t const k = (FftWidth / 2 - i) & (FftWidth - 1);
+            float const re = buffer[2 * k];
+            float const im = buffer[2 * k + 1];
+            spectrum[i] = (re * re + im * im) * toFullScale;
+        }
+        return;
+    }
+    for(size_t i = 0; i < FftWidth; i++)
+    {
+        size_t const k = (FftWidth / 2 - i) & (FftWidth - 1);
+        float const re = buffer[2 * k];
+        float const im = buffer[2 * k + 1];
+        float const power = re * re + im * im;
+        spectrum[i] = power > 0 ? 10 * log10f(power) - fullScaleDb : minimumDb;
+    }
+}
+
+// the widths of SpectrumLayout
+template class IqFft<256>;
+template class IqFft<512>;
+template class IqFft<1024>;
+template class IqFft<2048>;
@@ -0,0 +1,104 @@
+#ifndef IQFFT_H
+#define IQFFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum class FftWindow : uint8_t
+{
+    Rectangular,
+    Hann,
+    Hamming,
+    BlackmanHarris, // 4 term, for strong signals next to weak ones
+};
+
+enum class FftOutput : uint8_t
+{
+    Dbfs,  // dB relative to a full scale sine, like FFT_DBFS of the library
+    Power, // linear power relative to a full scale sine: 10 log10 of it is the Dbfs output
+};
+
+/**
+ * Spectra of the complex signal I + jQ with overlapping frames.
+ *
+ * The samples are collected in a history of the last FftWidth samples; every hop samples the history is windowed and
+ * transformed. A hop of FftWidth is the frame sequence of the IQ analysers of the audio library, FftWidth / 2 or
+ * FftWidth / 4 give 50 % or 75 % overlap and two or four times as many spectra per second.
+ *
+ * The output matches AudioAnalyzeFFT*_IQ_F32 with setOutputType(FFT_DBFS) and setXAxis(3): bin i is the power of
+ * the frequency (FftWidth / 2 - i) * sampleRate / FftWidth in dB relative to a full scale sine, i.e. 0 Hz is at
+ * FftWidth / 2 and bin FftWidth / 2 - n mirrors bin FftWidth / 2 + n. As in the library the window gain is not
+ * compensated; the static noise floor table (noise_floor.cpp) was measured with the Hann window, other windows shift
+ * all levels by the difference of their gain. With setOutput(FftOutput::Power) the bins hold the linear power instead,
+ * which saves the log10f of every bin; the analysis converts only the bins it keeps (AudioResults::processPower).
+ *
+ * The samples are counted as sample clock (see FrameClock.h): a spectrum is completed every hop samples of the clock
+ * once the history is full, and sequence() is the clock at its last sample in hops. skip() advances the clock for
+ * samples that never arrived; the history starts over, so the next spectrum is the first one on the hop grid with
+ * a complete history again and the sequence numbers of the lost ones are left out.
+ *
+ * The transform is CMSIS arm_cfft_f32 on the Teensy and a radix-2 FFT elsewhere. Everything is allocated with the
+ * object; push() does not allocate and can run in the audio interrupt.
+ */
+template <uint16_t FftWidth>
+class IqFft
+{
+    static_assert(FftWidth >= 16 && FftWidth <= 4096 && (FftWidth & (FftWidth - 1)) == 0, "unsupported FFT width");
+
+  public:
+    static constexpr uint16_t fftWidth = FftWidth;
+    static constexpr float minimumDb = -193; // output of bins without any power
+
+  public:
+    IqFft();
+
+    void setWindow(FftWindow window);
+    FftWindow getWindow() const { return window; }
+
+    void setOutput(FftOutput output) { this->output = output; }
+    FftOutput getOutput() const { return output; }
+
+    /// samples from one spectrum to the next, 1 to FftWidth; restarts the history and the sample clock
+    void setHop(uint16_t hop);
+    uint16_t getHop() const { return hop; }
+
+    /// appends count samples; every completed spectrum is written to spectrum (FftWidth bins), the last one stays
+    /// there. Returns the number of completed spectra.
+    size_t push(float const* i, float const* q, size_t count, float* spectrum);
+    /// count samples were lost: the sample clock goes on, the history starts over
+    void skip(size_t count);
+    /// sample clock at the last sample of the last completed spectrum, in hops
+    uint64_t sequence() const { return lastSequence; }
+
+    /// spectrum of exactly FftWidth samples, independent of the history
+    void transform(float const* i, float const* q, float* spectrum);
+
+    uint32_t spectrumCount() const { return spectra; }
+
+  private:
+    void transformHistory(float* spectrum);
+    void fft();
+    void writeSpectrum(float* spectrum) const;
+
+  private:
+    FftWindow window = FftWindow::Hann;
+    FftOutput output = FftOutput::Dbfs;
+    uint16_t hop = FftWidth;
+
+    float windowTable[FftWidth];
+    float historyI[FftWidth];
+    float historyQ[FftWidth];
+    size_t historyPosition = 0; // next sample to overwrite, i.e. the oldest one
+    size_t filled = 0;          // samples in the history, at most FftWidth
+    size_t sinceSpectrum = 0;   // samples of the clock since the last hop
+    uint64_t hops = 0;          // sample clock in hops
+    uint64_t lastSequence = 0;
+
+    float buffer[2 * FftWidth]; // interleaved real and imaginary part
+#ifndef __IMXRT1062__
+    float twiddles[FftWidth]; // cos and -sin of 2 pi k / FftWidth for k < FftWidth / 2, interleaved
+#endif
+    uint32_t spectra = 0;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef IQFFTANALYZER_H
+#define IQFFTANALYZER_H
+
+#include <Audio.h>
+#include <AudioStream_F32.h>
+
+#include "IqFftOutput.h"
+
+/**
+ * IqFft as block of the audio library, in place of AudioAnalyzeFFT*_IQ_F32: input 0 is I, input 1 is Q.
+ *
+ * update() runs in the audio interrupt and transforms whenever a hop is complete; IqFftOutput hands the spectra over
+ * to loop() and counts the ones that were overwritten before. An audio cycle in which a block is missing advances the
+ * sample clock by AUDIO_BLOCK_SAMPLES, so the sequence numbers leave a gap for it. The capture time of a spectrum is
+ * read from the RTC in the interrupt that completes it, i.e. within one audio block of its last sample.
+ *
+ * AudioAnalyzeIqFft_F32 takes the float blocks of the 32 bit library, AudioAnalyzeIqFft_I16 the 16 bit blocks of the
+ * Teensy library for the fixed point graph (IqFftFixed, CITRAD_FIXED_POINT). Both share the interface of
+ * IqFftAnalyzerBase.
+ */
+template <uint16_t FftWidth, class Fft>
+class IqFftAnalyzerBase
+{
+  public:
+    void setWindow(FftWindow window)
+    {
+        __disable_irq();
+        output.setWindow(window);
+        __enable_irq();
+    }
+    void setHop(uint16_t hop)
+    {
+        __disable_irq();
+        output.setHop(hop);
+        __enable_irq();
+    }
+    /// dBFS or linear power; a spectrum in the hand-over buffers keeps the output it was computed with
+    void setOutput(FftOutput type)
+    {
+        __disable_irq();
+        output.setOutput(type);
+        __enable_irq();
+    }
+
+    /// true if there is a new spectrum; it is returned by getData() until the next call to available()
+    bool available()
+    {
+        if(not output.available())
+            return false;
+
+        __disable_irq();
+        output.handOver();
+        __enable_irq();
+        return true;
+    }
+    float* getData() { return output.data(); }
+    /// sample clock and RTC time of the spectrum of getData(), see FrameClock.h
+    uint64_t sequence() const { return output.sequence(); }
+    FrameClock::Time captureTime() const { return output.captureTime(); }
+
+    uint32_t spectrumCount() const { return output.spectrumCount(); }
+    uint32_t missedCount() const { return output.missedCount(); }
+    uint32_t droppedBlockCount() const { return output.droppedBlockCount(); }
+
+  protected:
+    /// the samples of one audio cycle, nullptr if a block is missing
+    template <typename Sample>
+    void process(Sample const* i, Sample const* q, size_t length)
+    {
+        if(output.update(i, q, length) > 0)
+            output.setCaptureTime(readRtc());
+    }
+
+  private:
+    /// the SNVS counter runs at 32768 Hz; it is read twice because the two registers do not change together
+    static FrameClock::Time readRtc()
+    {
+        uint32_t high = SNVS_HPRTCMR;
+        uint32_t low = SNVS_HPRTCLR;
+        for(;;)
+        {
+            uint32_t const nextHigh = SNVS_HPRTCMR;
+            uint32_t const nextLow = SNVS_HPRTCLR;
+            if(nextHigh == high and nextLow == low)
+                break;
+            high = nextHigh;
+            low = nextLow;
+        }
+        FrameClock::Time time;
+        time.seconds = (high << 17) | (low >> 15);
+        time.micros = uint32_t((uint64_t(low & 0x7FFF) * 1000000) >> 15);
+        return time;
+    }
+
+  protected:
+    IqFftOutput<FftWidth, Fft> output;
+};
+
+template <uint16_t FftWidth>
+class AudioAnalyzeIqFft_F32 : public AudioStream_F32, public IqFftAnalyzerBase<FftWidth, IqFft<FftWidth>>
+{
+  public:
+    AudioAnalyzeIqFft_F32()
+        : AudioStream_F32(2, inputQueue)
+    {}
+
+    void update() override
+    {
+        audio_block_f32_t* blockI = receiveReadOnly_f32(0);
+        audio_block_f32_t* blockQ = receiveReadOnly_f32(1);
+        if(blockI and blockQ)
+        {
+            size_t const length = blockI->length < blockQ->length ? blockI->length : blockQ->length;
+            this->process(blockI->data, blockQ->data, length);
+        }
+        else
+            this->template process<float>(nullptr, nullptr, AUDIO_BLOCK_SAMPLES);
+        if(blockI)
+            release(blockI);
+        if(blockQ)
+            release(blockQ);
+    }
+
+  private:
+    audio_block_f32_t* inputQueue[2];
+};
+
+template <uint16_t FftWidth>
+class AudioAnalyzeIqFft_I16 : public AudioStream, public IqFftAnalyzerBase<FftWidth, IqFftFixed<FftWidth>>
+{
+  public:
+    AudioAnalyzeIqFft_I16()
+        : AudioStream(2, inputQueue)
+    {}
+
+    /// IQ imbalance correction, done on the samples instead of by gain and mixer blocks
+    void setCorrection(float a, float c, float d)
+    {
+        __disable_irq();
+        this->output.setCorrection(a, c, d);
+        __enable_irq();
+    }
+
+    void update() override
+    {
+        audio_block_t* blockI = receiveReadOnly(0);
+        audio_block_t* blockQ = receiveReadOnly(1);
+        if(blockI and blockQ)
+            this->process(blockI->data, blockQ->data, AUDIO_BLOCK_SAMPLES);
+        else
+            this->template process<int16_t>(nullptr, nullptr, AUDIO_BLOCK_SAMPLES);
+        if(blockI)
+            release(blockI);
+        if(blockQ)
+            release(blockQ);
+    }
+
+  private:
+    audio_block_t* inputQueue[2];
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "IqFftFixed.h"
+
+#include <math.h>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+int16_t saturate(int32_t value)
+{
+    return value > 32767 ? 32767 : value < -32768 ? -32768 : int16_t(value);
+}
+
+/// coefficient from -4 to 4 in Q29
+int32_t toQ29(float value)
+{
+    double const scaled = double(value) * (1 << 29);
+    return scaled >= INT32_MAX ? INT32_MAX : scaled <= INT32_MIN ? INT32_MIN : int32_t(lrint(scaled));
+}
+
+/// a Q59 value rounded to Q30, saturated at twice full scale
+int32_t toQ30(int64_t value)
+{
+    int64_t const rounded = (value + (int64_t(1) << 28)) >> 29;
+    return rounded > INT32_MAX ? INT32_MAX : rounded < INT32_MIN ? INT32_MIN : int32_t(rounded);
+}
+
+/// an upper bound of |value| in its highest bit: |value| for positive values, |value| - 1 for negative ones
+uint32_t magnitudeBits(int32_t value)
+{
+    return uint32_t(value ^ (value >> 31));
+}
+
+/// right shift by 0, 1 or 2 bits with rounding
+int32_t shiftRight(int32_t value, int shift)
+{
+    return (value + ((1 << shift) >> 1)) >> shift;
+}
+
+/// bits to shift so that no value of the buffer exceeds 2^29 and the next butterflies cannot overflow
+int headroomShift(uint32_t bits)
+{
+    return bits >= (1u << 30) ? 2 : bits >= (1u << 29) ? 1 : 0;
+}
+
+/// the full product of a value and a Q31 twiddle, 2^31 times too large
+int64_t multiplyQ31(int32_t value, int32_t twiddle)
+{
+    return int64_t(value) * twiddle;
+}
+} // namespace
+
+template <uint16_t FftWidth>
+IqFftFixed<FftWidth>::IqFftFixed()
+{
+    for(size_t k = 0; k < FftWidth / 2; k++)
+    {
+        // cos(0) = 1 is one step short of 2^31
+        twiddles[2 * k] = int32_t(fmin(cos(2 * pi * k / FftWidth) * 2147483648.0, 2147483647.0));
+        twiddles[2 * k + 1] = int32_t(fmin(-sin(2 * pi * k / FftWidth) * 2147483648.0, 2147483647.0));
+    }
+    setWindow(window);
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::setWindow(FftWindow window)
+{
+    this->window = window;
+    for(size_t n = 0; n < FftWidth; n++)
+    {
+        double const x = 2 * pi * n / FftWidth;
+        double value = 1;
+        switch(window)
+        {
+        case FftWindow::Rectangular:
+            break;
+        case FftWindow::Hann:
+            value = 0.5 - 0.5 * cos(x);
+            break;
+        case FftWindow::Hamming:
+            value = 0.54 - 0.46 * cos(x);
+            break;
+        case FftWindow::BlackmanHarris:
+            value = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+            break;
+        }
+        windowTable[n] = saturate(int32_t(lrint(value * 32768)));
+    }
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::setCorrection(float a, float c, float d)
+{
+    correctionA = toQ29(a);
+    correctionC = toQ29(c);
+    correctionD = toQ29(d);
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::setHop(uint16_t hop)
+{
+    this->hop = hop < 1 ? 1 : hop > FftWidth ? FftWidth : hop;
+    historyPosition = 0;
+    filled = 0;
+    sinceSpectrum = 0;
+    hops = 0;
+    lastSequence = 0;
+}
+
+template <uint16_t FftWidth>
+int16_t IqFftFixed<FftWidth>::toQ15(float sample)
+{
+    float const scaled = sample * 32768;
+    return scaled >= 32767 ? 32767 : scaled <= -32768 ? -32768 : int16_t(lrintf(scaled));
+}
+
+template <uint16_t FftWidth>
+size_t IqFftFixed<FftWidth>::push(int16_t const* i, int16_t const* q, size_t count, float* spectrum)
+{
+    size_t completed = 0;
+    for(size_t n = 0; n < count; n++)
+        append(i[n], q[n], spectrum, completed);
+    return completed;
+}
+
+template <uint16_t FftWidth>
+size_t IqFftFixed<FftWidth>::push(float const* i, float const* q, size_t count, float* spectrum)
+{
+    size_t completed = 0;
+    for(size_t n = 0; n < count; n++)
+        append(toQ15(i[n]), toQ15(q[n]), spectrum, completed);
+    return completed;
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::append(int16_t i, int16_t q, float* spectrum, size_t& completed)
+{
+    historyI[historyPosition] = i;
+    historyQ[historyPosition] = q;
+    historyPosition = (historyPosition + 1) % FftWidth;
+    if(filled < FftWidth)
+        filled++;
+
+    if(++sinceSpectrum < hop)
+        return;
+    sinceSpectrum = 0;
+    hops++;
+    if(filled == FftWidth)
+    {
+        transformHistory(spectrum);
+        lastSequence = hops;
+        completed++;
+    }
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::skip(size_t count)
+{
+    size_t const samples = sinceSpectrum + count;
+    hops += samples / hop;
+    sinceSpectrum = samples % hop;
+    filled = 0;
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::transform(int16_t const* i, int16_t const* q, float* spectrum)
+{
+    uint32_t bits = 0;
+    for(size_t n = 0; n < FftWidth; n++)
+    {
+        buffer[2 * n] = int32_t(i[n]) * windowTable[n]; // Q30
+        buffer[2 * n + 1] = int32_t(q[n]) * windowTable[n];
+        bits |= magnitudeBits(buffer[2 * n]) | magnitudeBits(buffer[2 * n + 1]);
+    }
+    fft(bits);
+    writeSpectrum(spectrum);
+    spectra++;
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::transformHistory(float* spectrum)
+{
+    // the history is a ring, the oldest sample is at historyPosition
+    uint32_t bits = 0;
+    size_t const older = FftWidth - historyPosition;
+    for(size_t n = 0; n < FftWidth; n++)
+    {
+        size_t const index = n < older ? historyPosition + n : n - older;
+        int64_t const i = historyI[index];
+        int64_t const q = historyQ[index];
+        // corrected sample in Q44, windowed in Q59 and rounded to Q30
+        buffer[2 * n] = toQ30((correctionA * i) * windowTable[n]);
+        buffer[2 * n + 1] = toQ30((correctionC * i + correctionD * q) * windowTable[n]);
+        bits |= magnitudeBits(buffer[2 * n]) | magnitudeBits(buffer[2 * n + 1]);
+    }
+    fft(bits);
+    writeSpectrum(spectrum);
+    spectra++;
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::fft(uint32_t bits)
+{
+    // in place radix-2 decimation in time like the float version, bit reversed order first
+    for(size_t n = 1, reversed = 0; n < FftWidth; n++)
+    {
+        size_t bit = FftWidth >> 1;
+        for(; reversed & bit; bit >>= 1)
+            reversed ^= bit;
+        reversed ^= bit;
+        if(n < reversed)
+        {
+            int32_t const re = buffer[2 * n];
+            int32_t const im = buffer[2 * n + 1];
+            buffer[2 * n] = buffer[2 * reversed];
+            buffer[2 * n + 1] = buffer[2 * reversed + 1];
+            buffer[2 * reversed] = re;
+            buffer[2 * reversed + 1] = im;
+        }
+    }
+
+    // each stage applies the shift the values of the stage before need, while reading them
+    exponent = 0;
+    for(size_t length = 2; length <= FftWidth; length <<= 1)
+    {
+        int const shift = headroomShift(bits);
+        exponent += shift;
+        bits = 0;
+
+        size_t const half = length / 2;
+        size_t const step = FftWidth / length;
+        for(size_t start = 0; start < FftWidth; start += length)
+            for(size_t k = 0; k < half; k++)
+            {
+                int32_t const wr = twiddles[2 * k * step];
+                int32_t const wi = twiddles[2 * k * step + 1];
+                int32_t* const a = &buffer[2 * (start + k)];
+                int32_t* const b = &buffer[2 * (start + k + half)];
+                int32_t const ar = shiftRight(a[0], shift);
+                int32_t const ai = shiftRight(a[1], shift);
+                int32_t const br = shiftRight(b[0], shift);
+                int32_t const bi = shiftRight(b[1], shift);
+                int32_t const re = int32_t((multiplyQ31(br, wr) - multiplyQ31(bi, wi) + (int64_t(1) << 30)) >> 31);
+                int32_t const im = int32_t((multiplyQ31(br, wi) + multiplyQ31(bi, wr) + (int64_t(1) << 30)) >> 31);
+                b[0] = ar - re;
+                b[1] = ai - im;
+                a[0] = ar + re;
+                a[1] = ai + im;
+                bits |= magnitudeBits(a[0]) | magnitudeBits(a[1]) | magnitudeBits(b[0]) | magnitudeBits(b[1]);
+            }
+    }
+}
+
+template <uint16_t FftWidth>
+void IqFftFixed<FftWidth>::writeSpectrum(float* spectrum) const
+{
+    // the buffer holds the float transform of IqFft in units of 2^(exponent - 30)
+    static float const fullScaleDb = float(20 * log10(FftWidth / 2.0));
+    static float const toFullScale = float(1 / (FftWidth / 2.0 * (FftWidth / 2.0)));
+    float const scale = ldexpf(1, exponent - 30);
+
+    // bin i holds the frequency FftWidth / 2 - i, see setXAxis(3) of the library
+    for(size_t i = 0; i < FftWidth; i++)
+    {
+        size_t const k = (FftWidth / 2 - i) & (FftWidth - 1);
+        float const re = float(buffer[2 * k]) * scale;
+        float const im = float(buffer[2 * k + 1]) * scale;
+        float const power = re * re + im * im;
+        if(output == FftOutput::Power)
+            spectrum[i] = power * toFullScale;
+        else
+            spectrum[i] = power > 0 ? 10 * log10f(power) - fullScaleDb : minimumDb;
+    }
+}
+
+// the widths of SpectrumLayout
+template class IqFftFixed<256>;
+template class IqFftFixed<512>;
+template class IqFftFixed<1024>;
+template class IqFftFixed<2048>;
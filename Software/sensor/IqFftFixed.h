@@ -0,0 +1,100 @@
+#ifndef IQFFTFIXED_H
+#define IQFFTFIXED_H
+
+#include "IqFft.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * IqFft in fixed point, for the 16 bit audio graph of CITRAD_FIXED_POINT (see AudioSystem.h): the samples of the I2S
+ * input are kept as they come from the codec (Q15), corrected for the IQ imbalance, windowed and transformed in
+ * integers. Only the bins of the output are floats, in the same dBFS or linear power as IqFft.
+ *
+ * - history and window table: Q15, half the RAM of the float version
+ * - IQ correction: I' = a I, Q' = c I + d Q with the coefficients in Q29 (-4 to 4), the same correction the float
+ *   graph does with AudioEffectGain_F32 and AudioMixer4_F32 (AudioSystem::updateIQ). It is applied together with the
+ *   window when a spectrum is transformed, so the corrected samples are not rounded to 16 bits again.
+ * - FFT: radix-2 in Q31 with block floating point. The windowed samples start as Q30; before each stage the buffer is
+ *   shifted right by the bits its largest value needs to stay clear of overflow in the next butterflies, and the
+ *   shifts are counted as the block exponent. A weak signal keeps all bits, a full scale one loses at most one bit
+ *   per stage. Twiddles are Q31.
+ *
+ * The rounding in the FFT stays far below the 16 bit samples; fixedcheck measures the difference to the float path.
+ * The interface and the sample clock are the ones of IqFft.
+ */
+template <uint16_t FftWidth>
+class IqFftFixed
+{
+    static_assert(FftWidth >= 16 && FftWidth <= 4096 && (FftWidth & (FftWidth - 1)) == 0, "unsupported FFT width");
+
+  public:
+    static constexpr uint16_t fftWidth = FftWidth;
+    static constexpr float minimumDb = IqFft<FftWidth>::minimumDb;
+
+  public:
+    IqFftFixed();
+
+    void setWindow(FftWindow window);
+    FftWindow getWindow() const { return window; }
+
+    void setOutput(FftOutput output) { this->output = output; }
+    FftOutput getOutput() const { return output; }
+
+    /// IQ imbalance correction from the next spectrum on, see above; a = d = 1, c = 0 leaves the samples as they are
+    void setCorrection(float a, float c, float d);
+
+    /// samples from one spectrum to the next, 1 to FftWidth; restarts the history and the sample clock
+    void setHop(uint16_t hop);
+    uint16_t getHop() const { return hop; }
+
+    /// appends count samples (Q15); every completed spectrum is written to spectrum (FftWidth bins), the last one
+    /// stays there. Returns the number of completed spectra.
+    size_t push(int16_t const* i, int16_t const* q, size_t count, float* spectrum);
+    /// the same for samples from -1 to 1, rounded to Q15 like the codec does
+    size_t push(float const* i, float const* q, size_t count, float* spectrum);
+    /// count samples were lost: the sample clock goes on, the history starts over
+    void skip(size_t count);
+    /// sample clock at the last sample of the last completed spectrum, in hops
+    uint64_t sequence() const { return lastSequence; }
+
+    /// spectrum of exactly FftWidth samples, independent of the history (and of the IQ correction)
+    void transform(int16_t const* i, int16_t const* q, float* spectrum);
+
+    uint32_t spectrumCount() const { return spectra; }
+    /// right shifts of the block floating point in the last spectrum
+    int blockExponent() const { return exponent; }
+
+    static int16_t toQ15(float sample);
+
+  private:
+    void append(int16_t i, int16_t q, float* spectrum, size_t& completed);
+    void transformHistory(float* spectrum);
+    /// bits: magnitudeBits of all values ORed, for the shift of the first stage
+    void fft(uint32_t bits);
+    void writeSpectrum(float* spectrum) const;
+
+  private:
+    FftWindow window = FftWindow::Hann;
+    FftOutput output = FftOutput::Dbfs;
+    uint16_t hop = FftWidth;
+    int32_t correctionA = 1 << 29;
+    int32_t correctionC = 0;
+    int32_t correctionD = 1 << 29;
+
+    int16_t windowTable[FftWidth];
+    int16_t historyI[FftWidth];
+    int16_t historyQ[FftWidth];
+    size_t historyPosition = 0; // next sample to overwrite, i.e. the oldest one
+    size_t filled = 0;          // samples in the history, at most FftWidth
+    size_t sinceSpectrum = 0;   // samples of the clock since the last hop
+    uint64_t hops = 0;          // sample clock in hops
+    uint64_t lastSequence = 0;
+
+    int32_t buffer[2 * FftWidth]; // interleaved real and imaginary part
+    int32_t twiddles[FftWidth];   // cos and -sin of 2 pi k / FftWidth for k < FftWidth / 2 in Q31, interleaved
+    int exponent = 0;
+    uint32_t spectra = 0;
+};
+
+#endif
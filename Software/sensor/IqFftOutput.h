@@ -0,0 +1,104 @@
+#ifndef IQFFTOUTPUT_H
+#define IQFFTOUTPUT_H
+
+#include "FrameClock.h"
+#include "IqFft.h"
+#include "IqFftFixed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * IqFft with the double buffer that hands its spectra from the audio interrupt to loop(), together with sequence
+ * number and capture time of each one (see FrameClock.h).
+ *
+ * update() takes the blocks of one audio cycle; a cycle whose blocks did not arrive (no free block in the pool) is
+ * passed as nullptr and advances the sample clock without samples. A new spectrum goes into the buffer that was not
+ * handed out by the last handOver(), so data() stays untouched while loop() analyses it. If loop() does not pick up a
+ * spectrum before the next one is complete, the older one is overwritten and counted as missed.
+ *
+ * Fft is IqFft with float samples or IqFftFixed with 16 bit samples (CITRAD_FIXED_POINT).
+ *
+ * Not synchronised: on the sensor the analyser of IqFftAnalyzer.h calls update() in the audio interrupt and
+ * handOver() with interrupts disabled. The host tools drive it directly.
+ */
+template <uint16_t FftWidth, class Fft = IqFft<FftWidth>>
+class IqFftOutput
+{
+  public:
+    void setWindow(FftWindow window) { fft.setWindow(window); }
+    void setOutput(FftOutput output) { fft.setOutput(output); }
+    /// IQ imbalance correction of IqFftFixed
+    void setCorrection(float a, float c, float d) { fft.setCorrection(a, c, d); }
+    void setHop(uint16_t hop)
+    {
+        fft.setHop(hop);
+        ready = false;
+    }
+    uint16_t getHop() const { return fft.getHop(); }
+
+    /// one block of I and Q samples, both nullptr if the block is missing; returns the number of completed spectra
+    template <typename Sample>
+    size_t update(Sample const* i, Sample const* q, size_t length)
+    {
+        blocks++;
+        if(not i or not q)
+        {
+            droppedBlocks++;
+            fft.skip(length);
+            return 0;
+        }
+
+        uint8_t const writeIndex = 1 - readIndex;
+        size_t const completed = fft.push(i, q, length, buffers[writeIndex].bins);
+        if(completed > 0)
+        {
+            missed += completed - 1 + (ready ? 1 : 0);
+            buffers[writeIndex].sequence = fft.sequence();
+            ready = true;
+        }
+        return completed;
+    }
+    size_t update(decltype(nullptr), decltype(nullptr), size_t length)
+    {
+        return update<float>(nullptr, nullptr, length);
+    }
+    /// time at which the spectrum of the last update() was complete; set right after update() returned spectra
+    void setCaptureTime(FrameClock::Time time) { buffers[1 - readIndex].captureTime = time; }
+
+    /// true if there is a spectrum that was not handed over yet
+    bool available() const { return ready; }
+    /// makes the newest spectrum the one of data(), sequence() and captureTime()
+    void handOver()
+    {
+        readIndex = 1 - readIndex;
+        ready = false;
+    }
+    float* data() { return buffers[readIndex].bins; }
+    uint64_t sequence() const { return buffers[readIndex].sequence; }
+    FrameClock::Time captureTime() const { return buffers[readIndex].captureTime; }
+
+    uint32_t spectrumCount() const { return fft.spectrumCount(); }
+    /// spectra overwritten before they were handed over
+    uint32_t missedCount() const { return missed; }
+    uint32_t blockCount() const { return blocks; }
+    uint32_t droppedBlockCount() const { return droppedBlocks; }
+
+  private:
+    struct Buffer
+    {
+        float bins[FftWidth];
+        uint64_t sequence = 0;
+        FrameClock::Time captureTime;
+    };
+
+    Fft fft;
+    Buffer buffers[2];
+    volatile uint8_t readIndex = 0; // buffer handed out by handOver(), update() writes the other one
+    volatile bool ready = false;
+    volatile uint32_t missed = 0;
+    volatile uint32_t blocks = 0;
+    volatile uint32_t droppedBlocks = 0;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "MetricsFormat.h"
+
+#include <string.h>
+
+size_t MetricsFormat::writeHeader(uint8_t* buffer, uint32_t creationTime, FrameClock::Anchor const& anchor)
+{
+    size_t length = 0;
+    auto const append = [&](void const* data, size_t size) {
+        memcpy(buffer + length, data, size);
+        length += size;
+    };
+
+    uint16_t const recordSize = sizeof(Record);
+    uint8_t const count = fieldCount;
+    uint16_t headerSize = 0; // patched below
+
+    append(magic, sizeof(magic));
+    append(&version, 2);
+    append(&headerSize, 2);
+    append(&creationTime, 4);
+    append(&recordSize, 2);
+    append(&count, 1);
+
+    for(auto const& field : fields)
+    {
+        uint8_t const nameLength = strlen(field.name);
+        append(&field.type, 1);
+        append(&field.offset, 1);
+        append(&nameLength, 1);
+        append(field.name, nameLength);
+    }
+    length += FrameClock::writeAnchor(buffer + length, anchor);
+
+    headerSize = length;
+    memcpy(buffer + 6, &headerSize, 2);
+    return length;
+}
@@ -0,0 +1,84 @@
+#ifndef METRICSFORMAT_H
+#define METRICSFORMAT_H
+
+#include "FrameClock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Binary replacement for the per-frame csv metrics table.
+ *
+ * A file starts with a self describing header:
+ *  - magic "CRMT" (4 bytes)
+ *  - version (uint 2 bytes)
+ *  - header size in bytes including the magic (uint 2 bytes)
+ *  - timestamp of file creation (uint 4 bytes)
+ *  - record size in bytes (uint 2 bytes)
+ *  - field count (uint 1 byte)
+ *  - per field: type (uint 1 byte), offset in the record (uint 1 byte), name length (uint 1 byte), name
+ *  - since version 2: anchor of the sample clock (FrameClock.h, 20 bytes) at the frame the file was created for
+ *
+ * followed by fixed size records. The field order of the header is the column order of the csv table, the names are
+ * the csv column names. All values are little endian. Version 2 added the sequence field, the sample clock of the
+ * frame (FrameClock.h): a reader tells from it how many frames are missing between two records and in front of the
+ * first record of a file.
+ */
+namespace MetricsFormat
+{
+constexpr char magic[4] = {'C', 'R', 'M', 'T'};
+constexpr uint16_t version = 2;
+
+enum class FieldType : uint8_t
+{
+    UInt8 = 1,
+    UInt32 = 2,
+    Float32 = 3,
+    UInt64 = 4,
+};
+
+#pragma pack(push, 1)
+struct Record
+{
+    uint32_t timestamp; // ms since start of the sensor
+    float speed;
+    float speed_reverse;
+    float strength;
+    float strength_reverse;
+    float mean_amplitude;
+    float mean_amplitude_reverse;
+    float pedestrian_mean_amplitude;
+    uint8_t bins_with_signal;
+    uint8_t bins_with_signal_reverse;
+    uint64_t sequence;
+};
+#pragma pack(pop)
+
+struct Field
+{
+    FieldType type;
+    uint8_t offset;
+    char const* name;
+};
+
+constexpr Field fields[] = {
+    {FieldType::UInt32, offsetof(Record, timestamp), "timestamp"},
+    {FieldType::Float32, offsetof(Record, speed), "speed"},
+    {FieldType::Float32, offsetof(Record, speed_reverse), "speed_reverse"},
+    {FieldType::Float32, offsetof(Record, strength), "strength"},
+    {FieldType::Float32, offsetof(Record, strength_reverse), "strength_reverse"},
+    {FieldType::Float32, offsetof(Record, mean_amplitude), "mean_amplitude"},
+    {FieldType::Float32, offsetof(Record, mean_amplitude_reverse), "mean_amplitude_reverse"},
+    {FieldType::UInt8, offsetof(Record, bins_with_signal), "bins_with_signal"},
+    {FieldType::UInt8, offsetof(Record, bins_with_signal_reverse), "bins_with_signal_reverse"},
+    {FieldType::Float32, offsetof(Record, pedestrian_mean_amplitude), "pedestrian_mean_amplitude"},
+    {FieldType::UInt64, offsetof(Record, sequence), "sequence"},
+};
+constexpr size_t fieldCount = sizeof(fields) / sizeof(fields[0]);
+
+/// writes the header into buffer and returns its size; buffer has to hold at least maxHeaderSize bytes
+size_t writeHeader(uint8_t* buffer, uint32_t creationTime, FrameClock::Anchor const& anchor);
+constexpr size_t maxHeaderSize = 15 + fieldCount * (3 + 32) + FrameClock::anchorSize;
+} // namespace MetricsFormat
+
+#endif
@@ -0,0 +1,80 @@
+#include "Profiler.h"
+
+void Profiler::Histogram::add(uint32_t micros)
+{
+    count++;
+    totalMicros += micros;
+    if(micros > maxMicros)
+        maxMicros = micros;
+    buckets[bucket(micros)]++;
+}
+
+char const* Profiler::stageName(Stage stage)
+{
+    switch(stage)
+    {
+    case Wait:
+        return "wait";
+    case Service:
+        return "service";
+    case Inputs:
+        return "inputs";
+    case Process:
+        return "process";
+    case RawData:
+        return "raw";
+    case CsvData:
+        return "csv";
+    case MetricsData:
+        return "metrics";
+    case SummaryData:
+        return "summary";
+    case EventData:
+        return "events";
+    case SerialOutput:
+        return "serial";
+    case Frame:
+        return "frame";
+    default:
+        return "?";
+    }
+}
+
+size_t Profiler::bucket(uint32_t micros)
+{
+    // index of the highest set bit, a single instruction (clz) on the M7
+    if(micros < 2)
+        return 0;
+    size_t const highestBit = 31 - __builtin_clz(micros);
+    return highestBit < bucketCount ? highestBit : bucketCount - 1;
+}
+
+Profiler::Profiler(uint32_t framePeriodMicros)
+    : periodMicros(framePeriodMicros)
+{}
+
+void Profiler::frameDone(uint32_t timestampMs, uint32_t micros)
+{
+    add(Frame, micros);
+    if(micros > periodMicros)
+        overrunFrames++;
+
+    // the FFT only keeps its latest output, frames that were not picked up in time leave a gap in the timestamps
+    if(hasTimestamp)
+    {
+        uint64_t const gapMicros = uint64_t(timestampMs - lastTimestampMs) * 1000;
+        if(2 * gapMicros > 3 * uint64_t(periodMicros))
+            dropped += uint32_t((gapMicros + periodMicros / 2) / periodMicros) - 1;
+    }
+    lastTimestampMs = timestampMs;
+    hasTimestamp = true;
+}
+
+void Profiler::reset()
+{
+    for(auto& histogram : histograms)
+        histogram = Histogram();
+    overrunFrames = 0;
+    dropped = 0;
+    hasTimestamp = false;
+}
@@ -0,0 +1,155 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__IMXRT1062__)
+#include <Arduino.h> // ARM_DWT_CYCCNT, F_CPU_ACTUAL
+#else
+#include <chrono>
+#endif
+
+/**
+ * Time spent in the stages of loop(), so stalls can be attributed to the SD card, the serial port or the analysis.
+ *
+ * On the Teensy the stages are timed with the DWT cycle counter (one load per timestamp), on the host with
+ * std::chrono. Each stage keeps a histogram with power of two buckets: bucket 0 counts durations below 2 us, bucket
+ * i those from 2^i to 2^(i+1) - 1 us and the last one everything longer. A frame whose processing took longer than
+ * one FFT period is counted as overrun; a gap between two frames of more than 1.5 periods counts the frames the FFT
+ * produced in between as dropped. The cycle counter wraps after about 7 s at 600 MHz, longer stages are not timed
+ * correctly.
+ */
+class Profiler
+{
+  public:
+    enum Stage : uint8_t
+    {
+        Wait,         // from the end of a frame until the next FFT frame is available
+        Service,      // one slice of SD writes while waiting
+        Inputs,       // serial commands
+        Process,      // analysis of the FFT frame
+        RawData,      // raw spectrum into the SD ring
+        CsvData,      // csv line into the SD ring
+        MetricsData,  // metrics record into the SD ring
+        SummaryData,  // spectrogram summaries, their records into the SD ring
+        EventData,    // passage tracking and its events into the SD ring
+        SerialOutput, // spectrum to the serial port
+        Frame,        // everything from the FFT frame being available until loop() returns
+        StageCount
+    };
+
+    static constexpr size_t bucketCount = 20; // the last bucket starts at 524 ms
+
+    struct Histogram
+    {
+        uint32_t count = 0;
+        uint64_t totalMicros = 0;
+        uint32_t maxMicros = 0;
+        uint32_t buckets[bucketCount] = {};
+
+        void add(uint32_t micros);
+        uint32_t meanMicros() const { return count > 0 ? uint32_t(totalMicros / count) : 0; }
+    };
+
+    /// times the lifetime of the scope as one sample of a stage
+    class Scope
+    {
+      public:
+        Scope(Profiler& profiler, Stage stage)
+            : profiler(profiler)
+            , stage(stage)
+            , start(ticks())
+        {}
+        ~Scope() { profiler.add(stage, ticksToMicros(ticks() - start)); }
+
+      private:
+        Profiler& profiler;
+        Stage const stage;
+        uint32_t const start;
+    };
+
+  public:
+    static char const* stageName(Stage stage);
+    static size_t bucket(uint32_t micros);
+    static uint32_t bucketStartMicros(size_t bucket) { return bucket == 0 ? 0 : uint32_t(1) << bucket; }
+
+#if defined(__IMXRT1062__)
+    static uint32_t ticks() { return ARM_DWT_CYCCNT; }
+    static uint32_t ticksToMicros(uint32_t ticks) { return ticks / (F_CPU_ACTUAL / 1000000); }
+#else
+    static uint32_t ticks()
+    {
+        using namespace std::chrono;
+        return uint32_t(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+    static uint32_t ticksToMicros(uint32_t ticks) { return ticks; }
+#endif
+
+    explicit Profiler(uint32_t framePeriodMicros);
+
+    void add(Stage stage, uint32_t micros) { histograms[stage].add(micros); }
+    /// counts the frame (timestamp from millis()) with the duration of its processing
+    void frameDone(uint32_t timestampMs, uint32_t micros);
+    void reset();
+
+    Histogram const& histogram(Stage stage) const { return histograms[stage]; }
+    uint32_t frames() const { return histograms[Frame].count; }
+    uint32_t overruns() const { return overrunFrames; }
+    uint32_t droppedFrames() const { return dropped; }
+    uint32_t framePeriodMicros() const { return periodMicros; }
+
+    /// one line per stage that has samples, e.g. "process: n 5000, mean 11, max 40 us | 8:4000 16:1000"
+    template <class Out>
+    void printTo(Out& out) const;
+
+  private:
+    uint32_t const periodMicros;
+    Histogram histograms[StageCount];
+    uint32_t overrunFrames = 0;
+    uint32_t dropped = 0;
+    uint32_t lastTimestampMs = 0;
+    bool hasTimestamp = false;
+};
+
+template <class Out>
+void Profiler::printTo(Out& out) const
+{
+    out.print("profile: frames ");
+    out.print(frames());
+    out.print(", overruns ");
+    out.print(overrunFrames);
+    out.print(" (> ");
+    out.print(periodMicros);
+    out.print(" us), dropped ");
+    out.println(dropped);
+
+    for(size_t stage = 0; stage < StageCount; stage++)
+    {
+        Histogram const& histogram = histograms[stage];
+        if(histogram.count == 0)
+            continue;
+
+        out.print("  ");
+        out.print(stageName(Stage(stage)));
+        out.print(": n ");
+        out.print(histogram.count);
+        out.print(", mean ");
+        out.print(histogram.meanMicros());
+        out.print(", max ");
+        out.print(histogram.maxMicros);
+        out.print(" us |");
+        for(size_t i = 0; i < bucketCount; i++)
+        {
+            if(histogram.buckets[i] == 0)
+                continue;
+            out.print(" ");
+            out.print(bucketStartMicros(i));
+            out.print(":");
+            out.print(histogram.buckets[i]);
+        }
+        out.println();
+    }
+}
+
+#endif
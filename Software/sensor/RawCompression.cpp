@@ -0,0 +1,196 @@
+#include "RawCompression.h"
+
+#include <string.h>
+
+namespace
+{
+constexpr uint8_t maxRiceParameter = 7;
+constexpr uint32_t escapeQuotient = 15; // quotients from here on are written as escape + 8 bit value
+
+inline uint8_t zigzag(uint8_t value, uint8_t prediction)
+{
+    int8_t const delta = static_cast<int8_t>(value - prediction);
+    return static_cast<uint8_t>((delta << 1) ^ (delta >> 7));
+}
+
+inline uint8_t unzigzag(uint32_t code, uint8_t prediction)
+{
+    int8_t const delta = static_cast<int8_t>((code >> 1) ^ -(code & 1));
+    return static_cast<uint8_t>(prediction + delta);
+}
+
+class BitWriter
+{
+  public:
+    BitWriter(uint8_t* out, size_t capacity)
+        : out(out)
+        , capacity(capacity)
+    {}
+
+    void put(uint32_t bits, uint8_t count) // count <= 24
+    {
+        accumulator = (accumulator << count) | bits;
+        pending += count;
+        while(pending >= 8)
+        {
+            pending -= 8;
+            if(length == capacity)
+            {
+                overflow = true;
+                return;
+            }
+            out[length++] = static_cast<uint8_t>(accumulator >> pending);
+        }
+    }
+
+    size_t finish()
+    {
+        if(pending > 0)
+            put(0, 8 - pending);
+        return length;
+    }
+
+    bool overflow = false;
+
+  private:
+    uint8_t* const out;
+    size_t const capacity;
+    size_t length = 0;
+    uint32_t accumulator = 0;
+    uint8_t pending = 0;
+};
+
+class BitReader
+{
+  public:
+    BitReader(uint8_t const* in, size_t size)
+        : in(in)
+        , size(size)
+    {}
+
+    uint32_t get(uint8_t count) // count <= 24
+    {
+        while(pending < count)
+        {
+            accumulator = (accumulator << 8) | (position < size ? in[position] : 0);
+            if(position++ >= size)
+                overrun = true;
+            pending += 8;
+        }
+        pending -= count;
+        return (accumulator >> pending) & ((1u << count) - 1);
+    }
+
+    bool overrun = false;
+
+  private:
+    uint8_t const* const in;
+    size_t const size;
+    size_t position = 0;
+    uint32_t accumulator = 0;
+    uint8_t pending = 0;
+};
+} // namespace
+
+void RawCompression::Encoder::reset(uint16_t keyFrameInterval)
+{
+    this->keyFrameInterval = keyFrameInterval;
+    needsKeyFrame = true;
+}
+
+size_t RawCompression::Encoder::encode(uint8_t const* bins, size_t binCount, uint8_t* out, uint8_t& flags)
+{
+    if(binCount > maxBinCount)
+        binCount = maxBinCount;
+
+    bool const keyFrame = needsKeyFrame || framesSinceKeyFrame + 1 >= keyFrameInterval;
+    flags = keyFrame ? KeyFrame : 0;
+
+    // pick the Rice parameter from the mean of the mapped residuals
+    uint32_t sum = 0;
+    for(size_t i = 0; i < binCount; i++)
+        sum += zigzag(bins[i], keyFrame ? (i ? bins[i - 1] : 0) : previous[i]);
+
+    uint8_t k = 0;
+    while(k < maxRiceParameter && (static_cast<uint32_t>(binCount) << (k + 1)) <= sum)
+        k++;
+
+    out[0] = k;
+    BitWriter writer(out + 1, maxPayloadSize(binCount) - 1);
+    for(size_t i = 0; i < binCount && not writer.overflow; i++)
+    {
+        uint32_t const code = zigzag(bins[i], keyFrame ? (i ? bins[i - 1] : 0) : previous[i]);
+        uint32_t const quotient = code >> k;
+        if(quotient < escapeQuotient)
+        {
+            writer.put(((1u << quotient) - 1) << 1, quotient + 1); // unary quotient terminated by a zero
+            writer.put(code & ((1u << k) - 1), k);
+        }
+        else
+        {
+            writer.put((1u << escapeQuotient) - 1, escapeQuotient);
+            writer.put(code, 8);
+        }
+    }
+    size_t payloadSize = 1 + writer.finish();
+
+    if(writer.overflow)
+    {
+        flags |= Stored;
+        memcpy(out, bins, binCount);
+        payloadSize = binCount;
+    }
+
+    memcpy(previous, bins, binCount);
+    framesSinceKeyFrame = keyFrame ? 0 : framesSinceKeyFrame + 1;
+    needsKeyFrame = false;
+
+    return payloadSize;
+}
+
+void RawCompression::Decoder::reset()
+{
+    hasKeyFrame = false;
+}
+
+bool RawCompression::Decoder::decode(
+    uint8_t const* payload, size_t payloadSize, uint8_t flags, uint8_t* bins, size_t binCount)
+{
+    bool const keyFrame = flags & KeyFrame;
+    if(binCount > maxBinCount || (not keyFrame && not hasKeyFrame))
+        return false;
+
+    if(flags & Stored)
+    {
+        if(payloadSize != binCount)
+            return false;
+        memcpy(bins, payload, binCount);
+    }
+    else
+    {
+        if(payloadSize < 1 || payload[0] > maxRiceParameter)
+            return false;
+
+        uint8_t const k = payload[0];
+        BitReader reader(payload + 1, payloadSize - 1);
+        for(size_t i = 0; i < binCount; i++)
+        {
+            uint32_t quotient = 0;
+            while(quotient < escapeQuotient && reader.get(1))
+                quotient++;
+
+            uint32_t const code = quotient < escapeQuotient ? (quotient << k) | reader.get(k) : reader.get(8);
+            bins[i] = unzigzag(code, keyFrame ? (i ? bins[i - 1] : 0) : previous[i]);
+        }
+
+        if(reader.overrun)
+        {
+            hasKeyFrame = false;
+            return false;
+        }
+    }
+
+    memcpy(previous, bins, binCount);
+    hasKeyFrame = true;
+    return true;
+}
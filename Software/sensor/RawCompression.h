@@ -0,0 +1,64 @@
+#ifndef RAWCOMPRESSION_H
+#define RAWCOMPRESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Lossless compression of 8 bit spectra for raw file format versions 2 to 4.
+ *
+ * Every bin is predicted and only the difference to the prediction is stored. Key frames predict each bin from the
+ * previous bin of the same frame, all other frames predict it from the same bin of the previous frame. The
+ * differences are zigzag mapped to unsigned values and Rice coded with one parameter per frame. A frame that would
+ * grow is stored verbatim instead.
+ *
+ * The payload holds the verbatim bins of stored frames, otherwise the Rice parameter (1 byte) followed by the bit
+ * stream. The records around it are described in RawRecord.h.
+ */
+namespace RawCompression
+{
+constexpr size_t maxBinCount = 2048;
+
+enum Flags : uint8_t
+{
+    KeyFrame = 1 << 0,
+    Stored = 1 << 1,
+    EventStart = 1 << 2, // first frame of an event segment in triggered recording (see EventCapture.h)
+};
+
+/// upper bound of the payload size for a frame of binCount bins
+constexpr size_t maxPayloadSize(size_t binCount)
+{
+    return binCount;
+}
+
+class Encoder
+{
+  public:
+    void reset(uint16_t keyFrameInterval); // next frame will be a key frame
+
+    /// encodes one frame into out (at least maxPayloadSize(binCount) bytes) and returns the payload size
+    size_t encode(uint8_t const* bins, size_t binCount, uint8_t* out, uint8_t& flags);
+
+  private:
+    uint16_t keyFrameInterval = 64;
+    uint16_t framesSinceKeyFrame = 0;
+    bool needsKeyFrame = true;
+    uint8_t previous[maxBinCount];
+};
+
+class Decoder
+{
+  public:
+    void reset();
+
+    /// decodes one payload into bins; returns false on corrupt input (a key frame is needed to continue then)
+    bool decode(uint8_t const* payload, size_t payloadSize, uint8_t flags, uint8_t* bins, size_t binCount);
+
+  private:
+    bool hasKeyFrame = false;
+    uint8_t previous[maxBinCount];
+};
+} // namespace RawCompression
+
+#endif
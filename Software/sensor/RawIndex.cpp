@@ -0,0 +1,60 @@
+#include "RawIndex.h"
+
+#include <string.h>
+
+size_t RawIndex::writeHeader(uint8_t* buffer)
+{
+    uint16_t const size = entrySize;
+    memcpy(buffer, magic, sizeof(magic));
+    memcpy(buffer + 4, &version, 2);
+    memcpy(buffer + 6, &size, 2);
+    return headerSize;
+}
+
+void RawIndex::writeEntry(uint8_t* buffer, Entry const& entry)
+{
+    memcpy(buffer, &entry.timestamp, 4);
+    memcpy(buffer + 4, &entry.offset, 4);
+}
+
+size_t RawIndex::entryCount(uint8_t const* data, size_t size)
+{
+    if(size < headerSize || memcmp(data, magic, sizeof(magic)) != 0)
+        return 0;
+
+    uint16_t fileVersion;
+    uint16_t fileEntrySize;
+    memcpy(&fileVersion, data + 4, 2);
+    memcpy(&fileEntrySize, data + 6, 2);
+    if(fileVersion > version || fileEntrySize != entrySize)
+        return 0;
+    return (size - headerSize) / entrySize;
+}
+
+RawIndex::Entry RawIndex::entry(uint8_t const* data, size_t index)
+{
+    Entry result;
+    uint8_t const* const pointer = data + headerSize + index * entrySize;
+    memcpy(&result.timestamp, pointer, 4);
+    memcpy(&result.offset, pointer + 4, 4);
+    return result;
+}
+
+bool RawIndex::find(uint8_t const* data, size_t size, uint32_t timestamp, Entry& found)
+{
+    // first entry after timestamp; the one before it is the result
+    size_t low = 0;
+    size_t high = entryCount(data, size);
+    while(low < high)
+    {
+        size_t const middle = low + (high - low) / 2;
+        if(entry(data, middle).timestamp <= timestamp)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if(low == 0)
+        return false;
+    found = entry(data, low - 1);
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef RAWINDEX_H
+#define RAWINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Seek index for raw files, written by FileWriter as sidecar next to the .bin file (same name, extension .idx).
+ *
+ * Each entry points to a record of the raw file that can be read without the records before it: the key frames of
+ * compressed files (versions 2 to 4, see RawRecord.h) and every rawIndexInterval-th record and the first record of
+ * each event segment of uncompressed files. A reader looks up the last entry at or before the time it wants, starts
+ * there and reads on sequentially.
+ *
+ * Layout (all values little endian):
+ *  - magic "CRIX" (4 bytes)
+ *  - version (uint 2 bytes)
+ *  - entry size in bytes (uint 2 bytes)
+ *  - entries, ordered by timestamp:
+ *    - timestamp of the record (uint 4 bytes, ms since start of the sensor)
+ *    - byte offset of the record in the raw file (uint 4 bytes; FAT32 files stay below 4 GB)
+ *
+ * The index reaches the card in whole sectors, so after a power loss the last entries can be missing; the records
+ * after the last entry are still found by reading on from it. A partial last entry is ignored.
+ */
+namespace RawIndex
+{
+constexpr char magic[4] = {'C', 'R', 'I', 'X'};
+constexpr uint16_t version = 1;
+constexpr size_t headerSize = 8;
+constexpr size_t entrySize = 8;
+
+struct Entry
+{
+    uint32_t timestamp;
+    uint32_t offset;
+};
+
+/// writes the header into buffer (headerSize bytes) and returns its size
+size_t writeHeader(uint8_t* buffer);
+/// writes one entry into buffer (entrySize bytes)
+void writeEntry(uint8_t* buffer, Entry const& entry);
+
+/// number of entries in an index file, 0 if data is no index
+size_t entryCount(uint8_t const* data, size_t size);
+Entry entry(uint8_t const* data, size_t index);
+
+/// the last entry with a timestamp at or before timestamp; false if there is none
+bool find(uint8_t const* data, size_t size, uint32_t timestamp, Entry& found);
+} // namespace RawIndex
+
+#endif
@@ -0,0 +1,84 @@
+#include "RawRecord.h"
+
+#include "Checksum.h"
+
+#include <string.h>
+
+size_t RawRecord::frame(uint8_t* buffer, uint32_t timestamp, uint64_t sequence, uint8_t flags, uint16_t payloadSize)
+{
+    memcpy(buffer, syncWord, sizeof(syncWord));
+    memcpy(buffer + 2, &timestamp, 4);
+    memcpy(buffer + 6, &sequence, 8);
+    buffer[14] = flags;
+    memcpy(buffer + 15, &payloadSize, 2);
+
+    size_t const checked = headerSize(sequencedVersion) - sizeof(syncWord) + payloadSize;
+    uint32_t const crc = Checksum::crc32(buffer + sizeof(syncWord), checked);
+    memcpy(buffer + sizeof(syncWord) + checked, &crc, 4);
+    return headerSize(sequencedVersion) + payloadSize + trailerSize(sequencedVersion);
+}
+
+bool RawRecord::parse(
+    uint8_t const* data, size_t size, uint16_t version, size_t offset, size_t maxPayloadSize, Record& record)
+{
+    bool const framed = version >= framedVersion;
+    size_t const header = headerSize(version);
+    if(offset > size || size - offset < header)
+        return false;
+
+    uint8_t const* const start = data + offset;
+    uint8_t const* const fields = framed ? start + sizeof(syncWord) : start;
+    size_t const sequenceSize = version >= sequencedVersion ? 8 : 0; // behind the timestamp
+    if(framed && memcmp(start, syncWord, sizeof(syncWord)) != 0)
+        return false;
+
+    uint16_t payloadSize;
+    memcpy(&payloadSize, fields + 5 + sequenceSize, 2);
+    size_t const recordSize = header + payloadSize + trailerSize(version);
+    if(payloadSize > maxPayloadSize || size - offset < recordSize)
+        return false;
+
+    if(framed)
+    {
+        size_t const checked = recordSize - sizeof(syncWord) - trailerSize(version);
+        uint32_t crc;
+        memcpy(&crc, fields + checked, 4);
+        if(Checksum::crc32(fields, checked) != crc)
+            return false;
+    }
+
+    record.offset = offset;
+    record.size = recordSize;
+    memcpy(&record.timestamp, fields, 4);
+    record.sequence = 0;
+    memcpy(&record.sequence, fields + 4, sequenceSize);
+    record.flags = fields[4 + sequenceSize];
+    record.payloadSize = payloadSize;
+    record.payload = start + header;
+    record.skippedBytes = 0;
+    return true;
+}
+
+bool RawRecord::next(
+    uint8_t const* data, size_t size, uint16_t version, size_t offset, size_t maxPayloadSize, Record& record)
+{
+    if(parse(data, size, version, offset, maxPayloadSize, record))
+        return true;
+    if(version < framedVersion)
+        return false; // without sync words there is no way past a damaged record
+
+    size_t const start = offset;
+    while(++offset < size)
+    {
+        auto const sync = static_cast<uint8_t const*>(memchr(data + offset, syncWord[0], size - offset));
+        if(not sync)
+            return false;
+        offset = size_t(sync - data);
+        if(parse(data, size, version, offset, maxPayloadSize, record))
+        {
+            record.skippedBytes = offset - start;
+            return true;
+        }
+    }
+    return false;
+}
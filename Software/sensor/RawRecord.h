@@ -0,0 +1,87 @@
+#ifndef RAWRECORD_H
+#define RAWRECORD_H
+
+#include "FrameClock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Records of compressed raw files (payloads coded with RawCompression.h).
+ *
+ * Version 2 records (all values little endian):
+ *  - timestamp (uint 4 bytes)
+ *  - flags (uint 1 byte, see RawCompression::Flags)
+ *  - payload size (uint 2 bytes)
+ *  - payload
+ *
+ * Version 3 frames the same record so that a reader can start anywhere in the file and finds every intact record:
+ *  - sync word 0xA5 0xC3 (2 bytes)
+ *  - timestamp, flags, payload size and payload as in version 2
+ *  - CRC-32 (IEEE 802.3, see Checksum.h, uint 4 bytes) over timestamp, flags, payload size and payload
+ *
+ * Version 4 adds the sequence number of the frame (FrameClock.h) behind the timestamp, covered by the CRC, and the
+ * anchor of the sample clock behind the 11 byte file header (FileWriter::openRawFile):
+ *  - sync word 0xA5 0xC3 (2 bytes)
+ *  - timestamp (uint 4 bytes), sequence (uint 8 bytes), flags, payload size and payload as in version 2
+ *  - CRC-32 over everything after the sync word
+ *
+ * A record whose checksum does not match or that reaches past the end of the file (cut off by a power loss) is
+ * skipped; the reader searches for the next sync word at which a valid record starts. The frames after a gap are
+ * coded relative to frames that are gone, so they only decode again from the next key frame on. Version 2 records
+ * are read up to the first one that does not fit into the file.
+ */
+namespace RawRecord
+{
+constexpr uint16_t compressedVersion = 2;
+constexpr uint16_t framedVersion = 3;
+constexpr uint16_t sequencedVersion = 4;
+constexpr uint8_t syncWord[2] = {0xA5, 0xC3};
+
+/// true for the versions of compressed files
+constexpr bool isCompressed(uint16_t version)
+{
+    return version >= compressedVersion && version <= sequencedVersion;
+}
+/// bytes in front of the first record: file header and, from version 4, the anchor
+constexpr size_t dataOffset(uint16_t version)
+{
+    return version >= sequencedVersion ? 11 + FrameClock::anchorSize : 11;
+}
+constexpr size_t headerSize(uint16_t version)
+{
+    return version >= sequencedVersion ? 17 : version >= framedVersion ? 9 : 7;
+}
+constexpr size_t trailerSize(uint16_t version)
+{
+    return version >= framedVersion ? 4 : 0;
+}
+constexpr size_t maxRecordSize(uint16_t version, size_t maxPayloadSize)
+{
+    return headerSize(version) + maxPayloadSize + trailerSize(version);
+}
+
+struct Record
+{
+    size_t offset = 0; // of the record in the data
+    size_t size = 0;   // of the whole record
+    uint32_t timestamp = 0;
+    uint64_t sequence = 0; // 0 before version 4
+    uint8_t flags = 0;
+    uint16_t payloadSize = 0;
+    uint8_t const* payload = nullptr;
+    size_t skippedBytes = 0; // in front of the record since the end of the previous one, damaged or foreign data
+};
+
+/// writes header and CRC of a version 4 record around the payload at buffer + headerSize(sequencedVersion) and
+/// returns the size of the record
+size_t frame(uint8_t* buffer, uint32_t timestamp, uint64_t sequence, uint8_t flags, uint16_t payloadSize);
+
+/// the record at offset if it is complete and (version 3 and later) intact
+bool parse(uint8_t const* data, size_t size, uint16_t version, size_t offset, size_t maxPayloadSize, Record& record);
+
+/// the first record at or after offset, skipping damaged data from version 3 on; false if there is none
+bool next(uint8_t const* data, size_t size, uint16_t version, size_t offset, size_t maxPayloadSize, Record& record);
+} // namespace RawRecord
+
+#endif
@@ -0,0 +1,183 @@
+#include "Scheduler.h"
+
+Scheduler::Task Scheduler::realtime(char const* name, bool (*ready)(), void (*run)(), uint8_t priority,
+                                    uint32_t budgetMicros, uint32_t periodMicros, uint32_t deadlineMicros)
+{
+    Task task;
+    task.name = name;
+    task.ready = ready;
+    task.run = run;
+    task.priority = priority;
+    task.budgetMicros = budgetMicros;
+    task.periodMicros = periodMicros > 0 ? periodMicros : 1;
+    task.deadlineMicros = deadlineMicros;
+    return task;
+}
+
+Scheduler::Task Scheduler::background(char const* name, bool (*ready)(), void (*run)(), uint8_t priority,
+                                      uint32_t budgetMicros, uint32_t maxDelayMicros)
+{
+    Task task;
+    task.name = name;
+    task.ready = ready;
+    task.run = run;
+    task.priority = priority;
+    task.budgetMicros = budgetMicros;
+    task.maxDelayMicros = maxDelayMicros;
+    return task;
+}
+
+Scheduler::Scheduler(uint32_t (*clock)())
+    : clock(clock)
+{}
+
+bool Scheduler::add(Task const& task)
+{
+    if(count == maxTasks || not task.ready || not task.run)
+        return false;
+
+    // sorted by priority, so runOnce() takes the first task that can run
+    size_t i = count;
+    for(; i > 0 && slots[i - 1].task.priority > task.priority; i--)
+        slots[i] = slots[i - 1];
+    slots[i] = Slot();
+    slots[i].task = task;
+    slots[i].meanMicros = task.budgetMicros;
+    count++;
+    return true;
+}
+
+bool Scheduler::runOnce()
+{
+    uint32_t const now = clock();
+
+    // every realtime task is polled, the ones that are not ready move their next release estimate forward
+    Slot* next = nullptr;
+    for(size_t i = 0; i < count; i++)
+    {
+        Slot& slot = slots[i];
+        if(not slot.task.isRealtime())
+            continue;
+        if(slot.task.ready())
+        {
+            if(not next)
+                next = &slot;
+        }
+        else
+        {
+            slot.idleMicros = now;
+            slot.seenIdle = true;
+        }
+    }
+    if(next)
+    {
+        run(*next, next->seenIdle ? next->idleMicros : now);
+        return true;
+    }
+
+    uint32_t const slack = slackMicros(now);
+    for(size_t i = 0; i < count; i++)
+    {
+        Slot& slot = slots[i];
+        if(slot.task.isRealtime())
+            continue;
+        if(not slot.task.ready())
+        {
+            slot.waiting = false;
+            continue;
+        }
+        if(not slot.waiting)
+        {
+            slot.waiting = true;
+            slot.deferred = false;
+            slot.readySince = now;
+        }
+
+        bool const fits = slot.meanMicros <= slack;
+        bool const overdue = slot.task.maxDelayMicros > 0 && now - slot.readySince >= slot.task.maxDelayMicros;
+        if(not fits && not overdue)
+        {
+            if(not slot.deferred)
+                slot.stats.deferred++;
+            slot.deferred = true;
+            continue;
+        }
+        if(not fits)
+            slot.stats.forced++;
+        run(slot, slot.readySince);
+        slot.waiting = false;
+        return true;
+    }
+    return false;
+}
+
+uint32_t Scheduler::slackMicros(uint32_t nowMicros) const
+{
+    uint32_t slack = UINT32_MAX;
+    for(size_t i = 0; i < count; i++)
+    {
+        Slot const& slot = slots[i];
+        if(not slot.task.isRealtime() || not slot.released)
+            continue;
+        uint32_t const period = slot.task.periodMicros;
+        uint32_t const elapsed = nowMicros - slot.releaseMicros;
+        if(elapsed / 2 >= period)
+            continue; // the data stopped
+        uint32_t const left = elapsed < period ? period - elapsed : 0;
+        if(left < slack)
+            slack = left;
+    }
+    return slack;
+}
+
+uint32_t Scheduler::deadlineMisses() const
+{
+    uint32_t misses = 0;
+    for(size_t i = 0; i < count; i++)
+        misses += slots[i].stats.deadlineMisses;
+    return misses;
+}
+
+uint32_t Scheduler::forcedSlices() const
+{
+    uint32_t forced = 0;
+    for(size_t i = 0; i < count; i++)
+        forced += slots[i].stats.forced;
+    return forced;
+}
+
+void Scheduler::resetStatistics()
+{
+    for(size_t i = 0; i < count; i++)
+        slots[i].stats = Statistics();
+}
+
+void Scheduler::run(Slot& slot, uint32_t releaseMicros)
+{
+    uint32_t const start = clock();
+    slot.task.run();
+    uint32_t const end = clock();
+
+    Statistics& stats = slot.stats;
+    uint32_t const micros = end - start;
+    stats.runs++;
+    stats.totalMicros += micros;
+    if(micros > stats.maxMicros)
+        stats.maxMicros = micros;
+    if(micros > slot.task.budgetMicros)
+        stats.overBudget++;
+    slot.meanMicros += (int32_t(micros) - int32_t(slot.meanMicros)) / 8;
+    if(start - releaseMicros > stats.maxWaitMicros)
+        stats.maxWaitMicros = start - releaseMicros;
+
+    if(slot.task.isRealtime())
+    {
+        if(end - releaseMicros > slot.task.deadlineMicros)
+            stats.deadlineMisses++;
+        slot.releaseMicros = releaseMicros;
+        slot.released = true;
+        // the data of this slice was taken at its start, whatever is ready afterwards came later
+        slot.idleMicros = start;
+        slot.seenIdle = true;
+    }
+}
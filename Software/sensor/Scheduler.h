@@ -0,0 +1,156 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Cooperative scheduler of loop(): every call of runOnce() runs at most one slice of one task, chosen by priority and
+ * by the time left until the next FFT frame.
+ *
+ * - realtime tasks (the FFT frame: acquisition and analysis) are released by their data about every periodMicros.
+ *   Whenever one is ready it runs before any background task. The scheduler only sees the release when it polls, so
+ *   it takes the last poll that found the task not ready as the release: a slice that delayed the pick-up counts
+ *   against the task. A run that ends more than deadlineMicros after the release is a deadline miss.
+ * - background tasks (SD writes, serial output, card re-initialisation, housekeeping) run in the slack: only if no
+ *   realtime task is ready and their slice is expected to end before the next expected release of every realtime
+ *   task (the last release plus the period). A slice is expected to take the running mean of the slices of the task
+ *   (weight 1/8), which starts at the budget: when a slow card stretches the SD slices they only start in the gaps
+ *   that hold them, when it is fast again they fit in short gaps again. If a task does not fit, a lower priority one
+ *   with shorter slices may still run.
+ *   A task that waited maxDelayMicros runs without slack as soon as no realtime task is ready, so a budget longer than
+ *   the slack of a short FFT period delays the frames instead of starving the task; these runs are counted as forced.
+ *   A realtime task that is two periods late has lost its data (no input) and no longer holds the others back.
+ *
+ * Nothing is preempted: the tasks keep each slice within their budget themselves (e.g. a bounded number of sectors),
+ * runs that take longer are counted. The clock is micros() on the Teensy and a simulated one in schedulercheck.
+ * Priorities run from 0 (first); tasks of the same priority run in the order they were added.
+ */
+class Scheduler
+{
+  public:
+    static constexpr size_t maxTasks = 8;
+
+    struct Task
+    {
+        char const* name = "";
+        bool (*ready)() = nullptr; // whether the task has work now; called on every poll, has to be cheap
+        void (*run)() = nullptr;   // one slice of that work
+        uint8_t priority = 0;
+        uint32_t budgetMicros = 0;   // the longest a slice should take
+        uint32_t periodMicros = 0;   // realtime: expected time from one release to the next; 0 for background tasks
+        uint32_t deadlineMicros = 0; // realtime: from the release until the slice is done
+        uint32_t maxDelayMicros = 0; // background: runs without slack after waiting this long, 0: never
+
+        bool isRealtime() const { return periodMicros > 0; }
+    };
+
+    struct Statistics
+    {
+        uint32_t runs = 0;
+        uint64_t totalMicros = 0;
+        uint32_t maxMicros = 0;
+        uint32_t overBudget = 0;     // slices longer than the budget
+        uint32_t maxWaitMicros = 0;  // from the release (realtime) or from being ready (background) until the start
+        uint32_t deadlineMisses = 0; // realtime: slices done after the deadline
+        uint32_t deferred = 0;       // background: times the task had to wait for slack
+        uint32_t forced = 0;         // background: slices started without slack after maxDelayMicros
+
+        uint32_t meanMicros() const { return runs > 0 ? uint32_t(totalMicros / runs) : 0; }
+    };
+
+  public:
+    static Task realtime(char const* name, bool (*ready)(), void (*run)(), uint8_t priority, uint32_t budgetMicros,
+                         uint32_t periodMicros, uint32_t deadlineMicros);
+    static Task background(char const* name, bool (*ready)(), void (*run)(), uint8_t priority, uint32_t budgetMicros,
+                           uint32_t maxDelayMicros);
+
+    explicit Scheduler(uint32_t (*clock)());
+
+    /// false if all maxTasks are taken or the task has no functions
+    bool add(Task const& task);
+
+    /// polls the tasks and runs at most one slice; false if nothing ran
+    bool runOnce();
+
+    /// time until the next expected release of a realtime task, UINT32_MAX if none is expected
+    uint32_t slackMicros(uint32_t nowMicros) const;
+
+    size_t taskCount() const { return count; }
+    Task const& task(size_t index) const { return slots[index].task; }
+    Statistics const& statistics(size_t index) const { return slots[index].stats; }
+    /// of all realtime tasks
+    uint32_t deadlineMisses() const;
+    uint32_t forcedSlices() const;
+    void resetStatistics();
+
+    /// one line per task, e.g. "frame: n 5000, mean 2100, max 4000 us (budget 10000, over 0), wait max 900 us,
+    /// deadline misses 0"
+    template <class Out>
+    void printTo(Out& out) const;
+
+  private:
+    struct Slot
+    {
+        Task task;
+        Statistics stats;
+        uint32_t meanMicros = 0; // running mean of the slices, the budget before the first one
+        uint32_t idleMicros = 0; // realtime: last poll that found the task not ready
+        bool seenIdle = false;
+        uint32_t releaseMicros = 0; // realtime: release of the last slice
+        bool released = false;
+        uint32_t readySince = 0; // background: first poll that found the task ready
+        bool waiting = false;
+        bool deferred = false; // background: counted as deferred in this wait
+    };
+
+    void run(Slot& slot, uint32_t releaseMicros);
+
+  private:
+    uint32_t (*const clock)();
+    Slot slots[maxTasks];
+    size_t count = 0;
+};
+
+template <class Out>
+void Scheduler::printTo(Out& out) const
+{
+    out.print("scheduler: deadline misses ");
+    out.print(deadlineMisses());
+    out.print(", forced slices ");
+    out.println(forcedSlices());
+
+    for(size_t i = 0; i < count; i++)
+    {
+        Task const& task = slots[i].task;
+        Statistics const& stats = slots[i].stats;
+        out.print("  ");
+        out.print(task.name);
+        out.print(": n ");
+        out.print(stats.runs);
+        out.print(", mean ");
+        out.print(stats.meanMicros());
+        out.print(", max ");
+        out.print(stats.maxMicros);
+        out.print(" us (budget ");
+        out.print(task.budgetMicros);
+        out.print(", over ");
+        out.print(stats.overBudget);
+        out.print("), wait max ");
+        out.print(stats.maxWaitMicros);
+        if(task.isRealtime())
+        {
+            out.print(" us, deadline misses ");
+            out.println(stats.deadlineMisses);
+        }
+        else
+        {
+            out.print(" us, deferred ");
+            out.print(stats.deferred);
+            out.print(", forced ");
+            out.println(stats.forced);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "SerialFormat.h"
+
+#include "Checksum.h"
+
+#include <string.h>
+
+namespace
+{
+template <typename T>
+T load(uint8_t const* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+} // namespace
+
+uint8_t SerialFormat::quantize(float value)
+{
+    float const steps = (value - quantizedOffset) / quantizedStep + 0.5f;
+    if(not(steps > 0)) // also catches NaN
+        return 0;
+    return steps >= 255 ? 255 : static_cast<uint8_t>(steps);
+}
+
+void SerialFormat::Encoder::reset(uint16_t keyFrameInterval)
+{
+    sequence = 0;
+    this->keyFrameInterval = keyFrameInterval;
+    deltaEncoder.reset(keyFrameInterval);
+}
+
+size_t SerialFormat::Encoder::encode(FrameInfo info, float const* bins, uint8_t* out)
+{
+    if(info.binCount > RawCompression::maxBinCount)
+        info.binCount = RawCompression::maxBinCount;
+    info.sequence = sequence++;
+    info.codecFlags = 0;
+
+    uint8_t* const payload = out + headerSize;
+    size_t payloadSize = 0;
+    switch(info.type)
+    {
+    case PayloadType::Float32:
+        payloadSize = info.binCount * 4;
+        memcpy(payload, bins, payloadSize);
+        break;
+    case PayloadType::Quantized8:
+        for(size_t i = 0; i < info.binCount; i++)
+            payload[i] = quantize(bins[i]);
+        payloadSize = info.binCount;
+        break;
+    case PayloadType::Delta8:
+        for(size_t i = 0; i < info.binCount; i++)
+            quantized[i] = quantize(bins[i]);
+        payloadSize = deltaEncoder.encode(quantized, info.binCount, payload, info.codecFlags);
+        break;
+    }
+
+    uint16_t const size = payloadSize;
+    auto const type = static_cast<uint8_t>(info.type);
+    memcpy(out, sync, 2);
+    memcpy(out + 2, &version, 1);
+    memcpy(out + 3, &type, 1);
+    memcpy(out + 4, &info.codecFlags, 1);
+    memcpy(out + 5, &info.sequence, 2);
+    memcpy(out + 7, &size, 2);
+    memcpy(out + 9, &info.timestamp, 4);
+    memcpy(out + 13, &info.micGain, 1);
+    memcpy(out + 14, &info.maxFreqIndex, 2);
+    memcpy(out + 16, &info.peak, 4);
+    memcpy(out + 20, &info.binCount, 2);
+
+    size_t const frameSize = headerSize + payloadSize;
+    uint32_t const crc = Checksum::crc32(out + 2, frameSize - 2);
+    memcpy(out + frameSize, &crc, 4);
+    return frameSize + crcSize;
+}
+
+size_t SerialFormat::Decoder::push(uint8_t const* data, size_t size)
+{
+    size_t const count = size < sizeof(buffer) - fill ? size : sizeof(buffer) - fill;
+    memcpy(buffer + fill, data, count);
+    fill += count;
+    return count;
+}
+
+void SerialFormat::Decoder::consume(size_t count)
+{
+    memmove(buffer, buffer + count, fill - count);
+    fill -= count;
+}
+
+bool SerialFormat::Decoder::next(FrameInfo& info, float* bins, size_t maxBins)
+{
+    while(true)
+    {
+        // everything up to the next sync word is text or the rest of a broken frame
+        size_t start = 0;
+        while(start + 1 < fill && not(buffer[start] == sync[0] && buffer[start + 1] == sync[1]))
+            start++;
+        if(start + 1 >= fill && fill > 0 && buffer[fill - 1] != sync[0])
+            start = fill;
+        stats.skippedBytes += start;
+        consume(start);
+
+        if(fill < headerSize)
+            return false;
+
+        auto const type = static_cast<PayloadType>(buffer[3]);
+        uint16_t const payloadSize = load<uint16_t>(buffer + 7);
+        uint16_t const binCount = load<uint16_t>(buffer + 20);
+        bool const validHeader =
+            buffer[2] == version && binCount <= RawCompression::maxBinCount &&
+            ((type == PayloadType::Float32 && payloadSize == 4 * binCount) ||
+             (type == PayloadType::Quantized8 && payloadSize == binCount) ||
+             (type == PayloadType::Delta8 && payloadSize <= RawCompression::maxPayloadSize(binCount)));
+        if(not validHeader)
+        {
+            stats.crcErrors++;
+            stats.skippedBytes++;
+            consume(1);
+            continue;
+        }
+
+        size_t const frameSize = headerSize + payloadSize;
+        if(fill < frameSize + crcSize)
+            return false;
+
+        if(Checksum::crc32(buffer + 2, frameSize - 2) != load<uint32_t>(buffer + frameSize))
+        {
+            stats.crcErrors++;
+            stats.skippedBytes++;
+            consume(1);
+            continue;
+        }
+
+        info.type = type;
+        info.codecFlags = buffer[4];
+        info.sequence = load<uint16_t>(buffer + 5);
+        info.timestamp = load<uint32_t>(buffer + 9);
+        info.micGain = load<int8_t>(buffer + 13);
+        info.maxFreqIndex = load<uint16_t>(buffer + 14);
+        info.peak = load<float>(buffer + 16);
+        info.binCount = binCount;
+
+        uint16_t const missing = info.sequence - static_cast<uint16_t>(lastSequence + 1);
+        if(hasSequence && missing > 0)
+        {
+            stats.lostFrames += missing;
+            deltaDecoder.reset(); // the frame the next delta refers to is gone
+        }
+        hasSequence = true;
+        lastSequence = info.sequence;
+
+        uint8_t const* payload = buffer + headerSize;
+        bool decoded = binCount <= maxBins;
+        if(decoded)
+        {
+            switch(type)
+            {
+            case PayloadType::Float32:
+                memcpy(bins, payload, payloadSize);
+                break;
+            case PayloadType::Quantized8:
+                for(size_t i = 0; i < binCount; i++)
+                    bins[i] = dequantize(payload[i]);
+                break;
+            case PayloadType::Delta8:
+                decoded = deltaDecoder.decode(payload, payloadSize, info.codecFlags, quantized, binCount);
+                stats.undecodable += not decoded;
+                for(size_t i = 0; decoded && i < binCount; i++)
+                    bins[i] = dequantize(quantized[i]);
+                break;
+            }
+        }
+
+        consume(frameSize + crcSize);
+        if(decoded)
+        {
+            stats.frames++;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef SERIALFORMAT_H
+#define SERIALFORMAT_H
+
+#include "RawCompression.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Framed spectrum output on the serial port (protocol version 2).
+ *
+ * Every spectrum is sent as one frame (all values little endian):
+ *  - sync word 0xA5 0xD2 (2 bytes)
+ *  - version (uint 1 byte)
+ *  - payload type (uint 1 byte, see PayloadType)
+ *  - codec flags (uint 1 byte, RawCompression::Flags of Delta8 payloads, otherwise 0)
+ *  - sequence number (uint 2 bytes), counts the frames sent and wraps around
+ *  - payload size in bytes (uint 2 bytes)
+ *  - timestamp in ms since the start of the sensor (uint 4 bytes)
+ *  - mic gain (int 1 byte)
+ *  - FFT bin of the highest signal (uint 2 bytes)
+ *  - peak of the input signal, >= 1 means clipping (float 4 bytes)
+ *  - bin count (uint 2 bytes)
+ *  - payload: the noise floor distance of each bin in dB
+ *  - CRC-32 (IEEE 802.3) of everything after the sync word (uint 4 bytes)
+ *
+ * Float32 sends the bins as floats. Quantized8 sends one byte per bin in steps of quantizedStep starting at
+ * quantizedOffset. Delta8 compresses these bytes with RawCompression; a receiver that missed a frame (gap in the
+ * sequence numbers) has to wait for the next key frame. Other text on the port (status output) is skipped by the
+ * receiver while it searches for the next sync word.
+ */
+namespace SerialFormat
+{
+constexpr uint8_t sync[2] = {0xA5, 0xD2};
+constexpr uint8_t version = 2;
+constexpr size_t headerSize = 22;
+constexpr size_t crcSize = 4;
+
+enum class PayloadType : uint8_t
+{
+    Float32 = 1,
+    Quantized8 = 2,
+    Delta8 = 3,
+};
+
+constexpr float quantizedOffset = -20; // dB of the quantized value 0
+constexpr float quantizedStep = 0.5;   // dB per step, so 255 is 107.5 dB
+
+/// upper bound of the frame size for binCount bins
+constexpr size_t maxFrameSize(size_t binCount)
+{
+    return headerSize + 4 * binCount + crcSize;
+}
+
+/// everything of a frame besides the bins
+struct FrameInfo
+{
+    PayloadType type = PayloadType::Float32;
+    uint8_t codecFlags = 0;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    int8_t micGain = 0;
+    uint16_t maxFreqIndex = 0;
+    float peak = 0;
+    uint16_t binCount = 0;
+};
+
+uint8_t quantize(float value);
+inline float dequantize(uint8_t value)
+{
+    return quantizedOffset + value * quantizedStep;
+}
+
+class Encoder
+{
+  public:
+    /// the next frame gets sequence number 0 and Delta8 starts with a key frame
+    void reset(uint16_t keyFrameInterval = 16);
+
+    /// writes the complete frame for info (the sequence number is assigned here) into out and returns its size;
+    /// out has to hold maxFrameSize(info.binCount) bytes
+    size_t encode(FrameInfo info, float const* bins, uint8_t* out);
+
+  private:
+    uint16_t sequence = 0;
+    uint16_t keyFrameInterval = 16;
+    RawCompression::Encoder deltaEncoder;
+    uint8_t quantized[RawCompression::maxBinCount];
+};
+
+/**
+ * Reassembles frames from a byte stream that may contain other text and lose or corrupt bytes.
+ *
+ * The bytes are collected with push(); next() returns the next complete frame with a valid checksum. After a
+ * corrupted frame the search for a sync word starts again one byte after the sync word of the corrupted frame.
+ */
+class Decoder
+{
+  public:
+    struct Statistics
+    {
+        uint32_t frames = 0;       // valid frames returned by next()
+        uint32_t lostFrames = 0;   // frames missing according to the sequence numbers
+        uint32_t crcErrors = 0;    // frames dropped because of a wrong checksum or an invalid header
+        uint32_t skippedBytes = 0; // bytes outside of frames (text, partial frames)
+        uint32_t undecodable = 0;  // Delta8 frames that could not be decoded because their key frame is missing
+    };
+
+  public:
+    /// stores as many bytes as fit and returns how many; call next() until it returns false to make room
+    size_t push(uint8_t const* data, size_t size);
+
+    /// bins receives info.binCount values as dB; frames with more than maxBins bins are skipped
+    bool next(FrameInfo& info, float* bins, size_t maxBins);
+
+    Statistics const& statistics() const { return stats; }
+
+  private:
+    void consume(size_t count);
+
+  private:
+    uint8_t buffer[maxFrameSize(RawCompression::maxBinCount)];
+    size_t fill = 0;
+
+    bool hasSequence = false;
+    uint16_t lastSequence = 0;
+    RawCompression::Decoder deltaDecoder;
+    uint8_t quantized[RawCompression::maxBinCount];
+
+    Statistics stats;
+};
+} // namespace SerialFormat
+
+#endif
@@ -3,101 +3,228 @@
 #include <SerialFlash.h>
 #include <TimeLib.h>
 
-void SerialIO::printDigits(int digits)
+#include <string.h>
+
+void SerialIO::printDigits(Print& out, int digits)
 {
     // utility function for digital clock display: prints preceding colon and leading 0
-    Serial.print(":");
+    out.print(":");
     if(digits < 10)
-        Serial.print('0');
-    Serial.print(digits);
+        out.print('0');
+    out.print(digits);
 }
 
-void SerialIO::processInputs(AudioSystem::Config& config, bool& sendOutput)
+void SerialIO::processInputs(AudioSystem::Config& config, Requests& requests)
 {
-    // control input from serial
-    while(Serial.available())
+    // only a bounded number of bytes per call; the rest stays in the USB buffer for the next frame
+    uint32_t const now = millis();
+    for(size_t budget = inputBudget; budget > 0 && Serial.available() > 0; budget--)
     {
-        int8_t input = Serial.read();
+        parser.feed(Serial.read(), now);
+        for(auto command = parser.next(now); command.type != CommandParser::Command::None; command = parser.next(now))
+            execute(command, config, requests);
+    }
 
-        if(input == 100) // 'd' for data
-            sendOutput = true;
+    // a T command without a terminator ends after its timeout
+    for(auto command = parser.next(now); command.type != CommandParser::Command::None; command = parser.next(now))
+        execute(command, config, requests);
+}
 
-        if((input == 0) & (config.mic_gain > 0.001))
-        { // - key
-            config.mic_gain -= 0.01;
-        }
-        if((input == 1) & (config.mic_gain < 10))
-        { // + key
-            config.mic_gain += 0.01;
-        }
+void SerialIO::execute(CommandParser::Command const& command, AudioSystem::Config& config, Requests& requests)
+{
+    using Command = CommandParser::Command;
 
-        if(input == 111)
-        { // o
-            config.alpha += 0.01;
+    using Limits = AudioSystem::Config;
+    float* value = nullptr;
+    float minValue = 0; // what $set accepts
+    float maxValue = 0;
+    if(command.type == Command::SetValue || command.type == Command::GetValue)
+    {
+        if(strcmp(command.name, "mic_gain") == 0)
+        {
+            value = &config.mic_gain;
+            maxValue = Limits::max_mic_gain;
         }
-        if(input == 108)
-        { // l
-            config.alpha -= 0.01;
+        else if(strcmp(command.name, "alpha") == 0)
+        {
+            value = &config.alpha;
+            minValue = Limits::min_alpha;
+            maxValue = Limits::max_alpha;
         }
-        if(input == 105)
-        { // i
-            config.psi += 0.01;
+        else if(strcmp(command.name, "psi") == 0)
+        {
+            value = &config.psi;
+            minValue = -Limits::max_psi;
+            maxValue = Limits::max_psi;
         }
-        if(input == 107)
-        { // k
-            config.psi -= 0.01;
+        else
+        {
+            textOutput.print("unknown value: ");
+            textOutput.println(command.name);
+            return;
         }
+    }
 
-        if(input == 111 || input == 108 || input == 105 || input == 107)
-        {
-            Serial.print("alpha = ");
-            Serial.println(config.alpha);
-            Serial.print("psi = ");
-            Serial.println(config.psi);
+    switch(command.type)
+    {
+    case Command::None:
+        break;
+    case Command::SendOutput:
+        requests.output = true;
+        break;
+    case Command::Status:
+        requests.status = true;
+        break;
+    case Command::Profile:
+        requests.profile = true;
+        break;
+    case Command::Counters:
+        requests.counters = true;
+        break;
+    case Command::Memory:
+        requests.memory = true;
+        break;
 
-            config.hasChanges = true;
+    case Command::MicGainDown:
+        if(config.mic_gain > 0.001)
+            config.mic_gain -= 0.01;
+        break;
+    case Command::MicGainUp:
+        if(config.mic_gain < Limits::max_mic_gain)
+            config.mic_gain += 0.01;
+        break;
+
+    case Command::AlphaUp:
+    case Command::AlphaDown:
+    case Command::PsiUp:
+    case Command::PsiDown:
+    {
+        double const alphaStep =
+            command.type == Command::AlphaUp ? 0.01 : command.type == Command::AlphaDown ? -0.01 : 0;
+        double const psiStep = command.type == Command::PsiUp ? 0.01 : command.type == Command::PsiDown ? -0.01 : 0;
+        // like the mic gain a step is only taken within the limits
+        float const alpha = config.alpha + alphaStep;
+        float const psi = config.psi + psiStep;
+        if(alpha >= Limits::min_alpha && alpha <= Limits::max_alpha)
+            config.alpha = alpha;
+        if(psi >= -Limits::max_psi && psi <= Limits::max_psi)
+            config.psi = psi;
+
+        textOutput.print("alpha = ");
+        textOutput.println(config.alpha);
+        textOutput.print("psi = ");
+        textOutput.println(config.psi);
+
+        config.hasChanges = true;
+        break;
+    }
+
+    case Command::SetValue:
+        if(command.value < minValue || command.value > maxValue)
+        {
+            textOutput.print(command.name);
+            textOutput.print(" out of range ");
+            textOutput.print(minValue);
+            textOutput.print(" .. ");
+            textOutput.println(maxValue);
+            break;
         }
+        *value = command.value;
+        if(value != &config.mic_gain) // the mic gain is only applied in setup(), like with the single byte commands
+            config.hasChanges = true;
+        // fall through - report the new value
+    case Command::GetValue:
+        textOutput.print(command.name);
+        textOutput.print(" = ");
+        textOutput.println(*value);
+        break;
 
-        if(input == 84)
+    case Command::SetTime:
+    {
+        // check if we got a somewhat recent time (greater than March 20 2024)
+        unsigned long const minimalTime = 1710930219;
+        if(command.number >= minimalTime)
         {
-            unsigned long externalTime = Serial.parseInt();
-
-            // check if we got a somewhat recent time (greater than March 20 2024)
-            unsigned long const minimalTime = 1710930219;
-            if(externalTime >= minimalTime)
-            {
-                setTime(externalTime);          // Sync Arduino clock to the time received on the serial port
-                Teensy3Clock.set(externalTime); // set Teensy RTC
-            }
-
-            Serial.print("Time set to: ");
-            Serial.print(year());
-            Serial.print("-");
-            Serial.print(month());
-            Serial.print("-");
-            Serial.print(day());
-            Serial.print(" ");
-            Serial.print(hour());
-            printDigits(minute());
-            printDigits(second());
-            Serial.println();
+            setTime(command.number);          // Sync Arduino clock to the time received on the serial port
+            Teensy3Clock.set(command.number); // set Teensy RTC
         }
+
+        textOutput.print("Time set to: ");
+        textOutput.print(year());
+        textOutput.print("-");
+        textOutput.print(month());
+        textOutput.print("-");
+        textOutput.print(day());
+        textOutput.print(" ");
+        textOutput.print(hour());
+        printDigits(textOutput, minute());
+        printDigits(textOutput, second());
+        textOutput.println();
+        break;
+    }
+
+    case Command::Invalid:
+        textOutput.print("unknown command: ");
+        textOutput.println(command.name);
+        break;
     }
 }
 
-void SerialIO::sendOutput(AudioSystem::Results const& audioResults, AudioSystem const& audio, Config const& config)
+void SerialIO::sendOutput(AudioSystem::Results const& results, AudioSystem& audio, Config const& config)
 {
+    if(outputPosition < outputSize)
+    {
+        skippedOutputs++;
+        return;
+    }
+
     // send data via serial port - this is tied to the FFT_visualisation-pde java code
-    auto const micGain = static_cast<int8_t>(config.audio.mic_gain);
-    Serial.write((byte*)&micGain, 1);
-    Serial.write((byte*)&audioResults.max_freq_Index, 2);
+    SerialFormat::FrameInfo info;
+    info.type = config.serialPayload;
+    info.timestamp = results.timestamp;
+    info.micGain = static_cast<int8_t>(config.audio.mic_gain);
+    info.maxFreqIndex = results.max_freq_Index;
+    info.peak = audio.getPeak(); // highest peak-to-peak distance of the signal (if >= 1 clipping occurs)
+    info.binCount = results.numberOfFftBins;
+
+    outputSize = encoder.encode(info, results.noise_floor_distance, outputBuffer);
+    outputPosition = 0;
+    sentOutputs++;
+    service();
+}
 
-    // highest peak-to-peak distance of the signal (if >= 1 clipping occurs)
-    float const peak = audio.getPeak();
-    Serial.write((byte*)&peak, 4);
+void SerialIO::service()
+{
+    // the text waits for the end of a frame that is going out, a new frame waits for the end of the text
+    bool const frameStarted = outputPosition > 0 && outputPosition < outputSize;
+    if(not frameStarted && textOutput.length > 0)
+    {
+        size_t const written =
+            Serial.write(textOutput.data, min(textOutput.length, size_t(Serial.availableForWrite())));
+        textOutput.length -= written;
+        memmove(textOutput.data, textOutput.data + written, textOutput.length);
+        if(textOutput.length > 0)
+            return;
+    }
+    if(outputPosition == outputSize)
+        return;
 
-    Serial.write((byte*)&audioResults.numberOfFftBins, 2);
+    // the frame goes out in one write if the USB buffer has room, otherwise in pieces so a slow host does not stall
+    // the acquisition
+    size_t const available = Serial.availableForWrite();
+    if(available == 0)
+        return;
+    outputPosition += Serial.write(outputBuffer + outputPosition, min(outputSize - outputPosition, available));
+}
 
-    for(size_t i = audioResults.minBinIndex; i < audioResults.maxBinIndex; i++)
-        Serial.write((byte*)&(audioResults.noise_floor_distance[i]), 4);
+void SerialIO::printStatistics(Print& out) const
+{
+    out.print("serial: sending ");
+    out.print(isSending() ? "yes" : "no");
+    out.print(", outputs ");
+    out.print(sentOutputs);
+    out.print(", skipped outputs ");
+    out.print(skippedOutputs);
+    out.print(", dropped text ");
+    out.println(textOutput.dropped);
 }
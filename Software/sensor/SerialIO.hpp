@@ -2,7 +2,9 @@
 #define SERISALIO_HPP
 
 #include "AudioSystem.h"
+#include "CommandParser.h"
 #include "Config.h"
+#include "SerialFormat.h"
 
 /**
  * @brief The SerialIO class provides means to communicate with the FFT_visualisation pde java code program
@@ -10,10 +12,67 @@
 class SerialIO
 {
   public:
-    static void printDigits(int digits);
+    /// what the commands received by processInputs() ask loop() to do
+    struct Requests
+    {
+        bool output = false;   // send a spectrum frame
+        bool status = false;   // print the statistics
+        bool profile = false;  // print the profile (see Profiler.h)
+        bool counters = false; // print the frame counters
+        bool memory = false;   // print the memory use
+    };
 
-    void processInputs(AudioSystem::Config& config, bool& sendOutput);
-    void sendOutput(AudioSystem::Results const& results, AudioSystem const& audio, Config const& config);
+    static constexpr size_t inputBudget = 64; // received bytes handled per processInputs() call
+
+  public:
+    static void printDigits(Print& out, int digits);
+
+    /// handles the commands of CommandParser.h without waiting for bytes that did not arrive yet
+    void processInputs(AudioSystem::Config& config, Requests& requests);
+
+    /// encodes the frame (see SerialFormat.h) and sends it in service(); ignored while the previous frame is going out
+    void sendOutput(AudioSystem::Results const& results, AudioSystem& audio, Config const& config);
+    void service(); // call while waiting for the next FFT frame
+    bool isSending() const { return outputPosition < outputSize; }
+    void printStatistics(Print& out) const;
+
+    /// text for the host, sent in service() only between two frames so it never ends up inside one; what does not
+    /// fit until then is dropped and counted
+    Print& text() { return textOutput; }
+    bool hasText() const { return textOutput.length > 0; }
+
+  private:
+    /// collects the text while a frame is going out
+    class TextBuffer : public Print
+    {
+      public:
+        size_t write(uint8_t c) override
+        {
+            if(length == sizeof(data))
+            {
+                dropped++;
+                return 0;
+            }
+            data[length++] = c;
+            return 1;
+        }
+
+        uint8_t data[512];
+        size_t length = 0;
+        uint32_t dropped = 0; // bytes
+    };
+
+    void execute(CommandParser::Command const& command, AudioSystem::Config& config, Requests& requests);
+
+  private:
+    CommandParser parser;
+    SerialFormat::Encoder encoder;
+    uint8_t outputBuffer[SerialFormat::maxFrameSize(AudioSystem::Results::numberOfFftBins)];
+    size_t outputSize = 0;
+    size_t outputPosition = 0; // bytes of the frame already sent
+    uint32_t sentOutputs = 0;
+    uint32_t skippedOutputs = 0;
+    TextBuffer textOutput;
 };
 
 #endif
@@ -0,0 +1,68 @@
+#ifndef SPECTRUMLAYOUT_H
+#define SPECTRUMLAYOUT_H
+
+#include "AudioBlockPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CITRAD_FFT_WIDTH
+#define CITRAD_FFT_WIDTH 1024 // 256, 512, 1024 or 2048; fewer bins give a higher frame rate and need less RAM
+#endif
+#ifndef CITRAD_FFT_OVERLAP
+// 1, 2, 4 or 8 spectra per FFT width of samples; more give a finer time resolution, but the hop has to be at least
+// one audio block (128 samples), so 256 bins allow 2 and 512 bins 4
+#define CITRAD_FFT_OVERLAP 1
+#endif
+#ifndef CITRAD_IQ_MEASUREMENT
+#define CITRAD_IQ_MEASUREMENT 1 // measure in both directions?
+#endif
+
+/**
+ * Which bins of the FFT are analysed, stored and sent, known at compile time for one FFT width and IQ mode.
+ *
+ * The FFT output has fftWidth bins with 0 Hz at iqOffset. In IQ mode the bins below iqOffset hold the reverse
+ * direction, bin iqOffset - n mirrors bin iqOffset + n. Only the bins from minBinIndex to maxBinIndex (excluding) are
+ * kept; all arrays of AudioResults are indexed relative to minBinIndex.
+ */
+template <uint16_t FftWidth, bool IqMeasurement>
+struct SpectrumLayout
+{
+    static_assert(FftWidth == 256 || FftWidth == 512 || FftWidth == 1024 || FftWidth == 2048, "unsupported FFT width");
+
+    static constexpr uint16_t fftWidth = FftWidth;
+    static constexpr bool iqMeasurement = IqMeasurement;
+
+    static constexpr uint16_t sampleRate = 12000;     // Hz; sample rate of data acquisition
+    static constexpr float maxPedestrianSpeed = 10.0; // m/s; speed under which signals are detected as pedestrians
+    static constexpr float sendMaxSpeed = 500;        // don't send (and store) spectral data higher than this speed
+
+    static constexpr uint16_t fftOverlap = CITRAD_FFT_OVERLAP;
+    static constexpr uint16_t fftHop = fftWidth / fftOverlap; // samples from one spectrum to the next
+    static constexpr uint32_t framePeriodMicros = uint32_t(1000000ull * fftHop / sampleRate); // between two frames
+    static constexpr float speedConversion = double(sampleRate) / fftWidth / 44.0; // conversion from bins to m/s
+    static constexpr uint16_t maxPedestrianBin = maxPedestrianSpeed / speedConversion;
+    static constexpr uint16_t rawBinCount =
+        sendMaxSpeed / speedConversion < fftWidth / 2 ? uint16_t(sendMaxSpeed / speedConversion) : fftWidth / 2;
+
+    static constexpr uint16_t iqOffset = IqMeasurement ? fftWidth / 2 : 0; // new middle point
+    static constexpr uint16_t minBinIndex = IqMeasurement ? iqOffset - rawBinCount : 0;
+    static constexpr uint16_t maxBinIndex = iqOffset + rawBinCount;
+    static constexpr uint16_t numberOfFftBins = maxBinIndex - minBinIndex; // send both sides in IQ mode
+
+    static constexpr uint16_t pedestrianBegin = iqOffset + 3;
+    static constexpr uint16_t pedestrianEnd = iqOffset + maxPedestrianBin;
+    static constexpr uint16_t detectionBegin = iqOffset + maxPedestrianBin + 1;
+
+    static_assert(detectionBegin < maxBinIndex, "no bins left for the detection");
+    static_assert(fftOverlap == 1 || fftOverlap == 2 || fftOverlap == 4 || fftOverlap == 8, "unsupported overlap");
+};
+
+using DefaultSpectrumLayout = SpectrumLayout<CITRAD_FFT_WIDTH, CITRAD_IQ_MEASUREMENT != 0>;
+
+// the audio interrupt hands over the last spectrum of a block, the others of a shorter hop would only count as missed
+// and framePeriodMicros would not be the period of the frames (the other widths are only instantiated for the tools)
+static_assert(DefaultSpectrumLayout::fftHop >= AudioBlockPool::blockSamples,
+              "hop shorter than an audio block, use a lower overlap");
+
+#endif
@@ -0,0 +1,135 @@
+#include "SpectrumSummary.h"
+
+#include <string.h>
+
+size_t SpectrumSummary::writeHeader(uint8_t* buffer, Header const& header)
+{
+    uint16_t const size = headerSize;
+    uint16_t const binRecordSize = recordSize(header.binCount);
+    uint8_t const iq = header.iq ? 1 : 0;
+    memcpy(buffer, magic, sizeof(magic));
+    memcpy(buffer + 4, &version, 2);
+    memcpy(buffer + 6, &size, 2);
+    memcpy(buffer + 8, &header.creationTime, 4);
+    memcpy(buffer + 12, &header.windowSeconds, 4);
+    memcpy(buffer + 16, &header.binCount, 2);
+    memcpy(buffer + 18, &iq, 1);
+    memcpy(buffer + 19, &header.sampleRate, 2);
+    memcpy(buffer + 21, &binRecordSize, 2);
+    FrameClock::writeAnchor(buffer + 23, header.anchor);
+    return headerSize;
+}
+
+bool SpectrumSummary::readHeader(uint8_t const* data, size_t size, Header& header)
+{
+    if(size < headerSize || memcmp(data, magic, sizeof(magic)) != 0)
+        return false;
+
+    memcpy(&header.version, data + 4, 2);
+    memcpy(&header.headerSize, data + 6, 2);
+    memcpy(&header.creationTime, data + 8, 4);
+    memcpy(&header.windowSeconds, data + 12, 4);
+    memcpy(&header.binCount, data + 16, 2);
+    header.iq = data[18] != 0;
+    memcpy(&header.sampleRate, data + 19, 2);
+    memcpy(&header.recordSize, data + 21, 2);
+    header.anchor = FrameClock::readAnchor(data + 23);
+
+    // later versions may only append to the header and the records
+    return header.version >= 1 && header.headerSize >= headerSize && header.headerSize <= size &&
+           header.recordSize >= recordSize(header.binCount);
+}
+
+SpectrumSummary::Record SpectrumSummary::readRecord(uint8_t const* data, uint16_t binCount)
+{
+    Record record;
+    memcpy(&record.start, data, 4);
+    memcpy(&record.firstSequence, data + 4, 8);
+    memcpy(&record.lastSequence, data + 12, 8);
+    memcpy(&record.frames, data + 20, 4);
+    memcpy(&record.framesWithSignal, data + 24, 4);
+    memcpy(&record.framesWithSignalReverse, data + 28, 4);
+    memcpy(&record.binsWithSignal, data + 32, 4);
+    memcpy(&record.binsWithSignalReverse, data + 36, 4);
+    record.maxBinsWithSignal = data[40];
+    record.maxBinsWithSignalReverse = data[41];
+    record.lowest = data + 42;
+    record.mean = record.lowest + binCount;
+    record.highest = record.mean + binCount;
+    return record;
+}
+
+size_t SpectrumSummary::recordCount(uint8_t const* data, size_t size)
+{
+    Header header;
+    if(not readHeader(data, size, header))
+        return 0;
+    return (size - header.headerSize) / header.recordSize;
+}
+
+void SpectrumSummary::Window::reset(uint32_t windowSeconds, uint16_t binCount)
+{
+    seconds = windowSeconds;
+    bins = binCount <= maxBinCount ? binCount : maxBinCount;
+    frames = 0;
+}
+
+void SpectrumSummary::Window::add(Frame const& frame)
+{
+    if(frames == 0)
+    {
+        windowStart = startOf(frame.time);
+        firstSequence = frame.sequence;
+        for(size_t i = 0; i < 2; i++)
+        {
+            framesWithSignal[i] = 0;
+            binsWithSignal[i] = 0;
+            maxBinsWithSignal[i] = 0;
+        }
+        memset(lowest, 0, bins);
+        memset(highest, 255, bins);
+        memset(sums, 0, bins * sizeof(sums[0]));
+    }
+    lastSequence = frame.sequence;
+    frames++;
+
+    uint8_t const counts[2] = {frame.binsWithSignal, frame.binsWithSignalReverse};
+    for(size_t i = 0; i < 2; i++)
+    {
+        framesWithSignal[i] += counts[i] > 0 ? 1 : 0;
+        binsWithSignal[i] += counts[i];
+        if(counts[i] > maxBinsWithSignal[i])
+            maxBinsWithSignal[i] = counts[i];
+    }
+
+    for(size_t i = 0; i < bins; i++)
+    {
+        uint8_t const level = frame.levels[i];
+        if(level > lowest[i])
+            lowest[i] = level;
+        if(level < highest[i])
+            highest[i] = level;
+        sums[i] += level;
+    }
+}
+
+size_t SpectrumSummary::Window::writeRecord(uint8_t* buffer)
+{
+    memcpy(buffer, &windowStart, 4);
+    memcpy(buffer + 4, &firstSequence, 8);
+    memcpy(buffer + 12, &lastSequence, 8);
+    memcpy(buffer + 20, &frames, 4);
+    memcpy(buffer + 24, framesWithSignal, 8);
+    memcpy(buffer + 32, binsWithSignal, 8);
+    buffer[40] = maxBinsWithSignal[0];
+    buffer[41] = maxBinsWithSignal[1];
+
+    uint8_t* const mean = buffer + 42 + bins;
+    memcpy(buffer + 42, lowest, bins);
+    for(size_t i = 0; i < bins; i++)
+        mean[i] = frames > 0 ? uint8_t((sums[i] + frames / 2) / frames) : 0;
+    memcpy(mean + bins, highest, bins);
+
+    frames = 0;
+    return recordSize(bins);
+}
@@ -0,0 +1,154 @@
+#ifndef SPECTRUMSUMMARY_H
+#define SPECTRUMSUMMARY_H
+
+#include "FrameClock.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Spectrogram summaries for long deployments, written by FileWriter next to (or instead of) the raw files.
+ *
+ * Each tier aggregates the frames of a fixed window of the RTC (e.g. 1 s, 10 s, 60 s; windows start at multiples of
+ * their length) into one record: per bin the lowest, mean and highest level and per direction how many frames had
+ * bins with signal. A 60 s record of 1024 bins is about 3 kB against 15 MB of 8 bit raw frames. Each tier has its own
+ * files (name ending in _<window>s.sum); a file holds the windows of one summarySecondsPerFile period of the RTC.
+ *
+ * Levels are stored like the 8 bit raw files as -dBFS (0 to 255, fractions cut off): the lowest level is the highest
+ * stored value. The mean is the rounded mean of the stored values of the frames, (sum + frames / 2) / frames, so a
+ * reader that has the frames of a window gets exactly the same value.
+ *
+ * Layout (all values little endian):
+ *  - magic "CRSS" (4 bytes)
+ *  - version (uint 2 bytes)
+ *  - header size in bytes including the magic (uint 2 bytes)
+ *  - timestamp of file creation (uint 4 bytes)
+ *  - window length in seconds (uint 4 bytes)
+ *  - bin count (uint 2 bytes)
+ *  - iq measurement (uint 1 byte)
+ *  - sample rate (uint 2 bytes)
+ *  - record size in bytes (uint 2 bytes)
+ *  - anchor of the sample clock (FrameClock.h, 20 bytes) at the first frame of the file
+ *
+ * followed by fixed size records:
+ *  - RTC time of the window start (uint 4 bytes)
+ *  - sequence numbers of the first and the last frame (uint 8 bytes each, see FrameClock.h)
+ *  - frames in the window (uint 4 bytes); last - first + 1 - frames were missing
+ *  - frames with bins with signal, forward and reverse (uint 4 bytes each)
+ *  - sum of bins_with_signal over the frames, forward and reverse (uint 4 bytes each)
+ *  - highest bins_with_signal, forward and reverse (uint 1 byte each)
+ *  - lowest level per bin (bin count bytes)
+ *  - mean level per bin (bin count bytes)
+ *  - highest level per bin (bin count bytes)
+ *
+ * A window is written when the first frame of a later window arrives or the files are closed, so the last window
+ * before a close can be partial. Records reach the card with each flush (once a second); after a power loss a partial
+ * last record is ignored by readers.
+ */
+namespace SpectrumSummary
+{
+constexpr char magic[4] = {'C', 'R', 'S', 'S'};
+constexpr uint16_t version = 1;
+constexpr size_t headerSize = 23 + FrameClock::anchorSize;
+constexpr size_t maxBinCount = 2048;
+constexpr size_t tierCount = 3; // window lengths written side by side
+
+constexpr size_t recordSize(size_t binCount)
+{
+    return 42 + 3 * binCount;
+}
+
+/// the level of a bin as stored in the file
+inline uint8_t quantize(float dbfs)
+{
+    return dbfs >= 0 ? 0 : dbfs <= -255 ? 255 : uint8_t(-dbfs);
+}
+
+struct Header
+{
+    uint16_t version = SpectrumSummary::version;
+    uint16_t headerSize = SpectrumSummary::headerSize; // records start here
+    uint32_t creationTime = 0;
+    uint32_t windowSeconds = 0;
+    uint16_t binCount = 0;
+    bool iq = false;
+    uint16_t sampleRate = 0;
+    uint16_t recordSize = 0;
+    FrameClock::Anchor anchor;
+};
+
+/// a record as read from a file; the levels point into the file data
+struct Record
+{
+    uint32_t start;
+    uint64_t firstSequence;
+    uint64_t lastSequence;
+    uint32_t frames;
+    uint32_t framesWithSignal;
+    uint32_t framesWithSignalReverse;
+    uint32_t binsWithSignal;
+    uint32_t binsWithSignalReverse;
+    uint8_t maxBinsWithSignal;
+    uint8_t maxBinsWithSignalReverse;
+    uint8_t const* lowest;
+    uint8_t const* mean;
+    uint8_t const* highest;
+};
+
+/// the part of an analysed frame that goes into the summaries
+struct Frame
+{
+    uint32_t time;         // RTC seconds of the capture
+    uint64_t sequence;     // sample clock
+    uint8_t const* levels; // binCount levels, see quantize()
+    uint8_t binsWithSignal;
+    uint8_t binsWithSignalReverse;
+};
+
+/// writes the header into buffer (headerSize bytes) and returns its size; the record size is derived
+size_t writeHeader(uint8_t* buffer, Header const& header);
+/// false if data is no summary file this reader understands
+bool readHeader(uint8_t const* data, size_t size, Header& header);
+/// the record at data; binCount from the header
+Record readRecord(uint8_t const* data, uint16_t binCount);
+/// number of complete records in a file, 0 if data is no summary file
+size_t recordCount(uint8_t const* data, size_t size);
+
+/// aggregates the frames of one window of one tier
+class Window
+{
+  public:
+    /// windowSeconds 0 disables the tier; drops the frames added so far
+    void reset(uint32_t windowSeconds, uint16_t binCount);
+
+    bool enabled() const { return seconds > 0; }
+    uint32_t windowSeconds() const { return seconds; }
+    uint16_t binCount() const { return bins; }
+    bool empty() const { return frames == 0; }
+    /// RTC time of the window start, valid if not empty
+    uint32_t start() const { return windowStart; }
+    /// start of the window a frame captured at time belongs to
+    uint32_t startOf(uint32_t time) const { return time - time % seconds; }
+
+    /// adds a frame of the window of start(); an empty window takes the window of the frame
+    void add(Frame const& frame);
+    /// writes the record of the window into buffer (recordSize(binCount()) bytes), returns its size and empties it
+    size_t writeRecord(uint8_t* buffer);
+
+  private:
+    uint32_t seconds = 0;
+    uint16_t bins = 0;
+    uint32_t windowStart = 0;
+    uint64_t firstSequence = 0;
+    uint64_t lastSequence = 0;
+    uint32_t frames = 0;
+    uint32_t framesWithSignal[2];
+    uint32_t binsWithSignal[2];
+    uint8_t maxBinsWithSignal[2];
+    uint8_t lowest[maxBinCount]; // highest -dBFS
+    uint8_t highest[maxBinCount];
+    uint32_t sums[maxBinCount];
+};
+} // namespace SpectrumSummary
+
+#endif
@@ -0,0 +1,265 @@
+#include "Tracking.h"
+
+#include <string.h>
+
+size_t Tracking::findPeaks(
+    float const* values,
+    ptrdiff_t stride,
+    size_t count,
+    float threshold,
+    size_t minSeparation,
+    Peak* peaks,
+    size_t maxCount)
+{
+    size_t found = 0;
+    for(size_t k = 1; k + 1 < count; k++)
+    {
+        float const before = values[(ptrdiff_t(k) - 1) * stride];
+        float const value = values[ptrdiff_t(k) * stride];
+        float const after = values[(ptrdiff_t(k) + 1) * stride];
+        if(value <= threshold || value < before || value <= after)
+            continue;
+
+        // vertex of the parabola through the three bins, at most half a bin away from the maximum
+        float const curvature = before - 2 * value + after;
+        float const offset = curvature < 0 ? 0.5f * (before - after) / curvature : 0;
+        Peak const peak = {k + offset, value - 0.25f * (before - after) * offset};
+
+        // a stronger peak nearby suppresses this one, a weaker one nearby is replaced
+        size_t slot = found;
+        bool suppressed = false;
+        for(size_t i = 0; i < found; i++)
+        {
+            float const distance = peaks[i].bin > peak.bin ? peaks[i].bin - peak.bin : peak.bin - peaks[i].bin;
+            if(distance >= minSeparation)
+                continue;
+            if(peaks[i].strength >= peak.strength)
+                suppressed = true;
+            else
+                slot = i;
+            break;
+        }
+        if(suppressed)
+            continue;
+
+        if(slot == found)
+        {
+            if(found < maxCount)
+                found++;
+            else if(peaks[found - 1].strength >= peak.strength)
+                continue;
+            slot = found - 1;
+        }
+
+        // move the peak to its place in the strength order
+        while(slot > 0 && peaks[slot - 1].strength < peak.strength)
+        {
+            peaks[slot] = peaks[slot - 1];
+            slot--;
+        }
+        while(slot + 1 < found && peaks[slot + 1].strength > peak.strength)
+        {
+            peaks[slot] = peaks[slot + 1];
+            slot++;
+        }
+        peaks[slot] = peak;
+    }
+    return found;
+}
+
+char const* Tracking::directionName(Direction direction)
+{
+    return direction == Direction::Forward ? "forward" : "reverse";
+}
+
+char const* Tracking::categoryName(Category category)
+{
+    switch(category)
+    {
+    case Category::Pedestrian:
+        return "pedestrian";
+    case Category::Cyclist:
+        return "cyclist";
+    case Category::Vehicle:
+        return "vehicle";
+    }
+    return "?";
+}
+
+void Tracking::Tracker::update(
+    uint32_t timestamp, Detection const* forward, size_t forwardCount, Detection const* reverse, size_t reverseCount)
+{
+    for(auto& track : tracks)
+        if(track.active && timestamp - track.lastSeen > settings.maxGapMs)
+            end(track);
+
+    associate(timestamp, Direction::Forward, forward, forwardCount);
+    associate(timestamp, Direction::Reverse, reverse, reverseCount);
+}
+
+void Tracking::Tracker::associate(
+    uint32_t timestamp, Direction direction, Detection const* detections, size_t count)
+{
+    bool continued[maxTracks] = {};
+    for(size_t i = 0; i < count; i++)
+    {
+        Detection const& detection = detections[i];
+
+        // the strongest peaks come first and pick the closest track within the gate
+        Track* closest = nullptr;
+        float closestDistance = 0;
+        bool claimed = false; // within the gate of a track that already has a peak of this frame
+        for(size_t t = 0; t < maxTracks; t++)
+        {
+            Track& track = tracks[t];
+            if(not track.active || track.direction != direction)
+                continue;
+
+            float const distance = detection.speed > track.lastSpeed ? detection.speed - track.lastSpeed
+                                                                     : track.lastSpeed - detection.speed;
+            if(distance > gate(track.lastSpeed))
+                continue;
+            if(continued[t])
+            {
+                claimed = true;
+                continue;
+            }
+            if(not closest || distance < closestDistance)
+            {
+                closest = &track;
+                closestDistance = distance;
+            }
+        }
+
+        if(closest)
+        {
+            continued[closest - tracks] = true;
+            add(*closest, timestamp, detection);
+            continue;
+        }
+
+        // further peaks of a passage that is already followed (wheels, reflections) do not start a track
+        if(claimed || detection.strength < settings.startStrength)
+            continue;
+
+        Track* free = nullptr;
+        for(auto& track : tracks)
+            if(not track.active)
+            {
+                free = &track;
+                break;
+            }
+        if(not free)
+        {
+            stats.noFreeTrack++;
+            continue;
+        }
+        start(*free, timestamp, direction, detection);
+        continued[free - tracks] = true;
+    }
+}
+
+void Tracking::Tracker::finish()
+{
+    for(auto& track : tracks)
+        if(track.active)
+            end(track);
+}
+
+bool Tracking::Tracker::nextEvent(Event& event)
+{
+    if(eventCount == 0)
+        return false;
+
+    event = events[firstEvent];
+    firstEvent = (firstEvent + 1) % maxEvents;
+    eventCount--;
+    return true;
+}
+
+size_t Tracking::Tracker::activeTracks() const
+{
+    size_t count = 0;
+    for(auto const& track : tracks)
+        count += track.active;
+    return count;
+}
+
+void Tracking::Tracker::start(Track& track, uint32_t timestamp, Direction direction, Detection const& detection)
+{
+    track.active = true;
+    track.direction = direction;
+    track.start = timestamp;
+    track.peakSpeed = 0;
+    track.strength = 0;
+    track.frames = 0;
+    memset(track.histogram, 0, sizeof(track.histogram));
+    add(track, timestamp, detection);
+}
+
+void Tracking::Tracker::add(Track& track, uint32_t timestamp, Detection const& detection)
+{
+    track.lastSeen = timestamp;
+    track.lastSpeed = detection.speed;
+    if(detection.speed > track.peakSpeed)
+        track.peakSpeed = detection.speed;
+    if(detection.strength > track.strength)
+        track.strength = detection.strength;
+    if(track.frames < UINT16_MAX)
+        track.frames++;
+
+    size_t const bucket = detection.speed > 0 ? size_t(detection.speed / histogramStep) : 0;
+    uint16_t& histogramCount = track.histogram[bucket < histogramBuckets ? bucket : histogramBuckets - 1];
+    if(histogramCount < UINT16_MAX)
+        histogramCount++;
+}
+
+void Tracking::Tracker::end(Track& track)
+{
+    track.active = false;
+    if(track.frames < settings.minFrames)
+    {
+        stats.dropped++;
+        return;
+    }
+
+    Event event;
+    event.start = track.start;
+    event.end = track.lastSeen;
+    event.peakSpeed = track.peakSpeed;
+    event.strength = track.strength;
+    event.frames = track.frames;
+    event.direction = track.direction;
+    event.category = track.peakSpeed <= settings.pedestrianMaxSpeed ? Category::Pedestrian
+                     : track.peakSpeed <= settings.cyclistMaxSpeed  ? Category::Cyclist
+                                                                    : Category::Vehicle;
+
+    // median from the histogram, interpolated within its bucket
+    uint32_t const half = track.frames / 2;
+    uint32_t below = 0;
+    for(size_t i = 0; i < histogramBuckets; i++)
+    {
+        if(below + track.histogram[i] > half)
+        {
+            event.medianSpeed = (i + (half - below + 0.5f) / track.histogram[i]) * histogramStep;
+            break;
+        }
+        below += track.histogram[i];
+    }
+
+    if(eventCount == maxEvents)
+    {
+        stats.lostEvents++;
+        firstEvent = (firstEvent + 1) % maxEvents;
+        eventCount--;
+    }
+    events[(firstEvent + eventCount) % maxEvents] = event;
+    eventCount++;
+    stats.events++;
+}
+
+float Tracking::Tracker::gate(float speed) const
+{
+    float const relative = speed * settings.gateRatio;
+    return relative > settings.gateSpeed ? relative : settings.gateSpeed;
+}
@@ -0,0 +1,154 @@
+#ifndef TRACKING_H
+#define TRACKING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Passages of road users from the peaks of the spectra.
+ *
+ * findPeaks() picks the strongest local maxima of the noise floor distance of one direction and refines their
+ * position between the bins by fitting a parabola through the maximum and its neighbours. Tracker follows these
+ * peaks from frame to frame: a peak continues the track of the same direction with the closest speed, a strong peak
+ * that no track claims starts a new one. A track ends once it has not been continued for maxGapMs and is reported as
+ * one Event with its duration, peak and median speed and strength, unless it was too short to be a passage. The
+ * tracker has a fixed number of tracks and a fixed speed histogram per track, so it needs no allocation.
+ */
+namespace Tracking
+{
+constexpr size_t maxPeaks = 4; // per frame and direction
+
+struct Peak
+{
+    float bin = 0;      // fractional index into the analysed values
+    float strength = 0; // interpolated dB above the noise floor
+};
+
+/**
+ * Stores the up to maxCount strongest local maxima above threshold of values[0], values[stride], ...,
+ * values[(count - 1) * stride] in peaks, strongest first, and returns how many were found. Maxima closer than
+ * minSeparation bins to a stronger one are left out, they are usually part of the same signal.
+ */
+size_t findPeaks(
+    float const* values,
+    ptrdiff_t stride,
+    size_t count,
+    float threshold,
+    size_t minSeparation,
+    Peak* peaks,
+    size_t maxCount);
+
+enum class Direction : uint8_t
+{
+    Forward,
+    Reverse,
+};
+
+enum class Category : uint8_t
+{
+    Pedestrian,
+    Cyclist,
+    Vehicle,
+};
+
+char const* directionName(Direction direction);
+char const* categoryName(Category category);
+
+struct Event
+{
+    uint32_t start = 0; // timestamp of the first frame in ms
+    uint32_t end = 0;   // timestamp of the last frame in ms
+    float peakSpeed = 0;
+    float medianSpeed = 0;
+    float strength = 0; // highest dB above the noise floor
+    uint16_t frames = 0;
+    Direction direction = Direction::Forward;
+    Category category = Category::Vehicle;
+};
+
+/// one frame's peaks of one direction, converted to m/s
+struct Detection
+{
+    float speed = 0;
+    float strength = 0;
+};
+
+class Tracker
+{
+  public:
+    static constexpr size_t maxTracks = 8;
+    static constexpr size_t maxEvents = 4;          // finished passages waiting for nextEvent()
+    static constexpr size_t histogramBuckets = 128; // per track for the median speed
+    static constexpr float histogramStep = 0.5;     // m/s per bucket, faster speeds go into the last one
+
+    struct Settings
+    {
+        float startStrength = 15;      // dB above the noise floor a peak needs to start a track
+        float gateSpeed = 1.5;         // m/s a peak may differ from the last speed of a track to continue it
+        float gateRatio = 0.15;        // ... or this share of the speed, whichever is larger
+        uint32_t maxGapMs = 400;       // a track ends after this long without a peak
+        uint16_t minFrames = 3;        // shorter tracks are dropped as noise
+        float pedestrianMaxSpeed = 2.5; // m/s; peak speeds up to here are pedestrians
+        float cyclistMaxSpeed = 8;     // m/s; ... up to here cyclists, faster ones vehicles
+    };
+
+    struct Statistics
+    {
+        uint32_t events = 0;      // passages reported
+        uint32_t dropped = 0;     // tracks shorter than minFrames
+        uint32_t noFreeTrack = 0; // peaks that could have started a track but all were in use
+        uint32_t lostEvents = 0;  // passages lost because nextEvent() was not called often enough
+    };
+
+  public:
+    void setSettings(Settings const& settings) { this->settings = settings; }
+    Settings const& getSettings() const { return settings; }
+
+    /// the peaks of one frame, strongest first; ends the tracks that were not continued for too long
+    void update(
+        uint32_t timestamp,
+        Detection const* forward,
+        size_t forwardCount,
+        Detection const* reverse,
+        size_t reverseCount);
+
+    /// ends all tracks, e.g. before the recording stops
+    void finish();
+
+    /// the next finished passage, false if there is none
+    bool nextEvent(Event& event);
+
+    size_t activeTracks() const;
+    Statistics const& statistics() const { return stats; }
+
+  private:
+    struct Track
+    {
+        bool active = false;
+        Direction direction = Direction::Forward;
+        uint32_t start = 0;
+        uint32_t lastSeen = 0;
+        float lastSpeed = 0;
+        float peakSpeed = 0;
+        float strength = 0;
+        uint16_t frames = 0;
+        uint16_t histogram[histogramBuckets];
+    };
+
+    void associate(uint32_t timestamp, Direction direction, Detection const* detections, size_t count);
+    void start(Track& track, uint32_t timestamp, Direction direction, Detection const& detection);
+    void add(Track& track, uint32_t timestamp, Detection const& detection);
+    void end(Track& track);
+    float gate(float speed) const;
+
+  private:
+    Settings settings;
+    Track tracks[maxTracks];
+    Event events[maxEvents];
+    size_t firstEvent = 0;
+    size_t eventCount = 0;
+    Statistics stats;
+};
+} // namespace Tracking
+
+#endif
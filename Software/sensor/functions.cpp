@@ -28,3 +28,35 @@ time_t getTeensy3Time()
 {
     return Teensy3Clock.get();
 }
+
+// the stack grows down from the end of RAM1 (DTCM) towards the static variables, see the Teensy 4 linker script
+extern unsigned long _ebss;
+extern unsigned long _estack;
+
+namespace
+{
+constexpr uint32_t stackPattern = 0xC17AD5A5;
+constexpr uint32_t stackReserve = 1024; // bytes below the current frame that are left alone
+} // namespace
+
+void paintStack()
+{
+    uint32_t* word = reinterpret_cast<uint32_t*>(&_ebss);
+    uint32_t* const end = reinterpret_cast<uint32_t*>(static_cast<char*>(__builtin_frame_address(0)) - stackReserve);
+    for(; word < end; word++)
+        *word = stackPattern;
+}
+
+uint32_t stackSize()
+{
+    return reinterpret_cast<char*>(&_estack) - reinterpret_cast<char*>(&_ebss);
+}
+
+uint32_t stackUsed()
+{
+    uint32_t const* word = reinterpret_cast<uint32_t const*>(&_ebss);
+    uint32_t const* const end = reinterpret_cast<uint32_t const*>(&_estack);
+    while(word < end and *word == stackPattern)
+        word++;
+    return reinterpret_cast<char const*>(end) - reinterpret_cast<char const*>(word);
+}
@@ -6,4 +6,10 @@
 void setI2SFreq(int freq);
 time_t getTeensy3Time();
 
+/// fills the unused stack with a pattern, at the start of setup(); stackUsed() finds the deepest overwritten word
+void paintStack();
+/// bytes of the stack (from the end of the static variables in RAM1 to its top) and its high-water mark
+uint32_t stackSize();
+uint32_t stackUsed();
+
 #endif
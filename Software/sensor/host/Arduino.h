@@ -0,0 +1,130 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Thin stand-ins for the parts of the Teensy core the sensor code uses, so it can be built and replayed on a PC.
+// Time and I/O are controlled by HostEnvironment.h.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <type_traits>
+
+typedef uint8_t byte;
+
+#define PIN_A3 17
+#define PIN_A4 18
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+
+template <typename A, typename B>
+constexpr typename std::common_type<A, B>::type min(A a, B b)
+{
+    return a < b ? a : b;
+}
+template <typename A, typename B>
+constexpr typename std::common_type<A, B>::type max(A a, B b)
+{
+    return a > b ? a : b;
+}
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+class String
+{
+  public:
+    String(char const* text = "")
+        : text(text)
+    {}
+    String(std::string text)
+        : text(std::move(text))
+    {}
+
+    char const* c_str() const { return text.c_str(); }
+    size_t length() const { return text.size(); }
+
+    friend String operator+(String const& a, String const& b) { return String(a.text + b.text); }
+    friend String operator+(String const& a, char const* b) { return String(a.text + b); }
+    friend String operator+(char const* a, String const& b) { return String(a + b.text); }
+
+  private:
+    std::string text;
+};
+
+/// formats like the Teensy core, so csv output matches the device byte by byte
+class Print
+{
+  public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(uint8_t const* data, size_t size)
+    {
+        size_t written = 0;
+        while(size-- > 0)
+            written += write(*data++);
+        return written;
+    }
+    size_t write(char const* text) { return write(reinterpret_cast<uint8_t const*>(text), strlen(text)); }
+
+    size_t print(char const* text) { return write(text); }
+    size_t print(String const& text) { return write(text.c_str()); }
+    size_t print(char c) { return write(uint8_t(c)); }
+    size_t print(int value) { return print(long(value)); }
+    size_t print(unsigned int value) { return print((unsigned long)value); }
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(unsigned long long value);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T const& value)
+    {
+        size_t const written = print(value);
+        return written + println();
+    }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    long parseInt();
+};
+
+class usb_serial_class : public Stream
+{
+  public:
+    void begin(long) {}
+    explicit operator bool() const { return true; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(uint8_t const* data, size_t size) override;
+    using Print::write;
+    int availableForWrite();
+
+    int available() override;
+    int read() override;
+};
+extern usb_serial_class Serial;
+
+class teensy3_clock_class
+{
+  public:
+    unsigned long get();
+    void set(unsigned long time);
+};
+extern teensy3_clock_class Teensy3Clock;
+
+#endif
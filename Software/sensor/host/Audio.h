@@ -0,0 +1,77 @@
+#ifndef HOST_AUDIO_H
+#define HOST_AUDIO_H
+
+#include "Arduino.h"
+
+#define AUDIO_INPUT_LINEIN 0
+#define AUDIO_INPUT_MIC 1
+
+/// how an audio object uses the blocks of the pool (see AudioBlockPool.h); the patch cords are recorded with it, so
+/// HostEnvironment::audioGraph() can count the blocks of the graph that was built
+enum class HostBlockUse
+{
+    Reading, // takes the blocks of its inputs and releases them in the same cycle (peak, FFT)
+    Input,   // I2S input, a block per channel being filled and one handed to the graph
+    Writing, // allocates a block for its output (gain, mixer)
+    Output,  // I2S output, a block per channel being played and the next one
+};
+
+class AudioStream
+{
+  public:
+    explicit AudioStream(HostBlockUse use = HostBlockUse::Reading)
+        : blockUse(use)
+    {}
+
+    HostBlockUse const blockUse;
+};
+
+class AudioConnection
+{
+  public:
+    AudioConnection(AudioStream& source, unsigned char sourceOutput, AudioStream& destination, unsigned char input);
+};
+
+/// the pool size is kept for HostEnvironment::audioMemoryBlocks()
+void AudioMemory(int blocks);
+inline int AudioMemoryUsage()
+{
+    return 0;
+}
+inline int AudioMemoryUsageMax()
+{
+    return 0;
+}
+
+class AudioAnalyzePeak : public AudioStream
+{
+  public:
+    float read() { return 0; }
+};
+
+class AudioInputI2S : public AudioStream
+{
+  public:
+    AudioInputI2S()
+        : AudioStream(HostBlockUse::Input)
+    {}
+};
+class AudioOutputI2S : public AudioStream
+{
+  public:
+    AudioOutputI2S()
+        : AudioStream(HostBlockUse::Output)
+    {}
+};
+
+class AudioControlSGTL5000
+{
+  public:
+    bool enable() { return true; }
+    bool inputSelect(int) { return true; }
+    bool micGain(unsigned int) { return true; }
+    bool lineInLevel(uint8_t) { return true; }
+    bool volume(float) { return true; }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HOST_AUDIOSTREAM_F32_H
+#define HOST_AUDIOSTREAM_F32_H
+
+#include "Audio.h"
+
+class AudioStream_F32
+{
+  public:
+    explicit AudioStream_F32(HostBlockUse use = HostBlockUse::Reading)
+        : blockUse(use)
+    {}
+
+    HostBlockUse const blockUse;
+};
+
+class AudioConnection_F32
+{
+  public:
+    AudioConnection_F32(
+        AudioStream_F32& source, unsigned char sourceOutput, AudioStream_F32& destination, unsigned char input);
+};
+
+/// the pool size is kept for HostEnvironment::audioMemoryBlocks()
+void AudioMemory_F32(int blocks);
+inline int AudioMemoryUsage_F32()
+{
+    return 0;
+}
+inline int AudioMemoryUsageMax_F32()
+{
+    return 0;
+}
+
+#endif
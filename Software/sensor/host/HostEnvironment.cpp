@@ -0,0 +1,425 @@
+#include "HostEnvironment.h"
+
+#include "Arduino.h"
+#include "OpenAudio_ArduinoLibrary.h"
+#include "SD.h"
+#include "SPI.h"
+#include "TimeLib.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <set>
+#include <utility>
+
+namespace
+{
+uint32_t currentMillis = 0;
+uint32_t timeBaseSeconds = 0;
+uint32_t timeBaseMillis = 0;
+
+float const* fftFrame = nullptr;
+uint64_t fftSequence = 0;
+FrameClock::Time fftTime;
+
+std::deque<uint8_t> serialInput;
+std::vector<uint8_t> serialOutputData;
+size_t serialWriteBudget = 4096;
+
+/// connected channels of the I2S objects and connected writing stages; the audio objects can be globals constructed
+/// before the ones of this file
+struct AudioPatch
+{
+    std::set<std::pair<void const*, unsigned>> inputChannels;
+    std::set<void const*> writingStages;
+    std::set<std::pair<void const*, unsigned>> outputChannels;
+    size_t poolBlocks = 0;
+};
+
+AudioPatch& audioPatch()
+{
+    static AudioPatch patch;
+    return patch;
+}
+
+void connectAudio(
+    void const* source, HostBlockUse sourceUse, unsigned output, void const* destination, HostBlockUse destinationUse,
+    unsigned input)
+{
+    AudioPatch& patch = audioPatch();
+    if(sourceUse == HostBlockUse::Input)
+        patch.inputChannels.insert({source, output});
+    if(destinationUse == HostBlockUse::Writing)
+        patch.writingStages.insert(destination);
+    if(destinationUse == HostBlockUse::Output)
+        patch.outputChannels.insert({destination, input});
+}
+
+tm currentTime()
+{
+    time_t const time = now();
+    tm result;
+    gmtime_r(&time, &result);
+    return result;
+}
+} // namespace
+
+usb_serial_class Serial;
+teensy3_clock_class Teensy3Clock;
+SDClass SD;
+SPIClass SPI;
+
+void HostEnvironment::setMillis(uint32_t ms)
+{
+    currentMillis = ms;
+}
+
+void HostEnvironment::setTime(uint32_t seconds)
+{
+    timeBaseSeconds = seconds;
+    timeBaseMillis = currentMillis;
+}
+
+void HostEnvironment::setFftFrame(float const* data, uint64_t sequence)
+{
+    fftFrame = data;
+    fftSequence = sequence > 0 ? sequence : fftSequence + 1;
+    uint32_t const sinceTimeBase = currentMillis - timeBaseMillis;
+    fftTime.seconds = timeBaseSeconds + sinceTimeBase / 1000;
+    fftTime.micros = sinceTimeBase % 1000 * 1000;
+}
+
+void HostEnvironment::sendSerialInput(char const* text)
+{
+    serialInput.insert(serialInput.end(), text, text + strlen(text));
+}
+
+void HostEnvironment::setSerialWriteBudget(size_t bytes)
+{
+    serialWriteBudget = bytes;
+}
+
+std::vector<uint8_t> const& HostEnvironment::serialOutput()
+{
+    return serialOutputData;
+}
+
+HostEnvironment::FileSystem& HostEnvironment::sdFiles()
+{
+    static FileSystem files;
+    return files;
+}
+
+std::map<std::string, HostEnvironment::FileAccess>& HostEnvironment::sdAccess()
+{
+    static std::map<std::string, FileAccess> access;
+    return access;
+}
+
+AudioBlockPool::Graph HostEnvironment::audioGraph()
+{
+    AudioPatch const& patch = audioPatch();
+    return {uint8_t(patch.inputChannels.size()),
+            uint8_t(patch.writingStages.size()),
+            uint8_t(patch.outputChannels.size()),
+            0};
+}
+
+size_t HostEnvironment::audioMemoryBlocks()
+{
+    return audioPatch().poolBlocks;
+}
+
+AudioConnection::AudioConnection(
+    AudioStream& source, unsigned char sourceOutput, AudioStream& destination, unsigned char input)
+{
+    connectAudio(&source, source.blockUse, sourceOutput, &destination, destination.blockUse, input);
+}
+
+AudioConnection_F32::AudioConnection_F32(
+    AudioStream_F32& source, unsigned char sourceOutput, AudioStream_F32& destination, unsigned char input)
+{
+    connectAudio(&source, source.blockUse, sourceOutput, &destination, destination.blockUse, input);
+}
+
+void AudioMemory(int blocks)
+{
+    audioPatch().poolBlocks = size_t(blocks);
+}
+
+void AudioMemory_F32(int blocks)
+{
+    audioPatch().poolBlocks = size_t(blocks);
+}
+
+uint32_t millis()
+{
+    return currentMillis;
+}
+
+uint32_t micros()
+{
+    // durations measured by the sensor code (e.g. BufferedFile) are real host durations
+    using namespace std::chrono;
+    return uint32_t(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void delay(uint32_t ms)
+{
+    currentMillis += ms;
+}
+
+size_t Print::print(long value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long long value)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%llu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits)
+{
+    // Print::printFloat of the Teensy core: the rounding is added up front and the digits are cut off one by one,
+    // which differs from printf in the last digit for some values
+    if(isnan(value))
+        return write("nan");
+    if(isinf(value))
+        return write("inf");
+    if(value > 4294967040.0f || value < -4294967040.0f)
+        return write("ovf");
+
+    std::string text;
+    if(value < 0.0)
+    {
+        text += '-';
+        value = -value;
+    }
+
+    double rounding = 0.5;
+    for(int i = 0; i < digits; ++i)
+        rounding *= 0.1;
+    value += rounding;
+
+    unsigned long const intPart = (unsigned long)value;
+    double remainder = value - (double)intPart;
+    text += std::to_string(intPart);
+    if(digits > 0)
+        text += '.';
+    for(int i = 0; i < digits && i < 15; i++)
+    {
+        remainder *= 10.0;
+        uint8_t const n = (uint8_t)remainder;
+        text += char('0' + n);
+        remainder -= n;
+    }
+    return write(text.c_str());
+}
+
+long Stream::parseInt()
+{
+    // like the Teensy core: skip everything up to the first digit or minus sign, then read while digits follow
+    int c;
+    while((c = read()) >= 0 && c != '-' && (c < '0' || c > '9'))
+        ;
+    if(c < 0)
+        return 0;
+
+    bool const negative = c == '-';
+    long value = negative ? 0 : c - '0';
+    while(available() > 0)
+    {
+        c = read();
+        if(c < '0' || c > '9')
+            break;
+        value = value * 10 + c - '0';
+    }
+    return negative ? -value : value;
+}
+
+size_t usb_serial_class::write(uint8_t const* data, size_t size)
+{
+    serialOutputData.insert(serialOutputData.end(), data, data + size);
+    return size;
+}
+
+int usb_serial_class::availableForWrite()
+{
+    return int(serialWriteBudget);
+}
+
+int usb_serial_class::available()
+{
+    return int(serialInput.size());
+}
+
+int usb_serial_class::read()
+{
+    if(serialInput.empty())
+        return -1;
+    int const c = serialInput.front();
+    serialInput.pop_front();
+    return c;
+}
+
+unsigned long teensy3_clock_class::get()
+{
+    return now();
+}
+
+void teensy3_clock_class::set(unsigned long time)
+{
+    ::setTime(time);
+}
+
+time_t now()
+{
+    return timeBaseSeconds + (currentMillis - timeBaseMillis) / 1000;
+}
+
+void setTime(time_t time)
+{
+    HostEnvironment::setTime(uint32_t(time));
+}
+
+int year()
+{
+    return currentTime().tm_year + 1900;
+}
+
+int month()
+{
+    return currentTime().tm_mon + 1;
+}
+
+int day()
+{
+    return currentTime().tm_mday;
+}
+
+int hour()
+{
+    return currentTime().tm_hour;
+}
+
+int minute()
+{
+    return currentTime().tm_min;
+}
+
+int second()
+{
+    return currentTime().tm_sec;
+}
+
+bool HostFftBase::available()
+{
+    return fftFrame != nullptr;
+}
+
+float* HostFftBase::getData()
+{
+    // the analyser hands out its internal buffer, the sensor code only reads it
+    float* const data = const_cast<float*>(fftFrame);
+    fftFrame = nullptr;
+    frameSequence = fftSequence;
+    frameTime = fftTime;
+    spectra++;
+    return data;
+}
+
+float* HostFftBase::toOutput(float* data, size_t width)
+{
+    if(output == FftOutput::Dbfs || not data)
+        return data;
+    power.resize(width);
+    for(size_t i = 0; i < width; i++)
+        power[i] = std::pow(10.0f, data[i] / 10);
+    return power.data();
+}
+
+size_t File::write(uint8_t const* buffer, size_t size)
+{
+    if(not data)
+        return 0;
+    if(position + size > data->size())
+        data->resize(position + size);
+    std::copy(buffer, buffer + size, data->begin() + position);
+    position += size;
+    if(access)
+    {
+        access->writeCalls++;
+        if(position % 512 != 0)
+            access->unalignedWrites++;
+    }
+    return size;
+}
+
+int File::available()
+{
+    return data ? int(data->size() - position) : 0;
+}
+
+int File::read()
+{
+    if(available() <= 0)
+        return -1;
+    return (*data)[position++];
+}
+
+size_t File::read(void* buffer, size_t size)
+{
+    size_t const count = std::min<size_t>(size, available());
+    if(count > 0)
+        std::copy(data->begin() + position, data->begin() + position + count, static_cast<uint8_t*>(buffer));
+    position += count;
+    return count;
+}
+
+File SDClass::open(char const* name, uint8_t mode)
+{
+    auto& files = HostEnvironment::sdFiles();
+    auto const it = files.find(name);
+    if(it != files.end())
+        return File(it->second, mode == FILE_WRITE, &HostEnvironment::sdAccess()[name]);
+    if(mode != FILE_WRITE)
+        return File();
+
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    files[name] = data;
+    return File(data, true, &HostEnvironment::sdAccess()[name]);
+}
+
+bool SDClass::exists(char const* name)
+{
+    return HostEnvironment::sdFiles().count(name) > 0;
+}
+
+bool SDClass::remove(char const* name)
+{
+    return HostEnvironment::sdFiles().erase(name) > 0;
+}
+
+bool SDClass::rename(char const* from, char const* to)
+{
+    auto& files = HostEnvironment::sdFiles();
+    auto const it = files.find(from);
+    if(it == files.end() || files.count(to) > 0)
+        return false;
+    files[to] = it->second;
+    files.erase(it);
+    return true;
+}
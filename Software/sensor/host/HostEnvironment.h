@@ -0,0 +1,57 @@
+#ifndef HOST_HOSTENVIRONMENT_H
+#define HOST_HOSTENVIRONMENT_H
+
+// Control side of the Arduino stand-ins in this directory: the replay decides what time it is, which FFT frame the
+// analyser yields, what arrives on the serial port and reads back everything the sensor code wrote.
+
+#include "../AudioBlockPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HostEnvironment
+{
+/// millis() only moves when the replay says so, which makes every run of a recording produce the same output
+void setMillis(uint32_t ms);
+/// wall clock of TimeLib and Teensy3Clock in seconds since 1970 at the current millis()
+void setTime(uint32_t seconds);
+
+/// the next AudioAnalyzeFFT*_IQ_F32::available() returns true and getData() returns data (Layout::fftWidth bins);
+/// its sequence number is the given one or, with 0, the one after the previous frame. The capture time is the wall
+/// clock at the current millis().
+void setFftFrame(float const* data, uint64_t sequence = 0);
+
+/// bytes the sensor code reads from Serial next
+void sendSerialInput(char const* text);
+/// what Serial.availableForWrite() reports each time it is called, like the free space of the USB buffer
+void setSerialWriteBudget(size_t bytes);
+std::vector<uint8_t> const& serialOutput();
+
+using FileSystem = std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>;
+/// files of the stand-in SD card; can be filled before setup() to provide e.g. NOISEFLR.BIN
+FileSystem& sdFiles();
+
+/// calls of the sensor code on one file of the SD card
+struct FileAccess
+{
+    size_t writeCalls = 0;
+    size_t flushCalls = 0;
+    size_t unalignedWrites = 0; // writes that do not end on a 512 byte sector boundary of the file
+};
+/// by the name the file was opened with
+std::map<std::string, FileAccess>& sdAccess();
+
+/// the patch cords of the audio objects constructed so far, counted like AudioBlockPool::Graph: the channels of the
+/// I2S input and output that are connected and the writing stages with a connected input. The stand-ins replay
+/// spectra and keep no samples across cycles.
+AudioBlockPool::Graph audioGraph();
+/// blocks of the last AudioMemory or AudioMemory_F32 call, 0 before
+size_t audioMemoryBlocks();
+} // namespace HostEnvironment
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef HOST_OPENAUDIO_ARDUINOLIBRARY_H
+#define HOST_OPENAUDIO_ARDUINOLIBRARY_H
+
+#include "AudioStream_F32.h"
+
+#include "../FrameClock.h"
+#include "../IqFft.h"
+
+#include <vector>
+
+/// the next FFT output is handed in by the replay (HostAudio in HostEnvironment.h) instead of being computed; it takes
+/// the place of both analysers of IqFftAnalyzer.h
+class HostFftBase : public AudioStream_F32, public AudioStream
+{
+  public:
+    void setWindow(FftWindow) {}
+    void setHop(uint16_t) {}
+    void setCorrection(float, float, float) {}
+    /// the recorded frames are dBFS; with FftOutput::Power getData() converts them exactly
+    void setOutput(FftOutput type) { output = type; }
+    bool available();
+    float* getData();
+    uint64_t sequence() const { return frameSequence; }
+    FrameClock::Time captureTime() const { return frameTime; }
+    uint32_t spectrumCount() const { return spectra; }
+    uint32_t missedCount() const { return 0; }
+    uint32_t droppedBlockCount() const { return 0; }
+
+  protected:
+    float* toOutput(float* data, size_t width);
+
+  private:
+    FftOutput output = FftOutput::Dbfs;
+    std::vector<float> power;
+    uint32_t spectra = 0;
+    uint64_t frameSequence = 0;
+    FrameClock::Time frameTime;
+};
+
+template <int Width>
+class HostFft : public HostFftBase
+{
+  public:
+    float* getData() { return toOutput(HostFftBase::getData(), Width); }
+};
+
+class AudioAnalyzePeak_F32 : public AudioStream_F32
+{
+  public:
+    float read() { return 0; }
+};
+
+class AudioEffectGain_F32 : public AudioStream_F32
+{
+  public:
+    AudioEffectGain_F32()
+        : AudioStream_F32(HostBlockUse::Writing)
+    {}
+    void setGain(float) {}
+};
+
+class AudioMixer4_F32 : public AudioStream_F32
+{
+  public:
+    AudioMixer4_F32()
+        : AudioStream_F32(HostBlockUse::Writing)
+    {}
+    void gain(unsigned int, float) {}
+};
+
+class AudioInputI2S_F32 : public AudioStream_F32
+{
+  public:
+    AudioInputI2S_F32()
+        : AudioStream_F32(HostBlockUse::Input)
+    {}
+};
+class AudioOutputI2S_F32 : public AudioStream_F32
+{
+  public:
+    AudioOutputI2S_F32()
+        : AudioStream_F32(HostBlockUse::Output)
+    {}
+};
+
+#endif
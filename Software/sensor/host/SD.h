@@ -0,0 +1,60 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include "Arduino.h"
+#include "HostEnvironment.h"
+
+#include <memory>
+#include <vector>
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+
+/// file of the in-memory card of HostEnvironment.h; FILE_WRITE appends like on the Teensy
+class File : public Stream
+{
+  public:
+    File() = default;
+    File(std::shared_ptr<std::vector<uint8_t>> data, bool append, HostEnvironment::FileAccess* access)
+        : data(std::move(data))
+        , position(append ? this->data->size() : 0)
+        , access(access)
+    {}
+
+    explicit operator bool() const { return data != nullptr; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(uint8_t const* buffer, size_t size) override;
+    size_t write(void const* buffer, size_t size) { return write(static_cast<uint8_t const*>(buffer), size); }
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    size_t read(void* buffer, size_t size);
+
+    void flush()
+    {
+        if(access)
+            access->flushCalls++;
+    }
+    void close() { data.reset(); }
+    uint64_t size() const { return data ? data->size() : 0; }
+
+  private:
+    std::shared_ptr<std::vector<uint8_t>> data;
+    size_t position = 0;
+    HostEnvironment::FileAccess* access = nullptr;
+};
+
+class SDClass
+{
+  public:
+    bool begin(uint8_t) { return true; }
+    File open(char const* name, uint8_t mode = FILE_READ);
+    bool exists(char const* name);
+    bool remove(char const* name);
+    bool rename(char const* from, char const* to);
+};
+extern SDClass SD;
+
+#endif
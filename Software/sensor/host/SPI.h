@@ -0,0 +1,14 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+class SPIClass
+{
+  public:
+    void setMOSI(uint8_t) {}
+    void setSCK(uint8_t) {}
+};
+extern SPIClass SPI;
+
+#endif
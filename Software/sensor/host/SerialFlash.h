@@ -0,0 +1,6 @@
+#ifndef HOST_SERIALFLASH_H
+#define HOST_SERIALFLASH_H
+
+#include "Arduino.h"
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_TIMELIB_H
+#define HOST_TIMELIB_H
+
+#include "Arduino.h"
+
+#include <time.h>
+
+// the wall clock of the replay is the Teensy3Clock of HostEnvironment.h
+int year();
+int month();
+int day();
+int hour();
+int minute();
+int second();
+void setTime(time_t time);
+time_t now();
+inline void setSyncProvider(time_t (*)()) {}
+
+#endif
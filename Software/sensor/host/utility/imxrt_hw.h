@@ -0,0 +1,8 @@
+#ifndef HOST_IMXRT_HW_H
+#define HOST_IMXRT_HW_H
+
+#include "../Arduino.h"
+
+inline void set_audioClock(int, int, int, bool) {}
+
+#endif
@@ -1,5 +1,9 @@
 #include "noise_floor.h"
 
+#include "Checksum.h"
+
+#include <string.h>
+
 const float global_noiseFloor[1024] = {
     -109.68, -109.47, -109.57, -109.47, -109.76, -109.58, -109.67, -109.6,  -109.75, -109.62, -109.66, -109.49, -109.43,
     -109.29, -109.4,  -109.21, -109.27, -109.07, -109.09, -108.94, -108.99, -108.8,  -108.94, -108.77, -108.9,  -108.66,
@@ -80,3 +84,62 @@ const float global_noiseFloor[1024] = {
     -107.97, -107.74, -108.11, -108.06, -108.33, -108.18, -108.48, -108.42, -108.64, -108.55, -108.69, -108.57, -108.8,
     -108.75, -108.91, -108.84, -109.02, -108.96, -109.18, -109.12, -109.3,  -109.24, -109.38, -109.36, -109.55, -109.61,
     -109.71, -109.6,  -109.61, -109.54, -109.6,  -109.38, -109.54, -109.55, -109.74, -109.83};
+
+namespace
+{
+constexpr char checkpointMagic[4] = {'C', 'R', 'N', 'F'};
+constexpr uint16_t checkpointVersion = 2;
+} // namespace
+
+void initNoiseFloor(float* floor, size_t binCount, uint16_t fftWidth, uint16_t firstBin)
+{
+    constexpr size_t tableWidth = sizeof(global_noiseFloor) / sizeof(global_noiseFloor[0]);
+    for(size_t i = 0; i < binCount; i++)
+        floor[i] = global_noiseFloor[(firstBin + i) * tableWidth / fftWidth];
+}
+
+void writeNoiseFloorCheckpoint(
+    uint8_t* buffer, float const* floor, size_t binCount, uint16_t fftWidth, uint16_t firstBin, uint32_t frames)
+{
+    uint16_t const bins = binCount;
+    memcpy(buffer, checkpointMagic, 4);
+    memcpy(buffer + 4, &checkpointVersion, 2);
+    memcpy(buffer + 6, &fftWidth, 2);
+    memcpy(buffer + 8, &firstBin, 2);
+    memcpy(buffer + 10, &bins, 2);
+    memcpy(buffer + 12, &frames, 4);
+    memcpy(buffer + 16, floor, binCount * 4);
+
+    size_t const size = noiseFloorCheckpointSize(binCount);
+    uint32_t const sum = Checksum::fnv1a(buffer, size - 4);
+    memcpy(buffer + size - 4, &sum, 4);
+}
+
+bool readNoiseFloorCheckpoint(
+    uint8_t const* buffer,
+    size_t size,
+    float* floor,
+    size_t binCount,
+    uint16_t fftWidth,
+    uint16_t firstBin,
+    uint32_t& frames)
+{
+    size_t const expectedSize = noiseFloorCheckpointSize(binCount);
+    if(size < expectedSize || memcmp(buffer, checkpointMagic, 4) != 0)
+        return false;
+
+    uint16_t version, width, first, bins;
+    uint32_t sum;
+    memcpy(&version, buffer + 4, 2);
+    memcpy(&width, buffer + 6, 2);
+    memcpy(&first, buffer + 8, 2);
+    memcpy(&bins, buffer + 10, 2);
+    memcpy(&sum, buffer + expectedSize - 4, 4);
+    if(version != checkpointVersion || width != fftWidth || first != firstBin || bins != binCount ||
+       sum != Checksum::fnv1a(buffer, expectedSize - 4))
+        return false;
+
+    memcpy(&frames, buffer + 12, 4);
+    memcpy(floor, buffer + 16, binCount * 4);
+    return true;
+}
@@ -1,7 +1,112 @@
 #ifndef NOISE_FLOOR_H
 #define NOISE_FLOOR_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 // TODO .. is this config, kinda?
-extern const float global_noiseFloor[1024];
+extern const float global_noiseFloor[1024]; // measured with a 1024 point FFT
+
+/// fills floor with global_noiseFloor resampled to the bins firstBin.. of an fftWidth point FFT
+void initNoiseFloor(float* floor, size_t binCount, uint16_t fftWidth, uint16_t firstBin);
+
+/// see NoiseFloorEstimator for the layout; buffer has to hold noiseFloorCheckpointSize(binCount) bytes
+void writeNoiseFloorCheckpoint(
+    uint8_t* buffer, float const* floor, size_t binCount, uint16_t fftWidth, uint16_t firstBin, uint32_t frames);
+bool readNoiseFloorCheckpoint(
+    uint8_t const* buffer,
+    size_t size,
+    float* floor,
+    size_t binCount,
+    uint16_t fftWidth,
+    uint16_t firstBin,
+    uint32_t& frames);
+
+constexpr size_t noiseFloorCheckpointSize(size_t binCount)
+{
+    return 16 + binCount * 4 + 4;
+}
+
+/**
+ * Per-bin noise floor that adapts to the site while the sensor is running.
+ *
+ * It covers the analysed bins of a SpectrumLayout (see SpectrumLayout.h), starts from global_noiseFloor and follows
+ * every bin with an exponential moving average. Bins that are more than the signal threshold above the floor are left
+ * out, so passing vehicles do not raise it. A site that is louder than the table would then never be reached, so a bin
+ * that has been above the threshold in riseAfterFrames more frames than below rises by at most maxRisePerFrame dB per
+ * frame while it stays above; a passage lights a bin for a few seconds, far less than riseAfterFrames.
+ *
+ * The state can be saved as a checkpoint so a reboot continues with the adapted floor (all values little endian):
+ *  - magic "CRNF" (4 bytes)
+ *  - version (uint 2 bytes)
+ *  - FFT width (uint 2 bytes)
+ *  - first bin (uint 2 bytes)
+ *  - bin count (uint 2 bytes)
+ *  - number of frames the floor has seen (uint 4 bytes)
+ *  - floor per bin (float 4 bytes each)
+ *  - checksum over everything before (uint 4 bytes, FNV-1a)
+ */
+template <class Layout>
+class NoiseFloorEstimator
+{
+  public:
+    static constexpr size_t binCount = Layout::numberOfFftBins;
+    static constexpr size_t checkpointSize = noiseFloorCheckpointSize(binCount);
+
+  public:
+    NoiseFloorEstimator() { reset(); }
+
+    void reset() // back to global_noiseFloor
+    {
+        initNoiseFloor(floor, binCount, Layout::fftWidth, Layout::minBinIndex);
+        for(auto& count : framesAbove)
+            count = 0;
+        frames = 0;
+    }
+
+    /// distance of value to the floor of bin; values less than threshold above the floor pull the floor towards them,
+    /// values above it only raise a bin that has stayed above for riseAfterFrames
+    float update(size_t bin, float value, float threshold)
+    {
+        float const distance = value - floor[bin];
+        if(distance < threshold)
+        {
+            floor[bin] += distance * adaptRate;
+            if(framesAbove[bin] > 0)
+                framesAbove[bin]--;
+        }
+        else if(framesAbove[bin] < riseAfterFrames)
+            framesAbove[bin]++;
+        else
+            floor[bin] += distance < maxRisePerFrame ? distance : maxRisePerFrame;
+        return distance;
+    }
+    void finishFrame() { frames++; }
+
+    float operator[](size_t bin) const { return floor[bin]; }
+    uint32_t frameCount() const { return frames; }
+
+    /// buffer has to hold checkpointSize bytes
+    void writeCheckpoint(uint8_t* buffer) const
+    {
+        writeNoiseFloorCheckpoint(buffer, floor, binCount, Layout::fftWidth, Layout::minBinIndex, frames);
+    }
+    /// returns false and keeps the current state if the checkpoint is corrupt or from another layout
+    bool readCheckpoint(uint8_t const* buffer, size_t size)
+    {
+        return readNoiseFloorCheckpoint(
+            buffer, size, floor, binCount, Layout::fftWidth, Layout::minBinIndex, frames);
+    }
+
+    float adaptRate = 1.0f / 1000; // weight of a new frame, the floor follows over about 1000 frames
+    // a bin that is above the threshold for about 30 s rises by up to 0.5 dB/s; maxRisePerFrame 0 turns that off
+    uint16_t riseAfterFrames = uint16_t(30000000ull / Layout::framePeriodMicros);
+    float maxRisePerFrame = 0.5f * Layout::framePeriodMicros / 1000000;
+
+  private:
+    float floor[binCount];
+    uint16_t framesAbove[binCount]; // frames above the threshold minus frames below, at most riseAfterFrames
+    uint32_t frames = 0;
+};
 
 #endif
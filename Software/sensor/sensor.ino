@@ -1,7 +1,11 @@
 #include "AudioSystem.h"
 #include "Config.h"
 #include "FileWriter.hpp"
+#include "FramePool.h"
+#include "Profiler.h"
+#include "Scheduler.h"
 #include "SerialIO.hpp"
+#include "Tracking.h"
 #include "functions.h"
 
 #include <SerialFlash.h>
@@ -9,16 +13,36 @@
 #include <utility/imxrt_hw.h>
 
 AudioSystem audio;
-AudioSystem::Results audioResults; // global to optimize for speed
+FramePool<AudioSystem::Results, 1> framePool; // the consumers copy or encode the frame within runFrame()
 Config config;
+Tracking::Tracker tracker;
+Profiler profiler(AudioSystem::Layout::framePeriodMicros);
+uint32_t waitStart = 0; // Profiler::ticks() when the last frame was done
 
 FileWriter fileWriter;
 SerialIO serialIO;
 
 bool canWriteData = false;
 
+Scheduler scheduler(micros);
+SerialIO::Requests replies; // commands the serial task still has to answer
+uint32_t lastCardSetupMs = 0;
+uint32_t lastHousekeepingMs = 0;
+
+bool frameReady();
+void runFrame();
+bool serialReady();
+void runSerial();
+bool sdReady();
+void runSd();
+bool cardReady();
+void runCard();
+bool housekeepingReady();
+void runHousekeeping();
+
 void setup()
 {
+    paintStack();
     setSyncProvider(getTeensy3Time);
     setI2SFreq(config.audio.sample_rate);
 
@@ -26,7 +50,7 @@ void setup()
     pinMode(PIN_A3, OUTPUT); // A3=17, A8=22, A4=18
     digitalWrite(PIN_A4, LOW);
 
-    audio.setup(config.audio, config.max_pedestrian_speed, config.send_max_speed);
+    audio.setup(config.audio);
 
     // TODO this seems to be a get&set to and from the same data point?
     // setTime(Teensy3Clock.get());
@@ -48,63 +72,300 @@ void setup()
         Serial.println("Hello Citizen Radar");
     }
 
+    // once the loop runs, serial frames can be going out when a file is created
+    fileWriter.setLog(serialIO.text());
     fileWriter.setupSpi();
 
     if(fileWriter.setupSdCard())
     {
         canWriteData = true;
         Serial.println("SD card initialized");
+
+        if(config.persistNoiseFloor)
+            fileWriter.loadNoiseFloor(audio.getNoiseFloor());
     }
     else
         Serial.println("Unable to access the SD card");
+    lastCardSetupMs = lastHousekeepingMs = millis();
+
+    // the frame first, the I/O in the slack until the next one; see Scheduler.h
+    uint32_t const period = AudioSystem::Layout::framePeriodMicros;
+    uint32_t const maxDelay = config.maxSliceDelayMs * 1000;
+    scheduler.add(Scheduler::realtime("frame", frameReady, runFrame, 0, config.frameBudgetMicros, period, period));
+    scheduler.add(Scheduler::background("serial", serialReady, runSerial, 1, config.serialSliceBudgetMicros, maxDelay));
+    scheduler.add(Scheduler::background("sd", sdReady, runSd, 2, config.sdSliceBudgetMicros, maxDelay));
+    scheduler.add(Scheduler::background("card", cardReady, runCard, 3, config.cardSetupBudgetMicros, maxDelay));
+    scheduler.add(
+        Scheduler::background("housekeeping", housekeepingReady, runHousekeeping, 4, config.housekeepingBudgetMicros,
+                              maxDelay));
+
+    waitStart = Profiler::ticks();
+}
+
+/// the audio block pool and the stack with their high-water marks, the static RAM of the subsystems
+void printMemory(Print& out)
+{
+    out.print("memory: audio blocks ");
+    out.print(audio.getBlocksInUse());
+    out.print(", max ");
+    out.print(audio.getBlocksMaxInUse());
+    out.print("/");
+    out.print(AudioSystem::blockPoolSize);
+    out.print(" (");
+    out.print(AudioBlockPool::poolBytes(AudioSystem::blockPoolSize, AudioSystem::blockBytes));
+    out.print(" bytes), stack max ");
+    out.print(stackUsed());
+    out.print("/");
+    out.println(stackSize());
+
+    out.print("static: audio ");
+    out.print(sizeof(audio));
+    out.print(", frames ");
+    out.print(sizeof(framePool));
+    out.print(", file writer ");
+    out.print(sizeof(fileWriter));
+    out.print(", serial ");
+    out.print(sizeof(serialIO));
+    out.print(", tracker ");
+    out.print(sizeof(tracker));
+    out.print(", profiler ");
+    out.print(sizeof(profiler));
+    out.print(", scheduler ");
+    out.println(sizeof(scheduler));
 }
 
 void loop()
 {
-    if(not canWriteData)
+    // one slice per call, loop() returns in between so the Teensy core can serve USB events
+    scheduler.runOnce();
+}
+
+bool frameReady()
+{
+    return audio.hasData();
+}
+
+/// acquisition and analysis of one FFT frame; its results only go into RAM buffers, the I/O follows in other tasks
+void runFrame()
+{
+    uint32_t const frameStart = Profiler::ticks();
+    profiler.add(Profiler::Wait, Profiler::ticksToMicros(frameStart - waitStart));
+
+    SerialIO::Requests requests;
     {
-        if(fileWriter.setupSdCard())
+        Profiler::Scope scope(profiler, Profiler::Inputs);
+        serialIO.processInputs(config.audio, requests);
+        if(config.audio.hasChanges)
         {
-            canWriteData = true;
-            Serial.println("SD card initialized");
+            audio.updateIQ(config.audio);
+            config.audio.hasChanges = false;
         }
-
-        delay(1000);
-        return;
     }
+    replies.status = replies.status || requests.status;
+    replies.profile = replies.profile || requests.profile;
+    replies.memory = replies.memory || requests.memory;
+    replies.counters = replies.counters || requests.counters;
 
-    if(not audio.hasData())
+    // the analysis writes the frame once; afterwards it is only read through handles
+    FrameRef<AudioSystem::Results> frame;
     {
-        delay(1);
-        return;
-    }
-
-    bool sendOutput = false; // send output over serial - attention: this is only send once and needs to be preserved
-    // and thus might be better put into global state or something
+        AudioSystem::Results* results = framePool.acquire(frame);
+        if(not results)
+        {
+            waitStart = Profiler::ticks();
+            return; // every frame is still held by a consumer, this one is dropped and counted by the pool
+        }
 
-    serialIO.processInputs(config.audio, sendOutput);
-    if(config.audio.hasChanges)
-    {
-        audio.updateIQ(config.audio);
-        config.audio.hasChanges = false;
+        Profiler::Scope scope(profiler, Profiler::Process);
+        // elapsed time since start of sensor in milliseconds
+        results->timestamp = millis();
+        audio.processData(*results);
     }
+    AudioSystem::Results const& audioResults = *frame;
 
-    // elapsed time since start of sensor in milliseconds
-    audioResults.timestamp = millis();
-    audio.processData(audioResults);
-
-    if(config.writeDataToSdCard)
+    // without a card the analysis and the serial output go on, the files start once the card task found one
+    if(config.writeDataToSdCard && canWriteData)
     {
         if(config.writeRawData)
+        {
+            Profiler::Scope scope(profiler, Profiler::RawData);
             fileWriter.writeRawData(audioResults, config.write8bit, config);
+        }
 
         if(config.writeCsvData)
+        {
+            Profiler::Scope scope(profiler, Profiler::CsvData);
             fileWriter.writeCsvData(audioResults, config);
+        }
+
+        if(config.writeMetricsData)
+        {
+            Profiler::Scope scope(profiler, Profiler::MetricsData);
+            fileWriter.writeMetricsData(audioResults, config);
+        }
 
-        // SerialUSB1.print("csv sd write time: ");
-        // SerialUSB1.println(millis()-time_millis);
+        if(config.writeSummaryData)
+        {
+            Profiler::Scope scope(profiler, Profiler::SummaryData);
+            fileWriter.writeSummaryData(audioResults, config);
+        }
+    }
+
+    // the tracker follows the passages also without a card, its events are only written with one
+    {
+        Profiler::Scope scope(profiler, Profiler::EventData);
+        Tracking::Detection forward[Tracking::maxPeaks];
+        Tracking::Detection reverse[Tracking::maxPeaks];
+        tracker.update(
+            audioResults.timestamp,
+            forward,
+            audioResults.detections(false, forward),
+            reverse,
+            audioResults.detections(true, reverse));
+
+        bool const writeEvents = config.writeDataToSdCard && canWriteData && config.writeEventData;
+        Tracking::Event event;
+        while(tracker.nextEvent(event))
+            if(writeEvents)
+                fileWriter.writeEventData(event, config);
     }
 
-    if(sendOutput)
+    if(requests.output)
+    {
+        Profiler::Scope scope(profiler, Profiler::SerialOutput);
         serialIO.sendOutput(audioResults, audio, config);
+    }
+
+    profiler.frameDone(audioResults.timestamp, Profiler::ticksToMicros(Profiler::ticks() - frameStart));
+    waitStart = Profiler::ticks();
+}
+
+bool serialReady()
+{
+    return serialIO.isSending() || serialIO.hasText() || replies.status || replies.profile || replies.memory ||
+           replies.counters;
+}
+
+/// the pending part of the serial output and at most one reply to a command
+void runSerial()
+{
+    serialIO.service();
+    // the replies are longer than the text buffer of SerialIO, they are written directly once the frame and the
+    // text in front of them are out
+    if(serialIO.isSending() || serialIO.hasText())
+        return;
+
+    if(replies.status)
+    {
+        replies.status = false;
+        fileWriter.printStatistics(Serial);
+        serialIO.printStatistics(Serial);
+
+        auto const& trackerStats = tracker.statistics();
+        Serial.print("tracker: active ");
+        Serial.print(tracker.activeTracks());
+        Serial.print(", events ");
+        Serial.print(trackerStats.events);
+        Serial.print(", too short ");
+        Serial.print(trackerStats.dropped);
+        Serial.print(", no free track ");
+        Serial.println(trackerStats.noFreeTrack);
+
+        if(AudioSystem::Layout::iqMeasurement)
+        {
+            auto const& ghosts = audio.getGhostSuppression();
+            Serial.print("ghosts: ratio ");
+            Serial.print(ghosts.ratio());
+            Serial.print(" dB, estimates ");
+            Serial.println(ghosts.estimateCount());
+        }
+
+        auto const& poolStats = framePool.statistics();
+        Serial.print("frames: acquired ");
+        Serial.print(poolStats.acquired);
+        Serial.print(", dropped ");
+        Serial.print(poolStats.exhausted);
+        Serial.print(", max in use ");
+        Serial.print(poolStats.maxInUse);
+        Serial.print("/");
+        Serial.println(framePool.capacity());
+    }
+    else if(replies.profile)
+    {
+        replies.profile = false;
+        profiler.printTo(Serial);
+        scheduler.printTo(Serial);
+    }
+    else if(replies.memory)
+    {
+        replies.memory = false;
+        printMemory(Serial);
+    }
+    else if(replies.counters)
+    {
+        replies.counters = false;
+        Serial.print("counters: frames ");
+        Serial.print(profiler.frames());
+        Serial.print(", overruns ");
+        Serial.print(profiler.overruns());
+        Serial.print(", dropped ");
+        Serial.print(profiler.droppedFrames());
+        Serial.print(", pool exhausted ");
+        Serial.print(framePool.statistics().exhausted);
+        Serial.print(", spectra ");
+        Serial.print(audio.getSpectrumCount());
+        Serial.print(", missed ");
+        Serial.print(audio.getMissedSpectra());
+        Serial.print(", dropped blocks ");
+        Serial.print(audio.getDroppedBlocks());
+        Serial.print(", deadline misses ");
+        Serial.println(scheduler.deadlineMisses());
+        serialIO.printStatistics(Serial);
+    }
+}
+
+bool sdReady()
+{
+    return canWriteData && fileWriter.needsService();
+}
+
+/// a few sectors of the buffered files
+void runSd()
+{
+    Profiler::Scope scope(profiler, Profiler::Service);
+    fileWriter.service(config.sdSectorsPerSlice);
+}
+
+bool cardReady()
+{
+    return not canWriteData && millis() - lastCardSetupMs >= config.cardRetryMs;
+}
+
+/// one attempt to set up the SD card; SD.begin() cannot be split, so it only runs when its budget fits
+void runCard()
+{
+    lastCardSetupMs = millis();
+    if(not fileWriter.setupSdCard())
+        return;
+
+    canWriteData = true;
+    serialIO.text().println("SD card initialized");
+
+    if(config.persistNoiseFloor)
+        fileWriter.loadNoiseFloor(audio.getNoiseFloor());
+}
+
+bool housekeepingReady()
+{
+    return canWriteData && millis() - lastHousekeepingMs >= 1000;
+}
+
+/// the noise floor checkpoint and the profile log, each writes a small file when its interval has passed
+void runHousekeeping()
+{
+    lastHousekeepingMs = millis();
+    if(config.persistNoiseFloor)
+        fileWriter.checkpointNoiseFloor(audio.getNoiseFloor(), config);
+    if(config.profileLogSeconds > 0)
+        fileWriter.logProfile(profiler, config);
 }
@@ -0,0 +1,420 @@
+#include "RawFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+template <typename T>
+T read(uint8_t const* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+} // namespace
+
+RawFile::~RawFile()
+{
+    close();
+}
+
+bool RawFile::open(std::string const& name, Layout layout)
+{
+    close();
+
+    int const descriptor = ::open(name.c_str(), O_RDONLY);
+    if(descriptor < 0)
+    {
+        errorMessage = "Unable to open " + name;
+        return false;
+    }
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || status.st_size < off_t(headerSize))
+    {
+        ::close(descriptor);
+        errorMessage = name + " is not a raw file";
+        return false;
+    }
+
+    size = size_t(status.st_size);
+    void* const mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor); // the mapping stays valid
+    if(mapping == MAP_FAILED)
+    {
+        size = 0;
+        errorMessage = "Unable to map " + name;
+        return false;
+    }
+    data = static_cast<uint8_t const*>(mapping);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    fileHeader.version = read<uint16_t>(data);
+    fileHeader.startTime = read<uint32_t>(data + 2);
+    fileHeader.binCount = read<uint16_t>(data + 6);
+    fileHeader.iqMeasurement = data[8] != 0;
+    fileHeader.sampleRate = read<uint16_t>(data + 9);
+    bool const anchored = fileHeader.version == RawRecord::sequencedVersion;
+    if(anchored && size >= headerSize + FrameClock::anchorSize)
+    {
+        fileHeader.anchor = FrameClock::readAnchor(data + headerSize);
+        dataStart = headerSize + FrameClock::anchorSize;
+    }
+
+    bool ok = false;
+    if(fileHeader.binCount == 0 || fileHeader.binCount > RawCompression::maxBinCount)
+        errorMessage = "Unsupported bin count " + std::to_string(fileHeader.binCount);
+    else if(anchored && dataStart == headerSize)
+        errorMessage = name + " is not a raw file";
+    else if(fileHeader.version >= RawRecord::compressedVersion && fileHeader.version <= RawRecord::sequencedVersion)
+    {
+        fileLayout = Layout::Compressed;
+        ok = layout == Layout::Unknown || layout == Layout::Compressed;
+        if(not ok)
+            errorMessage = name + " is compressed";
+    }
+    else if(fileHeader.version == 1)
+    {
+        fileLayout = layout;
+        ok = layout != Layout::Compressed && detectLayout();
+        if(not ok && errorMessage.empty())
+            errorMessage = name + " is not compressed";
+    }
+    else
+        errorMessage = "Unsupported file version " + std::to_string(fileHeader.version);
+
+    if(not ok)
+    {
+        std::string const message = errorMessage;
+        close();
+        errorMessage = message;
+        return false;
+    }
+
+    loadIndex(name);
+    seek(0);
+    return true;
+}
+
+void RawFile::close()
+{
+    if(data)
+        munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+    fileHeader = Header();
+    dataStart = headerSize;
+    fileLayout = Layout::Unknown;
+    frames = 0;
+    recordSize = 0;
+    fileDamage = Damage();
+    indexed = false;
+    offsets.clear();
+    keyFrames.clear();
+    gapFrames.clear();
+    lastDecoded = SIZE_MAX;
+    index.clear();
+    position = 0;
+    errorMessage.clear();
+}
+
+uint32_t RawFile::timestamp(size_t frame) const
+{
+    size_t const offset = recordOffset(frame);
+    return read<uint32_t>(data + (fileHeader.version >= RawRecord::framedVersion ? offset + 2 : offset));
+}
+
+uint64_t RawFile::sequence(size_t frame) const
+{
+    if(fileHeader.version < RawRecord::sequencedVersion)
+        return 0;
+    return read<uint64_t>(data + recordOffset(frame) + 6);
+}
+
+void RawFile::range(uint32_t fromMs, uint32_t toMs, size_t& first, size_t& end) const
+{
+    indexRecords();
+    auto const firstAtOrAfter = [this](uint32_t ms) {
+        size_t low = 0;
+        size_t high = frames;
+        while(low < high)
+        {
+            size_t const middle = low + (high - low) / 2;
+            if(timestamp(middle) < ms)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low;
+    };
+
+    first = firstAtOrAfter(fromMs);
+    end = toMs == UINT32_MAX ? frames : firstAtOrAfter(toMs + 1);
+    if(end < first)
+        end = first;
+}
+
+bool RawFile::readBytes(size_t frame, uint8_t* bins)
+{
+    if(frame >= frameCount())
+        return false;
+    if(fileLayout == Layout::Bytes)
+    {
+        std::memcpy(bins, this->bins(frame), fileHeader.binCount);
+        return true;
+    }
+    return fileLayout == Layout::Compressed && decode(frame, bins);
+}
+
+bool RawFile::readDbfs(size_t frame, float* dbfs)
+{
+    if(frame >= frameCount())
+        return false;
+    if(fileLayout == Layout::Floats)
+    {
+        std::memcpy(dbfs, bins(frame), fileHeader.binCount * sizeof(float));
+        return true;
+    }
+
+    uint8_t const* bytes = nullptr;
+    if(fileLayout == Layout::Bytes)
+        bytes = bins(frame);
+    else
+    {
+        decoded.resize(fileHeader.binCount);
+        if(not decode(frame, decoded.data()))
+            return false;
+        bytes = decoded.data();
+    }
+    for(size_t i = 0; i < fileHeader.binCount; i++)
+        dbfs[i] = -float(bytes[i]);
+    return true;
+}
+
+bool RawFile::detectLayout()
+{
+    size_t const payload = size - headerSize;
+    size_t const binCount = fileHeader.binCount;
+
+    // a layout fits if the timestamps of the first records increase; read at the wrong record size they are bins
+    auto const fits = [this, payload](size_t candidateRecordSize) {
+        size_t const count = payload / candidateRecordSize;
+        if(count == 0)
+            return payload == 0;
+        uint32_t previous = read<uint32_t>(data + headerSize);
+        for(size_t i = 1; i < count && i < 16; i++)
+        {
+            uint32_t const current = read<uint32_t>(data + headerSize + i * candidateRecordSize);
+            if(current <= previous)
+                return false;
+            previous = current;
+        }
+        return true;
+    };
+
+    size_t const byteRecord = 4 + binCount;
+    size_t const floatRecord = 4 + 4 * binCount;
+    if(fileLayout == Layout::Unknown)
+    {
+        bool const bytesFit = fits(byteRecord);
+        bool const floatsFit = fits(floatRecord);
+        if(bytesFit and floatsFit)
+            fileLayout = payload % floatRecord == 0 ? Layout::Floats : Layout::Bytes;
+        else if(bytesFit or floatsFit)
+            fileLayout = bytesFit ? Layout::Bytes : Layout::Floats;
+        else
+        {
+            errorMessage = "Unable to tell 8 bit from float records";
+            return false;
+        }
+    }
+
+    recordSize = fileLayout == Layout::Bytes ? byteRecord : floatRecord;
+    frames = payload / recordSize; // a truncated last record is left out
+    fileDamage.tailBytes = payload % recordSize;
+    return true;
+}
+
+void RawFile::seek(uint32_t fromMs)
+{
+    seekMs = fromMs;
+    skipped = 0;
+    if(fileLayout != Layout::Compressed)
+    {
+        size_t first;
+        size_t end;
+        range(fromMs, UINT32_MAX, first, end);
+        position = headerSize + first * recordSize;
+        return;
+    }
+
+    // the entry has to point to an intact key frame with its timestamp, otherwise the index belongs to another file
+    position = dataStart;
+    streamDecoder.reset();
+    RawIndex::Entry entry;
+    RawRecord::Record record;
+    if(RawIndex::find(index.data(), index.size(), fromMs, entry) &&
+       RawRecord::parse(data,
+                        size,
+                        fileHeader.version,
+                        entry.offset,
+                        RawCompression::maxPayloadSize(fileHeader.binCount),
+                        record) &&
+       record.timestamp == entry.timestamp && (record.flags & RawCompression::KeyFrame))
+        position = entry.offset;
+}
+
+bool RawFile::next(uint32_t& timestamp, float* dbfs)
+{
+    size_t const binCount = fileHeader.binCount;
+    if(fileLayout != Layout::Compressed)
+    {
+        if(position + recordSize > size)
+            return false;
+        timestamp = read<uint32_t>(data + position);
+        uint8_t const* bins = data + position + 4;
+        if(fileLayout == Layout::Floats)
+            std::memcpy(dbfs, bins, binCount * sizeof(float));
+        else
+            for(size_t i = 0; i < binCount; i++)
+                dbfs[i] = -float(bins[i]);
+        position += recordSize;
+        return true;
+    }
+
+    streamBins.resize(binCount);
+    RawRecord::Record record;
+    while(nextRecord(position, record))
+    {
+        position = record.offset + record.size;
+        timestamp = record.timestamp;
+        if(record.skippedBytes > 0)
+            streamDecoder.reset(); // the frames after a gap decode again from the next key frame on
+
+        // the frames in front of the wanted one are decoded as well, the following ones are coded relative to them
+        bool const ok =
+            streamDecoder.decode(record.payload, record.payloadSize, record.flags, streamBins.data(), binCount);
+        if(ok && timestamp >= seekMs)
+        {
+            for(size_t i = 0; i < binCount; i++)
+                dbfs[i] = -float(streamBins[i]);
+            seekMs = 0;
+            return true;
+        }
+        skipped += seekMs > 0;
+    }
+    return false;
+}
+
+void RawFile::loadIndex(std::string const& name)
+{
+    std::string const extension = ".bin";
+    if(name.size() < extension.size() || name.compare(name.size() - extension.size(), extension.size(), extension) != 0)
+        return;
+
+    std::ifstream input(name.substr(0, name.size() - extension.size()) + ".idx", std::ios::binary);
+    if(input)
+        index.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+void RawFile::indexRecords() const
+{
+    if(indexed || fileLayout != Layout::Compressed)
+        return;
+    indexed = true;
+
+    size_t position = dataStart;
+    RawRecord::Record record;
+    while(nextRecord(position, record))
+    {
+        if(record.skippedBytes > 0)
+        {
+            gapFrames.push_back(uint32_t(offsets.size()));
+            fileDamage.gaps++;
+            fileDamage.gapBytes += record.skippedBytes;
+        }
+        if(record.flags & RawCompression::KeyFrame)
+            keyFrames.push_back(uint32_t(offsets.size()));
+        offsets.push_back(record.offset);
+        position = record.offset + record.size;
+    }
+    frames = offsets.size();
+    fileDamage.tailBytes = size - position;
+}
+
+bool RawFile::nextRecord(size_t offset, RawRecord::Record& record) const
+{
+    return RawRecord::next(
+        data, size, fileHeader.version, offset, RawCompression::maxPayloadSize(fileHeader.binCount), record);
+}
+
+size_t RawFile::recordOffset(size_t frame) const
+{
+    indexRecords();
+    return fileLayout == Layout::Compressed ? size_t(offsets[frame]) : headerSize + frame * recordSize;
+}
+
+uint8_t RawFile::flags(size_t frame) const
+{
+    RawRecord::Record record;
+    if(fileLayout != Layout::Compressed)
+        return 0;
+    return nextRecord(recordOffset(frame), record) ? record.flags : 0;
+}
+
+size_t RawFile::recordLength(size_t frame) const
+{
+    RawRecord::Record record;
+    if(fileLayout != Layout::Compressed)
+        return recordSize;
+    return nextRecord(recordOffset(frame), record) ? record.size : 0;
+}
+
+bool RawFile::decode(size_t frame, uint8_t* bins)
+{
+    size_t const binCount = fileHeader.binCount;
+    decoded.resize(binCount);
+    auto const decodeRecord = [this, binCount](size_t index, uint8_t* out) {
+        RawRecord::Record record;
+        nextRecord(offsets[index], record);
+        if(std::binary_search(gapFrames.begin(), gapFrames.end(), uint32_t(index)))
+            decoder.reset(); // the frames before the gap do not belong to this one
+        return decoder.decode(record.payload, record.payloadSize, record.flags, out, binCount);
+    };
+
+    if(frame == lastDecoded)
+    {
+        if(bins != decoded.data())
+            std::memcpy(bins, decoded.data(), binCount);
+        return true;
+    }
+
+    // the decoder continues from the last frame it decoded; otherwise it starts again at the key frame before, or
+    // after the last gap if that is closer (nothing before it helps)
+    if(lastDecoded == SIZE_MAX || frame != lastDecoded + 1)
+    {
+        auto const key = std::upper_bound(keyFrames.begin(), keyFrames.end(), uint32_t(frame));
+        auto const gap = std::upper_bound(gapFrames.begin(), gapFrames.end(), uint32_t(frame));
+        size_t const start =
+            std::max(key == keyFrames.begin() ? 0 : *(key - 1), gap == gapFrames.begin() ? 0 : *(gap - 1));
+        decoder.reset();
+        for(size_t i = start; i < frame; i++)
+            decodeRecord(i, decoded.data());
+    }
+
+    lastDecoded = SIZE_MAX;
+    if(not decodeRecord(frame, bins))
+        return false;
+
+    if(bins != decoded.data())
+        std::memcpy(decoded.data(), bins, binCount);
+    lastDecoded = frame;
+    return true;
+}
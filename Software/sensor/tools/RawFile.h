@@ -0,0 +1,166 @@
+#ifndef RAWFILE_H
+#define RAWFILE_H
+
+#include "../FrameClock.h"
+#include "../RawCompression.h"
+#include "../RawIndex.h"
+#include "../RawRecord.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Read access to a raw recording (.bin, see FileWriter::openRawFile) without loading it into memory.
+ *
+ * The file is memory-mapped. The records of an uncompressed file (version 1) all have the same size, so a frame is
+ * found by its index and its bins are handed out as a pointer into the mapping: bins(i) points to frame i and frame
+ * i + 1 starts stride() bytes later. Compressed files (versions 2 to 4, RawRecord.h) are indexed on the first access
+ * by frame number; a frame is decoded on access, starting from the closest key frame before it unless the previous
+ * frame was the last one decoded.
+ *
+ * Version 4 files carry the sequence number of each frame and the anchor of the sample clock behind the header (see
+ * FrameClock.h); the first record follows at dataOffset() instead of headerSize.
+ *
+ * Damaged files are read as far as their layout allows: a cut off last record is left out, and framed files skip
+ * damaged records and go on with the next intact one (see RawRecord.h). The frames after such a gap cannot be decoded
+ * up to the next key frame. damage() tells what was skipped.
+ *
+ * seek() and next() read by time without frame numbers. For compressed files they use the index sidecar (.idx next to
+ * the .bin, see RawIndex.h) if there is one, so only the records from the last key frame before the time on are
+ * read; without it they start at the first record. Uncompressed files are searched directly.
+ *
+ * The header does not say whether an uncompressed file holds 8 bit or float bins. Unless the layout is given, open()
+ * takes the one whose first timestamps increase; if both do, the one whose record size divides the file.
+ *
+ * Host only (POSIX mmap), not part of the sensor build.
+ */
+class RawFile
+{
+  public:
+    static constexpr size_t headerSize = 11;
+
+    enum class Layout : uint8_t
+    {
+        Unknown,
+        Bytes,      // version 1, one byte per bin: -dBFS
+        Floats,     // version 1, one float per bin: dBFS
+        Compressed, // version 2 to 4, bytes as Bytes, coded with RawCompression
+    };
+
+    struct Damage
+    {
+        size_t gaps = 0;      // places where damaged data was skipped between two records
+        size_t gapBytes = 0;  // bytes skipped there
+        size_t tailBytes = 0; // after the last complete record, cut off or damaged
+    };
+
+    struct Header
+    {
+        uint16_t version = 0;
+        uint32_t startTime = 0; // unix time of the sensor clock when the file was created
+        uint16_t binCount = 0;
+        bool iqMeasurement = false;
+        uint16_t sampleRate = 0;
+        FrameClock::Anchor anchor; // version 4, zero before
+    };
+
+  public:
+    RawFile() = default;
+    RawFile(RawFile const&) = delete;
+    RawFile& operator=(RawFile const&) = delete;
+    ~RawFile();
+
+    /// maps the file; false with a message in error() if it cannot be read as raw file of the given layout
+    bool open(std::string const& name, Layout layout = Layout::Unknown);
+    void close();
+    std::string const& error() const { return errorMessage; }
+
+    Header const& header() const { return fileHeader; }
+    /// bytes in front of the first record: headerSize, plus the anchor in version 4
+    size_t dataOffset() const { return dataStart; }
+    Layout layout() const { return fileLayout; }
+    size_t frameCount() const
+    {
+        indexRecords();
+        return frames;
+    }
+    uint32_t timestamp(size_t frame) const;
+    /// sample clock of the frame (FrameClock.h), 0 in files before version 4
+    uint64_t sequence(size_t frame) const;
+
+    /// frames [first, end) with fromMs <= timestamp <= toMs; the timestamps of a file only increase
+    void range(uint32_t fromMs, uint32_t toMs, size_t& first, size_t& end) const;
+
+    /// byte offset of the record of frame in the file
+    size_t recordOffset(size_t frame) const;
+    /// size of the record of frame in bytes
+    size_t recordLength(size_t frame) const;
+    /// the record of frame as it is in the file, recordLength(frame) bytes
+    uint8_t const* record(size_t frame) const { return data + recordOffset(frame); }
+    /// RawCompression::Flags of a compressed frame, 0 in the uncompressed layouts
+    uint8_t flags(size_t frame) const;
+    /// what was skipped to read the file; nothing for an intact file
+    Damage const& damage() const
+    {
+        indexRecords();
+        return fileDamage;
+    }
+
+    /// zero-copy view into the mapping, only for the uncompressed layouts
+    uint8_t const* bins(size_t frame) const { return data + recordOffset(frame) + 4; }
+    size_t stride() const { return recordSize; }
+
+    /// bins of a Bytes or Compressed frame; false if the frame cannot be decoded (corrupt, no key frame before it)
+    bool readBytes(size_t frame, uint8_t* bins);
+    /// bins of a frame of any layout in dBFS
+    bool readDbfs(size_t frame, float* dbfs);
+
+    /// next() continues with the first frame at or after fromMs
+    void seek(uint32_t fromMs);
+    /// timestamp and bins in dBFS of the next frame; false at the end of the file
+    bool next(uint32_t& timestamp, float* dbfs);
+    bool hasIndex() const { return RawIndex::entryCount(index.data(), index.size()) > 0; }
+    /// records read by next() in front of the frame the last seek() was after
+    size_t skippedRecords() const { return skipped; }
+
+  private:
+    bool detectLayout();
+    void loadIndex(std::string const& name);
+    void indexRecords() const;
+    bool nextRecord(size_t offset, RawRecord::Record& record) const;
+    bool decode(size_t frame, uint8_t* bins);
+
+  private:
+    std::string errorMessage;
+    uint8_t const* data = nullptr;
+    size_t size = 0;
+
+    Header fileHeader;
+    size_t dataStart = headerSize;
+    Layout fileLayout = Layout::Unknown;
+    mutable size_t frames = 0;
+    size_t recordSize = 0; // uncompressed layouts
+    mutable Damage fileDamage;
+
+    // compressed layout, indexRecords() fills offsets and keyFrames on the first access by frame number
+    mutable bool indexed = false;
+    mutable std::vector<uint64_t> offsets; // of each record
+    mutable std::vector<uint32_t> keyFrames; // frame indices
+    mutable std::vector<uint32_t> gapFrames; // frame indices of the records after skipped data
+    RawCompression::Decoder decoder;
+    std::vector<uint8_t> decoded;      // bins of lastDecoded, the decoder continues from it
+    size_t lastDecoded = SIZE_MAX;
+
+    // reading by time
+    std::vector<uint8_t> index; // sidecar, empty without one
+    size_t position = 0;        // of the next record
+    uint32_t seekMs = 0;
+    size_t skipped = 0;
+    RawCompression::Decoder streamDecoder;
+    std::vector<uint8_t> streamBins;
+};
+
+#endif
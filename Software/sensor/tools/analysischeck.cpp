@@ -0,0 +1,431 @@
+// Checks the analysis of AudioResults against the Results::process() of the original sensor code on synthetic
+// spectra: noise around the measured noise floor (global_noiseFloor) with targets in both directions, some of them
+// strong enough to count as signal, and now and then a frame with every bin over the threshold.
+//
+// The original only knew the 1024 point IQ layout and a static noise floor, so the analysis runs with that layout,
+// without ghost suppression and with the adaptation of the noise floor switched off (adaptRate and maxRisePerFrame
+// 0). Every field the original computed has to be bit-identical in every frame: the spectrum, the noise floor
+// distances, the maxima and their bins, the speeds, the pedestrian amplitude, the means and the bins with signal. The
+// first mismatch is printed and the tool fails with exit code 2.
+//
+// The one intended difference is the reverse maximum (strength_reverse, speed_reverse of the csv table): the original
+// compared a reverse bin with the forward maximum found so far instead of the reverse one and never reset it, so a
+// reverse target weaker than the forward one was lost and a frame without one kept the strength of an earlier frame.
+// The original stays unchanged; the reverse maximum, its bin and speed are compared with correctReverse() on its
+// noise floor distances, and the frames in which that differs from the original are counted.
+//
+// Every layout (FFT width and IQ mode) first has to convert bins to speeds with sampleRate / fftWidth Hz per bin (44 Hz
+// per m/s), with the pedestrian and sent bins derived from that. Then it is checked against a plain walk over its
+// bins, on frames with a strong forward target and a weaker reverse target at another speed: all metrics have to
+// match, the targets have to be found at their speeds and among the peaks; without IQ the reverse metrics stay empty.
+//
+// usage: analysischeck [--frames 2000] [--seed 1]
+
+#include "../AudioResults.h"
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr float threshold = 8; // AudioSystem::Config::noise_floor_distance_threshold
+
+struct Options
+{
+    size_t frames = 2000;
+    unsigned seed = 1;
+};
+
+/// the fields of the original AudioSystem::Results
+struct BaselineResults
+{
+    float noise_floor_distance[1024];
+    float spectrum[1024];
+    float spectrum_smoothed[1024] = {0};
+
+    float amplitudeMax;
+    float amplitudeMaxReverse;
+    uint16_t max_freq_Index;
+    uint16_t max_freq_Index_reverse;
+    uint16_t max_pedestrian_bin;
+    float pedestrian_amplitude;
+    float detected_speed;
+    float detected_speed_reverse;
+    float mean_amplitude;
+    float mean_amplitude_reverse;
+    uint8_t bins_with_signal;
+    uint8_t bins_with_signal_reverse;
+    uint16_t numberOfFftBins;
+    uint16_t maxBinIndex;
+    uint16_t minBinIndex;
+
+    void process(float* pointer, uint16_t iq_offset, float noiseFloorDistanceThreshold, float speedConversion);
+};
+
+// AudioSystem::Results::process() of the original code, unchanged
+void BaselineResults::process(
+    float* pointer, uint16_t iq_offset, float noiseFloorDistanceThreshold, float speedConversion)
+{
+    for(size_t kk = 0; kk < 1024; kk++)
+        spectrum[kk] = *(pointer + kk);
+
+    int smooth_n = 1000; // number of samples used for smoothing the spectrum
+    for(size_t i = 0; i < 1024; i++)
+        spectrum_smoothed[i] = ((smooth_n - 1) * spectrum_smoothed[i] + spectrum[i]) / smooth_n;
+
+    // detect highest frequency
+    amplitudeMax = -9999.0;
+    max_freq_Index = 0;
+    max_freq_Index_reverse = 0;
+    mean_amplitude = 0.0;
+    mean_amplitude_reverse = 0.0;
+    pedestrian_amplitude = 0.0;
+    bins_with_signal = 0;
+    bins_with_signal_reverse = 0;
+
+    // detect pedestrian
+    for(size_t i = 3 + iq_offset; i < max_pedestrian_bin + iq_offset; i++)
+    {
+        pedestrian_amplitude = pedestrian_amplitude + spectrum[i];
+    }
+    pedestrian_amplitude = pedestrian_amplitude / max_pedestrian_bin;
+
+    for(size_t i = 0; i < 1024; i++)
+    {
+        noise_floor_distance[i] = spectrum[i] - global_noiseFloor[i];
+    }
+
+    for(size_t i = (max_pedestrian_bin + 1 + iq_offset); i < maxBinIndex; i++)
+    {
+        mean_amplitude = mean_amplitude + noise_floor_distance[i];
+        if(noise_floor_distance[i] > noiseFloorDistanceThreshold)
+            bins_with_signal++;
+
+        mean_amplitude_reverse = mean_amplitude_reverse + noise_floor_distance[1024 - i];
+        if(noise_floor_distance[1024 - i] > noiseFloorDistanceThreshold)
+            bins_with_signal_reverse++;
+
+        // with noise_floor_distance[i] > noise_floor_distance[1024-i] make shure that the signal is in the right
+        // direction
+        if(noise_floor_distance[i] > noise_floor_distance[1024 - i] && noise_floor_distance[i] > amplitudeMax)
+        {
+            amplitudeMax = noise_floor_distance[i]; // remember highest amplitude
+            max_freq_Index = i;                     // remember frequency index
+        }
+        if(noise_floor_distance[1024 - i] > noise_floor_distance[i] && noise_floor_distance[1024 - i] > amplitudeMax)
+        {
+            amplitudeMaxReverse = noise_floor_distance[1024 - i]; // remember highest amplitude
+            max_freq_Index_reverse = i;                           // remember frequency index
+        }
+    }
+    detected_speed = (max_freq_Index - iq_offset) * speedConversion;
+    detected_speed_reverse = (max_freq_Index_reverse - iq_offset) * speedConversion;
+
+    mean_amplitude =
+        mean_amplitude /
+        (maxBinIndex - (max_pedestrian_bin + 1 + iq_offset)); // TODO: is this valid when working with dB values?
+    mean_amplitude_reverse =
+        mean_amplitude_reverse /
+        (maxBinIndex - (max_pedestrian_bin + 1 + iq_offset)); // TODO: is this valid when working with dB values?
+}
+
+/// the reverse maximum of the sensor on the noise floor distances of the original: reset every frame and searched
+/// against itself
+struct Reverse
+{
+    float amplitudeMax = -9999.0;
+    uint16_t index = 0;
+    float speed = 0;
+};
+
+Reverse correctReverse(BaselineResults const& b, uint16_t iq_offset, float speedConversion)
+{
+    Reverse reverse;
+    for(size_t i = (b.max_pedestrian_bin + 1 + iq_offset); i < b.maxBinIndex; i++)
+        if(b.noise_floor_distance[1024 - i] > b.noise_floor_distance[i] &&
+           b.noise_floor_distance[1024 - i] > reverse.amplitudeMax)
+        {
+            reverse.amplitudeMax = b.noise_floor_distance[1024 - i];
+            reverse.index = i;
+        }
+    reverse.speed = (reverse.index - iq_offset) * speedConversion;
+    return reverse;
+}
+
+/// noise around the floor, a few targets per direction and now and then a frame that is loud everywhere
+void synthesize(std::mt19937& random, float* fft, size_t width)
+{
+    std::normal_distribution<float> noise(0, 2);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    float const offset = uniform(random) < 0.02f ? 20 : 0;
+    for(size_t i = 0; i < width; i++)
+        fft[i] = global_noiseFloor[i * 1024 / width] + offset + noise(random);
+
+    std::uniform_int_distribution<size_t> bin(1, width - 2);
+    size_t const targets = size_t(uniform(random) * 6);
+    for(size_t t = 0; t < targets; t++)
+    {
+        size_t const center = bin(random);
+        float const level = 5 + 40 * uniform(random);
+        fft[center] += level;
+        fft[center - 1] += level / 2;
+        fft[center + 1] += level / 2;
+    }
+}
+
+template <class T>
+bool same(char const* name, T const& a, T const& b, size_t frame)
+{
+    if(std::memcmp(&a, &b, sizeof(T)) == 0)
+        return true;
+    std::cout << "frame " << frame << ": " << name << " differs (" << +a << " / " << +b << ")" << std::endl;
+    return false;
+}
+
+bool sameArray(char const* name, float const* a, float const* b, size_t count, size_t frame)
+{
+    for(size_t i = 0; i < count; i++)
+        if(std::memcmp(&a[i], &b[i], sizeof(float)) != 0)
+        {
+            std::cout << "frame " << frame << ": " << name << "[" << i << "] differs (" << a[i] << " / " << b[i] << ")"
+                      << std::endl;
+            return false;
+        }
+    return true;
+}
+
+bool checkBaseline(Options const& options)
+{
+    using Layout = SpectrumLayout<1024, true>;
+    static_assert(Layout::minBinIndex == 0 && Layout::maxBinIndex == 1024, "the original analysed all 1024 bins");
+
+    // several 10 kB each, not for the stack
+    auto const baseline = std::unique_ptr<BaselineResults>(new BaselineResults());
+    auto const results = std::unique_ptr<AudioResults<Layout>>(new AudioResults<Layout>());
+    // the field the original never reset starts the same
+    baseline->amplitudeMaxReverse = -9999;
+    baseline->max_pedestrian_bin = Layout::maxPedestrianBin;
+    baseline->maxBinIndex = Layout::maxBinIndex;
+    baseline->minBinIndex = Layout::minBinIndex;
+    baseline->numberOfFftBins = Layout::numberOfFftBins;
+    // the original took the conversion as a parameter; its constant truncated 12000 / 1024 Hz per bin to 11
+    float const speedConversion = Layout::speedConversion;
+
+    NoiseFloorEstimator<Layout> noiseFloor;
+    noiseFloor.adaptRate = 0;
+    noiseFloor.maxRisePerFrame = 0;
+
+    std::mt19937 random(options.seed);
+    std::vector<float> fft(Layout::fftWidth);
+    size_t corrected = 0;
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        synthesize(random, fft.data(), fft.size());
+        baseline->process(fft.data(), Layout::iqOffset, threshold, speedConversion);
+        results->process(fft.data(), noiseFloor, threshold);
+        Reverse const reverse = correctReverse(*baseline, Layout::iqOffset, speedConversion);
+        corrected += reverse.amplitudeMax != baseline->amplitudeMaxReverse ||
+                     reverse.index != baseline->max_freq_Index_reverse;
+
+        BaselineResults const& b = *baseline;
+        AudioResults<Layout> const& r = *results;
+        bool const ok = sameArray("spectrum", b.spectrum, r.spectrum, 1024, frame) &&
+                        sameArray("noise_floor_distance", b.noise_floor_distance, r.noise_floor_distance, 1024,
+                                  frame) &&
+                        same("amplitudeMax", b.amplitudeMax, r.amplitudeMax, frame) &&
+                        same("amplitudeMaxReverse", reverse.amplitudeMax, r.amplitudeMaxReverse, frame) &&
+                        same("max_freq_Index", b.max_freq_Index, r.max_freq_Index, frame) &&
+                        same("max_freq_Index_reverse", reverse.index, r.max_freq_Index_reverse, frame) &&
+                        same("pedestrian_amplitude", b.pedestrian_amplitude, r.pedestrian_amplitude, frame) &&
+                        same("detected_speed", b.detected_speed, r.detected_speed, frame) &&
+                        same("detected_speed_reverse", reverse.speed, r.detected_speed_reverse, frame) &&
+                        same("mean_amplitude", b.mean_amplitude, r.mean_amplitude, frame) &&
+                        same("mean_amplitude_reverse", b.mean_amplitude_reverse, r.mean_amplitude_reverse, frame) &&
+                        same("bins_with_signal", b.bins_with_signal, r.bins_with_signal, frame) &&
+                        same("bins_with_signal_reverse", b.bins_with_signal_reverse, r.bins_with_signal_reverse, frame);
+        if(not ok)
+            return false;
+    }
+    std::printf("1024 point IQ: %zu frames identical to the original process(), the reverse maximum corrected in %zu\n",
+                options.frames,
+                corrected);
+    return true;
+}
+
+/// process() against a plain walk over the bins of the layout: a strong forward target and, in IQ mode, a weaker
+/// reverse target at another speed (the reverse peak was missed when it was weaker than the forward one)
+template <class Layout>
+bool checkLayout(Options const& options)
+{
+    using Results = AudioResults<Layout>;
+    auto const results = std::unique_ptr<Results>(new Results());
+    auto const noiseFloor = std::unique_ptr<NoiseFloorEstimator<Layout>>(new NoiseFloorEstimator<Layout>());
+    noiseFloor->adaptRate = 0;
+    noiseFloor->maxRisePerFrame = 0;
+
+    constexpr size_t minBin = Layout::minBinIndex;
+    std::mt19937 random(options.seed);
+    std::normal_distribution<float> noise(0, 1);
+    std::uniform_int_distribution<size_t> targetBin(Layout::detectionBegin + 1, Layout::maxBinIndex - 2);
+    std::vector<float> fft(Layout::fftWidth, 0);
+    std::vector<float> distance(Layout::numberOfFftBins);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%u point%s", unsigned(Layout::fftWidth), Layout::iqMeasurement ? " IQ" : "");
+    auto const fail = [&name](size_t frame, char const* what) {
+        std::printf("%s, frame %zu: %s\n", name, frame, what);
+        return false;
+    };
+
+    // bins to speeds: the last pedestrian bin is the last one up to maxPedestrianSpeed, the sent bins end at
+    // sendMaxSpeed or half the width
+    double const metersPerSecond = double(Layout::sampleRate) / Layout::fftWidth / 44.0;
+    if(std::fabs(Layout::speedConversion - metersPerSecond) > 1e-6 * metersPerSecond)
+    {
+        std::printf("%s: %.6f m/s per bin instead of %.6f\n", name, Layout::speedConversion, metersPerSecond);
+        return false;
+    }
+    size_t const rawBins = std::min<size_t>(Layout::sendMaxSpeed / metersPerSecond, Layout::fftWidth / 2);
+    if(Layout::maxPedestrianBin != size_t(Layout::maxPedestrianSpeed / metersPerSecond) ||
+       Layout::rawBinCount != rawBins)
+        return fail(0, "pedestrian or sent bins not at their speeds");
+    float const lastPedestrianSpeed = (int(Layout::pedestrianEnd) - Layout::iqOffset) * Layout::speedConversion;
+    if(lastPedestrianSpeed > Layout::maxPedestrianSpeed ||
+       lastPedestrianSpeed + Layout::speedConversion <= Layout::maxPedestrianSpeed)
+        return fail(0, "last pedestrian bin");
+
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        for(size_t i = minBin; i < Layout::maxBinIndex; i++)
+            fft[i] = (*noiseFloor)[i - minBin] + noise(random);
+        size_t const forwardBin = targetBin(random);
+        size_t reverseBin = forwardBin;
+        while(reverseBin + 2 >= forwardBin && reverseBin <= forwardBin + 2)
+            reverseBin = targetBin(random);
+        for(int d = -1; d <= 1; d++)
+        {
+            fft[forwardBin + d] += d == 0 ? 30 : 20;
+            if(Layout::iqMeasurement)
+                fft[Layout::fftWidth - reverseBin + d] += d == 0 ? 20 : 10;
+        }
+        results->process(fft.data(), *noiseFloor, threshold);
+        Results const& r = *results;
+
+        for(size_t j = 0; j < Layout::numberOfFftBins; j++)
+        {
+            distance[j] = fft[minBin + j] - (*noiseFloor)[j];
+            if(r.spectrum[j] != fft[minBin + j] || r.noise_floor_distance[j] != distance[j])
+                return fail(frame, "spectrum or noise floor distance");
+        }
+
+        float pedestrian = 0;
+        for(size_t i = Layout::pedestrianBegin; i < Layout::pedestrianEnd; i++)
+            pedestrian += fft[i];
+        pedestrian /= Layout::maxPedestrianBin;
+
+        float amplitudeMax = -9999, amplitudeMaxReverse = -9999, mean = 0, meanReverse = 0;
+        uint16_t index = 0, indexReverse = 0;
+        uint8_t bins = 0, binsReverse = 0;
+        for(size_t i = Layout::detectionBegin; i < Layout::maxBinIndex; i++)
+        {
+            float const value = distance[i - minBin];
+            float const reverse = Layout::iqMeasurement ? distance[Layout::fftWidth - i - minBin] : -9999;
+            mean += value;
+            bins += value > threshold;
+            if(Layout::iqMeasurement)
+                meanReverse += reverse;
+            binsReverse += reverse > threshold;
+            if(value > reverse && value > amplitudeMax)
+            {
+                amplitudeMax = value;
+                index = i;
+            }
+            if(reverse > value && reverse > amplitudeMaxReverse)
+            {
+                amplitudeMaxReverse = reverse;
+                indexReverse = i;
+            }
+        }
+        constexpr float detectionBins = Layout::maxBinIndex - Layout::detectionBegin;
+        mean /= detectionBins;
+        meanReverse /= detectionBins;
+
+        if(r.pedestrian_amplitude != pedestrian)
+            return fail(frame, "pedestrian_amplitude");
+        if(r.amplitudeMax != amplitudeMax || r.max_freq_Index != index || r.mean_amplitude != mean ||
+           r.bins_with_signal != bins)
+            return fail(frame, "forward metrics");
+        if(r.amplitudeMaxReverse != amplitudeMaxReverse || r.max_freq_Index_reverse != indexReverse ||
+           r.mean_amplitude_reverse != meanReverse || r.bins_with_signal_reverse != binsReverse)
+            return fail(frame, "reverse metrics");
+
+        // the targets themselves, at their speeds
+        float const speed = (int(forwardBin) - Layout::iqOffset) * Layout::speedConversion;
+        float const reverseSpeed = (int(reverseBin) - Layout::iqOffset) * Layout::speedConversion;
+        if(r.max_freq_Index != forwardBin || r.detected_speed != speed)
+            return fail(frame, "forward target not found");
+        if(Layout::iqMeasurement ? r.max_freq_Index_reverse != reverseBin || r.detected_speed_reverse != reverseSpeed
+                                 : r.amplitudeMaxReverse != -9999 || r.peak_count_reverse != 0)
+            return fail(frame, "reverse target not found");
+
+        auto const hasPeak = [](Tracking::Peak const* peaks, size_t count, float speed) {
+            for(size_t i = 0; i < count; i++)
+                if(std::fabs(Results::peakSpeed(peaks[i]) - speed) <= Layout::speedConversion)
+                    return true;
+            return false;
+        };
+        if(not hasPeak(r.peaks, r.peak_count, speed) ||
+           (Layout::iqMeasurement && not hasPeak(r.peaks_reverse, r.peak_count_reverse, reverseSpeed)))
+            return fail(frame, "no peak at the target");
+    }
+    std::printf("%s: %zu frames as expected\n", name, options.frames);
+    return true;
+}
+
+template <class... Layouts>
+bool checkLayouts(Options const& options)
+{
+    bool ok = true;
+    for(bool layoutOk : {checkLayout<Layouts>(options)...})
+        ok = ok && layoutOk;
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--frames 2000] [--seed 1]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool const ok = checkBaseline(options) && checkLayouts<SpectrumLayout<256, false>,
+                                                           SpectrumLayout<256, true>,
+                                                           SpectrumLayout<512, false>,
+                                                           SpectrumLayout<512, true>,
+                                                           SpectrumLayout<1024, false>,
+                                                           SpectrumLayout<1024, true>,
+                                                           SpectrumLayout<2048, false>,
+                                                           SpectrumLayout<2048, true>>(options);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,322 @@
+// Checks the buffered SD writes of FileWriter (see BufferedFile.hpp) against the writer of the original sensor code,
+// which wrote every frame directly to the card and flushed it: synthetic frames go through FileWriter with the Arduino
+// stand-ins of host/ and through a copy of the original writeRawData/writeCsvData on the same card. The raw file
+// (float, file_version 1) and the csv table have to be byte-identical.
+//
+// The card calls are counted by the SD stand-in. FileWriter may only write whole sectors apart from the writes before
+// a flush or close, it flushes at most once per flush interval and the card is written about once per sector. An event
+// line, far less than a sector, has to be on the card one flush interval after it was written. Switching to the next
+// file must not touch the card before service(), which completes the switch one step per slice.
+//
+// usage: buffercheck [--frames 3000] [--seed 1]
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../CsvFormat.h"
+#include "../FileWriter.hpp"
+#include "../host/HostEnvironment.h"
+
+#include <SD.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    size_t frames = 3000;
+    unsigned seed = 1;
+};
+
+/// the writer of the original sensor code: each frame goes to the card right away and is flushed
+class PerFrameWriter
+{
+  public:
+    void writeRawData(AudioSystem::Results const& audioResults, Config const& config)
+    {
+        if(not rawFile)
+            openRawFile(audioResults.numberOfFftBins, config);
+
+        rawFile.write((byte*)&audioResults.timestamp, 4);
+        for(size_t i = 0; i < audioResults.numberOfFftBins; i++)
+            rawFile.write((byte*)&audioResults.spectrum[i], 4);
+        rawFile.flush();
+    }
+
+    void writeCsvData(AudioSystem::Results const& audioResults)
+    {
+        if(not csvFile)
+        {
+            csvFile = SD.open(csvName, FILE_WRITE);
+            csvFile.println(CsvFormat::header);
+            csvFile.flush();
+        }
+
+        CsvFormat::printLine(csvFile, audioResults);
+        csvFile.flush();
+    }
+
+    void close()
+    {
+        rawFile.close();
+        csvFile.close();
+    }
+
+    static constexpr char const* rawName = "perframe.bin";
+    static constexpr char const* csvName = "perframe.csv";
+
+  private:
+    void openRawFile(size_t const binCount, Config const& config)
+    {
+        uint16_t const fileFormatVersion = 1;
+        time_t timestamp = Teensy3Clock.get();
+
+        rawFile = SD.open(rawName, FILE_WRITE);
+        rawFile.write((byte*)&fileFormatVersion, 2);
+        rawFile.write((byte*)&timestamp, 4);
+        rawFile.write((byte*)&binCount, 2);
+        bool const iqMeasurement = config.audio.iq_measurement;
+        uint16_t const sampleRate = config.audio.sample_rate;
+        rawFile.write((byte*)&iqMeasurement, 1);
+        rawFile.write((byte*)&sampleRate, 2);
+        rawFile.flush();
+    }
+
+  private:
+    File rawFile;
+    File csvFile;
+};
+
+/// the globals of sensor.ino that are needed for writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+};
+
+/// the file of FileWriter with the given extension
+std::string fileWriterFile(char const* extension)
+{
+    for(auto const& file : HostEnvironment::sdFiles())
+        if(file.first.rfind("test_unit_", 0) == 0 && file.first.size() > 4 &&
+           file.first.compare(file.first.size() - 4, 4, extension) == 0)
+            return file.first;
+    return std::string();
+}
+
+bool compare(char const* name, std::string const& written, char const* expected)
+{
+    auto const& files = HostEnvironment::sdFiles();
+    if(written.empty() || files.count(expected) == 0)
+    {
+        std::printf("%s: file missing\n", name);
+        return false;
+    }
+    auto const& a = *files.at(written);
+    auto const& b = *files.at(expected);
+    if(a != b)
+    {
+        std::printf("%s: %s (%zu bytes) differs from the per frame writer (%zu bytes)\n",
+                    name, written.c_str(), a.size(), b.size());
+        return false;
+    }
+    return true;
+}
+
+/// the card calls of FileWriter on one file: about one write per sector, unaligned ones only before flush or close
+bool checkAccess(char const* name, std::string const& written, char const* perFrame, uint32_t durationMs,
+                 uint32_t flushIntervalMs)
+{
+    auto const& access = HostEnvironment::sdAccess();
+    auto const& buffered = access.at(written);
+    auto const& direct = access.at(perFrame);
+    size_t const sectors = (HostEnvironment::sdFiles().at(written)->size() + 511) / 512;
+    size_t const maxFlushes = durationMs / flushIntervalMs + 1;
+
+    std::printf("%s: %zu sectors, per frame writer %zu writes and %zu flushes, FileWriter %zu writes (%zu unaligned) "
+                "and %zu flushes\n",
+                name, sectors, direct.writeCalls, direct.flushCalls, buffered.writeCalls, buffered.unalignedWrites,
+                buffered.flushCalls);
+
+    bool const ok = buffered.flushCalls <= maxFlushes && buffered.unalignedWrites <= buffered.flushCalls &&
+                    buffered.writeCalls <= sectors + buffered.flushCalls;
+    if(not ok)
+        std::printf("  expected at most %zu flushes, no more unaligned writes than flushes and one write per sector\n",
+                    maxFlushes);
+    return ok;
+}
+
+/// one event line has to reach the card within the flush interval, although the ring holds far less than a sector
+bool checkSparseFile(Sensor& sensor, uint32_t& now)
+{
+    Tracking::Event event;
+    event.start = now - 1500;
+    event.end = now;
+    event.peakSpeed = 12.5f;
+    event.medianSpeed = 11.25f;
+    event.strength = 31;
+    event.frames = 70;
+    sensor.fileWriter.writeEventData(event, sensor.config);
+    // the file is created by service(), writeEventData() only switches the ring to it
+    auto const lines = []() {
+        std::string const name = fileWriterFile(".evt");
+        if(name.empty())
+            return size_t(0);
+        auto const& data = *HostEnvironment::sdFiles().at(name);
+        size_t count = 0;
+        for(uint8_t c : data)
+            count += c == '\n';
+        return count;
+    };
+
+    uint32_t const written = now;
+    while(now - written <= 1000 + AudioSystem::Layout::framePeriodMicros / 1000)
+    {
+        now += AudioSystem::Layout::framePeriodMicros / 1000;
+        HostEnvironment::setMillis(now);
+        while(sensor.fileWriter.needsService())
+            sensor.fileWriter.service(sensor.config.sdSectorsPerSlice);
+    }
+
+    // the header and the event
+    if(lines() != 2)
+    {
+        std::printf("events: %zu lines on the card 1 s after the event, expected 2\n", lines());
+        return false;
+    }
+    std::printf("events: the line is on the card after %u ms\n", now - written);
+    return true;
+}
+
+/// the frame task starts the next file with switchTo(); only service() may touch the card for it, one step per slice
+bool checkSwitch(uint32_t now)
+{
+    static uint8_t storage[4 * BufferedFile::sectorSize];
+    BufferedFile file(storage, sizeof(storage));
+    std::vector<uint8_t> data(3000);
+    for(size_t i = 0; i < data.size(); i++)
+        data[i] = uint8_t(i * 7 + i / 251);
+    auto const& files = HostEnvironment::sdFiles();
+    auto const fail = [](char const* what) {
+        std::printf("switch: %s\n", what);
+        return false;
+    };
+    auto const serviceAll = [&file, now]() {
+        size_t slices = 0;
+        for(; file.needsService(now); slices++)
+            if(file.service(now, 1) > 1)
+                return size_t(0);
+        return slices;
+    };
+
+    if(not file.switchTo("switch_a.bin") || not file.write(data.data(), 1500) || files.count("switch_a.bin") > 0)
+        return fail("the first file was created before service()");
+    if(serviceAll() == 0)
+        return fail("more than one step in a slice");
+    size_t const writesBefore = HostEnvironment::sdAccess()["switch_a.bin"].writeCalls;
+
+    // the end of the current file and the start of the next one in the ring at the same time
+    if(not file.write(data.data() + 1500, 700) || not file.switchTo("switch_b.bin") ||
+       not file.write(data.data() + 2200, 800))
+        return fail("write or switch refused");
+    if(file.switchTo("switch_c.bin"))
+        return fail("a second switch accepted while the first one is pending");
+    if(files.count("switch_b.bin") > 0 || HostEnvironment::sdAccess()["switch_a.bin"].writeCalls != writesBefore)
+        return fail("the card was touched by write() or switchTo()");
+    size_t const slices = serviceAll();
+    if(slices == 0)
+        return fail("more than one step in a slice");
+
+    if(not file.switchTo(nullptr) || file.write(data.data(), 1) || serviceAll() == 0 || file.needsService(now))
+        return fail("the last file was not closed");
+    auto const& a = *files.at("switch_a.bin");
+    auto const& b = *files.at("switch_b.bin");
+    if(a != std::vector<uint8_t>(data.begin(), data.begin() + 2200) ||
+       b != std::vector<uint8_t>(data.begin() + 2200, data.begin() + 3000))
+        return fail("the records did not reach their files");
+    std::printf("switch: %zu slices of at most one step from one file to the next\n", slices);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--frames 3000] [--seed 1]" << std::endl;
+            return 1;
+        }
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    static PerFrameWriter perFrame;
+    auto& results = sensor.results;
+    sensor.fileWriter.setupSpi();
+    sensor.fileWriter.setupSdCard();
+
+    std::mt19937 random(options.seed);
+    std::normal_distribution<float> noise(-90, 6);
+    std::uniform_real_distribution<float> speed(-20, 20);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+
+    uint32_t now = 1000;
+    HostEnvironment::setMillis(now);
+    HostEnvironment::setTime(1700000000);
+    uint32_t const start = now;
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        now += AudioSystem::Layout::framePeriodMicros / 1000 + jitter(random);
+        HostEnvironment::setMillis(now);
+        for(size_t i = 0; i < results.numberOfFftBins; i++)
+            results.spectrum[i] = noise(random);
+        results.timestamp = now;
+        results.sequence = frame + 1;
+        results.detected_speed = speed(random);
+        results.detected_speed_reverse = speed(random);
+        results.amplitudeMax = noise(random) + 100;
+        results.amplitudeMaxReverse = noise(random) + 100;
+        results.mean_amplitude = noise(random) + 95;
+        results.mean_amplitude_reverse = noise(random) + 95;
+        results.bins_with_signal = uint8_t(frame % 40);
+        results.bins_with_signal_reverse = uint8_t(frame % 17);
+        results.pedestrian_amplitude = noise(random);
+
+        // float raw data is never compressed, so the file is version 1 like the original one
+        sensor.fileWriter.writeRawData(results, false, sensor.config);
+        sensor.fileWriter.writeCsvData(results, sensor.config);
+        perFrame.writeRawData(results, sensor.config);
+        perFrame.writeCsvData(results);
+
+        // the sd task of the scheduler runs in the slack between two frames until nothing is left to write
+        while(sensor.fileWriter.needsService())
+            sensor.fileWriter.service(sensor.config.sdSectorsPerSlice);
+    }
+
+    bool ok = checkSparseFile(sensor, now);
+    ok = checkSwitch(now) && ok;
+    uint32_t const durationMs = now - start;
+    sensor.fileWriter.close();
+    perFrame.close();
+
+    std::string const raw = fileWriterFile(".bin");
+    std::string const csv = fileWriterFile(".csv");
+    ok = compare("raw", raw, PerFrameWriter::rawName) && compare("csv", csv, PerFrameWriter::csvName) && ok;
+    ok = ok && checkAccess("raw", raw, PerFrameWriter::rawName, durationMs, 1000) &&
+         checkAccess("csv", csv, PerFrameWriter::csvName, durationMs, 1000);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,307 @@
+// Checks the serial commands of CommandParser.h and SerialIO::execute with the stand-ins of host/.
+//
+// The parser gets a stream with every command, invalid and overlong lines and values that are no finite number, cut
+// into random fragments of 1 to 5 bytes with random pauses in between, like from a slow or bursty USB host. Every run
+// has to yield the same commands with the same values; a T number also has to end after its timeout. SerialIO has to
+// refuse values that updateIQ() cannot use (alpha 0, nan, inf, psi beyond the limits), keep the single byte steps
+// within the limits and still apply valid values. Its replies and the messages of FileWriter about new files must not
+// end up inside a spectrum frame that goes out in pieces: the frame has to decode and the text has to follow it.
+//
+// The tool fails with exit code 2 and prints every check that failed.
+//
+// usage: commandcheck [--runs 200] [--seed 1]
+
+#include "../CommandParser.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../SerialIO.hpp"
+#include "../host/HostEnvironment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Command = CommandParser::Command;
+
+struct Options
+{
+    size_t runs = 200;
+    unsigned seed = 1;
+};
+
+struct Expected
+{
+    Command::Type type;
+    char const* name;
+    float value;
+    uint32_t number;
+};
+
+// the stream and the commands it has to yield; the T number ends with the next command byte
+char const stream[] = "ds$set alpha 1.12\nT1712345678p$get psi\r\n$status\n\x01ol\x00ik"
+                      "m$set psi -0.05\r$time 1712345679\n$counters\n$memory\n"
+                      "$set alpha nan\n$set psi inf\n$set alpha 1e40\n$set psi -INF\n$set alpha 0x\n"
+                      "$frobnicate\n$xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\nd"
+                      "$set averyveryverylongname 1\n$get\n$  \n$set  mic_gain\t 0.5 \n";
+Expected const expected[] = {
+    {Command::SendOutput, "", 0, 0},
+    {Command::Status, "", 0, 0},
+    {Command::SetValue, "alpha", 1.12f, 0},
+    {Command::SetTime, "", 0, 1712345678},
+    {Command::Profile, "", 0, 0},
+    {Command::GetValue, "psi", 0, 0},
+    {Command::Status, "", 0, 0},
+    {Command::MicGainUp, "", 0, 0},
+    {Command::AlphaUp, "", 0, 0},
+    {Command::AlphaDown, "", 0, 0},
+    {Command::MicGainDown, "", 0, 0},
+    {Command::PsiUp, "", 0, 0},
+    {Command::PsiDown, "", 0, 0},
+    {Command::Memory, "", 0, 0},
+    {Command::SetValue, "psi", -0.05f, 0},
+    {Command::SetTime, "", 0, 1712345679},
+    {Command::Counters, "", 0, 0},
+    {Command::Memory, "", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "frobnicate", 0, 0},
+    {Command::Invalid, "xxxxxxxxxxxxxxx", 0, 0}, // the start of the overlong line
+    {Command::SendOutput, "", 0, 0},
+    {Command::Invalid, "set", 0, 0},
+    {Command::Invalid, "get", 0, 0},
+    {Command::SetValue, "mic_gain", 0.5f, 0},
+};
+constexpr size_t expectedCount = sizeof(expected) / sizeof(expected[0]);
+
+bool failed = false;
+
+void expect(bool condition, std::string const& what)
+{
+    if(condition)
+        return;
+    std::printf("failed: %s\n", what.c_str());
+    failed = true;
+}
+
+bool same(Command const& command, Expected const& expected)
+{
+    return command.type == expected.type && strcmp(command.name, expected.name) == 0 &&
+           command.value == expected.value && command.number == expected.number;
+}
+
+void drain(CommandParser& parser, uint32_t now, std::vector<Command>& commands)
+{
+    for(auto command = parser.next(now); command.type != Command::None; command = parser.next(now))
+        commands.push_back(command);
+}
+
+/// the stream in random fragments; the pauses stay below the timeout of the T number
+void checkFragments(Options const& options)
+{
+    std::mt19937 random(options.seed);
+    std::uniform_int_distribution<size_t> fragment(1, 5);
+    std::uniform_int_distribution<uint32_t> pause(0, CommandParser::numberTimeoutMs - 1);
+    size_t const length = sizeof(stream) - 1;
+
+    for(size_t run = 0; run < options.runs; run++)
+    {
+        CommandParser parser;
+        std::vector<Command> commands;
+        uint32_t now = uint32_t(random()); // also across the wrap of millis()
+        for(size_t position = 0; position < length;)
+        {
+            for(size_t end = std::min(length, position + fragment(random)); position < end; position++)
+            {
+                parser.feed(uint8_t(stream[position]), now);
+                drain(parser, now, commands);
+            }
+            now += pause(random);
+            drain(parser, now, commands);
+        }
+
+        size_t i = 0;
+        while(i < expectedCount && i < commands.size() && same(commands[i], expected[i]))
+            i++;
+        if(i < expectedCount || commands.size() != expectedCount)
+        {
+            expect(false, "run " + std::to_string(run) + ": " + std::to_string(commands.size()) + " commands, " +
+                              std::to_string(expectedCount) + " expected, command " + std::to_string(i) + " differs");
+            return;
+        }
+    }
+    std::printf("%zu runs of %zu bytes in fragments: %zu commands each as expected\n",
+                options.runs, length, expectedCount);
+}
+
+/// a T number without a terminator ends 1 s after its last byte, even when next() is called late
+void checkTimeout()
+{
+    CommandParser parser;
+    std::vector<Command> commands;
+    for(char c : std::string("T171"))
+        parser.feed(uint8_t(c), 5000);
+    drain(parser, 5000 + CommandParser::numberTimeoutMs - 1, commands);
+    expect(commands.empty(), "T number ended before its timeout");
+    drain(parser, 5000 + CommandParser::numberTimeoutMs, commands);
+    expect(commands.size() == 1 && commands[0].type == Command::SetTime && commands[0].number == 171,
+           "T number ended after its timeout");
+
+    // without digits like Stream::parseInt(): 0
+    commands.clear();
+    parser.feed('T', 9000);
+    drain(parser, 20000, commands);
+    parser.feed('d', 20000);
+    drain(parser, 20000, commands);
+    expect(commands.size() == 2 && commands[0].type == Command::SetTime && commands[0].number == 0 &&
+               commands[1].type == Command::SendOutput,
+           "T without digits");
+}
+
+/// the commands through SerialIO, the replies are read back from the serial stand-in
+std::string execute(SerialIO& serialIO, AudioSystem::Config& config, char const* input)
+{
+    size_t const before = HostEnvironment::serialOutput().size();
+    HostEnvironment::sendSerialInput(input);
+    SerialIO::Requests requests;
+    // processInputs() handles a limited number of bytes per call
+    for(size_t i = 0; i <= strlen(input) / SerialIO::inputBudget; i++)
+        serialIO.processInputs(config, requests);
+    while(serialIO.hasText())
+        serialIO.service();
+    auto const& output = HostEnvironment::serialOutput();
+    return std::string(output.begin() + before, output.end());
+}
+
+void checkLimits()
+{
+    static SerialIO serialIO;
+    AudioSystem::Config config;
+    using Limits = AudioSystem::Config;
+    float const alpha = config.alpha;
+    float const psi = config.psi;
+    float const micGain = config.mic_gain;
+
+    std::string reply = execute(serialIO,
+                                config,
+                                "$set alpha 0\n$set alpha -1\n$set alpha nan\n$set alpha inf\n$set psi 1.58\n"
+                                "$set psi -inf\n$set mic_gain -1\n$set mic_gain 1e9\n");
+    expect(config.alpha == alpha && config.psi == psi && config.mic_gain == micGain && not config.hasChanges,
+           "values out of range or no finite number changed the configuration");
+    size_t refused = 0;
+    for(size_t at = reply.find("out of range"); at != std::string::npos; at = reply.find("out of range", at + 1))
+        refused++;
+    size_t invalid = 0;
+    for(size_t at = reply.find("unknown command: set"); at != std::string::npos;
+        at = reply.find("unknown command: set", at + 1))
+        invalid++;
+    expect(refused == 5 && invalid == 3, "replies to the refused values: " + reply);
+
+    reply = execute(serialIO, config, "$set alpha 0.8\n$set psi -0.3\n$set mic_gain 2.5\n");
+    expect(config.alpha == 0.8f && config.psi == -0.3f && config.mic_gain == 2.5f && config.hasChanges,
+           "valid values applied");
+    expect(reply.find("alpha = 0.80") != std::string::npos, "reply to a valid value: " + reply);
+
+    // far more steps than fit between the limits
+    config.hasChanges = false;
+    execute(serialIO, config, std::string(300, 'l').c_str());
+    execute(serialIO, config, std::string(300, 'k').c_str());
+    expect(config.alpha >= Limits::min_alpha && config.alpha < Limits::min_alpha + 0.01f &&
+               config.psi >= -Limits::max_psi && config.psi < -Limits::max_psi + 0.01f && config.hasChanges,
+           "steps down stop at the limits");
+    execute(serialIO, config, std::string(300, 'o').c_str());
+    execute(serialIO, config, std::string(300, 'i').c_str());
+    expect(config.alpha <= Limits::max_alpha && config.alpha > Limits::max_alpha - 0.01f &&
+               config.psi <= Limits::max_psi && config.psi > Limits::max_psi - 0.01f,
+           "steps up stop at the limits");
+
+    // what updateIQ() computes stays finite at the limits
+    for(float a : {Limits::min_alpha, Limits::max_alpha})
+        for(float p : {-Limits::max_psi, Limits::max_psi})
+            expect(std::isfinite(1 / a) && std::isfinite(-std::sin(p) / (a * std::cos(p))) &&
+                       std::isfinite(1 / std::cos(p)),
+                   "IQ correction at the limits");
+    if(not failed)
+        std::printf("SerialIO: out of range values and values that are no finite number refused, steps limited\n");
+}
+
+/// a reply and a new file while a frame is going out in pieces of a few bytes
+void checkTextDuringFrame()
+{
+    static SerialIO serialIO;
+    static AudioSystem audio;
+    static AudioSystem::Results results;
+    static FileWriter fileWriter;
+    Config config;
+    fileWriter.setLog(serialIO.text());
+    fileWriter.setupSdCard();
+    for(size_t i = 0; i < results.numberOfFftBins; i++)
+        results.noise_floor_distance[i] = float(i % 50);
+
+    size_t const before = HostEnvironment::serialOutput().size();
+    HostEnvironment::setSerialWriteBudget(7);
+    serialIO.sendOutput(results, audio, config);
+    serialIO.service();
+    HostEnvironment::sendSerialInput("$get alpha\n");
+    SerialIO::Requests requests;
+    serialIO.processInputs(config.audio, requests);
+    fileWriter.writeMetricsData(results, config);
+    for(size_t slices = 0; slices < 10000 && (serialIO.isSending() || serialIO.hasText()); slices++)
+        serialIO.service();
+    HostEnvironment::setSerialWriteBudget(4096);
+
+    auto const& output = HostEnvironment::serialOutput();
+    std::vector<uint8_t> const sent(output.begin() + before, output.end());
+    static SerialFormat::Decoder decoder;
+    static float bins[RawCompression::maxBinCount];
+    SerialFormat::FrameInfo info;
+    decoder.push(sent.data(), sent.size());
+    size_t frames = 0;
+    while(decoder.next(info, bins, RawCompression::maxBinCount))
+        frames++;
+    expect(frames == 1 && decoder.statistics().crcErrors == 0, "the frame sent in pieces around the text");
+    std::string const text(sent.begin(), sent.end());
+    size_t const reply = text.find("alpha = ");
+    expect(reply != std::string::npos && reply >= SerialFormat::headerSize + results.numberOfFftBins,
+           "reply after the frame: " + std::to_string(reply));
+    size_t const message = text.find("Creating new file: ");
+    expect(message != std::string::npos && message >= SerialFormat::headerSize + results.numberOfFftBins,
+           "message of FileWriter after the frame: " + std::to_string(message));
+    if(not failed)
+        std::printf("SerialIO: reply and file message held back until the frame was out\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--runs")
+            options.runs = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--runs 200] [--seed 1]" << std::endl;
+            return 1;
+        }
+    }
+
+    checkFragments(options);
+    checkTimeout();
+    checkLimits();
+    checkTextDuringFrame();
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,256 @@
+// Round trip of the compressed raw format (file_version 4, see RawCompression.h and RawRecord.h): frames go through
+// FileWriter in 8 bit mode with the Arduino stand-ins of host/, the file is saved into <dir> and read back with
+// RawFile. Every frame has to come back with its timestamp, its sequence number and the bins it was written with.
+// The compression ratio is the size of the same frames as 8 bit version 1 file over the size of the compressed file.
+//
+// The frames are synthetic by default: a noise floor that drifts slowly, noise on every bin and now and then a
+// passage that moves through the bins. With --input they are taken from a recording (version 1, 8 bit or float), e.g.
+// the Nordring recording of "data processing method/data".
+//
+// The tool fails with exit code 2 if a frame differs, a frame is missing or the ratio is below --min-ratio.
+//
+// usage: compressioncheck <dir> [--input recording.bin] [--frames 6000] [--min-ratio 2] [--seed 1]
+
+#include "RawFile.h"
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../host/HostEnvironment.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::string directory;
+    std::string input;
+    size_t frames = 6000;
+    double minRatio = 2;
+    unsigned seed = 1;
+};
+
+struct Frame
+{
+    uint32_t timestamp;
+    std::vector<uint8_t> bins; // as written in 8 bit mode: -dBFS
+};
+
+/// the globals of sensor.ino that are needed for writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+};
+
+/// a drifting noise floor with noise and passages of a target through the bins
+class SyntheticSpectra
+{
+  public:
+    SyntheticSpectra(size_t binCount, unsigned seed)
+        : random(seed)
+        , floor(binCount)
+    {
+        std::uniform_real_distribution<float> level(-100, -75);
+        for(auto& bin : floor)
+            bin = level(random);
+    }
+
+    void next(float* spectrum)
+    {
+        std::normal_distribution<float> noise(0, 1.5f);
+        std::normal_distribution<float> drift(0, 0.05f);
+        std::uniform_real_distribution<float> uniform(0, 1);
+        size_t const binCount = floor.size();
+
+        if(passageFrames == 0 && uniform(random) < 0.005f)
+        {
+            passageFrames = 40 + size_t(uniform(random) * 80);
+            passageBin = uniform(random) * binCount;
+            passageStep = (uniform(random) - 0.5f) * 4;
+        }
+
+        for(size_t i = 0; i < binCount; i++)
+        {
+            floor[i] = std::min(-60.0f, std::max(-110.0f, floor[i] + drift(random)));
+            spectrum[i] = floor[i] + noise(random);
+        }
+        if(passageFrames > 0)
+        {
+            passageFrames--;
+            passageBin = std::min(float(binCount - 3), std::max(2.0f, passageBin + passageStep));
+            size_t const center = size_t(passageBin);
+            for(size_t i = center - 2; i <= center + 2; i++)
+                spectrum[i] += 30 - 6 * float(i > center ? i - center : center - i);
+        }
+    }
+
+  private:
+    std::mt19937 random;
+    std::vector<float> floor;
+    size_t passageFrames = 0;
+    float passageBin = 0;
+    float passageStep = 0;
+};
+
+std::string fileWriterFile(char const* extension)
+{
+    for(auto const& file : HostEnvironment::sdFiles())
+        if(file.first.size() > 4 && file.first.compare(file.first.size() - 4, 4, extension) == 0)
+            return file.first;
+    return std::string();
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+/// writes the frames like loop() does; the card keeps up, so no frame is dropped
+bool record(Sensor& sensor, Options const& options, std::vector<Frame>& written)
+{
+    auto& results = sensor.results;
+    size_t const binCount = results.numberOfFftBins;
+    RawFile input;
+    if(not options.input.empty() &&
+       (not input.open(options.input) || input.header().binCount != binCount ||
+        input.layout() == RawFile::Layout::Compressed))
+    {
+        std::cerr << options.input << " is no uncompressed recording of " << binCount << " bins "
+                  << input.error() << std::endl;
+        return false;
+    }
+    size_t const frames = options.input.empty() ? options.frames : input.frameCount();
+    SyntheticSpectra synthetic(binCount, options.seed);
+
+    HostEnvironment::setTime(1700000000);
+    uint32_t now = 0;
+    for(size_t frame = 0; frame < frames; frame++)
+    {
+        if(options.input.empty())
+        {
+            now += AudioSystem::Layout::framePeriodMicros / 1000;
+            synthetic.next(results.spectrum);
+        }
+        else
+        {
+            now = input.timestamp(frame);
+            if(not input.readDbfs(frame, results.spectrum))
+                continue;
+        }
+        HostEnvironment::setMillis(now);
+        results.timestamp = now;
+        results.sequence = frame + 1;
+
+        sensor.fileWriter.writeRawData(results, true, sensor.config);
+        Frame expected{now, std::vector<uint8_t>(binCount)};
+        for(size_t i = 0; i < binCount; i++)
+            expected.bins[i] = (uint8_t)-results.spectrum[i];
+        written.push_back(std::move(expected));
+
+        while(sensor.fileWriter.needsService())
+            sensor.fileWriter.service();
+    }
+    sensor.fileWriter.close();
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <dir> [--input recording.bin] [--frames 6000] [--min-ratio 2] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.directory = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--input")
+            options.input = argv[++i];
+        else if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--min-ratio")
+            options.minRatio = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    if(not sensor.config.compressRawData)
+    {
+        std::cerr << "compressRawData is off in Config.h" << std::endl;
+        return 1;
+    }
+    std::vector<Frame> written;
+    if(not record(sensor, options, written))
+        return 1;
+
+    std::string const name = options.directory + "/compressed.bin";
+    std::string const rawName = fileWriterFile(".bin");
+    if(rawName.empty() || not writeFile(name, *HostEnvironment::sdFiles().at(rawName)))
+    {
+        std::cerr << "Unable to write into " << options.directory << std::endl;
+        return 1;
+    }
+
+    RawFile raw;
+    if(not raw.open(name) || raw.layout() != RawFile::Layout::Compressed)
+    {
+        std::printf("%s is no compressed raw file %s\n", name.c_str(), raw.error().c_str());
+        return 2;
+    }
+    if(raw.frameCount() != written.size())
+    {
+        std::printf("%zu frames written, %zu read back\n", written.size(), raw.frameCount());
+        return 2;
+    }
+    std::vector<uint8_t> bins(raw.header().binCount);
+    for(size_t i = 0; i < written.size(); i++)
+    {
+        if(not raw.readBytes(i, bins.data()) || bins != written[i].bins || raw.timestamp(i) != written[i].timestamp ||
+           raw.sequence(i) != i + 1)
+        {
+            std::printf("frame %zu (%u ms) differs\n", i, written[i].timestamp);
+            return 2;
+        }
+    }
+
+    size_t const binCount = raw.header().binCount;
+    size_t const uncompressed = RawFile::headerSize + written.size() * (4 + binCount);
+    size_t const compressed = HostEnvironment::sdFiles().at(rawName)->size();
+    double const ratio = double(uncompressed) / compressed;
+    std::printf("%zu frames of %zu bins identical, %zu -> %zu bytes, compression ratio %.2f\n",
+                written.size(),
+                binCount,
+                uncompressed,
+                compressed,
+                ratio);
+    if(ratio < options.minRatio)
+    {
+        std::printf("compression ratio below %.2f\n", options.minRatio);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+// Checks rawexport and the layout detection of RawFile on small raw files written here in every format the sensor
+// wrote: version 1 with 8 bit and with float bins, version 2 (compressed), 3 (framed) and 4 (with sequence numbers and
+// the anchor of the sample clock), see FileWriter::openRawFile and RawRecord.h.
+//
+// Each file is exported with <rawexport> into <dir>. Both .npy files need the magic, version 1.0, a header padded to
+// the data, the type of the file (uint8, float32 for float files and with --dbfs), fortran_order False and the shape
+// (frames, bins) and (frames,); every timestamp and bin has to be the one written. --from and --to have to select the
+// frames in between.
+//
+// RawFile::open has to tell the 8 bit from the float records without being told, also with a cut off last record, and
+// has to refuse records whose timestamps do not increase with either record size.
+//
+// The tool fails with exit code 2 and prints every check that failed.
+//
+// usage: exportcheck <rawexport> <dir> [--frames 50] [--seed 1]
+
+#include "RawFile.h"
+
+#include "../Checksum.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr uint16_t binCount = 64;
+constexpr uint16_t keyFrameInterval = 8;
+
+struct Options
+{
+    std::string exporter;
+    std::string directory;
+    size_t frames = 50;
+    unsigned seed = 1;
+};
+
+bool failed = false;
+
+void expect(bool condition, std::string const& what)
+{
+    if(condition)
+        return;
+    std::printf("failed: %s\n", what.c_str());
+    failed = true;
+}
+
+/// what a file holds: per frame the timestamp and the bins as -dBFS bytes or dBFS floats
+struct Frames
+{
+    std::vector<uint32_t> timestamps;
+    std::vector<uint8_t> bytes;
+    std::vector<float> floats;
+};
+
+Frames makeFrames(size_t count, std::mt19937& random)
+{
+    std::uniform_int_distribution<int> byte(0, 200);
+    std::uniform_real_distribution<float> dbfs(-140, 0);
+    Frames frames;
+    for(size_t i = 0; i < count; i++)
+    {
+        frames.timestamps.push_back(uint32_t(1000 + 85 * i));
+        for(size_t n = 0; n < binCount; n++)
+        {
+            frames.bytes.push_back(uint8_t(byte(random)));
+            frames.floats.push_back(dbfs(random));
+        }
+    }
+    return frames;
+}
+
+template <typename T>
+void append(std::vector<uint8_t>& data, T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+/// the 11 byte header of FileWriter::openRawFile, and from version 4 the anchor
+std::vector<uint8_t> fileHeader(uint16_t version)
+{
+    std::vector<uint8_t> data;
+    append(data, version);
+    append(data, uint32_t(1711700000));
+    append(data, binCount);
+    append(data, uint8_t(1));
+    append(data, uint16_t(12000));
+    if(version >= RawRecord::sequencedVersion)
+    {
+        FrameClock::Anchor anchor;
+        anchor.sequence = 500;
+        anchor.time = {1711700000, 250000};
+        anchor.hop = 1024;
+        anchor.sampleRate = 12000;
+        uint8_t anchorData[FrameClock::anchorSize];
+        data.insert(data.end(), anchorData, anchorData + FrameClock::writeAnchor(anchorData, anchor));
+    }
+    return data;
+}
+
+std::vector<uint8_t> uncompressedFile(Frames const& frames, bool floats)
+{
+    std::vector<uint8_t> data = fileHeader(1);
+    for(size_t i = 0; i < frames.timestamps.size(); i++)
+    {
+        append(data, frames.timestamps[i]);
+        if(floats)
+            for(size_t n = 0; n < binCount; n++)
+                append(data, frames.floats[i * binCount + n]);
+        else
+            data.insert(data.end(), &frames.bytes[i * binCount], &frames.bytes[(i + 1) * binCount]);
+    }
+    return data;
+}
+
+/// the records of RawRecord.h in the given version, coded like FileWriter::writeRawFrame
+std::vector<uint8_t> compressedFile(Frames const& frames, uint16_t version)
+{
+    std::vector<uint8_t> data = fileHeader(version);
+    static RawCompression::Encoder encoder;
+    encoder.reset(keyFrameInterval);
+    std::vector<uint8_t> payload(RawCompression::maxPayloadSize(binCount));
+    for(size_t i = 0; i < frames.timestamps.size(); i++)
+    {
+        uint8_t flags = 0;
+        uint16_t const payloadSize =
+            uint16_t(encoder.encode(&frames.bytes[i * binCount], binCount, payload.data(), flags));
+        std::vector<uint8_t> fields;
+        append(fields, frames.timestamps[i]);
+        if(version >= RawRecord::sequencedVersion)
+            append(fields, uint64_t(500 + i));
+        append(fields, flags);
+        append(fields, payloadSize);
+        fields.insert(fields.end(), payload.begin(), payload.begin() + payloadSize);
+        if(version >= RawRecord::framedVersion)
+        {
+            data.insert(data.end(), RawRecord::syncWord, RawRecord::syncWord + 2);
+            uint32_t const crc = Checksum::crc32(fields.data(), fields.size());
+            append(fields, crc);
+        }
+        data.insert(data.end(), fields.begin(), fields.end());
+    }
+    return data;
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream file(name, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(data.data()), std::streamsize(data.size()));
+    return bool(file);
+}
+
+std::vector<uint8_t> readFile(std::string const& name)
+{
+    std::ifstream file(name, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+/// the data of a .npy file after checking its header; empty if the header is not the expected one
+std::vector<uint8_t> npyData(std::string const& name, char const* type, std::string const& shape)
+{
+    std::vector<uint8_t> const file = readFile(name);
+    static uint8_t const magic[8] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0};
+    if(file.size() < 10 || std::memcmp(file.data(), magic, sizeof(magic)) != 0)
+    {
+        expect(false, name + ": no .npy 1.0 file");
+        return {};
+    }
+    size_t const headerLength = file[8] | file[9] << 8;
+    size_t const dataStart = 10 + headerLength;
+    std::string const header(file.begin() + 10, file.begin() + std::min(dataStart, file.size()));
+    std::string const dictionary =
+        "{'descr': '" + std::string(type) + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    if(dataStart % 64 != 0 || header.compare(0, dictionary.size(), dictionary) != 0 || header.back() != '\n' ||
+       header.find_first_not_of(' ', dictionary.size()) != header.size() - 1)
+    {
+        expect(false, name + ": header " + header + " instead of " + dictionary);
+        return {};
+    }
+    return std::vector<uint8_t>(file.begin() + dataStart, file.end());
+}
+
+/// exports the file and compares both .npy files with frames [first, end)
+void checkExport(Options const& options,
+                 std::string const& name,
+                 Frames const& frames,
+                 bool floats,
+                 size_t first,
+                 size_t end,
+                 std::string const& arguments = "")
+{
+    std::string const input = options.directory + "/" + name + ".bin";
+    std::string const prefix = options.directory + "/" + name;
+    std::string const command = "\"" + options.exporter + "\" \"" + input + "\" \"" + prefix + "\"" + arguments +
+                                " > \"" + prefix + ".txt\"";
+    if(std::system(command.c_str()) != 0)
+    {
+        expect(false, "unable to run " + command);
+        return;
+    }
+
+    size_t const count = end - first;
+    std::vector<uint8_t> const timestamps =
+        npyData(prefix + "_timestamps.npy", "<u4", "(" + std::to_string(count) + ",)");
+    std::vector<uint8_t> const spectra = npyData(prefix + "_spectra.npy",
+                                                 floats ? "<f4" : "|u1",
+                                                 "(" + std::to_string(count) + ", " + std::to_string(binCount) + ")");
+    size_t const rowSize = binCount * (floats ? 4 : 1);
+    if(timestamps.size() != 4 * count || spectra.size() != rowSize * count)
+    {
+        expect(false,
+               name + ": " + std::to_string(timestamps.size()) + " bytes of timestamps and " +
+                   std::to_string(spectra.size()) + " bytes of spectra for " + std::to_string(count) + " frames");
+        return;
+    }
+
+    bool const dbfs = arguments.find("--dbfs") != std::string::npos;
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t const frame = first + i;
+        uint32_t timestamp;
+        std::memcpy(&timestamp, &timestamps[4 * i], 4);
+        bool same = timestamp == frames.timestamps[frame];
+        for(size_t n = 0; n < binCount && same; n++)
+        {
+            size_t const bin = frame * binCount + n;
+            if(not floats)
+                same = spectra[i * rowSize + n] == frames.bytes[bin];
+            else
+            {
+                float value;
+                std::memcpy(&value, &spectra[i * rowSize + 4 * n], 4);
+                same = value == (dbfs ? -float(frames.bytes[bin]) : frames.floats[bin]);
+            }
+        }
+        if(not same)
+        {
+            expect(false, name + ": frame " + std::to_string(frame) + " differs");
+            return;
+        }
+    }
+    if(not failed)
+        std::printf("%s%s: %zu frames exported\n", name.c_str(), arguments.c_str(), count);
+}
+
+/// RawFile::open without a layout on the file as written and cut off in its last record
+void checkDetection(std::string const& name, std::vector<uint8_t> data, RawFile::Layout expected, size_t frames)
+{
+    for(size_t cut : {size_t(0), size_t(3)})
+    {
+        data.resize(data.size() - cut);
+        std::string const file = name + (cut > 0 ? ".cut" : "");
+        if(not writeFile(file, data))
+        {
+            expect(false, "unable to write " + file);
+            return;
+        }
+        RawFile raw;
+        bool const opened = raw.open(file);
+        expect(opened && raw.layout() == expected && raw.frameCount() == frames - (cut > 0 ? 1 : 0),
+               file + ": layout " + std::to_string(int(raw.layout())) + ", " + std::to_string(raw.frameCount()) +
+                   " frames");
+        if(opened && raw.header().binCount != binCount)
+            expect(false, file + ": bin count");
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else if(options.exporter.empty())
+            options.exporter = option;
+        else if(options.directory.empty())
+            options.directory = option;
+        else
+            options.frames = 0;
+    }
+    if(options.directory.empty() || options.frames < 10)
+    {
+        std::cerr << "usage: " << argv[0] << " <rawexport> <dir> [--frames 50] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(options.seed);
+    Frames const frames = makeFrames(options.frames, random);
+    size_t const count = options.frames;
+    std::string const directory = options.directory + "/";
+
+    std::vector<uint8_t> const bytesFile = uncompressedFile(frames, false);
+    std::vector<uint8_t> const floatsFile = uncompressedFile(frames, true);
+    bool const written = writeFile(directory + "export_v1_bytes.bin", bytesFile) &&
+                         writeFile(directory + "export_v1_float.bin", floatsFile) &&
+                         writeFile(directory + "export_v2.bin", compressedFile(frames, RawRecord::compressedVersion)) &&
+                         writeFile(directory + "export_v3.bin", compressedFile(frames, RawRecord::framedVersion)) &&
+                         writeFile(directory + "export_v4.bin", compressedFile(frames, RawRecord::sequencedVersion));
+    if(not written)
+    {
+        std::cerr << "Unable to write into " << options.directory << std::endl;
+        return 1;
+    }
+
+    checkDetection(directory + "detect_bytes.bin", bytesFile, RawFile::Layout::Bytes, count);
+    checkDetection(directory + "detect_float.bin", floatsFile, RawFile::Layout::Floats, count);
+    {
+        // the same timestamp at both record sizes
+        std::vector<uint8_t> unordered = fileHeader(1);
+        unordered.resize(unordered.size() + 20 * (4 + 4 * binCount), 0x55);
+        writeFile(directory + "detect_unordered.bin", unordered);
+        RawFile raw;
+        expect(not raw.open(directory + "detect_unordered.bin"), "records without increasing timestamps opened");
+    }
+    if(not failed)
+        std::printf("layout detection: 8 bit and float records told apart, also when cut off\n");
+
+    checkExport(options, "export_v1_bytes", frames, false, 0, count);
+    checkExport(options, "export_v1_float", frames, true, 0, count);
+    checkExport(options, "export_v2", frames, false, 0, count);
+    checkExport(options, "export_v3", frames, false, 0, count);
+    checkExport(options, "export_v4", frames, false, 0, count);
+    checkExport(options, "export_v4", frames, true, 0, count, " --dbfs");
+    checkExport(options, "export_v1_bytes", frames, true, 0, count, " --dbfs");
+    // frames 3 to 14 by their timestamps, across a key frame
+    std::string const range = " --from " + std::to_string(frames.timestamps[3]) + " --to " +
+                              std::to_string(frames.timestamps[keyFrameInterval + 7] - 1);
+    checkExport(options, "export_v1_float", frames, true, 3, keyFrameInterval + 7, range);
+    checkExport(options, "export_v3", frames, false, 3, keyFrameInterval + 7, range);
+    return failed ? 2 : 0;
+}
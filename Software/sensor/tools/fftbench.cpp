@@ -0,0 +1,369 @@
+// Checks the spectra of IqFft (see IqFft.h) against a direct DFT in double precision and measures how many spectra
+// per second it computes for each FFT width and hop.
+//
+// The check signal is a synthetic Doppler chirp of a passing vehicle: a complex tone that sweeps from a positive
+// frequency (approaching) through 0 Hz to a negative one (leaving), with a little noise. Every window and width is
+// compared bin by bin on a few overlapping frames, and the strongest bin has to be where the layout of SpectrumLayout
+// puts the instantaneous frequency. The tool fails with exit code 2 if a bin differs by more than --tolerance dB.
+//
+// The benchmark feeds --seconds of signal in blocks of 128 samples like the audio library and prints the spectra per
+// second of signal, the spectra per second of processing time and the share of one core that realtime needs.
+//
+// The linear power path (AudioSystem::Config::linear_power) is checked as well: FastLog::powerToDb against log10 in
+// double precision for every mantissa of a few exponents and a sweep over all normal floats, FastLog::dbToPower over
+// the whole dB range, and both paths of the analysis on the chirp with the default layout. The tool fails if the
+// conversion is off by more than --log-tolerance dB. Then the time per frame of FFT and analysis (AudioResults) is
+// measured for the dBFS path (log10f of every bin, process) and the linear path (processPower).
+//
+// usage: fftbench [--seconds 20] [--tolerance 0.05] [--log-tolerance 0.0002]
+
+#include "../AudioResults.h"
+#include "../FastLog.h"
+#include "../IqFft.h"
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+constexpr double sampleRate = SpectrumLayout<1024, true>::sampleRate;
+constexpr size_t blockSize = 128; // AUDIO_BLOCK_SAMPLES
+
+struct Options
+{
+    double seconds = 20;
+    double tolerance = 0.05;
+    double logTolerance = 0.0002;
+};
+
+/// instantaneous frequency of chirp() at sample n of count, and how fast it changes in Hz per sample
+double chirpFrequency(double n, size_t count, double maxFrequency, double* slope = nullptr)
+{
+    double const x = 6 * (0.5 - n / count);
+    if(slope)
+        *slope = maxFrequency * 6 / count / (std::cosh(x) * std::cosh(x));
+    return maxFrequency * std::tanh(x);
+}
+
+/// a passing vehicle seen by the radar: the frequency falls from +maxFrequency to -maxFrequency over the signal
+void chirp(size_t count, double maxFrequency, std::vector<float>& i, std::vector<float>& q)
+{
+    i.resize(count);
+    q.resize(count);
+    uint32_t noise = 12345;
+    auto const random = [&noise]() {
+        noise = noise * 1664525 + 1013904223;
+        return (noise >> 8) / double(1 << 24) - 0.5;
+    };
+
+    double phase = 0;
+    for(size_t n = 0; n < count; n++)
+    {
+        phase += 2 * pi * chirpFrequency(n, count, maxFrequency) / sampleRate;
+        i[n] = float(0.5 * std::cos(phase) + 0.001 * random());
+        q[n] = float(0.5 * std::sin(phase) + 0.001 * random());
+    }
+}
+
+double windowValue(FftWindow window, size_t n, size_t width)
+{
+    double const x = 2 * pi * n / width;
+    switch(window)
+    {
+    case FftWindow::Rectangular:
+        return 1;
+    case FftWindow::Hann:
+        return 0.5 - 0.5 * std::cos(x);
+    case FftWindow::Hamming:
+        return 0.54 - 0.46 * std::cos(x);
+    case FftWindow::BlackmanHarris:
+        return 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+    }
+    return 1;
+}
+
+/// direct DFT of width samples from i and q in the output layout of IqFft
+void referenceSpectrum(float const* i, float const* q, size_t width, FftWindow window, std::vector<double>& spectrum)
+{
+    std::vector<std::complex<double>> samples(width);
+    for(size_t n = 0; n < width; n++)
+        samples[n] = std::complex<double>(i[n], q[n]) * windowValue(window, n, width);
+
+    std::vector<std::complex<double>> twiddles(width);
+    for(size_t n = 0; n < width; n++)
+        twiddles[n] = std::polar(1.0, -2 * pi * n / width);
+
+    spectrum.resize(width);
+    double const fullScaleDb = 20 * std::log10(width / 2.0);
+    for(size_t index = 0; index < width; index++)
+    {
+        size_t const k = (width / 2 - index) & (width - 1);
+        std::complex<double> sum = 0;
+        for(size_t n = 0; n < width; n++)
+            sum += samples[n] * twiddles[(k * n) % width];
+        spectrum[index] = 10 * std::log10(std::norm(sum)) - fullScaleDb;
+    }
+}
+
+char const* windowName(FftWindow window)
+{
+    switch(window)
+    {
+    case FftWindow::Rectangular:
+        return "rectangular";
+    case FftWindow::Hann:
+        return "hann";
+    case FftWindow::Hamming:
+        return "hamming";
+    case FftWindow::BlackmanHarris:
+        return "blackman-harris";
+    }
+    return "?";
+}
+
+template <uint16_t Width>
+bool check(Options const& options)
+{
+    constexpr size_t hop = Width / 4;
+    constexpr size_t compareEvery = 8; // the direct DFT is slow, every frame is only checked for its peak
+    double const maxFrequency = sampleRate / 8;
+
+    std::vector<float> i, q;
+    chirp(16 * Width, maxFrequency, i, q);
+    size_t const frames = 1 + (i.size() - Width) / hop;
+
+    bool ok = true;
+    auto const fft = std::unique_ptr<IqFft<Width>>(new IqFft<Width>());
+    for(auto window : {FftWindow::Rectangular, FftWindow::Hann, FftWindow::Hamming, FftWindow::BlackmanHarris})
+    {
+        fft->setWindow(window);
+        fft->setHop(hop);
+
+        double maxError = 0;
+        size_t misplacedPeaks = 0;
+        std::vector<float> spectrum(Width);
+        std::vector<double> reference;
+        size_t frame = 0;
+        // pushed hop by hop, so every spectrum can be checked before the next one overwrites it
+        for(size_t start = 0; start + hop <= i.size(); start += hop)
+        {
+            if(fft->push(&i[start], &q[start], hop, spectrum.data()) == 0)
+                continue;
+
+            size_t const first = frame * hop;
+            size_t peakIndex = 0;
+            for(size_t bin = 0; bin < Width; bin++)
+                if(spectrum[bin] > spectrum[peakIndex])
+                    peakIndex = bin;
+
+            // the frequency in the middle of the frame as bin of the layout; the sweep within the frame smears the
+            // peak over the bins it passes
+            double slope;
+            double const frequency = chirpFrequency(first + Width / 2.0, i.size(), maxFrequency, &slope);
+            double const expected = Width / 2 - frequency * Width / sampleRate;
+            double const smear = slope * Width * Width / sampleRate / 2;
+            misplacedPeaks += std::abs(double(peakIndex) - expected) > smear + 2;
+
+            if(frame % compareEvery == 0)
+            {
+                referenceSpectrum(&i[first], &q[first], Width, window, reference);
+                double peak = reference[0];
+                for(size_t bin = 0; bin < Width; bin++)
+                    peak = std::max(peak, reference[bin]);
+
+                // bins far below the peak are dominated by the float rounding of the FFT input
+                for(size_t bin = 0; bin < Width; bin++)
+                    if(reference[bin] > peak - 90)
+                        maxError = std::max(maxError, double(std::abs(spectrum[bin] - reference[bin])));
+            }
+            frame++;
+        }
+
+        bool const passed = frame == frames && maxError <= options.tolerance && misplacedPeaks == 0;
+        std::printf(
+            "%4u point %-15s %zu spectra, max error %.4f dB, misplaced peaks %zu%s\n",
+            unsigned(Width),
+            windowName(window),
+            frame,
+            maxError,
+            misplacedPeaks,
+            passed ? "" : "  FAILED");
+        ok = ok && passed;
+    }
+    return ok;
+}
+
+template <uint16_t Width>
+void benchmark(Options const& options)
+{
+    std::vector<float> i, q;
+    chirp(size_t(options.seconds * sampleRate), sampleRate / 8, i, q);
+
+    auto const fft = std::unique_ptr<IqFft<Width>>(new IqFft<Width>());
+    std::vector<float> spectrum(Width);
+    for(size_t overlap = 1; overlap <= 8; overlap *= 2)
+    {
+        fft->setHop(Width / overlap);
+        uint32_t const before = fft->spectrumCount();
+        auto const begin = std::chrono::steady_clock::now();
+        for(size_t start = 0; start + blockSize <= i.size(); start += blockSize)
+            fft->push(&i[start], &q[start], blockSize, spectrum.data());
+        double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        uint32_t const spectra = fft->spectrumCount() - before;
+        std::printf(
+            "%4u point hop %4u (%3.0f %% overlap) %7.1f spectra/s signal %9.0f spectra/s processing %6.2f %% of "
+            "realtime\n",
+            unsigned(Width),
+            unsigned(Width / overlap),
+            100.0 * (overlap - 1) / overlap,
+            spectra / options.seconds,
+            spectra / seconds,
+            100 * seconds / options.seconds);
+    }
+}
+/// the largest error of FastLog against double precision; false if powerToDb is off by more than the tolerance
+bool checkFastLog(Options const& options)
+{
+    double maxDbError = 0;
+    float worstPower = 0;
+    auto const compare = [&](uint32_t bits) {
+        float power;
+        std::memcpy(&power, &bits, 4);
+        double const error = std::abs(FastLog::powerToDb(power) - 10 * std::log10(double(power)));
+        if(error > maxDbError)
+        {
+            maxDbError = error;
+            worstPower = power;
+        }
+    };
+    // every mantissa around full scale and at the levels of the noise floor, then all normal floats with a stride
+    for(uint32_t exponent : {126u, 127u, 128u, 127u - 33u, 127u - 40u})
+        for(uint32_t mantissa = 0; mantissa < (1u << 23); mantissa++)
+            compare(exponent << 23 | mantissa);
+    for(uint64_t bits = 1u << 23; bits < 0x7f800000u; bits += 997)
+        compare(uint32_t(bits));
+
+    double maxPowerError = 0;
+    for(double db = -370; db <= 380; db += 0.001)
+    {
+        double const exact = std::pow(10.0, db / 10);
+        maxPowerError = std::max(maxPowerError, std::abs(FastLog::dbToPower(float(db)) / exact - 1));
+    }
+
+    bool const passed = maxDbError <= options.logTolerance && FastLog::powerToDb(0) == FastLog::minimumDb &&
+                        FastLog::dbToPower(-400) == 0;
+    std::printf("powerToDb max error %.6f dB (at %g), dbToPower max relative error %.2g%s\n",
+                maxDbError,
+                worstPower,
+                maxPowerError,
+                passed ? "" : "  FAILED");
+    return passed;
+}
+
+/// both paths of the analysis on the chirp: the same spectrum within the tolerance of FastLog, and the time per frame
+template <class Layout>
+bool compareAnalysis(Options const& options)
+{
+    constexpr uint16_t width = Layout::fftWidth;
+    using Results = AudioResults<Layout>;
+    using NoiseFloor = NoiseFloorEstimator<Layout>;
+    float const threshold = 8;
+
+    std::vector<float> i, q;
+    chirp(size_t(options.seconds * sampleRate), sampleRate / 8, i, q);
+    size_t const frames = (i.size() - width) / Layout::fftHop;
+
+    auto const fft = std::unique_ptr<IqFft<width>>(new IqFft<width>());
+    std::unique_ptr<Results> results[2] = {std::unique_ptr<Results>(new Results()),
+                                           std::unique_ptr<Results>(new Results())};
+    std::unique_ptr<NoiseFloor> noiseFloors[2] = {std::unique_ptr<NoiseFloor>(new NoiseFloor()),
+                                                  std::unique_ptr<NoiseFloor>(new NoiseFloor())};
+    std::vector<float> spectrum(width);
+
+    double seconds[2] = {};
+    double maxError = 0;
+    size_t signalBins[2] = {};
+    for(size_t frame = 0; frame < frames; frame++)
+    {
+        size_t const first = frame * Layout::fftHop;
+        for(size_t path = 0; path < 2; path++)
+        {
+            fft->setOutput(path == 0 ? FftOutput::Dbfs : FftOutput::Power);
+            auto const begin = std::chrono::steady_clock::now();
+            fft->transform(&i[first], &q[first], spectrum.data());
+            if(path == 0)
+                results[path]->process(spectrum.data(), *noiseFloors[path], threshold);
+            else
+                results[path]->processPower(spectrum.data(), *noiseFloors[path], threshold);
+            seconds[path] += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            signalBins[path] += results[path]->bins_with_signal + results[path]->bins_with_signal_reverse;
+        }
+        for(size_t bin = 0; bin < Results::numberOfFftBins; bin++)
+            maxError = std::max(maxError, double(std::abs(results[0]->spectrum[bin] - results[1]->spectrum[bin])));
+    }
+
+    bool const passed = maxError <= options.logTolerance + 1e-4; // float rounding of the two paths
+    std::printf(
+        "%4u point %s analysis: dBFS %.2f us/frame, linear power %.2f us/frame (%.0f %%), spectrum max difference "
+        "%.6f dB, bins with signal %zu / %zu%s\n",
+        unsigned(width),
+        Layout::iqMeasurement ? "IQ" : "real",
+        1e6 * seconds[0] / frames,
+        1e6 * seconds[1] / frames,
+        100 * seconds[1] / seconds[0],
+        maxError,
+        signalBins[0],
+        signalBins[1],
+        passed ? "" : "  FAILED");
+    return passed;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--seconds")
+            options.seconds = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--tolerance")
+            options.tolerance = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--log-tolerance")
+            options.logTolerance = std::atof(argv[++i]);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--seconds 20] [--tolerance 0.05] [--log-tolerance 0.0002]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = check<256>(options);
+    ok = check<512>(options) && ok;
+    ok = check<1024>(options) && ok;
+    ok = check<2048>(options) && ok;
+
+    benchmark<256>(options);
+    benchmark<512>(options);
+    benchmark<1024>(options);
+    benchmark<2048>(options);
+
+    ok = checkFastLog(options) && ok;
+    ok = compareAnalysis<SpectrumLayout<1024, true>>(options) && ok;
+    ok = compareAnalysis<SpectrumLayout<1024, false>>(options) && ok;
+
+    return ok ? 0 : 2;
+}
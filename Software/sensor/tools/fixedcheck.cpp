@@ -0,0 +1,301 @@
+// Compares the fixed point FFT stage (IqFftFixed, CITRAD_FIXED_POINT) with the float one (IqFft) on the same 16 bit
+// samples, as the codec delivers them to either audio graph, and reports what the fixed point costs.
+//
+// The synthetic input is the Doppler chirp of a passing vehicle at a few levels over noise at the level of the radar
+// noise floor (about -107 dBFS per bin), seen through an IQ imbalance (--alpha, --psi) that both paths correct: the
+// float path like the gain and mixer blocks of the float graph, the fixed path with IqFftFixed::setCorrection. With
+// --samples a recording of the line input is used instead (16 bit little endian, I and Q interleaved, e.g. the data of
+// a stereo wav file), corrected the same way.
+//
+// Per input the tool prints the largest difference of the bins 20 dB or more over the noise floor, the median level of
+// the analysed bins (the noise floor) and the SNR (peak over that median) of both paths, the SNR loss, and in how
+// many frames the strongest peak of a direction the analysis (AudioResults) hands to the tracker is more than one bin
+// apart in the two paths, counting the frames where it is 6 dB or more over the threshold in one of them. The host
+// time per spectrum of both paths is printed as well; it says little about the Cortex-M7. The tool fails with exit code 2 if the SNR loss exceeds --max-loss dB or more than --max-mismatch of
+// the frames with such peaks differ.
+//
+// usage: fixedcheck [--seconds 20] [--samples FILE] [--alpha 1.10] [--psi -0.04] [--max-loss 0.1]
+//                   [--max-mismatch 0.01]
+
+#include "../AudioResults.h"
+#include "../IqFft.h"
+#include "../IqFftFixed.h"
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Layout = DefaultSpectrumLayout;
+using Results = AudioResults<Layout>;
+using NoiseFloor = NoiseFloorEstimator<Layout>;
+using Clock = std::chrono::steady_clock;
+
+constexpr double pi = 3.14159265358979323846;
+constexpr uint16_t width = Layout::fftWidth;
+constexpr size_t blockSize = 128; // AUDIO_BLOCK_SAMPLES
+constexpr float threshold = 8;    // AudioSystem::Config::noise_floor_distance_threshold
+constexpr float peakMargin = 6;   // peaks closer to the threshold come and go with the noise of either path
+
+struct Options
+{
+    double seconds = 20;
+    std::string samples;
+    float alpha = 1.10f;
+    float psi = -0.04f;
+    double maxLoss = 0.1;
+    double maxMismatch = 0.01;
+};
+
+/// the correction of AudioSystem::updateIQ
+struct Correction
+{
+    float a, c, d;
+};
+
+Correction correction(Options const& options)
+{
+    return {1 / options.alpha,
+            -std::sin(options.psi) / (options.alpha * std::cos(options.psi)),
+            1 / std::cos(options.psi)};
+}
+
+int16_t toSample(double value)
+{
+    return int16_t(std::lrint(std::min(32767.0, std::max(-32768.0, value * 32768))));
+}
+
+/// a vehicle passing at amplitude (1 is full scale) in noise, through the IQ imbalance the correction undoes
+void chirp(Options const& options, double amplitude, std::vector<int16_t>& i, std::vector<int16_t>& q)
+{
+    size_t const count = size_t(options.seconds * Layout::sampleRate);
+    double const maxFrequency = Layout::sampleRate / 8.0;
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, 8e-5); // about the noise floor of the radar
+
+    i.resize(count);
+    q.resize(count);
+    double phase = 0;
+    for(size_t n = 0; n < count; n++)
+    {
+        phase += 2 * pi * maxFrequency * std::tanh(6 * (0.5 - double(n) / count)) / Layout::sampleRate;
+        double const signalI = amplitude * std::cos(phase) + noise(random);
+        double const signalQ = amplitude * std::sin(phase) + noise(random);
+        i[n] = toSample(options.alpha * signalI);
+        q[n] = toSample(std::sin(options.psi) * signalI + std::cos(options.psi) * signalQ);
+    }
+}
+
+bool readSamples(std::string const& name, std::vector<int16_t>& i, std::vector<int16_t>& q)
+{
+    std::ifstream input(name, std::ios::binary);
+    if(not input)
+        return false;
+    std::vector<uint8_t> const data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    size_t const count = data.size() / 4;
+    i.resize(count);
+    q.resize(count);
+    for(size_t n = 0; n < count; n++)
+    {
+        i[n] = int16_t(data[4 * n] | data[4 * n + 1] << 8);
+        q[n] = int16_t(data[4 * n + 2] | data[4 * n + 3] << 8);
+    }
+    return true;
+}
+
+/// median and highest level of the analysed bins
+void levels(float const* spectrum, std::vector<float>& scratch, double& median, double& peak)
+{
+    scratch.assign(spectrum + Layout::minBinIndex, spectrum + Layout::maxBinIndex);
+    std::nth_element(scratch.begin(), scratch.begin() + scratch.size() / 2, scratch.end());
+    median = scratch[scratch.size() / 2];
+    peak = *std::max_element(spectrum + Layout::minBinIndex, spectrum + Layout::maxBinIndex);
+}
+
+/// the strongest peak of a direction as handed to the tracker, strength 0 without peak
+Tracking::Detection strongest(Results const& results, bool reverse)
+{
+    Tracking::Detection peaks[Tracking::maxPeaks];
+    Tracking::Detection best;
+    size_t const count = results.detections(reverse, peaks);
+    for(size_t n = 0; n < count; n++)
+        if(peaks[n].strength > best.strength)
+            best = peaks[n];
+    return best;
+}
+
+/// both paths on the samples; false if the fixed point path is off by more than the options allow
+bool compare(char const* name, std::vector<int16_t> const& i, std::vector<int16_t> const& q, Options const& options)
+{
+    Correction const iq = correction(options);
+    auto const floatFft = std::unique_ptr<IqFft<width>>(new IqFft<width>());
+    auto const fixedFft = std::unique_ptr<IqFftFixed<width>>(new IqFftFixed<width>());
+    floatFft->setHop(Layout::fftHop);
+    fixedFft->setHop(Layout::fftHop);
+    fixedFft->setCorrection(iq.a, iq.c, iq.d);
+
+    std::unique_ptr<Results> results[2] = {std::unique_ptr<Results>(new Results()),
+                                           std::unique_ptr<Results>(new Results())};
+    std::unique_ptr<NoiseFloor> noiseFloors[2] = {std::unique_ptr<NoiseFloor>(new NoiseFloor()),
+                                                  std::unique_ptr<NoiseFloor>(new NoiseFloor())};
+    for(auto& noiseFloor : noiseFloors)
+        noiseFloor->adaptRate = 1.0f / (1000 * Layout::fftOverlap);
+
+    std::vector<float> spectra[2] = {std::vector<float>(width), std::vector<float>(width)};
+    std::vector<float> blockI(blockSize);
+    std::vector<float> blockQ(blockSize);
+    std::vector<float> scratch;
+    double floorSums[2] = {};
+    double snrSums[2] = {};
+    double maxDifference = 0;
+    size_t frames = 0;
+    size_t framesWithPeaks = 0;
+    size_t mismatches = 0;
+    double seconds[2] = {};
+
+    for(size_t start = 0; start + blockSize <= i.size(); start += blockSize)
+    {
+        // the float graph: samples as floats, corrected by gain and mixer
+        for(size_t n = 0; n < blockSize; n++)
+        {
+            float const sampleI = i[start + n] / 32768.0f;
+            float const sampleQ = q[start + n] / 32768.0f;
+            blockI[n] = iq.a * sampleI;
+            blockQ[n] = iq.c * sampleI + iq.d * sampleQ;
+        }
+        auto const floatStart = Clock::now();
+        size_t const floatCompleted = floatFft->push(blockI.data(), blockQ.data(), blockSize, spectra[0].data());
+        auto const fixedStart = Clock::now();
+        size_t const fixedCompleted = fixedFft->push(&i[start], &q[start], blockSize, spectra[1].data());
+        auto const end = Clock::now();
+        seconds[0] += std::chrono::duration<double>(fixedStart - floatStart).count();
+        seconds[1] += std::chrono::duration<double>(end - fixedStart).count();
+        if(floatCompleted != 1 or fixedCompleted != 1)
+            continue; // with a hop below the block size only the last spectrum of a block is kept
+
+        double medians[2];
+        for(size_t path = 0; path < 2; path++)
+        {
+            double peak;
+            levels(spectra[path].data(), scratch, medians[path], peak);
+            floorSums[path] += medians[path];
+            snrSums[path] += peak - medians[path];
+            results[path]->process(spectra[path].data(), *noiseFloors[path], threshold);
+        }
+        // noise bins differ by the rounding noise, only bins with signal are compared
+        for(size_t bin = Layout::minBinIndex; bin < Layout::maxBinIndex; bin++)
+            if(spectra[0][bin] > medians[0] + 20)
+                maxDifference = std::max(maxDifference, double(std::abs(spectra[0][bin] - spectra[1][bin])));
+
+        bool clear = false;
+        bool differ = false;
+        for(bool reverse : {false, true})
+        {
+            Tracking::Detection const reference = strongest(*results[0], reverse);
+            Tracking::Detection const fixed = strongest(*results[1], reverse);
+            if(std::max(reference.strength, fixed.strength) < threshold + peakMargin)
+                continue;
+            clear = true;
+            differ = differ or std::abs(reference.speed - fixed.speed) > Layout::speedConversion * 1.5f;
+        }
+        framesWithPeaks += clear;
+        mismatches += differ;
+        frames++;
+    }
+    if(frames == 0)
+    {
+        std::printf("%-14s too short for a spectrum\n", name);
+        return false;
+    }
+
+    double const loss = (snrSums[0] - snrSums[1]) / frames;
+    double const mismatchShare = framesWithPeaks > 0 ? double(mismatches) / framesWithPeaks : 0;
+    bool const passed = loss <= options.maxLoss and mismatchShare <= options.maxMismatch;
+    std::printf(
+        "%-14s %zu spectra, max difference %.3f dB, floor %.2f / %.2f dBFS, SNR %.2f / %.2f dB, loss %.3f dB, "
+        "peaks differ in %zu of %zu frames, %.1f / %.1f us per spectrum%s\n",
+        name,
+        frames,
+        maxDifference,
+        floorSums[0] / frames,
+        floorSums[1] / frames,
+        snrSums[0] / frames,
+        snrSums[1] / frames,
+        loss,
+        mismatches,
+        framesWithPeaks,
+        seconds[0] * 1e6 / frames,
+        seconds[1] * 1e6 / frames,
+        passed ? "" : " FAILED");
+    return passed;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--seconds")
+            options.seconds = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--samples")
+            options.samples = argv[++i];
+        else if(i + 1 < argc && option == "--alpha")
+            options.alpha = float(std::atof(argv[++i]));
+        else if(i + 1 < argc && option == "--psi")
+            options.psi = float(std::atof(argv[++i]));
+        else if(i + 1 < argc && option == "--max-loss")
+            options.maxLoss = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--max-mismatch")
+            options.maxMismatch = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(
+                stderr,
+                "usage: %s [--seconds 20] [--samples FILE] [--alpha 1.10] [--psi -0.04] [--max-loss 0.1] "
+                "[--max-mismatch 0.01]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf(
+        "%u point FFT%s, hop %u, float / fixed point\n",
+        unsigned(width),
+        Layout::iqMeasurement ? " (IQ)" : "",
+        unsigned(Layout::fftHop));
+
+    bool passed = true;
+    std::vector<int16_t> i, q;
+    if(not options.samples.empty())
+    {
+        if(not readSamples(options.samples, i, q))
+        {
+            std::fprintf(stderr, "Unable to open %s\n", options.samples.c_str());
+            return 1;
+        }
+        passed = compare(options.samples.c_str(), i, q, options);
+    }
+    else
+    {
+        for(double dbfs : {-6.0, -40.0, -70.0})
+        {
+            chirp(options, std::pow(10, dbfs / 20), i, q);
+            std::string const name = "chirp " + std::to_string(int(dbfs)) + " dBFS";
+            passed = compare(name.c_str(), i, q, options) and passed;
+        }
+    }
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,155 @@
+// Checks the sharing of FramePool.h: random cycles of acquire, filling the frame, copying, moving and dropping
+// handles, like a producer with consumers that keep their frames for a while. A frame that is still held must never be
+// handed out again or change, acquire() may only fail once every frame is held and the statistics have to count
+// what happened. The pools of 1, 2 and 4 frames are checked; the first is the one of sensor.ino, where every consumer
+// is done with the frame before the next one is acquired.
+//
+// The tool fails with exit code 2 at the first violation.
+//
+// usage: framepoolcheck [--cycles 20000] [--seed 1]
+
+#include "../FramePool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    size_t cycles = 20000;
+    unsigned seed = 1;
+};
+
+/// every word carries the number of the cycle that filled the frame
+struct Frame
+{
+    uint32_t words[256];
+};
+
+void fill(Frame& frame, uint32_t stamp)
+{
+    for(size_t i = 0; i < sizeof(frame.words) / sizeof(frame.words[0]); i++)
+        frame.words[i] = stamp * 2654435761u + i;
+}
+
+bool unchanged(Frame const& frame, uint32_t stamp)
+{
+    for(size_t i = 0; i < sizeof(frame.words) / sizeof(frame.words[0]); i++)
+        if(frame.words[i] != stamp * 2654435761u + i)
+            return false;
+    return true;
+}
+
+/// a handle of a consumer with the cycle its frame was filled in
+struct Held
+{
+    FrameRef<Frame> ref;
+    uint32_t stamp;
+};
+
+template <size_t Capacity>
+bool check(Options const& options)
+{
+    static FramePool<Frame, Capacity> pool;
+    std::mt19937 random(options.seed);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::vector<Held> consumers;
+    uint32_t acquired = 0;
+    uint32_t exhausted = 0;
+    size_t maxInUse = 0;
+
+    auto const fail = [](size_t cycle, char const* what) {
+        std::printf("%zu frames, cycle %zu: %s\n", Capacity, cycle, what);
+        return false;
+    };
+
+    for(size_t cycle = 1; cycle <= options.cycles; cycle++)
+    {
+        size_t const heldBefore = pool.inUse();
+        FrameRef<Frame> producer;
+        Frame* const frame = pool.acquire(producer);
+        if(not frame)
+        {
+            exhausted++;
+            if(heldBefore != Capacity || producer)
+                return fail(cycle, "acquire failed with a free frame");
+        }
+        else
+        {
+            for(auto const& held : consumers)
+                if(&*held.ref == frame)
+                    return fail(cycle, "a held frame was handed out again");
+            if(producer.useCount() != 1 || &*producer != frame)
+                return fail(cycle, "the producer is not the only holder of the new frame");
+            acquired++;
+            maxInUse = std::max(maxInUse, heldBefore + 1);
+
+            fill(*frame, uint32_t(cycle));
+            // up to two consumers keep the frame, by copy or by moving the producer's handle
+            if(percent(random) < 40)
+                consumers.push_back(Held{producer, uint32_t(cycle)});
+            if(percent(random) < 20)
+                consumers.push_back(Held{std::move(producer), uint32_t(cycle)});
+        }
+
+        // the consumers finish in any order, a few hand their frame to another one by assignment
+        for(size_t i = 0; i < consumers.size();)
+        {
+            int const action = percent(random);
+            if(action < 30)
+            {
+                consumers[i] = std::move(consumers.back());
+                consumers.pop_back();
+            }
+            else
+            {
+                if(action < 35 && consumers.size() > 1)
+                    consumers[i] = consumers[(i + 1) % consumers.size()];
+                i++;
+            }
+        }
+
+        producer.reset();
+        for(auto const& held : consumers)
+            if(not unchanged(*held.ref, held.stamp))
+                return fail(cycle, "a held frame changed");
+    }
+
+    consumers.clear();
+    auto const& stats = pool.statistics();
+    if(pool.inUse() != 0)
+        return fail(options.cycles, "frames still held after every handle is gone");
+    if(stats.acquired != acquired || stats.exhausted != exhausted || stats.maxInUse != maxInUse)
+        return fail(options.cycles, "wrong statistics");
+    std::printf("%zu frames: %u acquired, %u times every frame held, max in use %zu\n",
+                Capacity, acquired, exhausted, maxInUse);
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--cycles")
+            options.cycles = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--cycles 20000] [--seed 1]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool const ok = check<1>(options) && check<2>(options) && check<4>(options);
+    return ok ? 0 : 2;
+}
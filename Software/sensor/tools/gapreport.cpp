@@ -0,0 +1,270 @@
+// Reports the frames missing in the files of a sensor from their sequence numbers (see FrameClock.h): metrics files
+// (.met, version 2) and compressed raw files (.bin, version 4). Older files have no sequence numbers and are skipped.
+// The arguments are files or directories whose .met and .bin files are read; metrics and raw files are two series,
+// each in the order of the file names, i.e. of their creation.
+//
+// Per file the tool lists the RTC time of its anchor, the sequence range, the frames it holds and the frames missing
+// inside it with the longest gap. Between two files of the same boot it lists the frames missing between them and the
+// drift of the sample clock against the RTC from their anchors; a sequence number that goes back marks a reboot.
+// Raw files written with triggerRawData only hold the frames of events, their gaps are intended.
+//
+// usage: gapreport <file or directory>...
+
+#include "RawFile.h"
+
+#include "../FrameClock.h"
+#include "../MetricsFormat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Series
+{
+    std::string name; // of the file
+    FrameClock::Anchor anchor;
+    std::vector<uint64_t> sequences;
+};
+
+struct Totals
+{
+    size_t frames = 0;
+    uint64_t missing = 0;
+    size_t reboots = 0;
+};
+
+template <typename T>
+T read(uint8_t const* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/// the sequence numbers of a metrics file; false with a message if it has none
+bool readMetrics(std::string const& name, Series& series, std::string& error)
+{
+    std::ifstream input(name, std::ios::binary);
+    std::vector<uint8_t> const file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if(file.size() < 15 || std::memcmp(file.data(), MetricsFormat::magic, sizeof(MetricsFormat::magic)) != 0)
+    {
+        error = "not a metrics file";
+        return false;
+    }
+
+    auto const version = read<uint16_t>(&file[4]);
+    auto const headerSize = read<uint16_t>(&file[6]);
+    auto const recordSize = read<uint16_t>(&file[12]);
+    auto const fieldCount = file[14];
+    if(version < 2 || version > MetricsFormat::version || headerSize > file.size() || recordSize == 0)
+    {
+        error = "metrics file version " + std::to_string(version) + " without sequence numbers";
+        return false;
+    }
+
+    // the anchor follows the field descriptions
+    size_t pos = 15;
+    int offset = -1;
+    for(size_t i = 0; i < fieldCount && pos + 3 <= headerSize; i++)
+    {
+        std::string const field(reinterpret_cast<char const*>(&file[pos + 3]), file[pos + 2]);
+        if(field == "sequence" && MetricsFormat::FieldType(file[pos]) == MetricsFormat::FieldType::UInt64)
+            offset = file[pos + 1];
+        pos += 3 + file[pos + 2];
+    }
+    if(offset < 0 || offset + 8 > recordSize || pos + FrameClock::anchorSize > headerSize)
+    {
+        error = "corrupt metrics header";
+        return false;
+    }
+
+    series.anchor = FrameClock::readAnchor(&file[pos]);
+    for(size_t record = headerSize; record + recordSize <= file.size(); record += recordSize)
+        series.sequences.push_back(read<uint64_t>(&file[record + offset]));
+    return true;
+}
+
+/// the sequence numbers of a raw file; false with a message if it has none
+bool readRaw(std::string const& name, Series& series, std::string& error)
+{
+    RawFile raw;
+    if(not raw.open(name))
+    {
+        error = raw.error();
+        return false;
+    }
+    if(raw.header().version < RawRecord::sequencedVersion)
+    {
+        error = "raw file version " + std::to_string(raw.header().version) + " without sequence numbers";
+        return false;
+    }
+
+    series.anchor = raw.header().anchor;
+    for(size_t i = 0; i < raw.frameCount(); i++)
+        series.sequences.push_back(raw.sequence(i));
+    return true;
+}
+
+std::string formatTime(FrameClock::Time const& time)
+{
+    time_t const seconds = time.seconds;
+    tm utc;
+    gmtime_r(&seconds, &utc);
+    char text[48];
+    size_t const length = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &utc);
+    std::snprintf(text + length, sizeof(text) - length, ".%06u UTC", unsigned(time.micros));
+    return text;
+}
+
+double seconds(FrameClock::Time const& time)
+{
+    return time.seconds + time.micros * 1e-6;
+}
+
+/// seconds the sample clock takes for the given number of hops
+double duration(FrameClock::Anchor const& anchor, uint64_t frames)
+{
+    return anchor.sampleRate > 0 ? double(frames) * anchor.hop / anchor.sampleRate : 0;
+}
+
+/// the files of one series, each compared with the one before
+void report(std::vector<Series> const& files, Totals& totals)
+{
+    Series const* previous = nullptr;
+    for(auto const& file : files)
+    {
+        auto const& anchor = file.anchor;
+        auto const& sequences = file.sequences;
+        if(previous && not sequences.empty() && not previous->sequences.empty())
+        {
+            uint64_t const last = previous->sequences.back();
+            if(sequences.front() <= last)
+            {
+                std::printf("  -- sequence goes back, the sensor restarted\n");
+                totals.reboots++;
+            }
+            else
+            {
+                uint64_t const missing = sequences.front() - last - 1;
+                totals.missing += missing;
+
+                // the sample clock predicts the anchor of this file from the one of the previous file
+                double const predicted = seconds(previous->anchor.time) +
+                                         FrameClock::secondsSince(previous->anchor, anchor.sequence);
+                double const elapsed = seconds(anchor.time) - seconds(previous->anchor.time);
+                std::printf("  -- %llu frames missing in between (%.3f s)",
+                            (unsigned long long)missing,
+                            duration(anchor, missing));
+                if(elapsed > 0)
+                    std::printf(", sample clock %+.1f ppm against the RTC",
+                                (predicted - seconds(anchor.time)) / elapsed * 1e6);
+                std::printf("\n");
+            }
+        }
+
+        uint64_t missing = 0;
+        uint64_t longest = 0;
+        size_t backwards = 0;
+        for(size_t i = 1; i < sequences.size(); i++)
+        {
+            if(sequences[i] <= sequences[i - 1])
+            {
+                backwards++;
+                continue;
+            }
+            uint64_t const gap = sequences[i] - sequences[i - 1] - 1;
+            missing += gap;
+            longest = std::max(longest, gap);
+        }
+        totals.frames += sequences.size();
+        totals.missing += missing;
+
+        std::printf("%s: anchor %s at sequence %llu\n",
+                    file.name.c_str(),
+                    formatTime(anchor.time).c_str(),
+                    (unsigned long long)anchor.sequence);
+        if(sequences.empty())
+            std::printf("  no frames\n");
+        else
+            std::printf("  sequence %llu to %llu, %zu frames, %llu missing, longest gap %llu frames (%.1f ms), %zu out "
+                        "of order\n",
+                        (unsigned long long)sequences.front(),
+                        (unsigned long long)sequences.back(),
+                        sequences.size(),
+                        (unsigned long long)missing,
+                        (unsigned long long)longest,
+                        duration(anchor, longest) * 1e3,
+                        backwards);
+        previous = &file;
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <file or directory>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> metricsNames;
+    std::vector<std::string> rawNames;
+    for(int i = 1; i < argc; i++)
+    {
+        std::error_code error;
+        std::vector<std::filesystem::path> paths;
+        if(std::filesystem::is_directory(argv[i], error))
+        {
+            for(auto const& entry : std::filesystem::directory_iterator(argv[i], error))
+                if(entry.is_regular_file())
+                    paths.push_back(entry.path());
+        }
+        else
+            paths.push_back(argv[i]);
+
+        for(auto const& path : paths)
+        {
+            if(path.extension() == ".met")
+                metricsNames.push_back(path.string());
+            else if(path.extension() == ".bin")
+                rawNames.push_back(path.string());
+        }
+    }
+    std::sort(metricsNames.begin(), metricsNames.end());
+    std::sort(rawNames.begin(), rawNames.end());
+
+    Totals totals;
+    for(bool const metrics : {true, false})
+    {
+        std::vector<Series> files;
+        for(auto const& name : metrics ? metricsNames : rawNames)
+        {
+            Series series;
+            series.name = name;
+            std::string error;
+            if(metrics ? readMetrics(name, series, error) : readRaw(name, series, error))
+                files.push_back(std::move(series));
+            else
+                std::cerr << name << ": " << error << ", skipped" << std::endl;
+        }
+        report(files, totals);
+    }
+
+    uint64_t const expected = totals.frames + totals.missing;
+    std::printf("%zu frames, %llu missing (%.3f %%), %zu restarts\n",
+                totals.frames,
+                (unsigned long long)totals.missing,
+                expected > 0 ? 100.0 * totals.missing / expected : 0.0,
+                totals.reboots);
+    return 0;
+}
@@ -0,0 +1,292 @@
+// Replays the spectra of an IQ raw file (any raw file version, see RawFile.h) through the analysis of the sensor and
+// the passage tracker (see Tracking.h) twice, without and with the ghost suppression of GhostSuppression.h, and
+// reports what the suppression removed. It is the sensor-side version of subtract_ghost_signal.qmd: run it on the
+// Nordring recording (rawdata_2024-3-29_12-8-50.BIN) with --first 19584 --count 1001 for the window of the slides.
+//
+// A passage counts as mirrored if a stronger passage in the other direction overlaps it in time with a median speed
+// at most --speed-tolerance m/s apart: the ghost of that passage. Per pass the tool prints the passages and the
+// mirrored ones per direction, the bins with signal per direction summed over all frames and the time per frame of the
+// analysis; then the ratio the suppression ended with. It fails with exit code 2 if more than --tolerance passages
+// without a mirror and at least --min-strength dB over the noise floor are lost with the suppression (no passage in the
+// same direction overlaps them any more; the weaker ones come and go with the noise), or if more than --max-ghosts
+// mirrored passages are left.
+//
+// --ratio is the start value of the ghost ratio in dB (ghost_ratio), --fixed keeps it instead of estimating it from
+// the strong targets (ghost_adaptive).
+//
+// usage: ghostreplay <input.bin> [--float | --bytes] [--first 0] [--count N] [--threshold 8] [--ratio -25] [--fixed]
+//                    [--speed-tolerance 2] [--min-strength 20] [--tolerance 0] [--max-ghosts 0]
+
+#include "RawFile.h"
+
+#include "../AudioResults.h"
+#include "../GhostSuppression.h"
+#include "../SpectrumLayout.h"
+#include "../Tracking.h"
+#include "../noise_floor.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr float emptyBin = -120; // dBFS of the FFT bins outside of the recorded range
+
+struct Options
+{
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    size_t first = 0;
+    size_t count = SIZE_MAX;
+    float threshold = 8;
+    float ratio = -25;
+    bool adaptive = true;
+    float speedTolerance = 2;
+    float minStrength = 20;
+    size_t tolerance = 0;
+    size_t maxGhosts = 0;
+};
+
+struct Pass
+{
+    std::vector<Tracking::Event> events;
+    size_t binsWithSignal[2] = {};
+    double seconds = 0;
+    float ratio = 0;
+    uint32_t estimates = 0;
+};
+
+bool overlap(Tracking::Event const& a, Tracking::Event const& b)
+{
+    return a.start <= b.end && b.start <= a.end;
+}
+
+/// a stronger passage in the other direction at the same time and speed
+bool isMirrored(Tracking::Event const& event, std::vector<Tracking::Event> const& events, Options const& options)
+{
+    for(auto const& other : events)
+        if(other.direction != event.direction && overlap(event, other) && other.strength > event.strength &&
+           std::fabs(std::fabs(other.medianSpeed) - std::fabs(event.medianSpeed)) <= options.speedTolerance)
+            return true;
+    return false;
+}
+
+template <class Layout>
+Pass replay(RawFile& raw, Options const& options, bool suppress, size_t& frames)
+{
+    // the results are as large as on the sensor, too large for the stack with the wide layouts
+    auto const results = std::unique_ptr<AudioResults<Layout>>(new AudioResults<Layout>());
+    NoiseFloorEstimator<Layout> noiseFloor;
+    GhostSuppression<Layout> ghosts;
+    typename GhostSuppression<Layout>::Settings settings;
+    settings.ratio = options.ratio;
+    settings.adaptive = options.adaptive;
+    ghosts.setSettings(settings);
+    Tracking::Tracker tracker;
+
+    Pass pass;
+    auto const collect = [&tracker, &pass]() {
+        Tracking::Event event;
+        while(tracker.nextEvent(event))
+            pass.events.push_back(event);
+    };
+
+    // the analysis expects the complete FFT output, the raw file only holds the analysed range
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+    size_t const end = options.count < raw.frameCount() - options.first ? options.first + options.count
+                                                                       : raw.frameCount();
+    frames = 0;
+    for(size_t frame = options.first; frame < end; frame++)
+    {
+        if(not raw.readDbfs(frame, fft.data() + Layout::minBinIndex))
+            continue; // not decodable, the sensor did not write it either
+
+        auto const start = std::chrono::steady_clock::now();
+        results->process(fft.data(), noiseFloor, options.threshold, suppress ? &ghosts : nullptr);
+        pass.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint32_t const timestamp = raw.timestamp(frame);
+        Tracking::Detection forward[Tracking::maxPeaks];
+        Tracking::Detection reverse[Tracking::maxPeaks];
+        tracker.update(
+            timestamp, forward, results->detections(false, forward), reverse, results->detections(true, reverse));
+        collect();
+        pass.binsWithSignal[0] += results->bins_with_signal;
+        pass.binsWithSignal[1] += results->bins_with_signal_reverse;
+        frames++;
+    }
+    tracker.finish();
+    collect();
+    pass.ratio = ghosts.ratio();
+    pass.estimates = ghosts.estimateCount();
+    return pass;
+}
+
+void printPass(char const* name, Pass const& pass, size_t frames, Options const& options)
+{
+    size_t passages[2] = {};
+    size_t mirrored[2] = {};
+    for(auto const& event : pass.events)
+    {
+        size_t const direction = size_t(event.direction);
+        passages[direction]++;
+        mirrored[direction] += isMirrored(event, pass.events, options);
+    }
+    std::printf(
+        "%-8s passages %zu / %zu (mirrored %zu / %zu), bins with signal %zu / %zu, %.2f us per frame\n",
+        name,
+        passages[0],
+        passages[1],
+        mirrored[0],
+        mirrored[1],
+        pass.binsWithSignal[0],
+        pass.binsWithSignal[1],
+        frames > 0 ? pass.seconds * 1e6 / frames : 0.0);
+}
+
+template <class Layout>
+int replay(RawFile& raw, Options const& options)
+{
+    if(not Layout::iqMeasurement)
+    {
+        std::cerr << "Not an IQ recording, there are no ghosts" << std::endl;
+        return 1;
+    }
+
+    size_t frames = 0;
+    Pass const without = replay<Layout>(raw, options, false, frames);
+    Pass const with = replay<Layout>(raw, options, true, frames);
+
+    std::printf("%u point FFT (IQ), %zu frames; forward / reverse:\n", unsigned(Layout::fftWidth), frames);
+    printPass("without", without, frames, options);
+    printPass("with", with, frames, options);
+    std::printf(
+        "ghost ratio %.2f dB (%s, started at %.2f dB, %u estimates)\n",
+        with.ratio,
+        options.adaptive ? "estimated" : "fixed",
+        options.ratio,
+        unsigned(with.estimates));
+
+    // the passages that are no ghost have to survive the suppression
+    size_t lost = 0;
+    for(auto const& event : without.events)
+    {
+        if(event.strength < options.minStrength || isMirrored(event, without.events, options))
+            continue;
+        bool found = false;
+        for(auto const& other : with.events)
+            found = found || (other.direction == event.direction && overlap(event, other));
+        if(not found)
+        {
+            std::printf(
+                "lost: %8u - %8u ms %-7s %5.1f m/s, %5.1f dB\n",
+                event.start,
+                event.end,
+                Tracking::directionName(event.direction),
+                event.medianSpeed,
+                event.strength);
+            lost++;
+        }
+    }
+    size_t ghosts = 0;
+    for(auto const& event : with.events)
+        ghosts += isMirrored(event, with.events, options);
+    std::printf("%zu passages without a mirror lost, %zu mirrored passages left\n", lost, ghosts);
+    return lost <= options.tolerance && ghosts <= options.maxGhosts ? 0 : 2;
+}
+
+template <class... Layouts>
+struct LayoutList
+{};
+
+int replay(RawFile& raw, Options const&, LayoutList<>)
+{
+    std::cerr << "No FFT layout with " << raw.header().binCount << " bins"
+              << (raw.header().iqMeasurement ? " (IQ)" : "") << std::endl;
+    return 1;
+}
+
+/// the file header only has the bin count, which is unique per IQ mode for the default speeds of SpectrumLayout
+template <class Layout, class... Rest>
+int replay(RawFile& raw, Options const& options, LayoutList<Layout, Rest...>)
+{
+    if(Layout::numberOfFftBins == raw.header().binCount && Layout::iqMeasurement == raw.header().iqMeasurement)
+        return replay<Layout>(raw, options);
+    return replay(raw, options, LayoutList<Rest...>());
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> [--float | --bytes] [--first 0] [--count N] [--threshold 8] [--ratio -25] [--fixed]"
+                     " [--speed-tolerance 2] [--min-strength 20] [--tolerance 0] [--max-ghosts 0]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(i + 1 < argc && option == "--first")
+            options.first = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--count")
+            options.count = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--threshold")
+            options.threshold = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--ratio")
+            options.ratio = std::atof(argv[++i]);
+        else if(option == "--fixed")
+            options.adaptive = false;
+        else if(i + 1 < argc && option == "--speed-tolerance")
+            options.speedTolerance = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--min-strength")
+            options.minStrength = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--tolerance")
+            options.tolerance = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--max-ghosts")
+            options.maxGhosts = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], options.layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+    if(options.first >= raw.frameCount())
+    {
+        std::cerr << argv[1] << " has only " << raw.frameCount() << " frames" << std::endl;
+        return 1;
+    }
+
+    return replay(
+        raw,
+        options,
+        LayoutList<
+            SpectrumLayout<256, false>,
+            SpectrumLayout<256, true>,
+            SpectrumLayout<512, false>,
+            SpectrumLayout<512, true>,
+            SpectrumLayout<1024, false>,
+            SpectrumLayout<1024, true>,
+            SpectrumLayout<2048, false>,
+            SpectrumLayout<2048, true>>());
+}
@@ -0,0 +1,271 @@
+// Checks the seek index of raw files (see RawIndex.h) end to end: synthetic spectra go through FileWriter with the
+// Arduino stand-ins of host/ like in sensorreplay, once compressed (8 bit) and once as float, several files each with
+// dropped frames from an SD card that falls behind. The files are written into <dir>, read back with RawFile and every
+// index entry has to point to a record with its timestamp (a key frame in compressed files). Then random seeks with
+// RawFile::seek and next() are compared with a full scan of the file, also with the last index entries cut off (as
+// after a power loss) and with the index of another file.
+//
+// The tool fails with exit code 2 if a seek returns another frame than the scan or reads more records in front of it
+// than the distance between two index entries.
+//
+// usage: indexcheck <dir> [--frames 6000] [--seeks 2000] [--seed 1]
+
+#include "RawFile.h"
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../RawIndex.h"
+#include "../host/HostEnvironment.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::string directory;
+    size_t frames = 6000;
+    size_t seeks = 2000;
+    unsigned seed = 1;
+};
+
+struct Frame
+{
+    uint32_t timestamp;
+    std::vector<float> dbfs;
+};
+
+/// the frames of a file through the access by frame number, which does not use the index
+std::vector<Frame> scan(RawFile& raw)
+{
+    std::vector<Frame> frames;
+    for(size_t i = 0; i < raw.frameCount(); i++)
+    {
+        Frame frame{raw.timestamp(i), std::vector<float>(raw.header().binCount)};
+        if(raw.readDbfs(i, frame.dbfs.data()))
+            frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+/// every entry has to point to a record with its timestamp that can be read on its own
+bool checkEntries(RawFile& raw, std::vector<uint8_t> const& file, std::vector<uint8_t> const& index, size_t& entries)
+{
+    entries = RawIndex::entryCount(index.data(), index.size());
+    size_t frame = 0;
+    for(size_t i = 0; i < entries; i++)
+    {
+        auto const entry = RawIndex::entry(index.data(), i);
+        while(frame < raw.frameCount() && raw.recordOffset(frame) < entry.offset)
+            frame++;
+        if(frame == raw.frameCount() || raw.recordOffset(frame) != entry.offset || raw.timestamp(frame) != entry.timestamp)
+        {
+            std::printf("  entry %zu (%u ms at %u) is not a record\n", i, entry.timestamp, entry.offset);
+            return false;
+        }
+        RawRecord::Record record;
+        bool const keyFrame =
+            RawRecord::parse(file.data(), file.size(), raw.header().version, entry.offset, SIZE_MAX, record) &&
+            (record.flags & RawCompression::KeyFrame);
+        if(raw.layout() == RawFile::Layout::Compressed && not keyFrame)
+        {
+            std::printf("  entry %zu (%u ms) is no key frame\n", i, entry.timestamp);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// random seeks compared with the scan; maxSkipped is the most records next() read in front of a wanted frame
+bool checkSeeks(RawFile& raw, std::vector<Frame> const& frames, size_t seeks, std::mt19937& random, size_t& maxSkipped)
+{
+    maxSkipped = 0;
+    std::uniform_int_distribution<uint32_t> target(0, frames.back().timestamp + 100);
+    std::vector<float> dbfs(raw.header().binCount);
+    for(size_t i = 0; i < seeks; i++)
+    {
+        uint32_t const fromMs = i == 0 ? 0 : target(random);
+        auto const expected = std::lower_bound(
+            frames.begin(), frames.end(), fromMs, [](Frame const& frame, uint32_t ms) { return frame.timestamp < ms; });
+
+        raw.seek(fromMs);
+        uint32_t timestamp = 0;
+        bool const found = raw.next(timestamp, dbfs.data());
+        if(found != (expected != frames.end()) || (found && (timestamp != expected->timestamp || dbfs != expected->dbfs)))
+        {
+            std::printf("  seek to %u ms returned %u ms\n", fromMs, found ? timestamp : 0);
+            return false;
+        }
+        maxSkipped = std::max(maxSkipped, raw.skippedRecords());
+    }
+    return true;
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) override { return std::fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+/// the globals of sensor.ino that are needed for writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+};
+
+/// three files per mode; the card stalls now and then, so the raw ring drops frames
+void record(Sensor& sensor, bool write8bit, Options const& options, std::mt19937& random)
+{
+    auto& results = sensor.results;
+    std::normal_distribution<float> noise(0, 1.5f);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::vector<float> level(results.numberOfFftBins, -90);
+
+    uint32_t now = millis();
+    for(size_t file = 0; file < 3; file++)
+    {
+        HostEnvironment::setTime(1700000000 + (write8bit ? 0 : 86400) + uint32_t(file) * 3600);
+        for(size_t frame = 0; frame < options.frames; frame++)
+        {
+            now += AudioSystem::Layout::framePeriodMicros / 1000 + jitter(random) + (frame % 997 == 0 ? 500 : 0);
+            HostEnvironment::setMillis(now);
+            for(size_t i = 0; i < results.numberOfFftBins; i++)
+            {
+                level[i] = std::min(-20.0f, std::max(-120.0f, level[i] + noise(random)));
+                results.spectrum[i] = level[i];
+            }
+            results.timestamp = now;
+            sensor.fileWriter.writeRawData(results, write8bit, sensor.config);
+
+            bool const stalled = frame % 1500 >= 1300;
+            if(not stalled)
+                sensor.fileWriter.service();
+        }
+        sensor.fileWriter.close(); // the next write opens the next file
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <dir> [--frames 6000] [--seeks 2000] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.directory = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seeks")
+            options.seeks = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    std::mt19937 random(options.seed);
+    sensor.fileWriter.setupSpi();
+    sensor.fileWriter.setupSdCard();
+    record(sensor, true, options, random);
+    record(sensor, false, options, random);
+
+    std::vector<std::string> names;
+    for(auto const& file : HostEnvironment::sdFiles())
+    {
+        if(not writeFile(options.directory + "/" + file.first, *file.second))
+        {
+            std::cerr << "Unable to write into " << options.directory << std::endl;
+            return 1;
+        }
+        if(file.first.size() > 4 && file.first.compare(file.first.size() - 4, 4, ".bin") == 0)
+            names.push_back(file.first.substr(0, file.first.size() - 4));
+    }
+
+    bool ok = true;
+    std::vector<uint8_t> const* previousIndex = nullptr;
+    for(auto const& name : names)
+    {
+        std::string const path = options.directory + "/" + name;
+        auto const& file = *HostEnvironment::sdFiles()[name + ".bin"];
+        auto const& index = *HostEnvironment::sdFiles()[name + ".idx"];
+        RawFile raw;
+        if(not raw.open(path + ".bin"))
+        {
+            std::cerr << raw.error() << std::endl;
+            return 1;
+        }
+        auto const frames = scan(raw);
+        bool const compressed = raw.layout() == RawFile::Layout::Compressed;
+        size_t entries = 0;
+        size_t maxSkipped = 0;
+        bool fileOk = not frames.empty() && checkEntries(raw, file, index, entries) && entries > 0;
+        fileOk = fileOk && checkSeeks(raw, frames, options.seeks, random, maxSkipped);
+        // the records between two entries are read at most, in uncompressed files none
+        size_t const limit = compressed ? std::max(sensor.config.rawKeyFrameInterval, sensor.config.rawIndexInterval) : 0;
+        fileOk = fileOk && maxSkipped <= limit;
+        std::printf(
+            "%s: %s, %zu frames, %zu index entries, %zu seeks, at most %zu records in front of a frame\n",
+            name.c_str(),
+            compressed ? "compressed" : "float",
+            frames.size(),
+            entries,
+            options.seeks,
+            maxSkipped);
+
+        // the last entries lost with the power: still right, the seeks after them only read more records (fewer seeks,
+        // they are slow now)
+        std::vector<uint8_t> truncated(index.begin(), index.begin() + index.size() - index.size() / 3);
+        size_t truncatedSkipped = 0;
+        fileOk = fileOk && writeFile(path + ".idx", truncated) && raw.open(path + ".bin") &&
+                 checkSeeks(raw, frames, options.seeks / 10, random, truncatedSkipped);
+
+        // an index of another file is not taken for this one
+        size_t foreignSkipped = 0;
+        if(previousIndex)
+            fileOk = fileOk && writeFile(path + ".idx", *previousIndex) && raw.open(path + ".bin") &&
+                     checkSeeks(raw, frames, options.seeks / 10, random, foreignSkipped);
+        std::printf(
+            "  index cut to %zu entries: at most %zu records, index of another file: at most %zu records%s\n",
+            RawIndex::entryCount(truncated.data(), truncated.size()),
+            truncatedSkipped,
+            foreignSkipped,
+            fileOk ? "" : ", FAILED");
+
+        writeFile(path + ".idx", index);
+        previousIndex = &index;
+        ok = ok && fileOk;
+    }
+
+    StdoutPrint out;
+    sensor.fileWriter.printStatistics(out);
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,126 @@
+// Prints the RAM plan of the sensor for the layout it was built for (CITRAD_FFT_WIDTH, CITRAD_IQ_MEASUREMENT,
+// CITRAD_FIXED_POINT): the audio block pool as derived from the graph of AudioSystem (see AudioBlockPool.h) against
+// the library FFT analysers and the former fixed pool of 400 blocks, the FFT stage of the audio interrupt in float
+// and in fixed point, and the size of the objects loop() works with. The sizes are the ones of the host build; on the
+// sensor pointers are 4 bytes, so the objects holding pointers are a bit smaller, and the float FFT stage uses the
+// twiddles of CMSIS in flash (FftWidth * 4 bytes less). On the host the audio system replays spectra and holds no
+// FFT stage. The sensor prints its live use with the command m ($memory).
+//
+// The block graph of AudioSystem is a model written next to the audio objects; the tool builds the audio system with
+// the stand-ins of host/, which record the patch cords, and compares the model with the I2S channels and writing
+// stages that are actually connected, and the pool setup() allocates with the one of the plan.
+//
+// The tool fails with exit code 2 if the model differs from the patched graph, setup() allocates another pool or the
+// pool does not hold the blocks the graph needs plus the margin.
+//
+// usage: memoryplan
+
+#include "../AudioBlockPool.h"
+#include "../AudioSystem.h"
+#include "../FileWriter.hpp"
+#include "../FramePool.h"
+#include "../IqFftOutput.h"
+#include "../Profiler.h"
+#include "../SerialIO.hpp"
+#include "../Tracking.h"
+#include "../host/HostEnvironment.h"
+
+#include <cstdio>
+
+namespace
+{
+using Layout = AudioSystem::Layout;
+
+void printPool(char const* name, AudioBlockPool::Graph const& graph, uint16_t margin, size_t blockBytes)
+{
+    uint16_t const blocks = AudioBlockPool::poolBlocks(graph, margin);
+    std::printf(
+        "%-22s %3u blocks needed, %3u in the pool (%6zu bytes)\n",
+        name,
+        unsigned(AudioBlockPool::requiredBlocks(graph)),
+        unsigned(blocks),
+        AudioBlockPool::poolBytes(blocks, blockBytes));
+}
+
+void printSize(char const* name, size_t bytes)
+{
+    std::printf("  %-20s %7zu bytes\n", name, bytes);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc > 1)
+    {
+        std::fprintf(stderr, "usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    auto const& graph = AudioSystem::blockGraph;
+    uint16_t const margin = AudioSystem::Config::audio_block_margin;
+    std::printf(
+        "%u point FFT%s%s, graph: %u input channels, %u writing stages, %u output channels, margin %u blocks\n",
+        unsigned(Layout::fftWidth),
+        Layout::iqMeasurement ? " (IQ)" : "",
+        AudioSystem::fixedPoint ? " in fixed point" : "",
+        unsigned(graph.inputChannels),
+        unsigned(graph.writingStages),
+        unsigned(graph.outputChannels),
+        unsigned(margin));
+    printPool(AudioSystem::fixedPoint ? "IqFftFixed" : "IqFft", graph, margin, AudioSystem::blockBytes);
+    // the library analysers keep the window of both channels in float blocks
+    AudioBlockPool::Graph const libraryGraph = {2, 2, 2, uint16_t(2 * Layout::fftWidth)};
+    printPool("library FFT analyser", libraryGraph, margin, AudioBlockPool::floatBlockBytes);
+    std::printf(
+        "%-22s %3u blocks reserved, %3u usable    (%6zu bytes)\n",
+        "former fixed pool",
+        400u,
+        unsigned(AudioBlockPool::maxBlocks),
+        AudioBlockPool::poolBytes(400, AudioBlockPool::floatBlockBytes));
+
+    std::printf("FFT stage of the audio interrupt:\n");
+    printSize("float", sizeof(IqFftOutput<Layout::fftWidth>));
+    printSize("fixed point", sizeof(IqFftOutput<Layout::fftWidth, IqFftFixed<Layout::fftWidth>>));
+    std::printf("objects of loop():\n");
+    printSize("audio system", sizeof(AudioSystem));
+    printSize("  of it noise floor", sizeof(AudioSystem::NoiseFloor));
+    printSize("frame pool", sizeof(FramePool<AudioSystem::Results, 1>));
+    printSize("  of it per frame", sizeof(AudioSystem::Results));
+    printSize("file writer", sizeof(FileWriter));
+    printSize("serial", sizeof(SerialIO));
+    printSize("tracker", sizeof(Tracking::Tracker));
+    printSize("profiler", sizeof(Profiler));
+
+    bool ok = true;
+    // like on the device the audio system is too large for the stack
+    static AudioSystem audio;
+    audio.setup(AudioSystem::Config());
+    AudioBlockPool::Graph const patched = HostEnvironment::audioGraph();
+    if(patched.inputChannels != graph.inputChannels || patched.writingStages != graph.writingStages ||
+       patched.outputChannels != graph.outputChannels)
+    {
+        std::printf(
+            "the patch cords connect %u input channels, %u writing stages, %u output channels, not the ones of the "
+            "graph\n",
+            unsigned(patched.inputChannels),
+            unsigned(patched.writingStages),
+            unsigned(patched.outputChannels));
+        ok = false;
+    }
+    if(HostEnvironment::audioMemoryBlocks() != AudioSystem::blockPoolSize)
+    {
+        std::printf(
+            "setup() allocates %zu blocks instead of %u\n",
+            HostEnvironment::audioMemoryBlocks(),
+            unsigned(AudioSystem::blockPoolSize));
+        ok = false;
+    }
+
+    uint16_t const required = AudioBlockPool::requiredBlocks(graph);
+    if(AudioSystem::blockPoolSize < required + margin)
+    {
+        std::printf("the pool of %u blocks is smaller than needed\n", unsigned(AudioSystem::blockPoolSize));
+        ok = false;
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,167 @@
+// Converts a binary metrics file (see MetricsFormat.h) into the csv table the sensor used to write.
+//
+// usage: metrics2csv <input.met> [output.csv]
+
+#include "../MetricsFormat.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Column
+{
+    MetricsFormat::FieldType type;
+    uint8_t offset;
+    std::string name;
+};
+
+template <typename T>
+T read(uint8_t const* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/// mirrors Print::printFloat of the Teensy core, so the output matches the old csv files byte by byte
+void printFloat(std::string& out, double number, uint8_t digits = 2)
+{
+    if(std::isnan(number))
+    {
+        out += "nan";
+        return;
+    }
+    if(std::isinf(number))
+    {
+        out += "inf";
+        return;
+    }
+    if(number > 4294967040.0f || number < -4294967040.0f)
+    {
+        out += "ovf";
+        return;
+    }
+
+    if(number < 0.0)
+    {
+        out += '-';
+        number = -number;
+    }
+
+    double rounding = 0.5;
+    for(uint8_t i = 0; i < digits; ++i)
+        rounding *= 0.1;
+    number += rounding;
+
+    unsigned long const intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    out += std::to_string(intPart);
+
+    if(digits > 0)
+        out += '.';
+    while(digits-- > 0)
+    {
+        remainder *= 10.0;
+        uint8_t const n = (uint8_t)remainder;
+        out += char('0' + n);
+        remainder -= n;
+    }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <input.met> [output.csv]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if(not input)
+    {
+        std::cerr << "Unable to open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> const file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    if(file.size() < 15 || std::memcmp(file.data(), MetricsFormat::magic, sizeof(MetricsFormat::magic)) != 0)
+    {
+        std::cerr << argv[1] << " is not a metrics file" << std::endl;
+        return 1;
+    }
+
+    auto const version = read<uint16_t>(&file[4]);
+    auto const headerSize = read<uint16_t>(&file[6]);
+    auto const recordSize = read<uint16_t>(&file[12]);
+    auto const fieldCount = file[14];
+    if(version > MetricsFormat::version || headerSize > file.size())
+    {
+        std::cerr << "Unsupported metrics file version " << version << std::endl;
+        return 1;
+    }
+
+    std::vector<Column> columns;
+    for(size_t pos = 15, i = 0; i < fieldCount; i++)
+    {
+        if(pos + 3 > headerSize || pos + 3 + file[pos + 2] > headerSize)
+        {
+            std::cerr << "Corrupt metrics header" << std::endl;
+            return 1;
+        }
+        Column column{MetricsFormat::FieldType(file[pos]), file[pos + 1], {}};
+        column.name.assign(reinterpret_cast<char const*>(&file[pos + 3]), file[pos + 2]);
+        pos += 3 + file[pos + 2];
+        columns.push_back(column);
+    }
+
+    std::string out;
+    for(size_t i = 0; i < columns.size(); i++)
+        out += (i ? ", " : "") + columns[i].name;
+    out += "\r\n";
+
+    for(size_t pos = headerSize; pos + recordSize <= file.size(); pos += recordSize)
+    {
+        uint8_t const* record = &file[pos];
+        for(size_t i = 0; i < columns.size(); i++)
+        {
+            if(i)
+                out += ", ";
+
+            uint8_t const* value = record + columns[i].offset;
+            switch(columns[i].type)
+            {
+                case MetricsFormat::FieldType::UInt8:
+                    out += std::to_string(*value);
+                    break;
+                case MetricsFormat::FieldType::UInt32:
+                    out += std::to_string(read<uint32_t>(value));
+                    break;
+                case MetricsFormat::FieldType::Float32:
+                    printFloat(out, read<float>(value));
+                    break;
+                case MetricsFormat::FieldType::UInt64:
+                    out += std::to_string(read<uint64_t>(value));
+                    break;
+            }
+        }
+        out += "\r\n";
+    }
+
+    if(argc > 2)
+    {
+        std::ofstream output(argv[2], std::ios::binary);
+        output << out;
+        return output ? 0 : 1;
+    }
+
+    std::cout << out;
+    return 0;
+}
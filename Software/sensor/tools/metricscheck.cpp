@@ -0,0 +1,203 @@
+// Checks that metrics2csv turns a binary metrics file (see MetricsFormat.h) back into the csv table the sensor writes
+// with CsvFormat::printLine: FileWriter writes the same frames as .met and as .csv file with the Arduino stand-ins of
+// host/, both are saved into <dir> and the output of metrics2csv for the .met file has to be byte-identical to the
+// .csv file. Besides random values the frames hold the cases of Print::printFloat: rounding at the second decimal,
+// negative values that round to zero, nan, inf and numbers beyond the range it prints ("ovf").
+//
+// The time FileWriter takes per frame for the binary record (writeMetricsData) and for the csv line (writeCsvData) is
+// measured along the way, the card writes of service() are not part of it.
+//
+// The tool fails with exit code 2 if the tables differ.
+//
+// usage: metricscheck <metrics2csv> <dir> [--frames 2000] [--seed 1]
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../MetricsFormat.h"
+#include "../host/HostEnvironment.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::string converter;
+    std::string directory;
+    size_t frames = 2000;
+    unsigned seed = 1;
+};
+
+/// the globals of sensor.ino that are needed for writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+};
+
+/// values printFloat has to handle like the Teensy core
+float const specialValues[] = {
+    0.0f, -0.0f, 0.005f, 0.015f, 2.675f, -0.004f, -0.005f, 99.995f, 1e-7f, 4294967040.0f, 4294967296.0f, -5e9f,
+    std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(),
+    -std::numeric_limits<float>::infinity(),
+};
+constexpr size_t specialCount = sizeof(specialValues) / sizeof(specialValues[0]);
+
+void fill(AudioSystem::Results& results, size_t frame, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> value(-150, 150);
+    std::uniform_int_distribution<int> bins(0, 255);
+    float* const fields[] = {
+        &results.detected_speed,
+        &results.detected_speed_reverse,
+        &results.amplitudeMax,
+        &results.amplitudeMaxReverse,
+        &results.mean_amplitude,
+        &results.mean_amplitude_reverse,
+        &results.pedestrian_amplitude,
+    };
+    size_t const fieldCount = sizeof(fields) / sizeof(fields[0]);
+    for(size_t i = 0; i < fieldCount; i++)
+        *fields[i] = value(random);
+    // the first frames go through all special values in every column
+    if(frame < specialCount + fieldCount)
+        for(size_t i = 0; i < fieldCount; i++)
+            *fields[i] = specialValues[(frame + i) % specialCount];
+
+    results.bins_with_signal = uint8_t(bins(random));
+    results.bins_with_signal_reverse = uint8_t(frame == 0 ? 255 : bins(random));
+    results.sequence = frame == 1 ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << 40) + frame;
+}
+
+std::string fileWriterFile(char const* extension)
+{
+    for(auto const& file : HostEnvironment::sdFiles())
+        if(file.first.size() > 4 && file.first.compare(file.first.size() - 4, 4, extension) == 0)
+            return file.first;
+    return std::string();
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+bool readFile(std::string const& name, std::vector<uint8_t>& data)
+{
+    std::ifstream input(name, std::ios::binary);
+    if(not input)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <metrics2csv> <dir> [--frames 2000] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.converter = argv[1];
+    options.directory = argv[2];
+    for(int i = 3; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    std::mt19937 random(options.seed);
+    HostEnvironment::setTime(1700000000);
+    uint32_t now = 0;
+    using Clock = std::chrono::steady_clock;
+    Clock::duration metricsTime{};
+    Clock::duration csvTime{};
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        now += AudioSystem::Layout::framePeriodMicros / 1000;
+        HostEnvironment::setMillis(now);
+        fill(sensor.results, frame, random);
+        // the largest timestamp as well, millis() wraps after 49 days
+        sensor.results.timestamp = frame == 2 ? std::numeric_limits<uint32_t>::max() : now;
+        auto const start = Clock::now();
+        sensor.fileWriter.writeMetricsData(sensor.results, sensor.config);
+        auto const between = Clock::now();
+        sensor.fileWriter.writeCsvData(sensor.results, sensor.config);
+        auto const end = Clock::now();
+        metricsTime += between - start;
+        csvTime += end - between;
+        while(sensor.fileWriter.needsService())
+            sensor.fileWriter.service();
+    }
+    sensor.fileWriter.close();
+
+    std::string const metrics = options.directory + "/metrics.met";
+    std::string const csv = options.directory + "/metrics.csv";
+    std::string const converted = options.directory + "/converted.csv";
+    auto const& files = HostEnvironment::sdFiles();
+    std::string const metricsName = fileWriterFile(".met");
+    std::string const csvName = fileWriterFile(".csv");
+    if(metricsName.empty() || csvName.empty() || not writeFile(metrics, *files.at(metricsName)) ||
+       not writeFile(csv, *files.at(csvName)))
+    {
+        std::cerr << "Unable to write into " << options.directory << std::endl;
+        return 1;
+    }
+
+    std::string const command = "\"" + options.converter + "\" \"" + metrics + "\" \"" + converted + "\"";
+    std::vector<uint8_t> expected, result;
+    if(std::system(command.c_str()) != 0 || not readFile(converted, result) || not readFile(csv, expected))
+    {
+        std::cerr << "Unable to run " << command << std::endl;
+        return 1;
+    }
+
+    size_t difference = 0;
+    while(difference < expected.size() && difference < result.size() && expected[difference] == result[difference])
+        difference++;
+    if(expected != result)
+    {
+        size_t line = 1;
+        for(size_t i = 0; i < difference; i++)
+            line += expected[i] == '\n';
+        std::printf("%s differs from %s in line %zu\n", converted.c_str(), csv.c_str(), line);
+        return 2;
+    }
+    std::printf("%zu frames, %zu bytes of csv identical\n", options.frames, expected.size());
+
+    auto const perFrame = [&options](Clock::duration time) {
+        return std::chrono::duration<double, std::nano>(time).count() / options.frames;
+    };
+    std::printf("per frame: binary record %.0f ns (%zu bytes), csv line %.0f ns (%.1f bytes)\n",
+                perFrame(metricsTime),
+                sizeof(MetricsFormat::Record),
+                perFrame(csvTime),
+                double(files.at(csvName)->size()) / options.frames);
+    return 0;
+}
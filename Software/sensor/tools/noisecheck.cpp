@@ -0,0 +1,155 @@
+// Compares the static noise floor table with the adaptive noise floor (see noise_floor.h) like noisereplay, on
+// synthetic recordings of sites that are louder or quieter than the table: the spectrum is global_noiseFloor plus an
+// offset plus noise, with passages of a target through the bins now and then. The offsets cover the cases of the
+// estimator: 0 and +4 dB (below the signal threshold, the moving average follows), +15 dB (above the threshold, only
+// the bounded rise reaches it) and -10 dB.
+//
+// A frame counts as detection if at least 3 bins are more than 8 dB above the noise floor. After the floor had time
+// to settle (the second half of the frames) the adaptive floor has to detect at least 95% of the passage frames and
+// at most 1% of the other frames. The tool fails with exit code 2 otherwise.
+//
+// usage: noisecheck [--frames 6000] [--seed 1]
+
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Layout = SpectrumLayout<1024, true>;
+
+constexpr float threshold = 8;
+constexpr size_t minBins = 3;
+
+struct Options
+{
+    size_t frames = 6000;
+    unsigned seed = 1;
+};
+
+struct Counts
+{
+    size_t passages = 0;    // frames with a passage
+    size_t quiet = 0;       // frames without
+    size_t detected = 0;    // passage frames detected
+    size_t falseAlarms = 0; // quiet frames detected
+};
+
+/// detections of the second half of the frames
+struct Result
+{
+    Counts staticFloor;
+    Counts adaptive;
+    double shift = 0; // mean of adaptive floor - table at the end
+};
+
+Result replay(float offset, Options const& options)
+{
+    std::mt19937 random(options.seed);
+    std::normal_distribution<float> noise(0, 2);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    float staticFloor[Layout::numberOfFftBins];
+    initNoiseFloor(staticFloor, Layout::numberOfFftBins, Layout::fftWidth, Layout::minBinIndex);
+    auto const noiseFloor = std::unique_ptr<NoiseFloorEstimator<Layout>>(new NoiseFloorEstimator<Layout>());
+
+    Result result;
+    std::vector<float> spectrum(Layout::numberOfFftBins);
+    size_t passageFrames = 0;
+    float passageBin = 0;
+    float passageStep = 0;
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        for(size_t i = 0; i < spectrum.size(); i++)
+            spectrum[i] = staticFloor[i] + offset + noise(random);
+
+        // a passage lights a few bins for about 3 s every 20 s on average
+        if(passageFrames == 0 && uniform(random) < 0.004f)
+        {
+            passageFrames = 20 + size_t(uniform(random) * 30);
+            passageBin = 5 + uniform(random) * (spectrum.size() - 10);
+            passageStep = (uniform(random) - 0.5f) * 2;
+        }
+        bool const passage = passageFrames > 0;
+        if(passage)
+        {
+            passageFrames--;
+            passageBin = std::min(float(spectrum.size() - 3), std::max(2.0f, passageBin + passageStep));
+            size_t const center = size_t(passageBin);
+            for(size_t i = center - 2; i <= center + 2; i++)
+                spectrum[i] += 20 - 6 * float(i > center ? i - center : center - i);
+        }
+
+        size_t staticBins = 0;
+        size_t adaptiveBins = 0;
+        for(size_t i = 0; i < spectrum.size(); i++)
+        {
+            staticBins += spectrum[i] - staticFloor[i] > threshold;
+            adaptiveBins += noiseFloor->update(i, spectrum[i], threshold) > threshold;
+        }
+        noiseFloor->finishFrame();
+
+        if(frame < options.frames / 2)
+            continue;
+        for(auto* counts : {&result.staticFloor, &result.adaptive})
+        {
+            bool const detected = (counts == &result.adaptive ? adaptiveBins : staticBins) >= minBins;
+            (passage ? counts->passages : counts->quiet)++;
+            (passage ? counts->detected : counts->falseAlarms) += detected;
+        }
+    }
+
+    for(size_t i = 0; i < Layout::numberOfFftBins; i++)
+        result.shift += (*noiseFloor)[i] - staticFloor[i];
+    result.shift /= Layout::numberOfFftBins;
+    return result;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--frames 6000] [--seed 1]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    for(float offset : {0.0f, 4.0f, 15.0f, -10.0f})
+    {
+        Result const result = replay(offset, options);
+        auto const& s = result.staticFloor;
+        auto const& a = result.adaptive;
+        bool const passed = a.detected >= 0.95 * a.passages && a.falseAlarms <= 0.01 * a.quiet;
+        std::printf("%+5.1f dB: passage frames %zu, detected static %zu, adaptive %zu; other frames %zu, detected "
+                    "static %zu, adaptive %zu; mean noise floor shift %.2f dB%s\n",
+                    offset,
+                    a.passages,
+                    s.detected,
+                    a.detected,
+                    a.quiet,
+                    s.falseAlarms,
+                    a.falseAlarms,
+                    result.shift,
+                    passed ? "" : " FAILED");
+        ok = ok && passed;
+    }
+    return ok ? 0 : 2;
+}
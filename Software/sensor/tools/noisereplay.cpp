@@ -0,0 +1,186 @@
+// Replays the spectra of a raw file (any raw file version, see RawFile.h) through the static noise floor table and
+// through the adaptive noise floor (see noise_floor.h) and compares how many frames each of them detects. The FFT
+// width is derived from the bin count in the file header.
+//
+// A frame counts as detection if at least --min-bins bins are more than --threshold dB above the noise floor. A bin
+// that stays above the threshold for --rise-after seconds rises by up to --max-rise dB/s (0: never). With --save the
+// adapted floor is written as a checkpoint that the sensor loads as NOISEFLR.BIN.
+//
+// usage: noisereplay <input.bin> [--float | --bytes] [--threshold 8] [--min-bins 3] [--adapt-rate 0.001]
+//                    [--rise-after 30] [--max-rise 0.5] [--save NOISEFLR.BIN]
+
+#include "RawFile.h"
+
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    float threshold = 8;
+    size_t minBins = 3;
+    float adaptRate = 1.0f / 1000;
+    float riseAfterSeconds = 30;
+    float maxRise = 0.5f; // dB/s
+    std::string saveName;
+};
+
+template <class Layout>
+int replay(RawFile& raw, Options const& options)
+{
+    float staticFloor[Layout::numberOfFftBins];
+    initNoiseFloor(staticFloor, Layout::numberOfFftBins, Layout::fftWidth, Layout::minBinIndex);
+
+    NoiseFloorEstimator<Layout> noiseFloor;
+    noiseFloor.adaptRate = options.adaptRate;
+    noiseFloor.riseAfterFrames = uint16_t(options.riseAfterSeconds * 1000000 / Layout::framePeriodMicros);
+    noiseFloor.maxRisePerFrame = options.maxRise * Layout::framePeriodMicros / 1000000;
+
+    size_t frames = 0;
+    size_t staticDetections = 0;
+    size_t adaptiveDetections = 0;
+    size_t bothDetections = 0;
+    std::vector<float> spectrum(Layout::numberOfFftBins);
+    for(size_t frame = 0; frame < raw.frameCount(); frame++)
+    {
+        if(not raw.readDbfs(frame, spectrum.data()))
+            continue; // after damaged data, up to the next key frame
+        size_t staticBins = 0;
+        size_t adaptiveBins = 0;
+        for(size_t i = 0; i < Layout::numberOfFftBins; i++)
+        {
+            staticBins += spectrum[i] - staticFloor[i] > options.threshold;
+            adaptiveBins += noiseFloor.update(i, spectrum[i], options.threshold) > options.threshold;
+        }
+        noiseFloor.finishFrame();
+
+        bool const staticDetection = staticBins >= options.minBins;
+        bool const adaptiveDetection = adaptiveBins >= options.minBins;
+        staticDetections += staticDetection;
+        adaptiveDetections += adaptiveDetection;
+        bothDetections += staticDetection && adaptiveDetection;
+        frames++;
+    }
+
+    double shift = 0;
+    for(size_t i = 0; i < Layout::numberOfFftBins; i++)
+        shift += noiseFloor[i] - staticFloor[i];
+
+    std::printf(
+        "%u point FFT%s, %zu frames\n"
+        "detections static %zu, adaptive %zu, both %zu, only static %zu, only adaptive %zu\n"
+        "mean noise floor shift %.2f dB\n",
+        unsigned(Layout::fftWidth),
+        Layout::iqMeasurement ? " (IQ)" : "",
+        frames,
+        staticDetections,
+        adaptiveDetections,
+        bothDetections,
+        staticDetections - bothDetections,
+        adaptiveDetections - bothDetections,
+        shift / Layout::numberOfFftBins);
+
+    if(not options.saveName.empty())
+    {
+        uint8_t checkpoint[NoiseFloorEstimator<Layout>::checkpointSize];
+        noiseFloor.writeCheckpoint(checkpoint);
+        std::ofstream output(options.saveName, std::ios::binary);
+        output.write(reinterpret_cast<char const*>(checkpoint), sizeof(checkpoint));
+        if(not output)
+        {
+            std::cerr << "Unable to write " << options.saveName << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+template <class... Layouts>
+struct LayoutList
+{};
+
+int replay(RawFile& raw, Options const&, LayoutList<>)
+{
+    std::cerr << "No FFT layout with " << raw.header().binCount << " bins"
+              << (raw.header().iqMeasurement ? " (IQ)" : "") << std::endl;
+    return 1;
+}
+
+/// the file header only has the bin count, which is unique per IQ mode for the default speeds of SpectrumLayout
+template <class Layout, class... Rest>
+int replay(RawFile& raw, Options const& options, LayoutList<Layout, Rest...>)
+{
+    if(Layout::numberOfFftBins == raw.header().binCount && Layout::iqMeasurement == raw.header().iqMeasurement)
+        return replay<Layout>(raw, options);
+    return replay(raw, options, LayoutList<Rest...>());
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> [--float | --bytes] [--threshold 8] [--min-bins 3] [--adapt-rate 0.001]"
+                     " [--rise-after 30] [--max-rise 0.5] [--save file]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(i + 1 < argc && option == "--threshold")
+            options.threshold = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--min-bins")
+            options.minBins = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--adapt-rate")
+            options.adaptRate = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--rise-after")
+            options.riseAfterSeconds = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--max-rise")
+            options.maxRise = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--save")
+            options.saveName = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], options.layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+
+    return replay(
+        raw,
+        options,
+        LayoutList<
+            SpectrumLayout<256, false>,
+            SpectrumLayout<256, true>,
+            SpectrumLayout<512, false>,
+            SpectrumLayout<512, true>,
+            SpectrumLayout<1024, false>,
+            SpectrumLayout<1024, true>,
+            SpectrumLayout<2048, false>,
+            SpectrumLayout<2048, true>>());
+}
@@ -0,0 +1,135 @@
+// Checks the bookkeeping of Profiler.h: the power of two buckets at their edges, the count, mean and maximum of a
+// histogram, the overruns and the dropped frames that frameDone() derives from the durations and the gaps between the
+// timestamps (also across the wrap of millis()), the lines of printTo() and reset().
+//
+// The tool fails with exit code 2 and prints every check that failed.
+//
+// usage: profilercheck
+
+#include "../Profiler.h"
+
+#include <cstdio>
+#include <string>
+
+namespace
+{
+/// collects what printTo() prints
+struct StringOut
+{
+    std::string text;
+
+    void print(char const* value) { text += value; }
+    void print(uint32_t value) { text += std::to_string(value); }
+    void println(uint32_t value)
+    {
+        print(value);
+        println();
+    }
+    void println() { text += "\n"; }
+};
+
+bool failed = false;
+
+void expect(bool condition, char const* what)
+{
+    if(condition)
+        return;
+    std::printf("failed: %s\n", what);
+    failed = true;
+}
+
+void checkBuckets()
+{
+    expect(Profiler::bucket(0) == 0 && Profiler::bucket(1) == 0, "durations below 2 us in bucket 0");
+    bool edges = true;
+    for(size_t i = 1; i < Profiler::bucketCount; i++)
+    {
+        uint32_t const start = Profiler::bucketStartMicros(i);
+        edges = edges && start == uint32_t(1) << i && Profiler::bucket(start) == i &&
+                Profiler::bucket(start - 1) == i - 1;
+        if(i + 1 < Profiler::bucketCount)
+            edges = edges && Profiler::bucket(2 * start - 1) == i;
+    }
+    expect(edges, "bucket i holds 2^i to 2^(i+1) - 1 us");
+    expect(Profiler::bucket(1u << Profiler::bucketCount) == Profiler::bucketCount - 1 &&
+               Profiler::bucket(UINT32_MAX) == Profiler::bucketCount - 1,
+           "longer durations in the last bucket");
+}
+
+void checkHistogram()
+{
+    Profiler profiler(46439);
+    for(uint32_t micros : {0u, 1u, 3u, 12u, 12u, 700u, 4000000u})
+        profiler.add(Profiler::Process, micros);
+    auto const& histogram = profiler.histogram(Profiler::Process);
+    expect(histogram.count == 7, "count");
+    expect(histogram.totalMicros == 4000728 && histogram.meanMicros() == 571532, "total and mean");
+    expect(histogram.maxMicros == 4000000, "maximum");
+    uint32_t const buckets[Profiler::bucketCount] = {2, 1, 0, 2, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    bool same = true;
+    for(size_t i = 0; i < Profiler::bucketCount; i++)
+        same = same && histogram.buckets[i] == buckets[i];
+    expect(same, "buckets");
+    expect(profiler.histogram(Profiler::Wait).count == 0 && profiler.histogram(Profiler::Wait).meanMicros() == 0,
+           "other stages untouched");
+}
+
+void checkFrames()
+{
+    uint32_t const period = 46439;
+    Profiler profiler(period);
+
+    // on time, with jitter below half a period
+    uint32_t now = 1000;
+    for(size_t i = 0; i < 100; i++)
+    {
+        now += 46 + (i % 3 == 0 ? 20 : 0);
+        profiler.frameDone(now, i == 10 || i == 20 ? period + 1 : period);
+    }
+    expect(profiler.frames() == 100, "frames counted");
+    expect(profiler.overruns() == 2, "overruns are frames longer than the period");
+    expect(profiler.droppedFrames() == 0, "no frame dropped within 1.5 periods");
+
+    // two and three periods since the previous frame, then ten across the wrap of millis()
+    now += 2 * 46;
+    profiler.frameDone(now, 10);
+    now += 3 * 46;
+    profiler.frameDone(now, 10);
+    expect(profiler.droppedFrames() == 1 + 2, "frames dropped for gaps of 2 and 3 periods");
+    now = UINT32_MAX - 100;
+    profiler.frameDone(now, 10);
+    uint32_t const dropped = profiler.droppedFrames();
+    profiler.frameDone(now + 10 * 46 + 10, 10);
+    expect(profiler.droppedFrames() - dropped == 9, "frames dropped across the wrap of millis()");
+    expect(profiler.histogram(Profiler::Frame).count == profiler.frames(), "frame stage");
+
+    StringOut out;
+    Profiler printed(period);
+    printed.frameDone(1000, 3);
+    printed.frameDone(1046, 100000);
+    printed.add(Profiler::Service, 5);
+    printed.printTo(out);
+    expect(out.text == "profile: frames 2, overruns 1 (> 46439 us), dropped 0\n"
+                       "  service: n 1, mean 5, max 5 us | 4:1\n"
+                       "  frame: n 2, mean 50001, max 100000 us | 2:1 65536:1\n",
+           "printTo");
+
+    profiler.reset();
+    expect(profiler.frames() == 0 && profiler.overruns() == 0 && profiler.droppedFrames() == 0 &&
+               profiler.histogram(Profiler::Process).maxMicros == 0,
+           "reset");
+    profiler.frameDone(5000000, 10);
+    expect(profiler.droppedFrames() == 0, "no gap to the frame before reset");
+}
+} // namespace
+
+int main()
+{
+    checkBuckets();
+    checkHistogram();
+    checkFrames();
+    if(failed)
+        return 2;
+    std::printf("buckets, histograms, overruns, dropped frames and the profile as expected\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Decodes a compressed raw file (file format version 2 to 4, see RawRecord.h) into an uncompressed 8 bit file
+// (version 1) that can be read with read_binary_file_8bit in functions.R. Damaged records of version 3 and 4 files are
+// skipped (see rawrecover for a report).
+//
+// usage: rawdecode <input.bin> <output.bin>
+
+#include "../RawCompression.h"
+#include "../RawRecord.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+constexpr size_t fileHeaderSize = 11;
+
+template <typename T>
+T read(uint8_t const* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <input.bin> <output.bin>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if(not input)
+    {
+        std::cerr << "Unable to open " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> const file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    uint16_t const fileVersion = file.size() < fileHeaderSize ? 0 : read<uint16_t>(&file[0]);
+    if(not RawRecord::isCompressed(fileVersion))
+    {
+        std::cerr << argv[1] << " is not a compressed raw file" << std::endl;
+        return 1;
+    }
+
+    auto const binCount = read<uint16_t>(&file[6]);
+    if(binCount > RawCompression::maxBinCount)
+    {
+        std::cerr << "Unsupported bin count " << binCount << std::endl;
+        return 1;
+    }
+
+    std::ofstream output(argv[2], std::ios::binary);
+    uint16_t const version = 1;
+    output.write(reinterpret_cast<char const*>(&version), 2);
+    output.write(reinterpret_cast<char const*>(&file[2]), fileHeaderSize - 2);
+
+    RawCompression::Decoder decoder;
+    std::vector<uint8_t> bins(binCount);
+    size_t frames = 0;
+    size_t skipped = 0;
+    size_t events = 0;
+    size_t pos = RawRecord::dataOffset(fileVersion);
+    RawRecord::Record record;
+    while(RawRecord::next(
+        file.data(), file.size(), fileVersion, pos, RawCompression::maxPayloadSize(binCount), record))
+    {
+        pos = record.offset + record.size;
+        if(record.flags & RawCompression::EventStart)
+            events++;
+        if(record.skippedBytes > 0)
+            decoder.reset(); // damaged data in between
+
+        if(decoder.decode(record.payload, record.payloadSize, record.flags, bins.data(), binCount))
+        {
+            output.write(reinterpret_cast<char const*>(&record.timestamp), 4);
+            output.write(reinterpret_cast<char const*>(bins.data()), binCount);
+            frames++;
+        }
+        else
+            skipped++;
+    }
+
+    size_t const uncompressedSize = fileHeaderSize + frames * (4 + binCount);
+    std::printf(
+        "%zu frames decoded, %zu skipped, %zu event segments, %zu -> %zu bytes, compression ratio %.2f\n",
+        frames,
+        skipped,
+        events,
+        file.size(),
+        uncompressedSize,
+        file.size() ? double(uncompressedSize) / file.size() : 0.0);
+
+    return output ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+// Exports the frames of a raw file (version 1 with 8 bit or float bins, or 2 to 4 compressed) as two NumPy
+// .npy files: <prefix>_timestamps.npy (uint32, ms since the start of the sensor) and <prefix>_spectra.npy (one row
+// per frame). The spectra keep the type of the file, i.e. uint8 -dBFS for 8 bit and compressed files and float32
+// dBFS for float files; --dbfs writes float32 dBFS for all of them. The rows are stored contiguously, so the data
+// part of the file can also be wrapped without copying, e.g. as Arrow FixedSizeList array.
+//
+// --from and --to select the frames by timestamp. Without an output prefix the tool only prints the file header,
+// the detected layout and the time range. The file is read through RawFile (memory-mapped), the output is written
+// in large blocks.
+//
+// usage: rawexport <input.bin> [<output prefix>] [--float | --bytes] [--from ms] [--to ms] [--dbfs]
+
+#include "RawFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t npyHeaderSize = 128;         // room for any shape, so the header can be rewritten in place
+constexpr size_t blockSize = 4 * 1024 * 1024; // bytes written at once
+
+struct Options
+{
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    uint32_t fromMs = 0;
+    uint32_t toMs = UINT32_MAX;
+    bool dbfs = false;
+};
+
+char const* layoutName(RawFile::Layout layout)
+{
+    switch(layout)
+    {
+    case RawFile::Layout::Unknown:
+        return "unknown";
+    case RawFile::Layout::Bytes:
+        return "8 bit";
+    case RawFile::Layout::Floats:
+        return "float";
+    case RawFile::Layout::Compressed:
+        return "compressed 8 bit";
+    }
+    return "?";
+}
+
+/// .npy format version 1.0 header for a little endian C order array
+bool writeNpyHeader(std::FILE* file, char const* type, size_t rows, size_t columns)
+{
+    std::string shape = "(" + std::to_string(rows) + (columns > 0 ? ", " + std::to_string(columns) + ")" : ",)");
+    std::string header = "{'descr': '" + std::string(type) + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    header.resize(npyHeaderSize - 10 - 1, ' ');
+    header += '\n';
+
+    uint8_t const preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, uint8_t(header.size()), uint8_t(header.size() >> 8)};
+    return std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(preamble, 1, sizeof(preamble), file) == sizeof(preamble) &&
+           std::fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+/// collects rows and writes them in blocks
+class BlockWriter
+{
+  public:
+    explicit BlockWriter(std::FILE* file)
+        : file(file)
+    {
+        buffer.reserve(blockSize);
+    }
+
+    void write(void const* data, size_t size)
+    {
+        if(buffer.size() + size > blockSize)
+            flush();
+        auto const bytes = static_cast<uint8_t const*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    bool flush()
+    {
+        ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+        return ok;
+    }
+
+  private:
+    std::FILE* const file;
+    std::vector<uint8_t> buffer;
+    bool ok = true;
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> [<output prefix>] [--float | --bytes] [--from ms] [--to ms] [--dbfs]" << std::endl;
+        return 1;
+    }
+
+    std::string prefix;
+    Options options;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(option == "--dbfs")
+            options.dbfs = true;
+        else if(i + 1 < argc && option == "--from")
+            options.fromMs = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if(i + 1 < argc && option == "--to")
+            options.toMs = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if(i == 2 && option.compare(0, 2, "--") != 0)
+            prefix = option;
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], options.layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+
+    auto const& header = raw.header();
+    size_t first = 0;
+    size_t end = 0;
+    raw.range(options.fromMs, options.toMs, first, end);
+    std::printf(
+        "version %u, %s, %u bins%s, %u Hz, started %u, %zu frames",
+        unsigned(header.version),
+        layoutName(raw.layout()),
+        unsigned(header.binCount),
+        header.iqMeasurement ? " (IQ)" : "",
+        unsigned(header.sampleRate),
+        unsigned(header.startTime),
+        raw.frameCount());
+    if(raw.frameCount() > 0)
+        std::printf(" from %u to %u ms", raw.timestamp(0), raw.timestamp(raw.frameCount() - 1));
+    std::printf(", %zu selected\n", end - first);
+    if(prefix.empty())
+        return 0;
+
+    std::string const timestampName = prefix + "_timestamps.npy";
+    std::string const spectraName = prefix + "_spectra.npy";
+    std::FILE* timestampFile = std::fopen(timestampName.c_str(), "wb");
+    std::FILE* spectraFile = std::fopen(spectraName.c_str(), "wb");
+    if(not timestampFile or not spectraFile)
+    {
+        std::cerr << "Unable to create " << (timestampFile ? spectraName : timestampName) << std::endl;
+        return 1;
+    }
+
+    bool const floats = options.dbfs || raw.layout() == RawFile::Layout::Floats;
+    char const* const spectraType = floats ? "<f4" : "|u1";
+    size_t const binCount = header.binCount;
+    size_t const rowSize = binCount * (floats ? sizeof(float) : 1);
+    writeNpyHeader(timestampFile, "<u4", 0, 0);
+    writeNpyHeader(spectraFile, spectraType, 0, binCount);
+
+    auto const begin = std::chrono::steady_clock::now();
+    BlockWriter timestamps(timestampFile);
+    BlockWriter spectra(spectraFile);
+    std::vector<uint8_t> bytes(binCount);
+    std::vector<float> dbfs(binCount);
+    size_t written = 0;
+    size_t skipped = 0;
+    for(size_t frame = first; frame < end; frame++)
+    {
+        // the uncompressed rows go straight from the mapping into the output buffer
+        void const* row = nullptr;
+        if(not floats and raw.layout() == RawFile::Layout::Bytes)
+            row = raw.bins(frame);
+        else if(floats and raw.layout() == RawFile::Layout::Floats)
+            row = raw.bins(frame);
+        else if(floats and raw.readDbfs(frame, dbfs.data()))
+            row = dbfs.data();
+        else if(not floats and raw.readBytes(frame, bytes.data()))
+            row = bytes.data();
+
+        if(not row)
+        {
+            skipped++;
+            continue;
+        }
+        uint32_t const timestamp = raw.timestamp(frame);
+        timestamps.write(&timestamp, sizeof(timestamp));
+        spectra.write(row, rowSize);
+        written++;
+    }
+
+    bool ok = timestamps.flush() && spectra.flush();
+    ok = ok && writeNpyHeader(timestampFile, "<u4", written, 0) && writeNpyHeader(spectraFile, spectraType, written, binCount);
+    ok = std::fclose(timestampFile) == 0 && ok;
+    ok = std::fclose(spectraFile) == 0 && ok;
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if(not ok)
+    {
+        std::cerr << "Unable to write " << prefix << "_*.npy" << std::endl;
+        return 1;
+    }
+
+    double const megabytes = (written * (4 + rowSize) + 2 * npyHeaderSize) / 1e6;
+    std::printf(
+        "%zu frames written, %zu undecodable skipped, %.1f MB in %.3f s (%.0f MB/s)\n",
+        written,
+        skipped,
+        megabytes,
+        seconds,
+        seconds > 0 ? megabytes / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Verifies a raw file and salvages the intact frames of a damaged one, e.g. after a power loss or with a card that
+// was pulled while the sensor was writing. The file is read with RawFile: records of version 3 and 4 files are checked
+// against their CRC and damaged ones are skipped (see RawRecord.h); of version 1 and 2 files only a cut off last
+// record is found. The frames after a gap in a compressed file are lost up to the next key frame.
+//
+// The report lists the gaps, the bytes after the last complete record and the frames that can be read. With an
+// output name every readable frame is copied with its record unchanged into a new file of the same version, together
+// with a new seek index (.idx, see RawIndex.h) next to it. The tool exits with code 2 if the file is damaged.
+//
+// usage: rawrecover <input.bin> [<output.bin>] [--float | --bytes]
+
+#include "RawFile.h"
+
+#include "../RawIndex.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t indexInterval = 64; // uncompressed frames per index entry, as Config::rawIndexInterval
+
+struct Salvage
+{
+    size_t frames = 0;     // readable frames
+    size_t lostFrames = 0; // intact records that cannot be decoded, behind a gap up to the next key frame
+    size_t indexEntries = 0;
+    size_t bytes = 0; // of the output file
+};
+
+template <typename T>
+bool write(std::FILE* file, T const& value)
+{
+    return std::fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+/// the file header as FileWriter::openRawFile writes it
+bool writeHeader(std::FILE* file, RawFile::Header const& header)
+{
+    uint8_t const iqMeasurement = header.iqMeasurement;
+    bool const ok = write(file, header.version) && write(file, header.startTime) && write(file, header.binCount) &&
+                    write(file, iqMeasurement) && write(file, header.sampleRate);
+    if(header.version < RawRecord::sequencedVersion)
+        return ok;
+
+    uint8_t anchor[FrameClock::anchorSize];
+    return ok && std::fwrite(anchor, FrameClock::writeAnchor(anchor, header.anchor), 1, file) == 1;
+}
+
+/// copies the readable records of raw into output and lists them in index; without output it only counts them
+bool salvage(RawFile& raw, std::FILE* output, std::FILE* index, Salvage& result)
+{
+    bool const compressed = raw.layout() == RawFile::Layout::Compressed;
+    std::vector<uint8_t> bins(raw.header().binCount);
+    uint8_t indexHeader[RawIndex::headerSize];
+    bool ok = not output || (writeHeader(output, raw.header()) &&
+                             std::fwrite(indexHeader, RawIndex::writeHeader(indexHeader), 1, index) == 1);
+    result.bytes = raw.dataOffset();
+
+    for(size_t frame = 0; frame < raw.frameCount() && ok; frame++)
+    {
+        // frames are decoded in order, so each one continues from the one before
+        if(compressed && not raw.readBytes(frame, bins.data()))
+        {
+            result.lostFrames++;
+            continue;
+        }
+
+        bool const indexed = compressed ? (raw.flags(frame) & RawCompression::KeyFrame) != 0
+                                        : result.frames % indexInterval == 0;
+        size_t const length = raw.recordLength(frame);
+        if(output && indexed)
+        {
+            uint8_t entry[RawIndex::entrySize];
+            RawIndex::writeEntry(entry, {raw.timestamp(frame), uint32_t(result.bytes)});
+            ok = std::fwrite(entry, sizeof(entry), 1, index) == 1;
+        }
+        if(output)
+            ok = ok && std::fwrite(raw.record(frame), length, 1, output) == 1;
+        result.indexEntries += indexed;
+        result.bytes += length;
+        result.frames++;
+    }
+    return ok;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <input.bin> [<output.bin>] [--float | --bytes]" << std::endl;
+        return 1;
+    }
+
+    std::string outputName;
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            layout = RawFile::Layout::Bytes;
+        else if(i == 2 && option.compare(0, 2, "--") != 0)
+            outputName = option;
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+
+    std::FILE* output = nullptr;
+    std::FILE* index = nullptr;
+    if(not outputName.empty())
+    {
+        std::string const extension = ".bin";
+        std::string stem = outputName;
+        if(stem.size() > extension.size() && stem.compare(stem.size() - extension.size(), extension.size(), extension) == 0)
+            stem.resize(stem.size() - extension.size());
+        std::string const indexName = stem + ".idx";
+        output = std::fopen(outputName.c_str(), "wb");
+        index = std::fopen(indexName.c_str(), "wb");
+        if(not output || not index)
+        {
+            std::cerr << "Unable to create " << (output ? indexName : outputName) << std::endl;
+            return 1;
+        }
+    }
+
+    Salvage result;
+    bool ok = salvage(raw, output, index, result);
+    ok = (not output || std::fclose(output) == 0) && (not index || std::fclose(index) == 0) && ok;
+
+    auto const& damage = raw.damage();
+    bool const damaged = damage.gaps > 0 || damage.tailBytes > 0 || result.lostFrames > 0;
+    std::printf(
+        "version %u, %u bins, %zu intact records, %zu gaps (%zu bytes), %zu bytes after the last record\n",
+        unsigned(raw.header().version),
+        unsigned(raw.header().binCount),
+        raw.frameCount(),
+        damage.gaps,
+        damage.gapBytes,
+        damage.tailBytes);
+    std::printf("%zu frames readable, %zu lost behind gaps", result.frames, result.lostFrames);
+    if(raw.frameCount() > 0)
+        std::printf(", from %u to %u ms", raw.timestamp(0), raw.timestamp(raw.frameCount() - 1));
+    std::printf("%s\n", damaged ? "" : ", file is intact");
+    if(output)
+        std::printf("%zu bytes and %zu index entries written\n", result.bytes, result.indexEntries);
+
+    if(not ok)
+    {
+        std::cerr << "Unable to write " << outputName << std::endl;
+        return 1;
+    }
+    return damaged ? 2 : 0;
+}
@@ -0,0 +1,303 @@
+// Checks that damaged raw files are read as far as their records are intact (see RawRecord.h): a compressed file is
+// written through FileWriter with the Arduino stand-ins of host/ like in indexcheck, then copies of it are cut at a
+// random length and get random bit flips, as after a power loss or from a failing card. Each copy is written to
+// <dir>/damaged.bin next to the index of the intact file and read back with RawFile, by frame number as rawrecover and
+// rawexport do and with seek() and next().
+//
+// Every frame read has to equal the frame with its timestamp in the intact file, sequence number included, and every
+// frame whose record and the records back to its key frame are untouched has to be read. The tool fails with exit
+// code 2 otherwise.
+//
+// usage: recoverycheck <dir> [--frames 3000] [--trials 100] [--flips 8] [--seed 1]
+
+#include "RawFile.h"
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../RawRecord.h"
+#include "../host/HostEnvironment.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::string directory;
+    size_t frames = 3000;
+    size_t trials = 100;
+    size_t flips = 8;
+    unsigned seed = 1;
+};
+
+struct Record
+{
+    size_t offset;
+    size_t size;
+    uint32_t timestamp;
+    uint64_t sequence;
+    bool keyFrame;
+    std::vector<float> dbfs;
+};
+
+struct Totals
+{
+    size_t cutTrials = 0;
+    size_t flippedBits = 0;
+    size_t gaps = 0;
+    size_t framesRead = 0;
+    size_t framesLost = 0; // intact records behind a gap up to the next key frame
+};
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+/// the globals of sensor.ino that are needed for writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+};
+
+/// one compressed file; the card stalls now and then, so the writer drops frames and starts over with key frames
+void record(Sensor& sensor, Options const& options, std::mt19937& random)
+{
+    auto& results = sensor.results;
+    std::normal_distribution<float> noise(0, 1.5f);
+    std::vector<float> level(results.numberOfFftBins, -90);
+
+    HostEnvironment::setTime(1700000000);
+    uint32_t now = millis();
+    for(size_t frame = 0; frame < options.frames; frame++)
+    {
+        now += AudioSystem::Layout::framePeriodMicros / 1000;
+        HostEnvironment::setMillis(now);
+        for(size_t i = 0; i < results.numberOfFftBins; i++)
+        {
+            level[i] = std::min(-20.0f, std::max(-120.0f, level[i] + noise(random)));
+            results.spectrum[i] = level[i];
+        }
+        results.timestamp = now;
+        results.sequence = 4 + frame * 3 / 2; // with gaps, as if every third spectrum was missed
+        sensor.fileWriter.writeRawData(results, true, sensor.config);
+        if(frame % 1000 < 900)
+            sensor.fileWriter.service();
+    }
+    sensor.fileWriter.close();
+}
+
+/// the records of the intact file with their decoded bins
+std::vector<Record> scan(RawFile& raw)
+{
+    std::vector<Record> records;
+    for(size_t i = 0; i < raw.frameCount(); i++)
+    {
+        Record record{raw.recordOffset(i),
+                      raw.recordLength(i),
+                      raw.timestamp(i),
+                      raw.sequence(i),
+                      (raw.flags(i) & RawCompression::KeyFrame) != 0,
+                      std::vector<float>(raw.header().binCount)};
+        raw.readDbfs(i, record.dbfs.data());
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+/// damages a copy of the file and compares what RawFile reads from it with the records of the intact file
+bool trial(std::vector<uint8_t> const& file,
+           size_t headerSize,
+           std::vector<Record> const& records,
+           std::string const& name,
+           Options const& options,
+           std::mt19937& random,
+           Totals& totals)
+{
+    // cut in half of the trials, the flips land behind the file header (a damaged header is not recoverable)
+    std::vector<uint8_t> damaged = file;
+    if(random() % 2)
+    {
+        damaged.resize(std::uniform_int_distribution<size_t>(headerSize, file.size())(random));
+        totals.cutTrials++;
+    }
+    std::vector<size_t> flips(std::uniform_int_distribution<size_t>(0, options.flips)(random));
+    for(auto& flip : flips)
+    {
+        flip = std::uniform_int_distribution<size_t>(headerSize * 8, damaged.size() * 8 - 1)(random) / 8;
+        damaged[flip] ^= uint8_t(1u << (random() % 8));
+    }
+    std::sort(flips.begin(), flips.end());
+    totals.flippedBits += flips.size();
+
+    // a frame is readable if its record and those back to its key frame are untouched
+    std::map<uint32_t, Record const*> expected;
+    size_t intact = 0;
+    bool chain = false;
+    for(auto const& record : records)
+    {
+        size_t const end = record.offset + record.size;
+        auto const flip = std::lower_bound(flips.begin(), flips.end(), record.offset);
+        bool const untouched = end <= damaged.size() && (flip == flips.end() || *flip >= end);
+        chain = untouched && (record.keyFrame || chain);
+        intact += untouched;
+        if(chain)
+            expected[record.timestamp] = &record;
+    }
+
+    RawFile raw;
+    if(not writeFile(name, damaged) || not raw.open(name))
+    {
+        std::printf("  unable to open the damaged file: %s\n", raw.error().c_str());
+        return false;
+    }
+    if(raw.frameCount() != intact)
+    {
+        std::printf("  %zu intact records, %zu found\n", intact, raw.frameCount());
+        return false;
+    }
+
+    size_t read = 0;
+    std::vector<float> dbfs(raw.header().binCount);
+    for(size_t i = 0; i < raw.frameCount(); i++)
+    {
+        if(not raw.readDbfs(i, dbfs.data()))
+            continue;
+        auto const found = expected.find(raw.timestamp(i));
+        if(found == expected.end() || found->second->sequence != raw.sequence(i) || found->second->dbfs != dbfs)
+        {
+            std::printf("  frame %zu (%u ms) is not in the intact file\n", i, raw.timestamp(i));
+            return false;
+        }
+        read++;
+    }
+    if(read != expected.size())
+    {
+        std::printf("  %zu frames read, %zu expected\n", read, expected.size());
+        return false;
+    }
+
+    // by time, starting at the index of the intact file
+    std::uniform_int_distribution<uint32_t> target(0, records.back().timestamp + 100);
+    for(size_t i = 0; i < 10; i++)
+    {
+        uint32_t const fromMs = target(random);
+        auto const wanted = expected.lower_bound(fromMs);
+        uint32_t timestamp = 0;
+        raw.seek(fromMs);
+        bool const found = raw.next(timestamp, dbfs.data());
+        if(found != (wanted != expected.end()) || (found && timestamp != wanted->first) ||
+           (found && dbfs != wanted->second->dbfs))
+        {
+            std::printf("  seek to %u ms returned %u ms\n", fromMs, found ? timestamp : 0);
+            return false;
+        }
+    }
+
+    totals.gaps += raw.damage().gaps;
+    totals.framesRead += read;
+    totals.framesLost += intact - read;
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <dir> [--frames 3000] [--trials 100] [--flips 8] [--seed 1]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.directory = argv[1];
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--trials")
+            options.trials = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--flips")
+            options.flips = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    std::mt19937 random(options.seed);
+    sensor.fileWriter.setupSpi();
+    sensor.fileWriter.setupSdCard();
+    record(sensor, options, random);
+
+    std::vector<uint8_t> const* file = nullptr;
+    std::vector<uint8_t> const* index = nullptr;
+    for(auto const& entry : HostEnvironment::sdFiles())
+    {
+        if(entry.first.size() > 4 && entry.first.compare(entry.first.size() - 4, 4, ".bin") == 0)
+            file = entry.second.get();
+        if(entry.first.size() > 4 && entry.first.compare(entry.first.size() - 4, 4, ".idx") == 0)
+            index = entry.second.get();
+    }
+
+    std::string const original = options.directory + "/intact.bin";
+    RawFile raw;
+    if(not file || not index || not writeFile(original, *file) || not raw.open(original))
+    {
+        std::cerr << "Unable to write the raw file into " << options.directory << std::endl;
+        return 1;
+    }
+    auto const records = scan(raw);
+    if(raw.layout() != RawFile::Layout::Compressed || raw.header().version != RawRecord::sequencedVersion ||
+       records.empty() || raw.damage().gaps > 0 || raw.damage().tailBytes > 0)
+    {
+        std::cerr << "The intact file is not a complete version 4 file" << std::endl;
+        return 2;
+    }
+
+    std::string const damaged = options.directory + "/damaged.bin";
+    writeFile(options.directory + "/damaged.idx", *index);
+    Totals totals;
+    size_t failed = 0;
+    for(size_t i = 0; i < options.trials; i++)
+    {
+        if(not trial(*file, raw.dataOffset(), records, damaged, options, random, totals))
+        {
+            std::printf("trial %zu FAILED\n", i);
+            failed++;
+        }
+    }
+
+    std::printf(
+        "%zu records, %zu trials (%zu cut, %zu bit flips): %zu gaps, %zu frames read, %zu intact frames lost behind "
+        "gaps, %zu failed\n",
+        records.size(),
+        options.trials,
+        totals.cutTrials,
+        totals.flippedBits,
+        totals.gaps,
+        totals.framesRead,
+        totals.framesLost,
+        failed);
+    return failed == 0 ? 0 : 2;
+}
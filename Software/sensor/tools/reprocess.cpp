@@ -0,0 +1,623 @@
+// Re-derives the per-frame metrics of raw recordings (any raw file version, see RawFile.h) with the analysis of the
+// sensor (AudioResults::process) on all cores. The arguments are raw files or directories whose .bin files are
+// processed. With --out every file gets the metrics csv table the sensor writes with writeCsvData, and summary.csv
+// lists per file and parameter set the frames, the frames with signal and what the event trigger of the raw capture
+// (see EventCapture.h) would have recorded. The FFT width is derived from the bin count of each file. The sequence
+// column of the tables holds the sequence numbers of version 4 files and 0 for older ones. The mirrored ghosts of IQ
+// spectra are removed before the detection with the settings of AudioSystem (ghost_suppression, see
+// GhostSuppression.h), --no-ghosts analyses the spectra as they are.
+//
+// --threshold (noise_floor_distance_threshold), --adapt-rate (noise_floor_adapt_rate), --amplitude (TRIGGER_AMPLITUDE)
+// and --bins (TRIGGER_BINS) take comma separated lists; every combination is a parameter set and all sets are
+// computed in the same pass over the data. With a grid the tables are named <file>_<set>.csv.
+//
+// The work is split into chunks that the threads take from their own queue and steal from the others once it is
+// empty. By default a chunk is a whole file, so the noise floor evolves exactly like on the sensor and the table
+// with the default parameters matches the one of the sensor for the same spectra (float recordings; 8 bit recordings
+// match sensorreplay). --chunk-frames splits the files further for more parallelism: each chunk first replays
+// --warm-up frames in front of it without output, so the noise floor and the trigger have settled, but values near a
+// chunk start can differ slightly from a sequential run.
+//
+// --benchmark runs without output with 1, 2, 4, ... up to --threads threads and reports the throughput in analysed
+// frames (frames times parameter sets) per second and per core.
+//
+// usage: reprocess <file or directory>... [--out DIR] [--threads N] [--chunk-frames 0] [--warm-up 10000]
+//                  [--threshold 8] [--adapt-rate 0.001] [--amplitude 100] [--bins 0] [--noise-floor NOISEFLR.BIN]
+//                  [--float | --bytes] [--no-ghosts] [--benchmark]
+
+#include "RawFile.h"
+
+#include "../AudioResults.h"
+#include "../CsvFormat.h"
+#include "../EventCapture.h"
+#include "../GhostSuppression.h"
+#include "../SpectrumLayout.h"
+#include "../noise_floor.h"
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr float emptyBin = -120; // dBFS of the FFT bins outside of the recorded range
+
+struct Parameters
+{
+    float threshold;
+    float adaptRate;
+    float amplitude;
+    uint8_t bins;
+};
+
+struct Options
+{
+    std::vector<std::string> inputs;
+    std::string outDir;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkFrames = 0; // 0: whole files
+    size_t warmUp = 10000;  // ten time constants of the noise floor at the default adapt rate
+    std::vector<float> thresholds{8};
+    std::vector<float> adaptRates{1.0f / 1000};
+    std::vector<float> amplitudes{100};
+    std::vector<float> bins{0};
+    std::vector<uint8_t> noiseFloor; // checkpoint every chunk starts from
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    bool ghostSuppression = true; // the default of AudioSystem::Config
+    bool benchmark = false;
+};
+
+struct Summary
+{
+    size_t frames = 0;
+    size_t framesWithSignal = 0; // at least one bin with signal in either direction
+    size_t triggeredFrames = 0;  // in a trigger event or its cool down
+    size_t events = 0;           // trigger events started in the chunk
+
+    void add(Summary const& other)
+    {
+        frames += other.frames;
+        framesWithSignal += other.framesWithSignal;
+        triggeredFrames += other.triggeredFrames;
+        events += other.events;
+    }
+};
+
+struct Input
+{
+    std::string name;
+    size_t frames = 0;
+    std::atomic<size_t> openChunks{0}; // the thread finishing the last chunk writes the tables
+    std::atomic<bool> failed{false};
+};
+
+struct Chunk
+{
+    size_t input;
+    size_t first; // frames [first, end) are reported
+    size_t end;
+    std::vector<std::string> tables; // csv lines per parameter set
+    std::vector<Summary> summaries;
+};
+
+/// appends everything printed to a string
+class StringPrint : public Print
+{
+  public:
+    explicit StringPrint(std::string& text)
+        : text(text)
+    {}
+
+    size_t write(uint8_t c) override
+    {
+        text.push_back(char(c));
+        return 1;
+    }
+    size_t write(uint8_t const* data, size_t size) override
+    {
+        text.append(reinterpret_cast<char const*>(data), size);
+        return size;
+    }
+    using Print::write;
+
+  private:
+    std::string& text;
+};
+
+/// one task queue per thread; a thread takes the front of its own queue and steals from the back of the others
+class WorkQueues
+{
+  public:
+    explicit WorkQueues(size_t threads)
+    {
+        for(size_t i = 0; i < threads; i++)
+            queues.emplace_back(new Queue());
+    }
+
+    void push(size_t thread, size_t task)
+    {
+        std::lock_guard<std::mutex> lock(queues[thread]->mutex);
+        queues[thread]->tasks.push_back(task);
+    }
+
+    bool pop(size_t thread, size_t& task)
+    {
+        {
+            Queue& own = *queues[thread];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(not own.tasks.empty())
+            {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for(size_t i = 1; i < queues.size(); i++)
+        {
+            Queue& other = *queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if(not other.tasks.empty())
+            {
+                task = other.tasks.back();
+                other.tasks.pop_back();
+                steals++;
+                return true;
+            }
+        }
+        return false; // no task is added while the threads run, so all work is taken
+    }
+
+    size_t stealCount() const { return steals; }
+
+  private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> steals{0};
+};
+
+std::vector<Parameters> parameterSets(Options const& options)
+{
+    std::vector<Parameters> sets;
+    for(float threshold : options.thresholds)
+        for(float adaptRate : options.adaptRates)
+            for(float amplitude : options.amplitudes)
+                for(float bins : options.bins)
+                    sets.push_back({threshold, adaptRate, amplitude, uint8_t(bins)});
+    return sets;
+}
+
+template <class Layout>
+void process(RawFile& raw, Chunk& chunk, std::vector<Parameters> const& sets, Options const& options, bool output)
+{
+    struct State
+    {
+        AudioResults<Layout> results;
+        NoiseFloorEstimator<Layout> noiseFloor;
+        GhostSuppression<Layout> ghosts; // the default settings are the ones AudioSystem::setup sets
+        EventCapture::Trigger trigger;
+    };
+
+    std::vector<std::unique_ptr<State>> states;
+    for(auto const& parameters : sets)
+    {
+        states.emplace_back(new State());
+        State& state = *states.back();
+        if(not options.noiseFloor.empty())
+            state.noiseFloor.readCheckpoint(options.noiseFloor.data(), options.noiseFloor.size());
+        state.noiseFloor.adaptRate = parameters.adaptRate;
+
+        EventCapture::Trigger::Settings settings;
+        settings.amplitude = parameters.amplitude;
+        settings.binsWithSignal = parameters.bins;
+        state.trigger.setSettings(settings);
+    }
+    chunk.tables.assign(output ? sets.size() : 0, std::string());
+    chunk.summaries.assign(sets.size(), Summary());
+
+    // the analysis expects the complete FFT output, the raw file only holds the analysed range
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+    size_t const warmUpFirst = chunk.first > options.warmUp ? chunk.first - options.warmUp : 0;
+    for(size_t frame = warmUpFirst; frame < chunk.end; frame++)
+    {
+        if(not raw.readDbfs(frame, fft.data() + Layout::minBinIndex))
+            continue; // not decodable, the sensor did not write it either
+
+        bool const report = frame >= chunk.first;
+        uint32_t const timestamp = raw.timestamp(frame);
+        uint64_t const sequence = raw.sequence(frame); // 0 before version 4
+        for(size_t i = 0; i < sets.size(); i++)
+        {
+            State& state = *states[i];
+            AudioResults<Layout>& results = state.results;
+            results.timestamp = timestamp;
+            results.sequence = sequence;
+            results.process(
+                fft.data(), state.noiseFloor, sets[i].threshold, options.ghostSuppression ? &state.ghosts : nullptr);
+            auto const triggerState = state.trigger.update(
+                timestamp,
+                results.mean_amplitude,
+                results.mean_amplitude_reverse,
+                results.bins_with_signal,
+                results.bins_with_signal_reverse);
+            if(not report)
+                continue;
+
+            Summary& summary = chunk.summaries[i];
+            summary.frames++;
+            summary.framesWithSignal += results.bins_with_signal > 0 || results.bins_with_signal_reverse > 0;
+            summary.triggeredFrames += triggerState != EventCapture::Trigger::State::Quiet;
+            summary.events += triggerState == EventCapture::Trigger::State::Start;
+            if(output)
+            {
+                StringPrint line(chunk.tables[i]);
+                CsvFormat::printLine(line, results);
+            }
+        }
+    }
+}
+
+template <class... Layouts>
+struct LayoutList
+{};
+
+bool process(RawFile&, Chunk&, std::vector<Parameters> const&, Options const&, bool, LayoutList<>)
+{
+    return false;
+}
+
+/// the file header only has the bin count, which is unique per IQ mode for the default speeds of SpectrumLayout
+template <class Layout, class... Rest>
+bool process(
+    RawFile& raw,
+    Chunk& chunk,
+    std::vector<Parameters> const& sets,
+    Options const& options,
+    bool output,
+    LayoutList<Layout, Rest...>)
+{
+    if(Layout::numberOfFftBins == raw.header().binCount && Layout::iqMeasurement == raw.header().iqMeasurement)
+    {
+        process<Layout>(raw, chunk, sets, options, output);
+        return true;
+    }
+    return process(raw, chunk, sets, options, output, LayoutList<Rest...>());
+}
+
+using Layouts = LayoutList<
+    SpectrumLayout<256, false>,
+    SpectrumLayout<256, true>,
+    SpectrumLayout<512, false>,
+    SpectrumLayout<512, true>,
+    SpectrumLayout<1024, false>,
+    SpectrumLayout<1024, true>,
+    SpectrumLayout<2048, false>,
+    SpectrumLayout<2048, true>>;
+
+std::string tableName(Options const& options, Input const& input, size_t set, size_t setCount)
+{
+    std::string name = options.outDir + "/" + std::filesystem::path(input.name).stem().string();
+    if(setCount > 1)
+        name += "_" + std::to_string(set);
+    return name + ".csv";
+}
+
+/// writes the tables of an input once all of its chunks are done and frees them
+bool writeTables(Options const& options, Input const& input, std::vector<Chunk*> const& chunks, size_t setCount)
+{
+    bool ok = true;
+    for(size_t set = 0; set < setCount; set++)
+    {
+        std::ofstream output(tableName(options, input, set, setCount), std::ios::binary);
+        output << CsvFormat::header << "\r\n";
+        for(Chunk* chunk : chunks)
+        {
+            output << chunk->tables[set];
+            std::string().swap(chunk->tables[set]);
+        }
+        ok = ok && output;
+    }
+    return ok;
+}
+
+struct Run
+{
+    double seconds = 0;
+    size_t frames = 0; // reported frames of all files, each analysed once per parameter set
+    size_t steals = 0;
+    bool ok = true;
+};
+
+Run run(std::vector<std::unique_ptr<Input>>& inputs, Options const& options, size_t threads, bool output)
+{
+    auto const sets = parameterSets(options);
+
+    // largest chunks first, dealt round robin, so the queues start out balanced
+    std::vector<Chunk> chunks;
+    for(size_t i = 0; i < inputs.size(); i++)
+    {
+        size_t const step = options.chunkFrames > 0 ? options.chunkFrames : std::max<size_t>(inputs[i]->frames, 1);
+        for(size_t first = 0; first < inputs[i]->frames; first += step)
+            chunks.push_back({i, first, std::min(first + step, inputs[i]->frames), {}, {}});
+        inputs[i]->openChunks = 0;
+    }
+    std::vector<size_t> order(chunks.size());
+    for(size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&chunks](size_t a, size_t b) {
+        return chunks[a].end - chunks[a].first > chunks[b].end - chunks[b].first;
+    });
+
+    std::vector<std::vector<Chunk*>> chunksOfInput(inputs.size());
+    for(auto& chunk : chunks)
+    {
+        chunksOfInput[chunk.input].push_back(&chunk);
+        inputs[chunk.input]->openChunks++;
+    }
+
+    WorkQueues queues(threads);
+    for(size_t i = 0; i < order.size(); i++)
+        queues.push(i % threads, order[i]);
+
+    std::atomic<bool> ok{true};
+    auto const work = [&](size_t thread) {
+        RawFile raw;
+        size_t task;
+        while(queues.pop(thread, task))
+        {
+            Chunk& chunk = chunks[task];
+            Input& input = *inputs[chunk.input];
+            // every chunk maps the file on its own, the decoder state of a RawFile is not shared between threads
+            if(not raw.open(input.name, options.layout) || not process(raw, chunk, sets, options, output, Layouts()))
+            {
+                input.failed = true;
+                ok = false;
+            }
+            if(--input.openChunks == 0 && output && not input.failed &&
+               not writeTables(options, input, chunksOfInput[chunk.input], sets.size()))
+            {
+                std::cerr << "Unable to write the tables of " << input.name << std::endl;
+                ok = false;
+            }
+        }
+    };
+
+    auto const begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(size_t thread = 1; thread < threads; thread++)
+        workers.emplace_back(work, thread);
+    work(0);
+    for(auto& worker : workers)
+        worker.join();
+
+    Run result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.steals = queues.stealCount();
+    result.ok = ok;
+    for(auto const& chunk : chunks)
+        if(not chunk.summaries.empty())
+            result.frames += chunk.summaries[0].frames;
+
+    if(not output)
+        return result;
+
+    std::ofstream summaryFile(options.outDir + "/summary.csv", std::ios::binary);
+    summaryFile << "file, set, threshold, adapt_rate, trigger_amplitude, trigger_bins, frames, frames_with_signal, "
+                   "triggered_frames, trigger_events\r\n";
+    std::vector<Summary> totals(sets.size());
+    for(size_t i = 0; i < inputs.size(); i++)
+        for(size_t set = 0; set < sets.size(); set++)
+        {
+            Summary summary;
+            for(Chunk const* chunk : chunksOfInput[i])
+                if(set < chunk->summaries.size())
+                    summary.add(chunk->summaries[set]);
+            totals[set].add(summary);
+            summaryFile << std::filesystem::path(inputs[i]->name).filename().string() << ", " << set << ", "
+                        << sets[set].threshold << ", " << sets[set].adaptRate << ", " << sets[set].amplitude << ", "
+                        << unsigned(sets[set].bins) << ", " << summary.frames << ", " << summary.framesWithSignal
+                        << ", " << summary.triggeredFrames << ", " << summary.events << "\r\n";
+        }
+    result.ok = result.ok && summaryFile;
+
+    for(size_t set = 0; set < sets.size(); set++)
+    {
+        Summary const& total = totals[set];
+        std::printf(
+            "set %zu: threshold %g, adapt rate %g, trigger amplitude %g, trigger bins %u: %zu frames, %zu with "
+            "signal, %zu triggered (%.1f %%), %zu trigger events\n",
+            set,
+            sets[set].threshold,
+            sets[set].adaptRate,
+            sets[set].amplitude,
+            unsigned(sets[set].bins),
+            total.frames,
+            total.framesWithSignal,
+            total.triggeredFrames,
+            total.frames ? 100.0 * total.triggeredFrames / total.frames : 0.0,
+            total.events);
+    }
+    return result;
+}
+
+std::vector<float> parseList(char const* text)
+{
+    std::vector<float> values;
+    std::stringstream list(text);
+    std::string value;
+    while(std::getline(list, value, ','))
+        values.push_back(std::atof(value.c_str()));
+    return values;
+}
+
+bool readFile(std::string const& name, std::vector<uint8_t>& data)
+{
+    std::ifstream input(name, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return bool(input) || input.eof();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <file or directory>... [--out DIR] [--threads N] [--chunk-frames 0] [--warm-up 10000]"
+                     " [--threshold 8] [--adapt-rate 0.001] [--amplitude 100] [--bins 0] [--noise-floor file]"
+                     " [--float | --bytes] [--no-ghosts] [--benchmark]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--out")
+            options.outDir = argv[++i];
+        else if(i + 1 < argc && option == "--threads")
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        else if(i + 1 < argc && option == "--chunk-frames")
+            options.chunkFrames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--warm-up")
+            options.warmUp = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--threshold")
+            options.thresholds = parseList(argv[++i]);
+        else if(i + 1 < argc && option == "--adapt-rate")
+            options.adaptRates = parseList(argv[++i]);
+        else if(i + 1 < argc && option == "--amplitude")
+            options.amplitudes = parseList(argv[++i]);
+        else if(i + 1 < argc && option == "--bins")
+            options.bins = parseList(argv[++i]);
+        else if(i + 1 < argc && option == "--noise-floor")
+        {
+            if(not readFile(argv[++i], options.noiseFloor) || options.noiseFloor.empty())
+            {
+                std::cerr << "Unable to read " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(option == "--no-ghosts")
+            options.ghostSuppression = false;
+        else if(option == "--benchmark")
+            options.benchmark = true;
+        else if(option.compare(0, 2, "--") == 0)
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+        else
+            options.inputs.push_back(option);
+    }
+    if(options.thresholds.empty() || options.adaptRates.empty() || options.amplitudes.empty() || options.bins.empty())
+    {
+        std::cerr << "Empty parameter list" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for(auto const& input : options.inputs)
+    {
+        std::error_code error;
+        if(not std::filesystem::is_directory(input, error))
+        {
+            names.push_back(input);
+            continue;
+        }
+        std::vector<std::string> files;
+        for(auto const& entry : std::filesystem::directory_iterator(input, error))
+            if(entry.is_regular_file() && entry.path().extension() == ".bin")
+                files.push_back(entry.path().string());
+        std::sort(files.begin(), files.end());
+        names.insert(names.end(), files.begin(), files.end());
+    }
+
+    bool ok = true;
+    std::vector<std::unique_ptr<Input>> inputs;
+    for(auto const& name : names)
+    {
+        RawFile raw;
+        if(not raw.open(name, options.layout))
+        {
+            std::cerr << raw.error() << ", skipped" << std::endl;
+            ok = false;
+            continue;
+        }
+        inputs.emplace_back(new Input());
+        inputs.back()->name = name;
+        inputs.back()->frames = raw.frameCount();
+    }
+    if(inputs.empty())
+    {
+        std::cerr << "No raw files" << std::endl;
+        return 1;
+    }
+
+    size_t const setCount = parameterSets(options).size();
+    if(not options.benchmark)
+    {
+        bool const output = not options.outDir.empty();
+        if(output)
+            std::filesystem::create_directories(options.outDir);
+        Run const result = run(inputs, options, options.threads, output);
+        std::printf(
+            "%zu files, %zu frames, %zu parameter sets, %zu threads: %.2f s, %.0f frames/s, %.0f frames/s per core\n",
+            inputs.size(),
+            result.frames,
+            setCount,
+            options.threads,
+            result.seconds,
+            result.frames * setCount / result.seconds,
+            result.frames * setCount / result.seconds / options.threads);
+        for(auto const& input : inputs)
+            if(input->failed)
+                std::cerr << "No FFT layout for " << input->name << std::endl;
+        return ok && result.ok ? 0 : 1;
+    }
+
+    // frames times parameter sets per second; the first run also brings the files into the page cache
+    run(inputs, options, 1, false);
+    double single = 0;
+    for(size_t threads = 1;; threads = std::min(threads * 2, options.threads))
+    {
+        Run const result = run(inputs, options, threads, false);
+        double const rate = result.frames * setCount / result.seconds;
+        if(threads == 1)
+            single = rate;
+        std::printf(
+            "%2zu threads: %8.3f s, %10.0f frames/s, %8.0f frames/s per core, speedup %.2f, %zu steals\n",
+            threads,
+            result.seconds,
+            rate,
+            rate / threads,
+            rate / single,
+            result.steals);
+        ok = ok && result.ok;
+        if(threads == options.threads)
+            break;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+// Checks that reprocess gives the metrics csv table the sensor writes for the same spectra: float raw files (version
+// 1, see FileWriter::openRawFile) of synthetic traffic are written into <dir>/recordings, every target with its
+// mirrored ghost ghostLevel dB under it like after the IQ correction, and the frames of the first one go through the
+// pipeline of the sensor (AudioSystem::processData with the settings of Config, the ghost suppression is on) with the
+// Arduino stand-ins of host/. The table of <reprocess> for that file has to be byte-identical to the lines
+// CsvFormat::printLine gives for the frames of the sensor. Version 1 files have no sequence numbers, reprocess writes 0
+// for them and so does the sensor side here. The ghosts stand over the detection threshold, so without the ghost
+// suppression (--no-ghosts) the table has to differ.
+//
+// With --threads threads, also with the files split by --chunk-frames and a warm-up over everything in front of each
+// chunk, every table and summary.csv have to be byte-identical to the ones of a run with one thread.
+//
+// The tool fails with exit code 2 and prints every check that failed.
+//
+// usage: reprocesscheck <reprocess> <dir> [--frames 3000] [--threads 4] [--seed 1]
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../CsvFormat.h"
+#include "../host/HostEnvironment.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Layout = AudioSystem::Layout;
+
+constexpr float emptyBin = -120;     // dBFS of the FFT bins outside of the recorded range, like in reprocess
+constexpr float targetLevel = 35;    // dB over the noise floor
+constexpr float ghostLevel = -25;    // dB; the mirror of a target, AudioSystem::Config::ghost_ratio
+constexpr size_t passageFrames = 60; // a target crosses the spectrum in this many frames, then the next one comes
+constexpr size_t recordingCount = 4;
+constexpr size_t recordingQuarters[recordingCount] = {4, 2, 3, 1}; // of --frames, so the threads end at different times
+
+struct Options
+{
+    std::string reprocess;
+    std::string directory;
+    size_t frames = 3000;
+    size_t threads = 4;
+    unsigned seed = 1;
+};
+
+/// the globals of sensor.ino that are needed for the analysis
+struct Sensor
+{
+    Config config;
+    AudioSystem audio;
+    AudioSystem::Results results;
+};
+
+/// appends everything printed to a string
+class StringPrint : public Print
+{
+  public:
+    explicit StringPrint(std::string& text)
+        : text(text)
+    {}
+
+    size_t write(uint8_t c) override
+    {
+        text.push_back(char(c));
+        return 1;
+    }
+    size_t write(uint8_t const* data, size_t size) override
+    {
+        text.append(reinterpret_cast<char const*>(data), size);
+        return size;
+    }
+    using Print::write;
+
+  private:
+    std::string& text;
+};
+
+template <typename T>
+void append(std::vector<uint8_t>& data, T value)
+{
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+/// the analysed bins of a frame in dBFS: the noise around the floor the sensor starts with and one target moving away
+/// from the center, every other passage in the reverse direction, with its ghost in the mirrored bin
+void makeFrame(size_t frame, NoiseFloorEstimator<Layout> const& floor, std::mt19937& random, float* bins)
+{
+    std::normal_distribution<float> noise(0, 2);
+    for(size_t n = 0; n < Layout::numberOfFftBins; n++)
+        bins[n] = floor[n] + noise(random);
+
+    size_t const center = Layout::iqOffset - Layout::minBinIndex;
+    size_t const passage = frame / passageFrames;
+    size_t const distance = Layout::maxPedestrianBin + 1 + (frame % passageFrames) * 4;
+    if(passage % 3 == 2 || distance >= Layout::rawBinCount)
+        return; // a quiet passage
+    bool const reverse = passage % 2 == 1;
+    size_t const target = reverse ? center - distance : center + distance;
+    size_t const ghost = reverse ? center + distance : center - distance;
+    bins[target] = floor[target] + targetLevel;
+    bins[ghost] = bins[target] + ghostLevel;
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+bool readFile(std::string const& name, std::string& data)
+{
+    std::ifstream input(name, std::ios::binary);
+    if(not input)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+
+/// a float raw file of synthetic frames; with sensor they also go through the data part of loop() and table gets the
+/// csv lines of the sensor
+bool writeRecording(std::string const& name, size_t frames, unsigned seed, Sensor* sensor, Print& table)
+{
+    NoiseFloorEstimator<Layout> const floor;
+    std::mt19937 random(seed);
+
+    // the header of FileWriter::openRawFile for float bins
+    std::vector<uint8_t> file;
+    append(file, uint16_t(1));
+    append(file, uint32_t(1711700000));
+    append(file, Layout::numberOfFftBins);
+    append(file, uint8_t(Layout::iqMeasurement));
+    append(file, Layout::sampleRate);
+
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+    for(size_t frame = 0; frame < frames; frame++)
+    {
+        float* const bins = fft.data() + Layout::minBinIndex;
+        makeFrame(frame, floor, random, bins);
+        uint32_t const timestamp = uint32_t(1000 + frame * Layout::framePeriodMicros / 1000);
+        append(file, timestamp);
+        for(size_t n = 0; n < Layout::numberOfFftBins; n++)
+            append(file, bins[n]);
+        if(not sensor)
+            continue;
+
+        HostEnvironment::setMillis(timestamp);
+        HostEnvironment::setFftFrame(fft.data());
+        if(not sensor->audio.hasData())
+            return false;
+        sensor->results.timestamp = millis();
+        sensor->audio.processData(sensor->results);
+        sensor->results.sequence = 0; // not in version 1 files
+        CsvFormat::printLine(table, sensor->results);
+    }
+    return writeFile(name, file);
+}
+
+/// the line of the first difference, 0 if the tables are identical
+size_t firstDifference(std::string const& expected, std::string const& result)
+{
+    if(expected == result)
+        return 0;
+    size_t line = 1;
+    for(size_t i = 0; i < expected.size() && i < result.size() && expected[i] == result[i]; i++)
+        line += expected[i] == '\n';
+    return line;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <reprocess> <dir> [--frames 3000] [--threads 4] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.reprocess = argv[1];
+    options.directory = argv[2];
+    for(int i = 3; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--frames")
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--threads")
+            options.threads = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    std::string const recordings = options.directory + "/recordings";
+    std::filesystem::create_directories(recordings);
+    std::vector<std::string> names;
+    for(size_t i = 0; i < recordingCount; i++)
+        names.push_back("recording_" + std::to_string(i));
+
+    // like on the device the pipeline is too large for the stack
+    static Sensor sensor;
+    sensor.audio.setup(sensor.config.audio);
+    std::string expected = std::string(CsvFormat::header) + "\r\n";
+    StringPrint table(expected);
+    for(size_t i = 0; i < recordingCount; i++)
+    {
+        size_t const frames = options.frames * recordingQuarters[i] / 4;
+        Sensor* const reference = i == 0 ? &sensor : nullptr;
+        if(not writeRecording(recordings + "/" + names[i] + ".bin", frames, options.seed + i, reference, table))
+        {
+            std::cerr << "Unable to write into " << recordings << std::endl;
+            return 1;
+        }
+    }
+
+    // the tables of all recordings and summary.csv of a run
+    auto const run = [&](std::string const& arguments) {
+        std::string const output = options.directory + "/reprocessed";
+        std::filesystem::remove_all(output);
+        std::string const command = "\"" + options.reprocess + "\" \"" + recordings + "\" --out \"" + output + "\" " +
+                                    arguments + " >/dev/null";
+        std::vector<std::string> tables(recordingCount + 1);
+        bool ok = std::system(command.c_str()) == 0;
+        for(size_t i = 0; ok && i < recordingCount; i++)
+            ok = readFile(output + "/" + names[i] + ".csv", tables[i]);
+        if(not ok || not readFile(output + "/summary.csv", tables.back()))
+        {
+            std::cerr << "Unable to run " << command << std::endl;
+            std::exit(1);
+        }
+        return tables;
+    };
+
+    bool failed = false;
+    auto const expect = [&failed](bool condition, std::string const& what) {
+        std::printf("%s: %s\n", condition ? "ok" : "failed", what.c_str());
+        failed = failed || not condition;
+    };
+
+    auto const sequential = run("--threads 1");
+    size_t const line = firstDifference(expected, sequential[0]);
+    expect(line == 0, "reprocess --threads 1 has the table of the sensor" +
+                          (line > 0 ? ", differs in line " + std::to_string(line) : std::string()));
+    expect(run("--threads 1 --no-ghosts")[0] != expected, "reprocess --no-ghosts differs from the sensor");
+
+    // a chunk with a warm-up over everything in front of it starts from the state of the sequential run
+    std::string const threads = std::to_string(options.threads);
+    std::string const warmUp = std::to_string(options.frames);
+    for(std::string const& arguments :
+        {"--threads " + threads, "--threads " + threads + " --chunk-frames 700 --warm-up " + warmUp})
+    {
+        auto const parallel = run(arguments);
+        for(size_t i = 0; i < recordingCount; i++)
+        {
+            size_t const line = firstDifference(sequential[i], parallel[i]);
+            expect(line == 0, "reprocess " + arguments + " has the table of --threads 1 for " + names[i] +
+                                  (line > 0 ? ", differs in line " + std::to_string(line) : std::string()));
+        }
+        expect(parallel.back() == sequential.back(), "reprocess " + arguments + " has the summary of --threads 1");
+    }
+
+    std::printf("%zu frames, %zu bytes of csv from the sensor\n", options.frames, expected.size());
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,541 @@
+// Simulates loop() on a microsecond clock to check that the FFT frames keep their deadlines when the SD card is slow
+// (see Scheduler.h). FFT frames arrive every period of the layout (or --period us); the analysis of one takes
+// --analysis us and puts its records into the RAM rings of the files, about as large as those of FileWriter, and the
+// serial output. The card writes a sector in --sector us; from --slow-from to --slow-until s it takes --slow-sector us
+// and a write stalls for another --stall us with probability --stall-rate, like a card that erases blocks. A flush
+// costs three sectors, the noise floor checkpoint every 600 s three sectors and a flush. Every --file-seconds s each
+// file is closed (three sectors) and the next one opened (two sectors). The card is missing for the first
+// --card-after s, a setup attempt takes --card-setup us.
+//
+// The run is simulated twice: with the polling loop() of the sensor before the scheduler (a missing card is retried
+// with delay(1000) in between, every idle call serves each file with up to 4 sectors and waits 1 ms, the frame closes
+// and opens the files itself) and with the tasks and budgets of sensor.ino and Config.h, where the frame only switches
+// the rings and the sd task closes and opens the files a step per slice. Per run the tool prints the frames, the ones
+// lost because the next one arrived before they were picked up, the deadline misses (done more than one period after
+// the arrival), the longest pick-up latency, the bytes dropped from full rings and the sectors written; then the
+// statistics of the scheduler, whose deadline misses are counted from the poll before the pick-up and may be more.
+//
+// The tool fails with exit code 2 if the scheduler loses a frame, counts a deadline miss or a slice went over its
+// budget without a slow card access in it. A card access cannot be interrupted, so the slices of a slow card may take
+// longer than their budget; the default stall still fits into a frame period together with the flush it delays.
+//
+// usage: schedulercheck [--seconds 600] [--period N] [--analysis 3000] [--sector 700] [--slow-from 200]
+//                       [--slow-until 400] [--slow-sector 8000] [--stall 50000] [--stall-rate 0.01] [--card-after 30]
+//                       [--card-setup 30000] [--file-seconds 150] [--seed 1]
+
+#include "../Config.h"
+#include "../Scheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+
+namespace
+{
+struct Options
+{
+    uint32_t seconds = 600;
+    uint32_t periodMicros = AudioSystem::Layout::framePeriodMicros;
+    uint32_t analysisMicros = 3000;
+    uint32_t sectorMicros = 700;
+    uint32_t slowFrom = 200;
+    uint32_t slowUntil = 400;
+    uint32_t slowSectorMicros = 8000;
+    uint32_t stallMicros = 50000;
+    double stallRate = 0.01;
+    uint32_t cardAfter = 30;
+    uint32_t cardSetupMicros = 30000;
+    uint32_t fileSeconds = 150;
+    unsigned seed = 1;
+};
+
+/// a file ring of FileWriter (see BufferedFile.hpp)
+struct Stream
+{
+    char const* name;
+    size_t bytesPerFrame;
+    size_t capacity;
+    uint32_t flushIntervalMs;
+
+    size_t fill = 0;
+    size_t maxFill = 0;
+    bool hasUnflushedData = false;
+    uint64_t lastFlush = 0;
+    bool switching = false; // the ring was switched to the next file, the current one is still open
+    bool closed = false;    // during the switch: the current file is closed, the next one not yet open
+};
+
+constexpr size_t sectorSize = 512;
+constexpr size_t streamCount = 6;
+constexpr size_t serialBytesPerFrame = 1000; // quantized spectrum
+constexpr uint32_t serialSliceMicros = 150;  // one write into the USB buffer
+constexpr size_t serialSliceBytes = 2048;
+constexpr uint64_t checkpointMicros = 600000000;
+constexpr size_t closeSectors = 3; // the partial sector, directory entry and FAT
+constexpr size_t openSectors = 2;  // directory search and the new entry
+
+struct Result
+{
+    uint32_t frames = 0;
+    uint32_t lost = 0;
+    uint32_t deadlineMisses = 0;
+    uint64_t maxLatency = 0;
+    uint64_t droppedBytes = 0;
+    uint32_t sectors = 0;
+    uint32_t files = 0;
+    std::map<std::string, uint32_t> slowOverruns; // per task: slices over budget with a slow card access in them
+};
+
+/// the sensor and its card; a global, the tasks of the scheduler are plain functions
+struct World
+{
+    Options options;
+    std::mt19937 random;
+    std::uniform_real_distribution<double> uniform{0, 1};
+
+    uint64_t now = 0;
+    uint64_t nextArrival = 0;
+    bool frameAvailable = false;
+    uint64_t arrival = 0;
+
+    // about the rings of FileWriter with the default 1024 point IQ layout, 8 bit raw data and summaries
+    Stream streams[streamCount] = {
+        {"raw", 700, 64 * sectorSize, 10000},
+        {"index", 1, 2 * sectorSize, 1000},
+        {"metrics", 40, 4 * sectorSize, 1000},
+        {"summary 1 s", 70, 4 * sectorSize, 1000},
+        {"summary 10 s", 7, 4 * sectorSize, 1000},
+        {"summary 60 s", 1, 4 * sectorSize, 1000},
+    };
+    size_t nextStream = 0;
+    size_t serialPending = 0;
+    bool canWriteData = false;
+    uint64_t lastCardSetup = 0;
+    uint64_t lastHousekeeping = 0;
+    uint64_t lastCheckpoint = 0;
+    uint64_t lastFiles = 0;
+    bool sliceSlowed = false; // the slice of the current task had a slow card access
+
+    Result result;
+
+    /// the clock runs, the FFT frames arrive; a frame that was not picked up is overwritten like in IqFftOutput
+    void advance(uint64_t micros)
+    {
+        now += micros;
+        for(; nextArrival <= now; nextArrival += options.periodMicros)
+        {
+            if(frameAvailable)
+                result.lost++;
+            frameAvailable = true;
+            arrival = nextArrival;
+        }
+    }
+
+    bool isSlow() const
+    {
+        return now >= uint64_t(options.slowFrom) * 1000000 && now < uint64_t(options.slowUntil) * 1000000;
+    }
+
+    /// one write or flush call of the card; a stall can come with each of them
+    void accessCard(size_t sectors)
+    {
+        uint64_t micros = sectors * (isSlow() ? options.slowSectorMicros : options.sectorMicros);
+        if(isSlow() && uniform(random) < options.stallRate)
+            micros += options.stallMicros;
+        sliceSlowed = sliceSlowed || isSlow();
+        advance(micros);
+        result.sectors += sectors;
+    }
+
+    /// BufferedFile::service()
+    size_t service(Stream& stream, size_t maxSectors)
+    {
+        size_t sectorsLeft = maxSectors;
+        for(; sectorsLeft > 0 && stream.fill >= sectorSize; sectorsLeft--)
+        {
+            accessCard(1);
+            stream.fill -= sectorSize;
+            stream.hasUnflushedData = true;
+        }
+        if(stream.switching && not stream.closed && sectorsLeft > 0)
+        {
+            accessCard(closeSectors);
+            stream.closed = true;
+            sectorsLeft--;
+        }
+        if(stream.switching && sectorsLeft > 0)
+        {
+            accessCard(openSectors);
+            stream.switching = stream.closed = false;
+            stream.lastFlush = now;
+            stream.hasUnflushedData = false;
+            result.files++;
+            sectorsLeft--;
+        }
+        if(not stream.switching && sectorsLeft > 0 && stream.hasUnflushedData &&
+           now - stream.lastFlush >= stream.flushIntervalMs * 1000ull)
+        {
+            accessCard(3);
+            stream.lastFlush = now;
+            stream.hasUnflushedData = false;
+            sectorsLeft--;
+        }
+        return maxSectors - sectorsLeft;
+    }
+
+    bool needsService() const
+    {
+        for(auto const& stream : streams)
+            if(stream.fill >= sectorSize || stream.switching ||
+               (stream.hasUnflushedData && now - stream.lastFlush >= stream.flushIntervalMs * 1000ull))
+                return true;
+        return false;
+    }
+
+    /// FileWriter::service(): the sectors of all files together, round robin
+    void serviceFiles(size_t maxSectors)
+    {
+        size_t sectors = 0;
+        size_t const first = nextStream;
+        for(size_t i = 0; i < streamCount && sectors < maxSectors; i++)
+        {
+            size_t const index = (first + i) % streamCount;
+            sectors += service(streams[index], maxSectors - sectors);
+            nextStream = (index + 1) % streamCount;
+        }
+    }
+
+    /// the next files: the loop() before the scheduler wrote the rest, closed and opened them in the frame, the frame
+    /// task only switches the rings (BufferedFile::switchTo())
+    void startFiles(bool inFrame)
+    {
+        lastFiles = now;
+        for(auto& stream : streams)
+        {
+            if(not inFrame)
+            {
+                stream.switching = true;
+                continue;
+            }
+            accessCard(stream.fill / sectorSize);
+            accessCard(closeSectors);
+            accessCard(openSectors);
+            stream.fill = 0;
+            stream.lastFlush = now;
+            stream.hasUnflushedData = false;
+            result.files++;
+        }
+    }
+
+    void processFrame(bool filesInFrame)
+    {
+        frameAvailable = false;
+        uint64_t const released = arrival;
+        if(now - released > result.maxLatency)
+            result.maxLatency = now - released;
+
+        advance(options.analysisMicros);
+        if(canWriteData && now - lastFiles >= uint64_t(options.fileSeconds) * 1000000)
+            startFiles(filesInFrame);
+        if(canWriteData)
+            for(auto& stream : streams)
+            {
+                if(stream.fill + stream.bytesPerFrame > stream.capacity)
+                    result.droppedBytes += stream.bytesPerFrame;
+                else
+                    stream.fill += stream.bytesPerFrame;
+                if(stream.fill > stream.maxFill)
+                    stream.maxFill = stream.fill;
+            }
+        serialPending += serialBytesPerFrame;
+
+        result.frames++;
+        if(now - released > options.periodMicros)
+            result.deadlineMisses++;
+    }
+
+    void serviceSerial()
+    {
+        if(serialPending == 0)
+            return;
+        advance(serialSliceMicros);
+        serialPending -= serialPending < serialSliceBytes ? serialPending : serialSliceBytes;
+    }
+
+    void setupCard()
+    {
+        lastCardSetup = now;
+        advance(options.cardSetupMicros);
+        canWriteData = now >= uint64_t(options.cardAfter) * 1000000;
+        lastFiles = now;
+    }
+
+    /// the noise floor checkpoint, it checks its own interval
+    void housekeeping()
+    {
+        lastHousekeeping = now;
+        if(now - lastCheckpoint < checkpointMicros)
+        {
+            advance(5);
+            return;
+        }
+        lastCheckpoint = now;
+        accessCard(3);
+        accessCard(3);
+    }
+};
+
+World world;
+Config const config;
+
+uint32_t simulatedMicros()
+{
+    return uint32_t(world.now);
+}
+
+bool frameReady()
+{
+    return world.frameAvailable;
+}
+
+/// one slice of a task that uses the card, with the overruns a slow card access explains
+void cardSlice(char const* name, uint32_t budgetMicros, void (*work)())
+{
+    uint64_t const start = world.now;
+    world.sliceSlowed = false;
+    work();
+    if(world.now - start > budgetMicros && world.sliceSlowed)
+        world.result.slowOverruns[name]++;
+}
+
+void runFrame()
+{
+    world.processFrame(false);
+}
+
+bool serialReady()
+{
+    return world.serialPending > 0;
+}
+
+void runSerial()
+{
+    world.serviceSerial();
+}
+
+bool sdReady()
+{
+    return world.canWriteData && world.needsService();
+}
+
+void runSd()
+{
+    cardSlice("sd", config.sdSliceBudgetMicros, []() { world.serviceFiles(config.sdSectorsPerSlice); });
+}
+
+bool cardReady()
+{
+    return not world.canWriteData && world.now - world.lastCardSetup >= config.cardRetryMs * 1000ull;
+}
+
+void runCard()
+{
+    world.setupCard();
+}
+
+bool housekeepingReady()
+{
+    return world.canWriteData && world.now - world.lastHousekeeping >= 1000000;
+}
+
+void runHousekeeping()
+{
+    cardSlice("housekeeping", config.housekeepingBudgetMicros, []() { world.housekeeping(); });
+}
+
+void start(Options const& options)
+{
+    world = World();
+    world.options = options;
+    world.random.seed(options.seed);
+    world.nextArrival = options.periodMicros;
+}
+
+/// loop() before the scheduler
+Result runLegacy(Options const& options)
+{
+    start(options);
+    uint64_t const end = uint64_t(options.seconds) * 1000000;
+    world.setupCard();
+    while(world.now < end)
+    {
+        if(not world.canWriteData)
+        {
+            world.setupCard();
+            world.advance(1000000);
+            continue;
+        }
+        if(not world.frameAvailable)
+        {
+            for(auto& stream : world.streams)
+                world.service(stream, 4);
+            world.serviceSerial();
+            world.housekeeping();
+            world.advance(1000);
+            continue;
+        }
+        world.processFrame(true);
+    }
+    return world.result;
+}
+
+/// the tasks of sensor.ino
+Result runScheduled(Options const& options, Scheduler& scheduler)
+{
+    start(options);
+    uint64_t const end = uint64_t(options.seconds) * 1000000;
+    world.setupCard();
+
+    uint32_t const period = options.periodMicros;
+    uint32_t const maxDelay = config.maxSliceDelayMs * 1000;
+    scheduler.add(Scheduler::realtime("frame", frameReady, runFrame, 0, config.frameBudgetMicros, period, period));
+    scheduler.add(Scheduler::background("serial", serialReady, runSerial, 1, config.serialSliceBudgetMicros, maxDelay));
+    scheduler.add(Scheduler::background("sd", sdReady, runSd, 2, config.sdSliceBudgetMicros, maxDelay));
+    scheduler.add(Scheduler::background("card", cardReady, runCard, 3, config.cardSetupBudgetMicros, maxDelay));
+    scheduler.add(
+        Scheduler::background("housekeeping", housekeepingReady, runHousekeeping, 4, config.housekeepingBudgetMicros,
+                              maxDelay));
+
+    while(world.now < end)
+        if(not scheduler.runOnce())
+            world.advance(20); // one poll of loop() with the USB events of the core
+    return world.result;
+}
+
+void printResult(char const* name, Result const& result)
+{
+    std::printf(
+        "%-10s frames %u, lost %u, deadline misses %u, max latency %llu us, dropped %llu bytes, %u sectors, %u "
+        "files\n",
+        name,
+        unsigned(result.frames),
+        unsigned(result.lost),
+        unsigned(result.deadlineMisses),
+        (unsigned long long)result.maxLatency,
+        (unsigned long long)result.droppedBytes,
+        unsigned(result.sectors),
+        unsigned(result.files));
+    for(auto const& stream : world.streams)
+        std::printf("  %-12s max fill %5zu of %5zu bytes\n", stream.name, stream.maxFill, stream.capacity);
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) override { return std::fputc(c, stdout) == EOF ? 0 : 1; }
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--seconds")
+            options.seconds = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--period")
+            options.periodMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--analysis")
+            options.analysisMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--sector")
+            options.sectorMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--slow-from")
+            options.slowFrom = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--slow-until")
+            options.slowUntil = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--slow-sector")
+            options.slowSectorMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--stall")
+            options.stallMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--stall-rate")
+            options.stallRate = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--card-after")
+            options.cardAfter = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--card-setup")
+            options.cardSetupMicros = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--file-seconds")
+            options.fileSeconds = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cerr << "usage: " << argv[0]
+                      << " [--seconds 600] [--period N] [--analysis 3000] [--sector 700] [--slow-from 200]"
+                         " [--slow-until 400] [--slow-sector 8000] [--stall 50000] [--stall-rate 0.01]"
+                         " [--card-after 30] [--card-setup 30000] [--file-seconds 150] [--seed 1]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if(options.periodMicros == 0 || options.fileSeconds == 0 || options.seconds > 4000)
+    {
+        std::cerr << "The period and the file duration have to be positive and the run at most 4000 s (the clock has "
+                     "32 bits)"
+                  << std::endl;
+        return 1;
+    }
+
+    std::printf(
+        "%u s, frame period %u us, analysis %u us, sector %u us (%u us and stalls of %u us from %u to %u s), card "
+        "after %u s\n",
+        unsigned(options.seconds),
+        unsigned(options.periodMicros),
+        unsigned(options.analysisMicros),
+        unsigned(options.sectorMicros),
+        unsigned(options.slowSectorMicros),
+        unsigned(options.stallMicros),
+        unsigned(options.slowFrom),
+        unsigned(options.slowUntil),
+        unsigned(options.cardAfter));
+
+    Result const legacy = runLegacy(options);
+    printResult("loop", legacy);
+
+    static Scheduler scheduler(simulatedMicros);
+    Result const scheduled = runScheduled(options, scheduler);
+    printResult("scheduler", scheduled);
+    StdoutPrint out;
+    scheduler.printTo(out);
+
+    // the verdict is the one of the scheduler, which counts the misses more strictly than the simulation
+    uint32_t overBudget = 0;
+    uint32_t slowCard = 0;
+    for(size_t i = 0; i < scheduler.taskCount(); i++)
+    {
+        uint32_t const over = scheduler.statistics(i).overBudget;
+        auto const slow = scheduled.slowOverruns.find(scheduler.task(i).name);
+        overBudget += over;
+        slowCard += slow == scheduled.slowOverruns.end() ? 0 : std::min(slow->second, over);
+    }
+    std::printf(
+        "over budget: %u slices, %u of them with a slow card access\n", unsigned(overBudget), unsigned(slowCard));
+
+    bool ok = true;
+    if(scheduled.lost > 0 || scheduler.deadlineMisses() > 0)
+    {
+        std::printf("failed: %u frames lost, %u deadline misses\n", unsigned(scheduled.lost),
+                    unsigned(scheduler.deadlineMisses()));
+        ok = false;
+    }
+    if(overBudget > slowCard)
+    {
+        std::printf("failed: %u slices over budget without a slow card access\n", unsigned(overBudget - slowCard));
+        ok = false;
+    }
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,372 @@
+// Replays a raw recording (any raw file version, see RawFile.h) frame by frame through the sensor pipeline as it
+// runs in loop(): AudioSystem::processData, the FileWriter buffers and SD service and the serial output. The
+// Arduino APIs are replaced by the stand-ins in host/, so this measures the pipeline code and not the hardware.
+//
+// Each frame of the recording is handed to the FFT analyser at its recorded timestamp; between two frames the idle
+// part of loop() runs once per simulated millisecond. The tool reports the frame rate, the realtime factor
+// (recorded time / processing time), the time per stage and checksums of everything written to the SD card and the
+// serial port, so a refactoring can be checked for unchanged output and for speed on a PC.
+//
+// The stages are fed into a Profiler (see Profiler.h) like on the sensor, its histograms are printed as well. As the
+// time between two frames is simulated, the service stage covers all idle calls between two frames and there is no
+// wait stage.
+//
+// The recording has to match the layout the tool was built for (CITRAD_FFT_WIDTH, CITRAD_IQ_MEASUREMENT).
+//
+// usage: sensorreplay <input.bin> [--float | --bytes] [--no-serial] [--serial-budget 4096]
+//                     [--noise-floor NOISEFLR.BIN] [--repeat 1] [--out DIR] [--serial-dump FILE]
+
+#include "RawFile.h"
+
+#include "../AudioSystem.h"
+#include "../Checksum.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../FramePool.h"
+#include "../Profiler.h"
+#include "../SerialIO.hpp"
+#include "../Tracking.h"
+#include "../host/HostEnvironment.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Layout = AudioSystem::Layout;
+using Clock = std::chrono::steady_clock;
+
+constexpr float emptyBin = -120; // dBFS of the FFT bins outside of the recorded range
+
+struct Options
+{
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    bool sendOutput = true;
+    size_t serialBudget = 4096;
+    std::string noiseFloorName;
+    unsigned repeat = 1;
+    std::string outputDirectory;
+    std::string serialDumpName;
+};
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) override { return std::fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+/// the globals of sensor.ino
+struct Sensor
+{
+    AudioSystem audio;
+    FramePool<AudioSystem::Results, 1> framePool;
+    Config config;
+    FileWriter fileWriter;
+    Tracking::Tracker tracker;
+    SerialIO serialIO;
+};
+
+bool readFile(std::string const& name, std::vector<uint8_t>& data)
+{
+    std::ifstream input(name, std::ios::binary);
+    if(not input)
+        return false;
+    data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int replay(RawFile& raw, Options const& options)
+{
+    HostEnvironment::setSerialWriteBudget(options.serialBudget);
+    HostEnvironment::setTime(raw.header().startTime);
+    if(not options.noiseFloorName.empty())
+    {
+        auto data = std::make_shared<std::vector<uint8_t>>();
+        if(not readFile(options.noiseFloorName, *data))
+        {
+            std::cerr << "Unable to read " << options.noiseFloorName << std::endl;
+            return 1;
+        }
+        HostEnvironment::sdFiles()["NOISEFLR.BIN"] = data;
+    }
+
+    // the pipeline objects are several 100 kB, like on the device they are not put on the stack
+    static Sensor sensor;
+    auto& config = sensor.config;
+
+    // setup()
+    sensor.audio.setup(config.audio);
+    sensor.fileWriter.setLog(sensor.serialIO.text());
+    sensor.fileWriter.setupSpi();
+    if(not sensor.fileWriter.setupSdCard())
+        return 1;
+    if(config.persistNoiseFloor)
+        sensor.fileWriter.loadNoiseFloor(sensor.audio.getNoiseFloor());
+
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+    Profiler profiler(Layout::framePeriodMicros);
+    double decodeSeconds = 0;
+    double stageSeconds[Profiler::StageCount] = {};
+    auto const measure = [&](Profiler::Stage stage, Clock::time_point& start) {
+        auto const end = Clock::now();
+        double const seconds = std::chrono::duration<double>(end - start).count();
+        stageSeconds[stage] += seconds;
+        profiler.add(stage, uint32_t(seconds * 1e6 + 0.5));
+        start = end;
+    };
+
+    size_t frames = 0;
+    uint32_t recordedMs = 0;
+    uint32_t now = 0;
+    uint64_t lastSequence = 0;
+    auto const begin = Clock::now();
+    for(unsigned pass = 0; pass < options.repeat; pass++)
+    {
+        uint32_t offset = now; // repeated passes continue on the timeline of the first one
+        uint64_t const sequenceOffset = lastSequence; // and on its sample clock
+        uint32_t firstTimestamp = 0;
+        uint32_t lastTimestamp = 0;
+        bool first = true;
+
+        auto start = Clock::now();
+        for(size_t index = 0; index < raw.frameCount(); index++)
+        {
+            if(not raw.readDbfs(index, fft.data() + Layout::minBinIndex))
+                continue; // after damaged data, up to the next key frame
+            uint32_t const timestamp = raw.timestamp(index);
+            uint64_t const sequence = raw.sequence(index); // 0 before version 4
+            auto const decoded = Clock::now();
+            decodeSeconds += std::chrono::duration<double>(decoded - start).count();
+            start = decoded;
+            if(first)
+                firstTimestamp = lastTimestamp = timestamp;
+            first = false;
+
+            // idle part of loop() until the frame is due, once per millisecond like with delay(1)
+            uint32_t const due = offset + (timestamp - firstTimestamp);
+            for(; now < due; now++)
+            {
+                HostEnvironment::setMillis(now);
+                sensor.fileWriter.service();
+                sensor.serialIO.service();
+                if(config.persistNoiseFloor)
+                    sensor.fileWriter.checkpointNoiseFloor(sensor.audio.getNoiseFloor(), config);
+            }
+            HostEnvironment::setMillis(now);
+            measure(Profiler::Service, start);
+            auto const frameStart = start;
+
+            // the data part of loop()
+            // frames of version 4 files keep their sample clock, so the gaps of the recording stay gaps
+            HostEnvironment::setFftFrame(fft.data(), sequence > 0 ? sequence + sequenceOffset : 0);
+            if(options.sendOutput)
+                HostEnvironment::sendSerialInput("d");
+            if(not sensor.audio.hasData())
+                continue;
+
+            SerialIO::Requests requests;
+            sensor.serialIO.processInputs(config.audio, requests);
+            measure(Profiler::Inputs, start);
+
+            FrameRef<AudioSystem::Results> frame;
+            AudioSystem::Results* results = sensor.framePool.acquire(frame);
+            if(not results)
+                continue;
+            results->timestamp = millis();
+            sensor.audio.processData(*results);
+            lastSequence = results->sequence;
+            measure(Profiler::Process, start);
+
+            if(config.writeDataToSdCard)
+            {
+                if(config.writeRawData)
+                {
+                    sensor.fileWriter.writeRawData(*frame, config.write8bit, config);
+                    measure(Profiler::RawData, start);
+                }
+                if(config.writeCsvData)
+                {
+                    sensor.fileWriter.writeCsvData(*frame, config);
+                    measure(Profiler::CsvData, start);
+                }
+                if(config.writeMetricsData)
+                {
+                    sensor.fileWriter.writeMetricsData(*frame, config);
+                    measure(Profiler::MetricsData, start);
+                }
+                if(config.writeSummaryData)
+                {
+                    sensor.fileWriter.writeSummaryData(*frame, config);
+                    measure(Profiler::SummaryData, start);
+                }
+            }
+
+            {
+                Tracking::Detection forward[Tracking::maxPeaks];
+                Tracking::Detection reverse[Tracking::maxPeaks];
+                sensor.tracker.update(
+                    frame->timestamp,
+                    forward,
+                    frame->detections(false, forward),
+                    reverse,
+                    frame->detections(true, reverse));
+
+                Tracking::Event event;
+                while(sensor.tracker.nextEvent(event))
+                    if(config.writeDataToSdCard && config.writeEventData)
+                        sensor.fileWriter.writeEventData(event, config);
+                measure(Profiler::EventData, start);
+            }
+
+            if(requests.output)
+            {
+                sensor.serialIO.sendOutput(*frame, sensor.audio, config);
+                measure(Profiler::SerialOutput, start);
+            }
+
+            double const frameSeconds = std::chrono::duration<double>(start - frameStart).count();
+            stageSeconds[Profiler::Frame] += frameSeconds;
+            profiler.frameDone(frame->timestamp, uint32_t(frameSeconds * 1e6 + 0.5));
+
+            lastTimestamp = timestamp;
+            frames++;
+        }
+
+        recordedMs += lastTimestamp - firstTimestamp;
+        // the gap to the next pass is one frame period, so the files continue without a jump
+        if(frames > 0)
+            now += Layout::framePeriodMicros / 1000;
+    }
+
+    // drain the buffers: the remaining serial output and the partial last sectors of the files
+    for(size_t i = 0; i < 1000; i++)
+        sensor.serialIO.service();
+    // passages still in progress at the end of the recording
+    sensor.tracker.finish();
+    Tracking::Event event;
+    while(sensor.tracker.nextEvent(event))
+        if(config.writeDataToSdCard and config.writeEventData)
+            sensor.fileWriter.writeEventData(event, config);
+    sensor.fileWriter.close();
+    double const seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    // the statistics contain measured durations, so they go to stdout and not into the checksummed serial output
+    StdoutPrint out;
+    sensor.fileWriter.printStatistics(out);
+    sensor.serialIO.printStatistics(out);
+    std::printf(
+        "%u point FFT%s, %zu frames, %.2f s recorded, %.3f s processing\n"
+        "%.0f frames/s, realtime factor %.1f\n",
+        unsigned(Layout::fftWidth),
+        Layout::iqMeasurement ? " (IQ)" : "",
+        frames,
+        recordedMs / 1000.0,
+        seconds,
+        frames / seconds,
+        recordedMs / 1000.0 / seconds);
+    auto const printStage = [frames](char const* name, double seconds) {
+        std::printf("  %-8s %9.3f ms %8.2f us/frame\n", name, seconds * 1000, frames > 0 ? seconds * 1e6 / frames : 0.0);
+    };
+    printStage("decode", decodeSeconds);
+    for(size_t i = 0; i < Profiler::StageCount; i++)
+        if(profiler.histogram(Profiler::Stage(i)).count > 0)
+            printStage(Profiler::stageName(Profiler::Stage(i)), stageSeconds[i]);
+    profiler.printTo(out);
+    return 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> [--float | --bytes] [--no-serial] [--serial-budget 4096] [--noise-floor file]"
+                     " [--repeat 1] [--out dir] [--serial-dump file]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(option == "--no-serial")
+            options.sendOutput = false;
+        else if(i + 1 < argc && option == "--serial-budget")
+            options.serialBudget = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--noise-floor")
+            options.noiseFloorName = argv[++i];
+        else if(i + 1 < argc && option == "--repeat")
+            options.repeat = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--out")
+            options.outputDirectory = argv[++i];
+        else if(i + 1 < argc && option == "--serial-dump")
+            options.serialDumpName = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], options.layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+    auto const& header = raw.header();
+    if(header.binCount != Layout::numberOfFftBins || header.iqMeasurement != Layout::iqMeasurement)
+    {
+        std::cerr << "The file has " << header.binCount << " bins" << (header.iqMeasurement ? " (IQ)" : "")
+                  << ", this build expects " << Layout::numberOfFftBins << (Layout::iqMeasurement ? " (IQ)" : "")
+                  << "; rebuild with -DCITRAD_FFT_WIDTH / -DCITRAD_IQ_MEASUREMENT" << std::endl;
+        return 1;
+    }
+
+    int const result = replay(raw, options);
+    if(result != 0)
+        return result;
+
+    std::printf("checksums (FNV-1a):\n");
+    auto const& serialOutput = HostEnvironment::serialOutput();
+    std::printf(
+        "  %08x %8zu bytes  serial\n", Checksum::fnv1a(serialOutput.data(), serialOutput.size()), serialOutput.size());
+    if(not options.serialDumpName.empty())
+    {
+        std::ofstream output(options.serialDumpName, std::ios::binary);
+        output.write(reinterpret_cast<char const*>(serialOutput.data()), serialOutput.size());
+        if(not output)
+        {
+            std::cerr << "Unable to write " << options.serialDumpName << std::endl;
+            return 1;
+        }
+    }
+    for(auto const& entry : HostEnvironment::sdFiles())
+    {
+        std::printf("  %08x %8zu bytes  %s\n", Checksum::fnv1a(entry.second->data(), entry.second->size()),
+                    entry.second->size(), entry.first.c_str());
+        if(options.outputDirectory.empty())
+            continue;
+
+        std::ofstream output(options.outputDirectory + "/" + entry.first, std::ios::binary);
+        output.write(reinterpret_cast<char const*>(entry.second->data()), entry.second->size());
+        if(not output)
+        {
+            std::cerr << "Unable to write " << entry.first << " to " << options.outputDirectory << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Checks the sequence numbers of the spectra handed from the audio interrupt to loop() (IqFftOutput.h, FrameClock.h)
+// with dropped audio blocks and late pickups: noise is fed in blocks of 128 samples like the audio library does, a
+// block is left out now and then as if the pool had no free block, and loop() picks up the spectra at random times
+// like behind a slow SD card. Every hop of the 256 bin FFT is checked.
+//
+// A hop of at least one block (the hops SpectrumLayout.h allows) completes at most one spectrum per block. The shorter
+// hops complete several and hand over only the last one, the others count as missed.
+//
+// The sequence numbers handed out have to increase; together with the missed spectra they have to be exactly the
+// hops of the sample clock whose window holds no dropped sample. Every spectrum handed out has to equal the direct
+// transform of its window and carry the capture time of the block that completed it. The tool fails with exit code 2
+// otherwise.
+//
+// usage: sequencecheck [--blocks 20000] [--drop 0.01] [--pickup 0.7] [--seed 1]
+
+#include "../IqFftOutput.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr uint16_t fftWidth = 256;
+constexpr size_t blockSamples = 128;
+
+struct Options
+{
+    size_t blocks = 20000;
+    double drop = 0.01;  // probability of a missing block
+    double pickup = 0.7; // probability that loop() picks up a spectrum after a block
+    unsigned seed = 1;
+};
+
+/// feeds the blocks with one hop; false with a message on the first mismatch
+bool check(uint16_t hop, Options const& options)
+{
+    std::mt19937 random(options.seed);
+    std::normal_distribution<float> noise(0, 0.1f);
+    std::bernoulli_distribution dropBlock(options.drop);
+    std::bernoulli_distribution pickUp(options.pickup);
+
+    // the samples on the sample clock, missing ones are marked
+    size_t const samples = options.blocks * blockSamples;
+    std::vector<float> i(samples);
+    std::vector<float> q(samples);
+    std::vector<bool> missing(samples);
+
+    auto output = std::make_unique<IqFftOutput<fftWidth>>();
+    auto reference = std::make_unique<IqFft<fftWidth>>();
+    output->setWindow(FftWindow::Hann);
+    output->setHop(hop);
+    reference->setWindow(FftWindow::Hann);
+
+    std::vector<float> expected(fftWidth);
+    uint64_t lastSequence = 0;
+    size_t handedOut = 0;
+    for(size_t block = 0; block < options.blocks; block++)
+    {
+        size_t const first = block * blockSamples;
+        bool const dropped = dropBlock(random);
+        for(size_t n = first; n < first + blockSamples; n++)
+        {
+            i[n] = noise(random);
+            q[n] = noise(random);
+            missing[n] = dropped;
+        }
+
+        size_t const completed = dropped ? output->update(nullptr, nullptr, blockSamples)
+                                         : output->update(&i[first], &q[first], blockSamples);
+        if(completed > 0)
+            output->setCaptureTime({uint32_t(block), 0});
+        if(hop >= blockSamples && completed > 1)
+        {
+            std::printf("  hop %u: %zu spectra in block %zu\n", unsigned(hop), completed, block);
+            return false;
+        }
+
+        if(not output->available() || not pickUp(random))
+            continue;
+        output->handOver();
+        handedOut++;
+
+        uint64_t const sequence = output->sequence();
+        size_t const end = size_t(sequence) * hop; // sample clock after the last sample of the window
+        if(sequence <= lastSequence || end < fftWidth || end > first + blockSamples)
+        {
+            std::printf("  hop %u: sequence %llu after %llu in block %zu\n",
+                        unsigned(hop),
+                        (unsigned long long)sequence,
+                        (unsigned long long)lastSequence,
+                        block);
+            return false;
+        }
+        lastSequence = sequence;
+
+        if(output->captureTime().seconds != (end - 1) / blockSamples)
+        {
+            std::printf("  hop %u: sequence %llu has the capture time of block %u\n",
+                        unsigned(hop),
+                        (unsigned long long)sequence,
+                        unsigned(output->captureTime().seconds));
+            return false;
+        }
+
+        reference->transform(&i[end - fftWidth], &q[end - fftWidth], expected.data());
+        for(size_t n = 0; n < fftWidth; n++)
+        {
+            if(missing[end - fftWidth + n] || output->data()[n] != expected[n])
+            {
+                std::printf("  hop %u: spectrum %llu differs from its window\n",
+                            unsigned(hop),
+                            (unsigned long long)sequence);
+                return false;
+            }
+        }
+    }
+
+    // every hop of the clock whose window is complete was transformed: handed out or missed
+    size_t complete = 0;
+    size_t run = 0; // samples since the last missing one
+    for(size_t n = 0; n < samples; n++)
+    {
+        run = missing[n] ? 0 : run + 1;
+        complete += (n + 1) % hop == 0 && run >= fftWidth;
+    }
+    size_t const transformed = handedOut + output->missedCount() + (output->available() ? 1 : 0);
+    std::printf("hop %3u: %zu blocks, %u dropped, %zu spectra expected, %zu handed out, %u missed\n",
+                unsigned(hop),
+                options.blocks,
+                unsigned(output->droppedBlockCount()),
+                complete,
+                handedOut,
+                unsigned(output->missedCount()));
+    if(transformed != complete || output->spectrumCount() != complete)
+    {
+        std::printf("  hop %u: %zu spectra accounted for, %u transformed\n",
+                    unsigned(hop),
+                    transformed,
+                    unsigned(output->spectrumCount()));
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--blocks")
+            options.blocks = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--drop")
+            options.drop = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--pickup")
+            options.pickup = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--blocks 20000] [--drop 0.01] [--pickup 0.7] [--seed 1]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    for(uint16_t hop : {256, 128, 64, 32, 96})
+        ok = check(hop, options) && ok;
+    std::printf("%s\n", ok ? "all sequences consistent" : "FAILED");
+    return ok ? 0 : 2;
+}
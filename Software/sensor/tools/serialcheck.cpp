@@ -0,0 +1,339 @@
+// Checks SerialFormat::Decoder on a stream like the sensor's serial port carries it: frames of every payload type
+// with status text between them, garbage with stray and false sync words, text that ended up inside a frame, a frame
+// with a flipped byte and frames that never arrived. The corrupted frames have to be rejected by their checksum, the
+// decoder has to resynchronise on the next frame, the missing and the corrupted frames have to be counted as lost by
+// the sequence numbers (also across the wrap-around of the sequence), Delta8 frames after a gap must not decode until
+// the next key frame and every frame that is returned has to match the one that was sent.
+//
+// The stream is decoded at once and in random fragments of 1 to 64 bytes with the same result. Then it is written
+// into a pseudo terminal, read by <serialdecode> from its other end, and the statistics serialdecode prints have to
+// match.
+//
+// The tool fails with exit code 2 and prints every check that failed.
+//
+// usage: serialcheck <serialdecode> [--seed 1]
+
+#include "../SerialFormat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+using SerialFormat::FrameInfo;
+using SerialFormat::PayloadType;
+
+struct Options
+{
+    std::string decoder;
+    unsigned seed = 1;
+};
+
+bool failed = false;
+
+void expect(bool condition, std::string const& what)
+{
+    if(condition)
+        return;
+    std::printf("failed: %s\n", what.c_str());
+    failed = true;
+}
+
+/// what the receiver has to see of a frame: the bins as the payload type carries them
+struct Sent
+{
+    FrameInfo info;
+    std::vector<float> bins;
+};
+
+/// the stream and what it holds
+struct Stream
+{
+    std::vector<uint8_t> bytes;
+    std::map<uint16_t, Sent> frames; // by sequence number
+    size_t sent = 0;                 // frames encoded, also the missing and the corrupted ones
+    size_t lost = 0;                 // frames missing or corrupted
+};
+
+void append(std::vector<uint8_t>& bytes, char const* text)
+{
+    bytes.insert(bytes.end(), text, text + strlen(text));
+}
+
+/// 40 frames of one payload type with every kind of damage, and the status text of the sensor in between
+void addFrames(Stream& stream, SerialFormat::Encoder& encoder, PayloadType type, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> value(-25, 110);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> frame(SerialFormat::maxFrameSize(RawCompression::maxBinCount));
+
+    for(size_t i = 0; i < 40; i++)
+    {
+        Sent sent;
+        sent.info.type = type;
+        sent.info.timestamp = uint32_t(1000 + 85 * i);
+        sent.info.micGain = int8_t(i % 7 - 3);
+        sent.info.maxFreqIndex = uint16_t(i * 11);
+        sent.info.peak = 0.25f * i;
+        sent.info.binCount = uint16_t(100 + i % 3 * 50);
+        sent.bins.resize(sent.info.binCount);
+        for(float& bin : sent.bins)
+            bin = value(random);
+        size_t const size = encoder.encode(sent.info, sent.bins.data(), frame.data());
+        sent.info.sequence = uint16_t(stream.sent);
+        if(type != PayloadType::Float32)
+            for(float& bin : sent.bins)
+                bin = SerialFormat::dequantize(SerialFormat::quantize(bin));
+
+        std::vector<uint8_t> bytes(frame.begin(), frame.begin() + size);
+        stream.sent++;
+        if(i == 5 || i == 6)
+        {
+            stream.lost++; // never arrives
+            continue;
+        }
+        if(i == 11)
+        {
+            // a status line in the middle of the frame
+            std::vector<uint8_t> text;
+            append(text, "Creating new file: test_unit_2024-03-21_10-00-00.csv\r\n");
+            bytes.insert(bytes.begin() + size / 2, text.begin(), text.end());
+            stream.lost++;
+        }
+        else if(i == 17)
+        {
+            bytes[SerialFormat::headerSize + 3] ^= 0x10;
+            stream.lost++;
+        }
+        else if(i == 23)
+        {
+            // garbage with a lone first sync byte, a sync word with an invalid header and one cut short
+            for(size_t n = 0; n < 50; n++)
+                stream.bytes.push_back(uint8_t(byte(random)));
+            stream.bytes.push_back(SerialFormat::sync[0]);
+            stream.bytes.insert(stream.bytes.end(), {SerialFormat::sync[0], SerialFormat::sync[1], 7, 1, 0, 0});
+            stream.bytes.insert(stream.bytes.end(), 30, 0);
+            stream.bytes.insert(stream.bytes.end(), {SerialFormat::sync[0], SerialFormat::sync[1]});
+            stream.frames[sent.info.sequence] = sent;
+        }
+        else
+            stream.frames[sent.info.sequence] = sent;
+        if(i % 4 == 0)
+            append(stream.bytes, "SD card initialized\r\n");
+        stream.bytes.insert(stream.bytes.end(), bytes.begin(), bytes.end());
+    }
+}
+
+/// decodes the stream in fragments of 1 to maxFragment bytes and checks every frame against what was sent
+SerialFormat::Decoder::Statistics decode(Stream const& stream, size_t maxFragment, std::mt19937& random)
+{
+    static SerialFormat::Decoder decoder;
+    decoder = SerialFormat::Decoder();
+    std::uniform_int_distribution<size_t> fragment(1, maxFragment);
+    std::vector<float> bins(RawCompression::maxBinCount);
+    FrameInfo info;
+    size_t mismatches = 0;
+    for(size_t offset = 0; offset < stream.bytes.size();)
+    {
+        size_t const size = std::min(fragment(random), stream.bytes.size() - offset);
+        for(size_t end = offset + size; offset < end;)
+        {
+            offset += decoder.push(stream.bytes.data() + offset, end - offset);
+            while(decoder.next(info, bins.data(), bins.size()))
+            {
+                auto const sent = stream.frames.find(info.sequence);
+                bool const same = sent != stream.frames.end() && info.type == sent->second.info.type &&
+                                  info.timestamp == sent->second.info.timestamp &&
+                                  info.micGain == sent->second.info.micGain &&
+                                  info.maxFreqIndex == sent->second.info.maxFreqIndex &&
+                                  info.peak == sent->second.info.peak && info.binCount == sent->second.info.binCount &&
+                                  std::equal(sent->second.bins.begin(), sent->second.bins.end(), bins.begin());
+                mismatches += not same;
+            }
+        }
+    }
+    expect(mismatches == 0, std::to_string(mismatches) + " frames differ from the ones sent");
+    return decoder.statistics();
+}
+
+void checkStream(Stream const& stream, std::mt19937& random)
+{
+    auto const whole = decode(stream, stream.bytes.size(), random);
+    size_t const arrived = stream.sent - stream.lost;
+    expect(whole.frames + whole.undecodable == arrived,
+           std::to_string(whole.frames) + " frames and " + std::to_string(whole.undecodable) + " undecodable of " +
+               std::to_string(arrived));
+    // a Delta8 frame after a gap is undecodable up to the next key frame
+    expect(whole.undecodable > 0, "Delta8 frames after the gaps");
+    // text in a frame, a flipped byte and the invalid header; sync words in the rest of the broken frames are more
+    expect(whole.crcErrors >= 3, "rejected frames: " + std::to_string(whole.crcErrors));
+    expect(whole.lostFrames == stream.lost, "lost frames: " + std::to_string(whole.lostFrames));
+
+    for(int run = 0; run < 20; run++)
+    {
+        auto const fragmented = decode(stream, 64, random);
+        if(fragmented.frames != whole.frames || fragmented.lostFrames != whole.lostFrames ||
+           fragmented.crcErrors != whole.crcErrors || fragmented.skippedBytes != whole.skippedBytes ||
+           fragmented.undecodable != whole.undecodable)
+        {
+            expect(false, "decoded in fragments differs from decoded at once");
+            break;
+        }
+    }
+    if(not failed)
+        std::printf("%u of %zu frames, %u lost, %u rejected, %u undecodable, same in fragments\n",
+                    whole.frames,
+                    stream.sent,
+                    whole.lostFrames,
+                    whole.crcErrors,
+                    whole.undecodable);
+}
+
+/// the sequence numbers wrap around from 65535 to 0 without a gap
+void checkWrapAround()
+{
+    static SerialFormat::Encoder encoder;
+    static SerialFormat::Decoder decoder;
+    encoder.reset();
+    FrameInfo info;
+    info.type = PayloadType::Quantized8;
+    info.binCount = 4;
+    float bins[4] = {0, 10, 20, 30};
+    uint8_t frame[SerialFormat::maxFrameSize(4)];
+    size_t frames = 0;
+    for(uint32_t i = 0; i < 65536 + 10; i++)
+    {
+        size_t const size = encoder.encode(info, bins, frame);
+        if(i == 65534)
+            continue; // lost right before the wrap-around
+        decoder.push(frame, size);
+        while(decoder.next(info, bins, 4))
+            frames++;
+    }
+    expect(frames == 65536 + 9 && decoder.statistics().lostFrames == 1,
+           "sequence wrap-around: lost " + std::to_string(decoder.statistics().lostFrames));
+    if(not failed)
+        std::printf("sequence wrap-around: one lost frame counted\n");
+}
+
+/// the stream through a pseudo terminal into serialdecode, its statistics have to match the decoder's
+void checkTerminal(Options const& options, Stream const& stream, SerialFormat::Decoder::Statistics const& expected)
+{
+    int const master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        expect(false, "no pseudo terminal");
+        return;
+    }
+    std::string const slaveName = ptsname(master);
+    // raw before serialdecode opens it, so no byte written from here on is translated
+    int const slave = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+    termios settings;
+    if(slave < 0 || tcgetattr(slave, &settings) != 0)
+    {
+        expect(false, "pseudo terminal " + slaveName);
+        return;
+    }
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+
+    char outputName[] = "/tmp/serialcheck-XXXXXX";
+    int const output = mkstemp(outputName);
+    pid_t const child = fork();
+    if(child == 0)
+    {
+        dup2(output, STDOUT_FILENO);
+        close(master);
+        execl(options.decoder.c_str(), options.decoder.c_str(), slaveName.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    // in pieces like USB packets; serialdecode reads while the buffer of the terminal fills
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    std::mt19937 random(options.seed);
+    std::uniform_int_distribution<size_t> fragment(1, 512);
+    for(size_t offset = 0; offset < stream.bytes.size();)
+    {
+        pollfd writable = {master, POLLOUT, 0};
+        if(poll(&writable, 1, 5000) <= 0)
+            break;
+        ssize_t const written =
+            write(master, stream.bytes.data() + offset, std::min(fragment(random), stream.bytes.size() - offset));
+        if(written > 0)
+            offset += written;
+    }
+    int status = 0;
+    waitpid(child, &status, 0); // serialdecode ends a second after the last byte
+    close(slave);
+    close(master);
+
+    std::ifstream file(outputName);
+    std::string const printed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    close(output);
+    unlink(outputName);
+
+    char summary[200];
+    std::snprintf(summary,
+                  sizeof(summary),
+                  "%u frames, %u lost, %u dropped (checksum/header), %u undecodable, %u bytes skipped, %zu bytes "
+                  "received\n",
+                  expected.frames,
+                  expected.lostFrames,
+                  expected.crcErrors,
+                  expected.undecodable,
+                  expected.skippedBytes,
+                  stream.bytes.size());
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0 && printed.compare(0, strlen(summary), summary) == 0,
+           "serialdecode over " + slaveName + " printed: " + printed + "instead of: " + summary);
+    if(not failed)
+        std::printf("serialdecode over a pseudo terminal: the same statistics\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--seed")
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        else if(options.decoder.empty())
+            options.decoder = option;
+        else
+            options.decoder.clear();
+    }
+    if(options.decoder.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " <serialdecode> [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(options.seed);
+    Stream stream;
+    static SerialFormat::Encoder encoder;
+    encoder.reset(8);
+    for(PayloadType type : {PayloadType::Float32, PayloadType::Quantized8, PayloadType::Delta8})
+        addFrames(stream, encoder, type, random);
+    append(stream.bytes, "Time set to: 2024-3-21 10:00:00\r\n");
+
+    checkStream(stream, random);
+    checkWrapAround();
+    checkTerminal(options, stream, decode(stream, stream.bytes.size(), random));
+    return failed ? 2 : 0;
+}
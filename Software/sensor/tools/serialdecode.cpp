@@ -0,0 +1,145 @@
+// Decodes the spectrum frames (see SerialFormat.h) of the sensor's serial output, either live from the serial device
+// or from a file with a captured stream (e.g. written by sensorreplay --serial-dump). Text between the frames is
+// skipped, corrupted frames are dropped and the decoder resynchronises on the next sync word.
+//
+// With --request a 'd' is sent for every frame like the FFT_visualisation viewer does; --frames stops after n
+// frames. --csv writes one line per frame with the header fields and the bins in dB.
+//
+// usage: serialdecode <device|file> [--request] [--frames 0] [--csv frames.csv]
+
+#include "../SerialFormat.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+/// raw mode, so no byte of the binary frames is translated or swallowed by the line discipline
+bool makeRaw(int fd)
+{
+    termios settings;
+    if(tcgetattr(fd, &settings) != 0)
+        return false;
+    cfmakeraw(&settings);
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 10; // a read returns after 1 s without data, so a sensor that went quiet ends the run
+    return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <device|file> [--request] [--frames 0] [--csv frames.csv]" << std::endl;
+        return 1;
+    }
+
+    bool request = false;
+    size_t maxFrames = 0;
+    std::string csvName;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--request")
+            request = true;
+        else if(i + 1 < argc && option == "--frames")
+            maxFrames = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--csv")
+            csvName = argv[++i];
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    int const fd = open(argv[1], request ? O_RDWR | O_NOCTTY : O_RDONLY | O_NOCTTY);
+    if(fd < 0)
+    {
+        std::cerr << "Unable to open " << argv[1] << std::endl;
+        return 1;
+    }
+    bool const isTerminal = isatty(fd);
+    if(isTerminal && not makeRaw(fd))
+    {
+        std::cerr << "Unable to configure " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::ofstream csv;
+    if(not csvName.empty())
+    {
+        csv.open(csvName);
+        if(not csv)
+        {
+            std::cerr << "Unable to write " << csvName << std::endl;
+            return 1;
+        }
+        csv << "sequence, timestamp, type, mic_gain, max_freq_index, peak, bin_count, bins\n";
+    }
+
+    auto const sendRequest = [&]() {
+        if(request && write(fd, "d", 1) != 1)
+            std::cerr << "Unable to send the request" << std::endl;
+    };
+
+    SerialFormat::Decoder decoder;
+    SerialFormat::FrameInfo info;
+    std::vector<float> bins(RawCompression::maxBinCount);
+    std::vector<uint8_t> chunk(4096);
+    size_t received = 0;
+    size_t frames = 0;
+    auto const begin = std::chrono::steady_clock::now();
+
+    sendRequest();
+    while(maxFrames == 0 || frames < maxFrames)
+    {
+        ssize_t const count = read(fd, chunk.data(), chunk.size());
+        if(count <= 0)
+            break; // end of file, or a terminal without data for a second
+        received += count;
+
+        for(size_t offset = 0; offset < size_t(count);)
+        {
+            offset += decoder.push(chunk.data() + offset, count - offset);
+            while(decoder.next(info, bins.data(), bins.size()))
+            {
+                frames++;
+                sendRequest();
+                if(not csv.is_open())
+                    continue;
+
+                csv << info.sequence << ", " << info.timestamp << ", " << int(info.type) << ", " << int(info.micGain)
+                    << ", " << info.maxFreqIndex << ", " << info.peak << ", " << info.binCount;
+                for(size_t i = 0; i < info.binCount; i++)
+                    csv << ", " << bins[i];
+                csv << "\n";
+            }
+        }
+    }
+    close(fd);
+
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    auto const& stats = decoder.statistics();
+    std::printf(
+        "%u frames, %u lost, %u dropped (checksum/header), %u undecodable, %u bytes skipped, %zu bytes received\n",
+        stats.frames,
+        stats.lostFrames,
+        stats.crcErrors,
+        stats.undecodable,
+        stats.skippedBytes,
+        received);
+    if(isTerminal)
+        std::printf("%.1f frames/s, %.0f bytes/s\n", frames / seconds, received / seconds);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Converts a spectrogram summary file (see SpectrumSummary.h) into a csv table with one line per window: the RTC time
+// of its start, the sequence numbers, the frames and the frames missing in it, the signal counts per direction and,
+// with --levels, the lowest, mean or highest level of every bin in dBFS (columns named after the bin index relative
+// to the first analysed bin, like the raw files).
+//
+// usage: summary2csv <input.sum> [output.csv] [--levels lowest|mean|highest]
+
+#include "../SpectrumSummary.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    std::string inputName;
+    std::string outputName;
+    std::string levels;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--levels")
+            levels = argv[++i];
+        else if(inputName.empty())
+            inputName = option;
+        else if(outputName.empty())
+            outputName = option;
+        else
+            inputName.clear();
+    }
+    if(inputName.empty() || not(levels.empty() || levels == "lowest" || levels == "mean" || levels == "highest"))
+    {
+        std::cerr << "usage: " << argv[0] << " <input.sum> [output.csv] [--levels lowest|mean|highest]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(inputName, std::ios::binary);
+    if(not input)
+    {
+        std::cerr << "Unable to open " << inputName << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> const file((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    SpectrumSummary::Header header;
+    if(not SpectrumSummary::readHeader(file.data(), file.size(), header))
+    {
+        std::cerr << inputName << " is not a summary file" << std::endl;
+        return 1;
+    }
+
+    std::string out = "start, first_sequence, last_sequence, frames, missing_frames, frames_with_signal, "
+                      "frames_with_signal_reverse, bins_with_signal, bins_with_signal_reverse, max_bins_with_signal, "
+                      "max_bins_with_signal_reverse";
+    if(not levels.empty())
+        for(size_t bin = 0; bin < header.binCount; bin++)
+            out += ", " + levels + "_" + std::to_string(bin);
+    out += "\r\n";
+
+    size_t const count = SpectrumSummary::recordCount(file.data(), file.size());
+    for(size_t i = 0; i < count; i++)
+    {
+        auto const record =
+            SpectrumSummary::readRecord(&file[header.headerSize + i * header.recordSize], header.binCount);
+        uint64_t const span = record.lastSequence - record.firstSequence + 1; // hops of the sample clock
+        out += std::to_string(record.start);
+        for(uint64_t value : {record.firstSequence,
+                              record.lastSequence,
+                              uint64_t(record.frames),
+                              span > record.frames ? span - record.frames : 0,
+                              uint64_t(record.framesWithSignal),
+                              uint64_t(record.framesWithSignalReverse),
+                              uint64_t(record.binsWithSignal),
+                              uint64_t(record.binsWithSignalReverse),
+                              uint64_t(record.maxBinsWithSignal),
+                              uint64_t(record.maxBinsWithSignalReverse)})
+            out += ", " + std::to_string(value);
+
+        uint8_t const* const values = levels == "lowest" ? record.lowest
+                                      : levels == "mean" ? record.mean
+                                                         : record.highest;
+        if(not levels.empty())
+            for(size_t bin = 0; bin < header.binCount; bin++)
+                out += values[bin] ? ", -" + std::to_string(values[bin]) : std::string(", 0");
+        out += "\r\n";
+    }
+
+    if(not outputName.empty())
+    {
+        std::ofstream output(outputName, std::ios::binary);
+        output << out;
+        return output ? 0 : 1;
+    }
+
+    std::cout << out;
+    return 0;
+}
@@ -0,0 +1,353 @@
+// Checks the spectrogram summaries (see SpectrumSummary.h) against a brute force computation: a raw recording is
+// replayed through the analysis (AudioResults::process) and FileWriter with the Arduino stand-ins of host/ like in
+// sensorreplay, several passes one after the other, with frames dropped at random and the files closed once in the
+// middle. The RTC starts shortly before a UTC midnight, so the files of the day change during the replay.
+//
+// Every frame the writer got is kept; per tier the frames are grouped by their window and by the close, and each
+// record of the files written into <dir> has to equal the minimum, mean and maximum computed directly from the frames
+// of its window, in the same order and without a record missing or left over. The header of each file has to carry
+// the window, the bin count and the anchor of its first frame, and all records of a file have to be of its period
+// (summarySecondsPerFile). The tool fails with exit code 2 otherwise.
+//
+// The recording has to match the layout the tool was built for (CITRAD_FFT_WIDTH, CITRAD_IQ_MEASUREMENT).
+//
+// usage: summarycheck <input.bin> <dir> [--passes 3] [--drop 0.02] [--start 1700006300] [--seed 1]
+
+#include "RawFile.h"
+
+#include "../AudioSystem.h"
+#include "../Config.h"
+#include "../FileWriter.hpp"
+#include "../SpectrumSummary.h"
+#include "../host/HostEnvironment.h"
+#include "../noise_floor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+using Layout = AudioSystem::Layout;
+
+constexpr float emptyBin = -120; // dBFS of the FFT bins outside of the recorded range
+
+struct Options
+{
+    std::string input;
+    std::string directory;
+    size_t passes = 3;
+    double drop = 0.02; // probability of a frame not reaching the writer
+    uint32_t start = 1700006300; // RTC at the first frame, 100 s before a UTC midnight
+    unsigned seed = 1;
+};
+
+/// what the writer got of a frame
+struct Frame
+{
+    uint32_t time;
+    uint64_t sequence;
+    std::vector<uint8_t> levels;
+    uint8_t binsWithSignal[2];
+    bool afterClose; // first frame after FileWriter::close()
+};
+
+struct Expected
+{
+    uint32_t start = 0;
+    uint64_t firstSequence = 0;
+    uint64_t lastSequence = 0;
+    uint32_t frames = 0;
+    uint32_t framesWithSignal[2] = {};
+    uint32_t binsWithSignal[2] = {};
+    uint8_t maxBinsWithSignal[2] = {};
+    std::vector<uint8_t> lowest;
+    std::vector<uint8_t> mean;
+    std::vector<uint8_t> highest;
+};
+
+/// the summary of frames [first, end) computed directly from the stored levels
+Expected summarize(std::vector<Frame> const& frames, size_t first, size_t end, uint32_t start)
+{
+    Expected expected;
+    expected.start = start;
+    expected.firstSequence = frames[first].sequence;
+    expected.lastSequence = frames[end - 1].sequence;
+    expected.frames = uint32_t(end - first);
+    for(size_t n = first; n < end; n++)
+    {
+        for(size_t direction = 0; direction < 2; direction++)
+        {
+            uint8_t const bins = frames[n].binsWithSignal[direction];
+            expected.framesWithSignal[direction] += bins > 0;
+            expected.binsWithSignal[direction] += bins;
+            expected.maxBinsWithSignal[direction] = std::max(expected.maxBinsWithSignal[direction], bins);
+        }
+    }
+
+    size_t const binCount = frames[first].levels.size();
+    for(size_t bin = 0; bin < binCount; bin++)
+    {
+        std::vector<uint8_t> column;
+        for(size_t n = first; n < end; n++)
+            column.push_back(frames[n].levels[bin]);
+        uint64_t sum = 0;
+        for(uint8_t level : column)
+            sum += level;
+        expected.lowest.push_back(*std::max_element(column.begin(), column.end()));
+        expected.highest.push_back(*std::min_element(column.begin(), column.end()));
+        expected.mean.push_back(uint8_t((sum + column.size() / 2) / column.size()));
+    }
+    return expected;
+}
+
+/// the records one tier should have written, in order
+std::vector<Expected> expectedRecords(std::vector<Frame> const& frames, uint32_t windowSeconds)
+{
+    std::vector<Expected> records;
+    size_t first = 0;
+    for(size_t n = 1; n <= frames.size(); n++)
+    {
+        uint32_t const start = frames[first].time / windowSeconds * windowSeconds;
+        if(n < frames.size() && not frames[n].afterClose && frames[n].time / windowSeconds * windowSeconds == start)
+            continue;
+        records.push_back(summarize(frames, first, n, start));
+        first = n;
+    }
+    return records;
+}
+
+bool equal(SpectrumSummary::Record const& record, Expected const& expected, size_t binCount)
+{
+    return record.start == expected.start && record.firstSequence == expected.firstSequence &&
+           record.lastSequence == expected.lastSequence && record.frames == expected.frames &&
+           record.framesWithSignal == expected.framesWithSignal[0] &&
+           record.framesWithSignalReverse == expected.framesWithSignal[1] &&
+           record.binsWithSignal == expected.binsWithSignal[0] &&
+           record.binsWithSignalReverse == expected.binsWithSignal[1] &&
+           record.maxBinsWithSignal == expected.maxBinsWithSignal[0] &&
+           record.maxBinsWithSignalReverse == expected.maxBinsWithSignal[1] &&
+           std::memcmp(record.lowest, expected.lowest.data(), binCount) == 0 &&
+           std::memcmp(record.mean, expected.mean.data(), binCount) == 0 &&
+           std::memcmp(record.highest, expected.highest.data(), binCount) == 0;
+}
+
+/// the files of one tier in the order they were written against the expected records
+bool checkTier(Config const& config, size_t tier, std::vector<Frame> const& frames)
+{
+    uint32_t const windowSeconds = config.summaryWindowSeconds[tier];
+    auto const expected = expectedRecords(frames, windowSeconds);
+    std::string const suffix = "_" + std::to_string(windowSeconds) + "s.sum";
+
+    size_t next = 0; // expected record
+    size_t files = 0;
+    for(auto const& file : HostEnvironment::sdFiles())
+    {
+        auto const& name = file.first;
+        if(name.size() < suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        files++;
+
+        auto const& data = *file.second;
+        SpectrumSummary::Header header;
+        if(not SpectrumSummary::readHeader(data.data(), data.size(), header) || header.windowSeconds != windowSeconds ||
+           header.binCount != Layout::numberOfFftBins ||
+           header.recordSize != SpectrumSummary::recordSize(header.binCount))
+        {
+            std::printf("  %s: wrong header\n", name.c_str());
+            return false;
+        }
+
+        size_t const count = SpectrumSummary::recordCount(data.data(), data.size());
+        if(count == 0 || next >= expected.size() || header.anchor.sequence != expected[next].firstSequence)
+        {
+            std::printf("  %s: anchor at sequence %llu, expected %llu\n",
+                        name.c_str(),
+                        (unsigned long long)header.anchor.sequence,
+                        next < expected.size() ? (unsigned long long)expected[next].firstSequence : 0ull);
+            return false;
+        }
+        uint32_t const secondsPerFile = config.summarySecondsPerFile > 0 ? config.summarySecondsPerFile : UINT32_MAX;
+        uint32_t const period = expected[next].start / secondsPerFile;
+        for(size_t i = 0; i < count; i++, next++)
+        {
+            auto const record =
+                SpectrumSummary::readRecord(&data[header.headerSize + i * header.recordSize], header.binCount);
+            if(next >= expected.size() || not equal(record, expected[next], header.binCount) ||
+               record.start / secondsPerFile != period)
+            {
+                std::printf("  %s: record %zu (window at %u) differs from the frames of its window\n",
+                            name.c_str(),
+                            i,
+                            unsigned(record.start));
+                return false;
+            }
+        }
+    }
+
+    std::printf("%us windows: %zu files, %zu records, %zu expected\n",
+                unsigned(windowSeconds),
+                files,
+                next,
+                expected.size());
+    return next == expected.size();
+}
+
+bool writeFile(std::string const& name, std::vector<uint8_t> const& data)
+{
+    std::ofstream output(name, std::ios::binary);
+    output.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return bool(output);
+}
+
+class StdoutPrint : public Print
+{
+  public:
+    size_t write(uint8_t c) override { return std::fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+/// the globals of sensor.ino that are needed for analysing and writing
+struct Sensor
+{
+    Config config;
+    FileWriter fileWriter;
+    AudioSystem::Results results;
+    NoiseFloorEstimator<Layout> noiseFloor;
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> <dir> [--passes 3] [--drop 0.02] [--start 1700006300] [--seed 1]" << std::endl;
+        return 1;
+    }
+
+    Options options;
+    options.input = argv[1];
+    options.directory = argv[2];
+    for(int i = 3; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(i + 1 < argc && option == "--passes")
+            options.passes = std::strtoul(argv[++i], nullptr, 10);
+        else if(i + 1 < argc && option == "--drop")
+            options.drop = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--start")
+            options.start = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        else if(i + 1 < argc && option == "--seed")
+            options.seed = unsigned(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(options.input))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+    if(raw.header().binCount != Layout::numberOfFftBins || raw.frameCount() == 0)
+    {
+        std::cerr << options.input << " has " << raw.header().binCount << " bins, the tool was built for "
+                  << Layout::numberOfFftBins << std::endl;
+        return 1;
+    }
+
+    // like on the device the writer is too large for the stack
+    static Sensor sensor;
+    auto& results = sensor.results;
+    std::mt19937 random(options.seed);
+    std::bernoulli_distribution dropFrame(options.drop);
+    sensor.fileWriter.setupSpi();
+    sensor.fileWriter.setupSdCard();
+    HostEnvironment::setMillis(0);
+    HostEnvironment::setTime(options.start);
+
+    // the passes follow each other like one long recording, one frame period apart
+    std::vector<Frame> frames;
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+    uint32_t const framePeriodMs = Layout::framePeriodMicros / 1000;
+    uint32_t const recordedMs = raw.timestamp(raw.frameCount() - 1) - raw.timestamp(0) + framePeriodMs;
+    // the sample clock of a pass, at least one hop per frame for recordings without sequence numbers
+    uint64_t const passHops =
+        std::max<uint64_t>(uint64_t(recordedMs) * Layout::sampleRate / 1000 / Layout::fftHop + 1, raw.frameCount());
+    size_t const closeAt = options.passes * raw.frameCount() / 2;
+    size_t dropped = 0;
+    bool closed = false;
+    for(size_t pass = 0; pass < options.passes; pass++)
+    {
+        for(size_t i = 0; i < raw.frameCount(); i++)
+        {
+            if(not raw.readDbfs(i, fft.data() + Layout::minBinIndex))
+                continue;
+
+            uint32_t const ms = uint32_t(pass) * recordedMs + raw.timestamp(i) - raw.timestamp(0);
+            HostEnvironment::setMillis(ms);
+            sensor.fileWriter.service();
+
+            results.timestamp = ms;
+            // frames of version 4 files keep their sample clock, older ones count from 1
+            uint64_t const sequence = raw.sequence(i) > 0 ? raw.sequence(i) : i + 1;
+            results.sequence = sequence + pass * passHops;
+            results.captureTime = {options.start + ms / 1000, ms % 1000 * 1000};
+            results.process(fft.data(), sensor.noiseFloor, sensor.config.audio.noise_floor_distance_threshold);
+            if(dropFrame(random))
+            {
+                dropped++;
+                continue;
+            }
+
+            bool afterClose = false;
+            if(not closed && frames.size() >= closeAt)
+            {
+                sensor.fileWriter.close();
+                closed = afterClose = true;
+            }
+
+            sensor.fileWriter.writeSummaryData(results, sensor.config);
+            Frame frame{results.captureTime.seconds, results.sequence, {}, {}, afterClose};
+            for(size_t bin = 0; bin < results.numberOfFftBins; bin++)
+                frame.levels.push_back(SpectrumSummary::quantize(results.spectrum[bin]));
+            frame.binsWithSignal[0] = results.bins_with_signal;
+            frame.binsWithSignal[1] = results.bins_with_signal_reverse;
+            frames.push_back(std::move(frame));
+        }
+    }
+    sensor.fileWriter.close();
+    std::printf("%zu frames, %zu dropped, %.1f s from %u\n",
+                frames.size(),
+                dropped,
+                frames.empty() ? 0.0 : (frames.back().time - frames.front().time + 1) * 1.0,
+                unsigned(options.start));
+
+    for(auto const& file : HostEnvironment::sdFiles())
+    {
+        if(not writeFile(options.directory + "/" + file.first, *file.second))
+        {
+            std::cerr << "Unable to write into " << options.directory << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = not frames.empty();
+    for(size_t tier = 0; tier < SpectrumSummary::tierCount; tier++)
+        if(sensor.config.summaryWindowSeconds[tier] > 0)
+            ok = checkTier(sensor.config, tier, frames) && ok;
+
+    StdoutPrint out;
+    sensor.fileWriter.printStatistics(out);
+    std::printf("%s\n", ok ? "all summaries match" : "FAILED");
+    return ok ? 0 : 2;
+}
@@ -0,0 +1,259 @@
+// Replays the spectra of a raw file (any raw file version, see RawFile.h) through the analysis of the sensor and the
+// passage tracker (see Tracking.h) and lists the passages it reports, as the sensor writes them to its .evt file. The
+// FFT width is derived from the bin count in the file header.
+//
+// With --metrics the passages are also counted in a metrics csv table of the same recording the way triggerreplay
+// does: a run of frames with at least --passage-bins bins with signal in either direction, runs closer than
+// --passage-gap ms merged. The tool fails with exit code 2 if the two counts differ by more than --tolerance.
+//
+// usage: trackreplay <input.bin> [--float | --bytes] [--threshold 8] [--start-strength 15] [--max-gap 400]
+//                    [--min-frames 3] [--metrics metrics.csv] [--passage-bins 1] [--passage-gap 500] [--tolerance 0]
+
+#include "RawFile.h"
+
+#include "../AudioResults.h"
+#include "../SpectrumLayout.h"
+#include "../Tracking.h"
+#include "../noise_floor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr float emptyBin = -120; // dBFS of the FFT bins outside of the recorded range
+
+struct Options
+{
+    RawFile::Layout layout = RawFile::Layout::Unknown;
+    float threshold = 8;
+    Tracking::Tracker::Settings tracker;
+    std::string metricsName;
+    uint8_t passageBins = 1;
+    uint32_t passageGap = 500;
+    size_t tolerance = 0;
+};
+
+/// passages in a metrics csv table, counted like triggerreplay does; false if the table cannot be read
+bool countPassages(std::string const& name, Options const& options, size_t& passages)
+{
+    std::ifstream input(name);
+    std::string line;
+    if(not input || not std::getline(input, line))
+        return false;
+
+    std::map<std::string, size_t> columns;
+    {
+        std::stringstream header(line);
+        std::string column;
+        for(size_t i = 0; std::getline(header, column, ','); i++)
+        {
+            column.erase(0, column.find_first_not_of(" \t"));
+            column.erase(column.find_last_not_of(" \t\r") + 1);
+            columns[column] = i;
+        }
+    }
+    for(auto const* column : {"timestamp", "bins_with_signal", "bins_with_signal_reverse"})
+        if(columns.count(column) == 0)
+        {
+            std::cerr << "Missing column " << column << std::endl;
+            return false;
+        }
+
+    passages = 0;
+    bool inPassage = false;
+    uint32_t lastSignal = 0;
+    std::vector<double> values;
+    while(std::getline(input, line))
+    {
+        values.clear();
+        std::stringstream row(line);
+        std::string cell;
+        while(std::getline(row, cell, ','))
+            values.push_back(std::atof(cell.c_str()));
+        if(values.size() < columns.size())
+            continue; // truncated last line
+
+        auto const timestamp = uint32_t(values[columns["timestamp"]]);
+        bool const hasSignal = values[columns["bins_with_signal"]] >= options.passageBins ||
+                               values[columns["bins_with_signal_reverse"]] >= options.passageBins;
+        if(not hasSignal)
+            continue;
+        if(not inPassage || timestamp - lastSignal > options.passageGap)
+            passages++;
+        inPassage = true;
+        lastSignal = timestamp;
+    }
+    return true;
+}
+
+template <class Layout>
+int replay(RawFile& raw, Options const& options)
+{
+    // the results are as large as on the sensor, too large for the stack with the wide layouts
+    auto const results = std::unique_ptr<AudioResults<Layout>>(new AudioResults<Layout>());
+    NoiseFloorEstimator<Layout> noiseFloor;
+    Tracking::Tracker tracker;
+    tracker.setSettings(options.tracker);
+
+    // the analysis expects the complete FFT output, the raw file only holds the analysed range
+    std::vector<float> fft(Layout::fftWidth, emptyBin);
+
+    size_t frames = 0;
+    size_t counts[2][3] = {};
+    auto const report = [&tracker, &counts]() {
+        Tracking::Event event;
+        while(tracker.nextEvent(event))
+        {
+            std::printf(
+                "%8u - %8u ms %-7s %-10s peak %5.1f m/s, median %5.1f m/s, %5.1f dB, %u frames\n",
+                event.start,
+                event.end,
+                Tracking::directionName(event.direction),
+                Tracking::categoryName(event.category),
+                event.peakSpeed,
+                event.medianSpeed,
+                event.strength,
+                unsigned(event.frames));
+            counts[size_t(event.direction)][size_t(event.category)]++;
+        }
+    };
+
+    for(size_t frame = 0; frame < raw.frameCount(); frame++)
+    {
+        if(not raw.readDbfs(frame, fft.data() + Layout::minBinIndex))
+            continue; // after damaged data, up to the next key frame
+        uint32_t const timestamp = raw.timestamp(frame);
+        results->process(fft.data(), noiseFloor, options.threshold);
+
+        Tracking::Detection forward[Tracking::maxPeaks];
+        Tracking::Detection reverse[Tracking::maxPeaks];
+        tracker.update(
+            timestamp, forward, results->detections(false, forward), reverse, results->detections(true, reverse));
+        report();
+        frames++;
+    }
+    tracker.finish();
+    report();
+
+    auto const& stats = tracker.statistics();
+    std::printf(
+        "%u point FFT%s, %zu frames, %u passages, %u too short, %u peaks without a free track\n",
+        unsigned(Layout::fftWidth),
+        Layout::iqMeasurement ? " (IQ)" : "",
+        frames,
+        stats.events,
+        stats.dropped,
+        stats.noFreeTrack);
+    for(size_t direction = 0; direction < 2; direction++)
+        std::printf(
+            "  %-7s pedestrians %zu, cyclists %zu, vehicles %zu\n",
+            Tracking::directionName(Tracking::Direction(direction)),
+            counts[direction][size_t(Tracking::Category::Pedestrian)],
+            counts[direction][size_t(Tracking::Category::Cyclist)],
+            counts[direction][size_t(Tracking::Category::Vehicle)]);
+
+    if(options.metricsName.empty())
+        return 0;
+
+    size_t passages = 0;
+    if(not countPassages(options.metricsName, options, passages))
+    {
+        std::cerr << "Unable to read " << options.metricsName << std::endl;
+        return 1;
+    }
+    size_t const difference = passages > stats.events ? passages - stats.events : stats.events - passages;
+    std::printf("metrics table: %zu passages, difference %zu\n", passages, difference);
+    return difference <= options.tolerance ? 0 : 2;
+}
+
+template <class... Layouts>
+struct LayoutList
+{};
+
+int replay(RawFile& raw, Options const&, LayoutList<>)
+{
+    std::cerr << "No FFT layout with " << raw.header().binCount << " bins"
+              << (raw.header().iqMeasurement ? " (IQ)" : "") << std::endl;
+    return 1;
+}
+
+/// the file header only has the bin count, which is unique per IQ mode for the default speeds of SpectrumLayout
+template <class Layout, class... Rest>
+int replay(RawFile& raw, Options const& options, LayoutList<Layout, Rest...>)
+{
+    if(Layout::numberOfFftBins == raw.header().binCount && Layout::iqMeasurement == raw.header().iqMeasurement)
+        return replay<Layout>(raw, options);
+    return replay(raw, options, LayoutList<Rest...>());
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <input.bin> [--float | --bytes] [--threshold 8] [--start-strength 15] [--max-gap 400]"
+                     " [--min-frames 3] [--metrics file] [--passage-bins 1] [--passage-gap 500] [--tolerance 0]"
+                  << std::endl;
+        return 1;
+    }
+
+    Options options;
+    for(int i = 2; i < argc; i++)
+    {
+        std::string const option = argv[i];
+        if(option == "--float")
+            options.layout = RawFile::Layout::Floats;
+        else if(option == "--bytes")
+            options.layout = RawFile::Layout::Bytes;
+        else if(i + 1 < argc && option == "--threshold")
+            options.threshold = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--start-strength")
+            options.tracker.startStrength = std::atof(argv[++i]);
+        else if(i + 1 < argc && option == "--max-gap")
+            options.tracker.maxGapMs = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--min-frames")
+            options.tracker.minFrames = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--metrics")
+            options.metricsName = argv[++i];
+        else if(i + 1 < argc && option == "--passage-bins")
+            options.passageBins = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--passage-gap")
+            options.passageGap = std::atoi(argv[++i]);
+        else if(i + 1 < argc && option == "--tolerance")
+            options.tolerance = std::atoi(argv[++i]);
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    RawFile raw;
+    if(not raw.open(argv[1], options.layout))
+    {
+        std::cerr << raw.error() << std::endl;
+        return 1;
+    }
+
+    return replay(
+        raw,
+        options,
+        LayoutList<
+            SpectrumLayout<256, false>,
+            SpectrumLayout<256, true>,
+            SpectrumLayout<512, false>,
+            SpectrumLayout<512, true>,
+            SpectrumLayout<1024, false>,
+            SpectrumLayout<1024, true>,
+            SpectrumLayout<2048, false>,
+            SpectrumLayout<2048, true>>());
+}
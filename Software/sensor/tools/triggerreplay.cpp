@@ -0,0 +1,218 @@
+// Replays a metrics csv table (as written by the sensor or by metrics2csv) through the event trigger of the raw
+// capture (see EventCapture.h) and checks that every vehicle passage in the table would have been recorded.
+//
+// A passage is a run of frames with at least --passage-bins bins with signal in either direction; runs closer than
+// --passage-gap ms are merged. It is lost if any of its frames is outside of the recorded event segments.
+//
+// usage: triggerreplay <metrics.csv> [--amplitude 100] [--bins 0] [--cool-down 1000] [--pre-trigger 3000]
+//                      [--frame-bytes 1028] [--passage-bins 1] [--passage-gap 500]
+
+#include "../EventCapture.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t historyStorageSize = 48 * 1024; // FileWriter::historyStorage with triggerRawData
+
+struct Frame
+{
+    uint32_t timestamp;
+    float meanAmplitude;
+    float meanAmplitudeReverse;
+    uint8_t binsWithSignal;
+    uint8_t binsWithSignalReverse;
+    bool recorded = false;
+};
+
+bool readCsv(std::istream& input, std::vector<Frame>& frames)
+{
+    std::string line;
+    if(not std::getline(input, line))
+        return false;
+
+    std::map<std::string, size_t> columns;
+    {
+        std::stringstream header(line);
+        std::string name;
+        for(size_t i = 0; std::getline(header, name, ','); i++)
+        {
+            name.erase(0, name.find_first_not_of(" \t"));
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+            columns[name] = i;
+        }
+    }
+    char const* required[] = {"timestamp",
+                              "mean_amplitude",
+                              "mean_amplitude_reverse",
+                              "bins_with_signal",
+                              "bins_with_signal_reverse"};
+    for(auto const* name : required)
+        if(columns.count(name) == 0)
+        {
+            std::cerr << "Missing column " << name << std::endl;
+            return false;
+        }
+
+    std::vector<double> values;
+    while(std::getline(input, line))
+    {
+        values.clear();
+        std::stringstream row(line);
+        std::string cell;
+        while(std::getline(row, cell, ','))
+            values.push_back(std::atof(cell.c_str()));
+        if(values.size() < columns.size())
+            continue; // truncated last line
+
+        Frame frame;
+        frame.timestamp = uint32_t(values[columns["timestamp"]]);
+        frame.meanAmplitude = float(values[columns["mean_amplitude"]]);
+        frame.meanAmplitudeReverse = float(values[columns["mean_amplitude_reverse"]]);
+        frame.binsWithSignal = uint8_t(values[columns["bins_with_signal"]]);
+        frame.binsWithSignalReverse = uint8_t(values[columns["bins_with_signal_reverse"]]);
+        frames.push_back(frame);
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2 || argc % 2 != 0)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <metrics.csv> [--amplitude 100] [--bins 0] [--cool-down 1000] [--pre-trigger 3000]"
+                     " [--frame-bytes 1028] [--passage-bins 1] [--passage-gap 500]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, double> options = {
+        {"--amplitude", 100},
+        {"--bins", 0},
+        {"--cool-down", 1000},
+        {"--pre-trigger", 3000},
+        {"--frame-bytes", 4 + 1024},
+        {"--passage-bins", 1},
+        {"--passage-gap", 500},
+    };
+    for(int i = 2; i + 1 < argc; i += 2)
+    {
+        if(options.count(argv[i]) == 0)
+        {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+        options[argv[i]] = std::atof(argv[i + 1]);
+    }
+
+    std::ifstream input(argv[1]);
+    std::vector<Frame> frames;
+    if(not input || not readCsv(input, frames))
+    {
+        std::cerr << "Unable to read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    EventCapture::Trigger::Settings settings;
+    settings.amplitude = float(options["--amplitude"]);
+    settings.binsWithSignal = uint8_t(options["--bins"]);
+    settings.coolDownMs = uint32_t(options["--cool-down"]);
+    EventCapture::Trigger trigger;
+    trigger.setSettings(settings);
+
+    // the history holds the timestamp and the frame index instead of the spectrum, but as many frames as the sensor
+    constexpr size_t replayFrameSize = 8;
+    size_t const historyFrames = historyStorageSize / (size_t(options["--frame-bytes"]) + 1);
+    std::vector<uint8_t> storage(historyFrames * (replayFrameSize + 1));
+    EventCapture::FrameHistory history(storage.data(), storage.size());
+    history.reset(replayFrameSize);
+
+    auto const preTrigger = uint32_t(options["--pre-trigger"]);
+    for(uint32_t i = 0; i < frames.size(); i++)
+    {
+        Frame const& frame = frames[i];
+        auto const state = trigger.update(
+            frame.timestamp,
+            frame.meanAmplitude,
+            frame.meanAmplitudeReverse,
+            frame.binsWithSignal,
+            frame.binsWithSignalReverse);
+
+        if(state == EventCapture::Trigger::State::Start)
+            history.startEvent(frame.timestamp - preTrigger);
+
+        uint8_t entry[replayFrameSize];
+        std::memcpy(entry, &frame.timestamp, 4);
+        std::memcpy(entry + 4, &i, 4);
+        history.push(entry, state != EventCapture::Trigger::State::Quiet);
+
+        // the card is assumed to keep up, so queued frames leave the history right away
+        bool startsEvent = false;
+        while(uint8_t const* queued = history.front(startsEvent))
+        {
+            uint32_t index;
+            std::memcpy(&index, queued + 4, 4);
+            frames[index].recorded = true;
+            history.pop();
+        }
+    }
+
+    size_t recorded = 0;
+    for(auto const& frame : frames)
+        recorded += frame.recorded;
+
+    auto const passageBins = uint8_t(options["--passage-bins"]);
+    auto const passageGap = uint32_t(options["--passage-gap"]);
+    size_t passages = 0;
+    size_t lost = 0;
+    for(size_t i = 0; i < frames.size();)
+    {
+        auto const hasSignal = [&](Frame const& frame) {
+            return frame.binsWithSignal >= passageBins || frame.binsWithSignalReverse >= passageBins;
+        };
+        if(not hasSignal(frames[i]))
+        {
+            i++;
+            continue;
+        }
+
+        size_t end = i + 1; // one past the last frame with signal of this passage
+        for(size_t j = end; j < frames.size() && frames[j].timestamp - frames[end - 1].timestamp <= passageGap; j++)
+            if(hasSignal(frames[j]))
+                end = j + 1;
+
+        bool complete = true;
+        for(size_t j = i; j < end; j++)
+            complete = complete && frames[j].recorded;
+
+        passages++;
+        if(not complete)
+        {
+            lost++;
+            std::printf("lost passage %u - %u ms\n", frames[i].timestamp, frames[end - 1].timestamp);
+        }
+        i = end;
+    }
+
+    std::printf(
+        "%zu frames, %zu recorded (%.1f %%), %u events, %zu passages, %zu lost, %u frames lost in the history\n",
+        frames.size(),
+        recorded,
+        frames.empty() ? 0.0 : 100.0 * recorded / frames.size(),
+        trigger.eventCount(),
+        passages,
+        lost,
+        history.lostFrames());
+
+    return lost == 0 ? 0 : 2;
+}